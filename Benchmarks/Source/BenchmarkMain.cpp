@@ -0,0 +1,792 @@
+/*
+  ==============================================================================
+
+    BenchmarkMain.cpp
+
+    Headless benchmark for EasyAudioMarker. Generates synthetic fixtures,
+    times the hot paths of WaveMarkerComp, the take aligner, the QC sweep,
+    the playback resampler, the preview chain, the denoiser, A/B
+    comparison lanes, region queries and decode-to-RAM, and writes the
+    results as JSON.
+
+    EasyAudioMarkerBenchmark [--seconds 600] [--channels 2] [--rate 48000]
+                             [--markers 1000] [--format wav|flac|both]
+                             [--iterations 5] [--workdir <dir>]
+                             [--out results.json] [--thresholds thresholds.json]
+                             [--remote-base http://localhost:8000] [--large]
+
+    With --remote-base the fixtures are also opened over HTTP from that base
+    URL, e.g. served from the work dir by Benchmarks/range_server.py.
+
+    --large adds runs on an 8 GB file (2^31 + 48000 stereo frames, past
+    what 32-bit sizes and sample counts can hold) as RF64 and as Wave64.
+    It is written sparse, so needs little disk space on most file systems.
+
+    Exit code is 1 when a metric exceeds its threshold, 2 on setup failure.
+
+  ==============================================================================
+*/
+
+#include "SyntheticFixtures.h"
+#include "../../Source/TakeAligner.h"
+#include "../../Source/QcAnalyzer.h"
+#include "../../Source/PreviewChain.h"
+#include "../../Source/SpectralDenoiser.h"
+#include "../../Source/WavCueChunks.h"
+#include "../../Source/CompareLanes.h"
+#include "../../Source/SidecarMerge.h"
+#include "../../Source/RegionIndex.h"
+#include "../../Source/RamAudioStore.h"
+
+
+using namespace juce;
+
+
+namespace
+{
+  String getOption (const StringArray& args, const String& name, const String& defaultValue)
+  {
+    const int i = args.indexOf (name);
+    if (i >= 0 && i + 1 < args.size())
+      return args[i + 1];
+    return defaultValue;
+  }
+
+  File getFileOption (const StringArray& args, const String& name, const File& defaultValue = {})
+  {
+    auto path = getOption (args, name, {});
+    if (path.isEmpty())
+      return defaultValue;
+    return File::getCurrentWorkingDirectory().getChildFile (path);
+  }
+
+  double median (Array<double> values)
+  {
+    if (values.isEmpty())
+      return 0.0;
+    values.sort();
+    return values[values.size() / 2];
+  }
+
+  // Blocks until the predicate holds, or gives up after timeoutMs. Returns elapsed ms, or -1 on timeout.
+  template <typename Predicate>
+  double waitFor (Predicate predicate, double startMs, double timeoutMs)
+  {
+    while (! predicate())
+    {
+      if (Time::getMillisecondCounterHiRes() - startMs > timeoutMs)
+        return -1.0;
+      Thread::sleep (1);
+    }
+    return Time::getMillisecondCounterHiRes() - startMs;
+  }
+
+
+  // one core's time spent per channel converting 44.1 kHz to 48 kHz in real time, in percent
+  void measureResampler (NamedValueSet& results)
+  {
+    const double seconds = 10.0, inputRate = 44100.0, outputRate = 48000.0;
+    const int blockSize = 512;
+
+    HeapBlock<float> input ((size_t) (seconds * inputRate) + 1024, true);
+    Random random (1);
+    for (int i = 0; i < (int) (seconds * inputRate); ++i)
+      input[i] = random.nextFloat() - 0.5f;
+
+    HeapBlock<float> output ((size_t) blockSize);
+    const auto names = StringArray { "fast", "balanced", "best" };
+
+    for (int q = 0; q < names.size(); ++q)
+    {
+      PolyphaseResampler resampler ((PolyphaseResampler::Quality) (q + 1), inputRate / outputRate);
+      const int numOutput = (int) ((seconds - 0.1) * outputRate);
+
+      const auto start = Time::getMillisecondCounterHiRes();
+      for (int n = 0; n < numOutput; n += blockSize)
+        resampler.process (input, n * (inputRate / outputRate), output, jmin (blockSize, numOutput - n));
+      const double elapsed = Time::getMillisecondCounterHiRes() - start;
+
+      results.set ("resample_" + names[q] + "_cpu_pct", elapsed / (seconds * 1000.0) * 100.0);
+    }
+  }
+
+
+  struct NoiseSource : public AudioSource
+  {
+    void prepareToPlay (int, double) override {}
+    void releaseResources() override {}
+
+    void getNextAudioBlock (const AudioSourceChannelInfo& info) override
+    {
+      for (int ch = 0; ch < info.buffer->getNumChannels(); ++ch)
+        for (int i = 0; i < info.numSamples; ++i)
+          info.buffer->setSample (ch, info.startSample + i, (random.nextFloat() - 0.5f) * 0.7f);
+    }
+
+    Random random { 1 };
+  };
+
+  // one core's time spent on stereo 48 kHz through high-pass, EQ and compressor, in percent
+  void measurePreviewChain (NamedValueSet& results)
+  {
+    const double seconds = 10.0, rate = 48000.0;
+    const int blockSize = 512;
+
+    NoiseSource noise;
+    PreviewChain chain (&noise);
+    chain.prepareToPlay (blockSize, rate);
+    chain.insertNode (PreviewNode::Type::highPass);
+    chain.insertNode (PreviewNode::Type::equalizer)->getParameters()[2]->setValue (0.75f);   // mid band +6 dB
+    chain.insertNode (PreviewNode::Type::compressor);
+
+    AudioBuffer<float> buffer (2, blockSize);
+    const AudioSourceChannelInfo info (buffer);
+
+    // the noise itself is not timed
+    double elapsed = 0;
+    for (int n = 0; n < (int) (seconds * rate); n += blockSize)
+    {
+      noise.getNextAudioBlock (info);
+      const auto start = Time::getMillisecondCounterHiRes();
+      for (int i = 0; i < chain.getNumNodes(); ++i)
+      {
+        MidiBuffer midi;
+        chain.getNode (i)->processBlock (buffer, midi);
+      }
+      elapsed += Time::getMillisecondCounterHiRes() - start;
+    }
+
+    results.set ("preview_chain_cpu_pct", elapsed / (seconds * 1000.0) * 100.0);
+  }
+
+  // one core's time spent denoising stereo 48 kHz with a profile of the same noise, in percent
+  void measureDenoiser (NamedValueSet& results)
+  {
+    const double seconds = 10.0, rate = 48000.0;
+    const int blockSize = 512;
+
+    NoiseSource noise;
+    AudioBuffer<float> buffer (2, (int) rate);
+    noise.getNextAudioBlock (AudioSourceChannelInfo (buffer));
+
+    auto profile = SpectralDenoiser::Profile::create (buffer, rate);
+    SpectralDenoiser denoiser (2, rate, *profile, 18.0f);
+
+    double elapsed = 0;
+    for (int n = 0; n < (int) (seconds * rate); n += blockSize)
+    {
+      AudioSourceChannelInfo info (&buffer, 0, blockSize);
+      noise.getNextAudioBlock (info);
+
+      const auto start = Time::getMillisecondCounterHiRes();
+      denoiser.process (buffer.getArrayOfWritePointers(), blockSize);
+      elapsed += Time::getMillisecondCounterHiRes() - start;
+    }
+
+    results.set ("denoise_cpu_pct", elapsed / (seconds * 1000.0) * 100.0);
+  }
+
+
+  // 100k regions over two hours: what one frame asks of them (the regions under the
+  // playhead, and those in a one minute view), in microseconds; -1 if an answer is wrong
+  void measureRegions (NamedValueSet& results)
+  {
+    const int numRegions = 100000, numQueries = 1000;
+    const double length = 7200.0;
+
+    RegionIndex index;
+    Array<MarkerRegion> all;
+    Random random (1);
+    for (int i = 0; i < numRegions; ++i)
+    {
+      const double start = random.nextDouble() * length;
+      all.add ({ start, start + 0.5 + random.nextDouble() * 60.0, "region " + String (i), i + 1 });
+      index.add (all.getReference (i));
+    }
+
+    // the first query builds the tree
+    Array<const MarkerRegion*> found;
+    auto start = Time::getMillisecondCounterHiRes();
+    index.getRegionsAt (0.0, found);
+    results.set ("region_build_ms", Time::getMillisecondCounterHiRes() - start);
+
+    bool ok = true;
+    double elapsed = 0;
+    for (int q = 0; q < numQueries; ++q)
+    {
+      const double time = random.nextDouble() * length;
+      const Range<double> view (time, time + 60.0);
+
+      start = Time::getMillisecondCounterHiRes();
+      index.getRegionsAt (time, found);
+      const int atTime = found.size();
+      index.getRegionsOverlapping (view, found);
+      elapsed += Time::getMillisecondCounterHiRes() - start;
+
+      // checked against a scan now and then
+      if (q % 100 == 0)
+      {
+        int expectedAt = 0, expectedInView = 0;
+        for (auto& r : all)
+        {
+          expectedAt += r.start <= time && time < r.end ? 1 : 0;
+          expectedInView += r.start < view.getEnd() && view.getStart() < r.end ? 1 : 0;
+        }
+        ok = ok && atTime == expectedAt && found.size() == expectedInView;
+      }
+    }
+
+    results.set ("region_query_us", ok ? elapsed * 1000.0 / numQueries : -1.0);
+  }
+
+
+  struct BenchmarkRun
+  {
+    BenchmarkRun (const File& f) : file (f)
+    {
+      Wave64AudioFormat::registerFormats (formatManager);
+    }
+
+    void measure (int iterations, NamedValueSet& results)
+    {
+      Array<double> open, firstWave, fullPeaks, load, save, search, cursor, paint, denseCursor, densePaint;
+      File sidecar (file.getFullPathName() + MarkerFilesExt);
+      TemporaryFile sidecarBackup (sidecar);
+      sidecar.copyFileTo (sidecarBackup.getFile());
+
+      for (int it = 0; it < iterations; ++it)
+      {
+        // file open: format sniffing + header parsing
+        {
+          auto start = Time::getMillisecondCounterHiRes();
+          ScopedPointer<AudioFormatReader> reader (formatManager.createReaderFor (file));
+          open.add (Time::getMillisecondCounterHiRes() - start);
+        }
+
+        AudioTransportSource transportSource;
+        Slider zoomSlider;
+        WaveMarkerComp comp (formatManager, transportSource, zoomSlider);
+        comp.setBounds (0, 0, 1600, 400);
+
+        // peaks: no sidecar present so setURL does not also pay for loadMarkers
+        sidecar.deleteFile();
+        auto start = Time::getMillisecondCounterHiRes();
+        comp.setURL (URL (file));
+        firstWave.add (waitFor ([&] { return comp.getThumbnail().getNumSamplesFinished() > 0; }, start, 600000.0));
+        fullPeaks.add (waitFor ([&] { return comp.getThumbnail().isFullyLoaded(); }, start, 600000.0));
+
+        sidecarBackup.getFile().copyFileTo (sidecar);
+
+        start = Time::getMillisecondCounterHiRes();
+        comp.loadMarkers();
+        load.add (Time::getMillisecondCounterHiRes() - start);
+
+        start = Time::getMillisecondCounterHiRes();
+        comp.saveMarkers();
+        save.add (Time::getMillisecondCounterHiRes() - start);
+
+        // type-ahead: one search per keystroke, as the marker list panel does
+        const String typed ("marker 12");
+        Array<int> matches;
+        start = Time::getMillisecondCounterHiRes();
+        for (int i = 1; i <= typed.length(); ++i)
+          comp.getMarkerIndex().search (typed.substring (0, i), 0, MarkerIndex::MatchMode::substring, matches);
+        search.add ((Time::getMillisecondCounterHiRes() - start) / typed.length());
+
+        const int cursorRepeats = 20;
+        start = Time::getMillisecondCounterHiRes();
+        for (int i = 0; i < cursorRepeats; ++i)
+          comp.updateCursorPosition();
+        cursor.add ((Time::getMillisecondCounterHiRes() - start) / cursorRepeats);
+
+        Image image (Image::RGB, comp.getWidth(), comp.getHeight(), true);
+        Graphics g (image);
+        start = Time::getMillisecondCounterHiRes();
+        comp.paintEntireComponent (g, false);
+        paint.add (Time::getMillisecondCounterHiRes() - start);
+
+        // zoomed out on 100k markers: drawn as clusters, at a cost set by the width
+        Array<double> times;
+        StringArray titles;
+        Random random (1);
+        const double length = comp.getThumbnail().getTotalLength();
+        for (int i = 0; i < 100000; ++i)
+        {
+          times.add (random.nextDouble() * length);
+          titles.add ("dense " + String (i));
+        }
+        comp.addMarkers (times, titles);
+        comp.setRange ({ 0.0, length });
+
+        start = Time::getMillisecondCounterHiRes();
+        for (int i = 0; i < cursorRepeats; ++i)
+          comp.updateCursorPosition();
+        denseCursor.add ((Time::getMillisecondCounterHiRes() - start) / cursorRepeats);
+
+        start = Time::getMillisecondCounterHiRes();
+        comp.paintEntireComponent (g, false);
+        densePaint.add (Time::getMillisecondCounterHiRes() - start);
+        comp.undo();
+      }
+
+      sidecarBackup.getFile().copyFileTo (sidecar);
+
+      results.set ("open_ms",                 median (open));
+      results.set ("first_waveform_ms",       median (firstWave));
+      results.set ("full_peaks_ms",           median (fullPeaks));
+      results.set ("load_markers_ms",         median (load));
+      results.set ("save_markers_ms",         median (save));
+      results.set ("marker_search_ms",        median (search));
+      results.set ("update_cursor_ms",        median (cursor));
+      results.set ("paint_ms",                median (paint));
+      results.set ("dense_update_cursor_ms",  median (denseCursor));
+      results.set ("dense_paint_ms",          median (densePaint));
+    }
+
+    // marker transfer onto a copy with the first 1.2345 s trimmed off; -1 if the offset comes out wrong
+    void measureAlignment (NamedValueSet& results)
+    {
+      const double trim = 1.2345;
+      TemporaryFile trimmed (file.withFileExtension ("wav"));
+
+      {
+        ScopedPointer<AudioFormatReader> reader (formatManager.createReaderFor (file));
+        ScopedPointer<FileOutputStream> out (trimmed.getFile().createOutputStream());
+        WavAudioFormat wav;
+        ScopedPointer<AudioFormatWriter> writer (reader != nullptr && out != nullptr
+                                                   ? wav.createWriterFor (out, reader->sampleRate, reader->numChannels, 24, {}, 0)
+                                                   : nullptr);
+        if (writer == nullptr)
+        {
+          results.set ("align_ms", -1.0);
+          return;
+        }
+        out.release();
+
+        const int64 start = (int64) (trim * reader->sampleRate);
+        writer->writeFromAudioReader (*reader, start, reader->lengthInSamples - start);
+      }
+
+      TakeAligner aligner (file, trimmed.getFile(), {});
+      String error;
+      const auto start = Time::getMillisecondCounterHiRes();
+      const bool ok = aligner.run (nullptr, error);
+      const double elapsed = Time::getMillisecondCounterHiRes() - start;
+
+      results.set ("align_ms", ok && std::abs (aligner.getOffset() + trim) < 0.002 ? elapsed : -1.0);
+    }
+
+    // one QC sweep over the whole fixture, without touching its sidecar
+    void measureQc (NamedValueSet& results)
+    {
+      ScopedPointer<AudioFormatReader> reader (formatManager.createReaderFor (file));
+      if (reader == nullptr)
+      {
+        results.set ("qc_ms", -1.0);
+        return;
+      }
+
+      QcAnalyzer::FileResult result;
+      result.file = file;
+      const auto start = Time::getMillisecondCounterHiRes();
+      const bool ok = QcAnalyzer::analyse (*reader, {}, result);
+      results.set ("qc_ms", ok ? Time::getMillisecondCounterHiRes() - start : -1.0);
+    }
+
+    // reading back a sidecar another program changed in a few places, and finding those; -1 if they are not found
+    void measureSidecarMerge (NamedValueSet& results)
+    {
+      File sidecar (file.getFullPathName() + MarkerFilesExt);
+      Array<SidecarMerge::Marker> base;
+      if (! SidecarMerge::read (sidecar, base))
+      {
+        results.set ("sidecar_merge_ms", -1.0);
+        return;
+      }
+
+      // every 100th renamed, every 100th after that removed, and 10 added
+      XmlElement root ("Markers");
+      int expected = 10;
+      for (int i = 0; i < base.size(); ++i)
+      {
+        if (i % 100 == 1)
+        {
+          ++expected;
+          continue;
+        }
+
+        auto m = root.createNewChildElement ("Marker");
+        m->setAttribute ("Time", base[i].time);
+        m->setAttribute ("Title", i % 100 == 0 ? base[i].title + " (checked)" : base[i].title);
+        expected += i % 100 == 0 ? 1 : 0;
+      }
+      for (int i = 0; i < 10; ++i)
+      {
+        auto m = root.createNewChildElement ("Marker");
+        m->setAttribute ("Time", 0.5 + i);
+        m->setAttribute ("Title", "Added " + String (i));
+      }
+
+      TemporaryFile changed (sidecar);
+      root.writeToFile (changed.getFile(), "");
+
+      const auto start = Time::getMillisecondCounterHiRes();
+      Array<SidecarMerge::Marker> theirs;
+      Array<SidecarMerge::Change> changes;
+      const bool ok = SidecarMerge::read (changed.getFile(), theirs);
+      SidecarMerge::diff (base, theirs, changes);
+      const double elapsed = Time::getMillisecondCounterHiRes() - start;
+
+      results.set ("sidecar_merge_ms", ok && changes.size() == expected ? elapsed : -1.0);
+    }
+
+    // decoding the fixture into memory, its size there against its PCM in the file, and a
+    // seek plus one block read from it; -1 if the decode fails or a sample differs from the file
+    void measureRam (NamedValueSet& results)
+    {
+      auto fail = [&results]
+      {
+        results.set ("ram_decode_ms", -1.0);
+        results.set ("ram_size_pct", -1.0);
+        results.set ("ram_seek_us", -1.0);
+      };
+
+      RamAudioDecoder decoder;
+      auto start = Time::getMillisecondCounterHiRes();
+      RamAudioStore::Ptr store (decoder.start (formatManager.createReaderFor (file)));
+      if (store == nullptr)
+        return fail();
+
+      const double decodeMs = waitFor ([&] { return ! decoder.isDecoding(); }, start, 600000.0);
+      ScopedPointer<AudioFormatReader> disk (formatManager.createReaderFor (file));
+      if (decodeMs < 0 || ! store->isComplete() || disk == nullptr)
+        return fail();
+
+      const double pcmBytes = (double) disk->lengthInSamples * disk->numChannels * (disk->bitsPerSample / 8);
+
+      RamAudioReader ram (formatManager.createReaderFor (file));
+      ram.setStore (store.get());
+
+      const int numSeeks = 1000, blockSize = 512;
+      const int numChannels = (int) disk->numChannels;
+      AudioBuffer<float> fromRam (numChannels, blockSize), fromDisk (numChannels, blockSize);
+      Random random (1);
+      bool same = true;
+      double elapsed = 0;
+
+      for (int i = 0; i < numSeeks; ++i)
+      {
+        const auto p = (int64) (random.nextDouble() * (double) jmax ((int64) 0, disk->lengthInSamples - blockSize));
+
+        start = Time::getMillisecondCounterHiRes();
+        ram.read (&fromRam, 0, blockSize, p, true, true);
+        elapsed += Time::getMillisecondCounterHiRes() - start;
+
+        // checked against the file now and then
+        if (i % 50 == 0)
+        {
+          disk->read (&fromDisk, 0, blockSize, p, true, true);
+          for (int ch = 0; ch < numChannels; ++ch)
+            same = same && memcmp (fromRam.getReadPointer (ch), fromDisk.getReadPointer (ch), sizeof (float) * blockSize) == 0;
+        }
+      }
+
+      results.set ("ram_decode_ms", decodeMs);
+      results.set ("ram_size_pct", same ? store->getCompressedBytes() / pcmBytes * 100.0 : -1.0);
+      results.set ("ram_seek_us", same ? elapsed * 1000.0 / numSeeks : -1.0);
+    }
+
+    // one core's time spent reading the fixture as four sample-locked compare lanes, in percent
+    void measureCompareLanes (NamedValueSet& results)
+    {
+      const int numLanes = 4, blockSize = 512;
+      ScopedPointer<AudioFormatReader> mainReader (formatManager.createReaderFor (file));
+      if (mainReader == nullptr)
+      {
+        results.set ("compare_lanes_cpu_pct", -1.0);
+        return;
+      }
+
+      const double rate = mainReader->sampleRate, seconds = jmin (10.0, mainReader->lengthInSamples / rate);
+      AudioFormatReaderSource mainSource (mainReader.release(), true);
+      ThreadPool pool (2);
+      LaneStackSource stack (pool);
+      stack.setMainSource (&mainSource, rate);
+
+      for (int i = 1; i < numLanes; ++i)
+        stack.addLane (formatManager.createReaderFor (file));
+
+      stack.prepareToPlay (blockSize, rate);
+      AudioBuffer<float> buffer (stack.getNumChannels(), blockSize);
+
+      const auto start = Time::getMillisecondCounterHiRes();
+      for (int n = 0; n < (int) (seconds * rate); n += blockSize)
+        stack.getNextAudioBlock (AudioSourceChannelInfo (buffer));
+      const double elapsed = Time::getMillisecondCounterHiRes() - start;
+
+      stack.releaseResources();
+      results.set ("compare_lanes_cpu_pct", stack.getNumLanes() == numLanes && seconds > 0
+                                              ? elapsed / (seconds * 1000.0) * 100.0 : -1.0);
+    }
+
+    // open and random seeks through the range-request stream; the second pass reads from the chunk cache
+    void measureRemote (const URL& url, int iterations, NamedValueSet& results)
+    {
+      Array<double> seek, cachedSeek;
+      Random random (1);
+
+      // the first open probes the server; later ones would be served from the open caches
+      String error;
+      auto start = Time::getMillisecondCounterHiRes();
+      RemoteChunkCache::Ptr cache (RemoteChunkCache::open (url, error));
+      ScopedPointer<AudioFormatReader> reader (cache != nullptr ? formatManager.createReaderFor (new RemoteInputStream (cache))
+                                                                : nullptr);
+      if (reader == nullptr)
+      {
+        std::cerr << "cannot open " << url.toString (false) << ": " << error << std::endl;
+        results.set ("remote_open_ms", -1.0);
+        return;
+      }
+      results.set ("remote_open_ms", Time::getMillisecondCounterHiRes() - start);
+
+      AudioBuffer<float> buffer ((int) reader->numChannels, 4096);
+
+      for (int it = 0; it < iterations; ++it)
+      {
+        Array<File> chunks;
+        cache->getFolder().findChildFiles (chunks, File::findFiles, false, "*.chunk");
+        for (auto& f : chunks)
+          f.deleteFile();
+
+        Array<int64> positions;
+        for (int i = 0; i < 20; ++i)
+          positions.add ((int64) (random.nextDouble() * jmax ((int64) 0, reader->lengthInSamples - buffer.getNumSamples())));
+
+        for (auto* times : { &seek, &cachedSeek })
+        {
+          start = Time::getMillisecondCounterHiRes();
+          for (auto pos : positions)
+            reader->read (&buffer, 0, buffer.getNumSamples(), pos, true, true);
+          times->add ((Time::getMillisecondCounterHiRes() - start) / positions.size());
+        }
+      }
+
+      std::cerr << "fetched " << cache->getNumBytesFetched() << " of " << cache->getTotalLength() << " bytes" << std::endl;
+
+      results.set ("remote_seek_ms",          median (seek));
+      results.set ("remote_cached_seek_ms",   median (cachedSeek));
+    }
+
+    // the large fixture: open, a read at its very end, the first peaks and a cue round trip; -1 where the result is wrong
+    void measureLarge (int64 numFrames, NamedValueSet& results)
+    {
+      auto start = Time::getMillisecondCounterHiRes();
+      ScopedPointer<AudioFormatReader> reader (formatManager.createReaderFor (file));
+      const bool opened = reader != nullptr && reader->lengthInSamples == numFrames;
+      results.set ("large_open_ms", opened ? Time::getMillisecondCounterHiRes() - start : -1.0);
+
+      if (! opened)
+      {
+        std::cerr << "cannot open " << file.getFullPathName() << " with its full length" << std::endl;
+        return;
+      }
+
+      // the tone fills the last second, silence comes before it
+      AudioBuffer<float> tone (2, 48000), silence (2, 48000);
+      start = Time::getMillisecondCounterHiRes();
+      reader->read (&tone, 0, tone.getNumSamples(), numFrames - tone.getNumSamples(), true, true);
+      const double readMs = Time::getMillisecondCounterHiRes() - start;
+      reader->read (&silence, 0, silence.getNumSamples(), numFrames - 2 * silence.getNumSamples(), true, true);
+      results.set ("large_tail_read_ms", tone.getMagnitude (0, tone.getNumSamples()) > 0.4f
+                                           && silence.getMagnitude (0, silence.getNumSamples()) == 0.0f ? readMs : -1.0);
+
+      {
+        AudioTransportSource transportSource;
+        Slider zoomSlider;
+        WaveMarkerComp comp (formatManager, transportSource, zoomSlider);
+        comp.setBounds (0, 0, 1600, 400);
+
+        start = Time::getMillisecondCounterHiRes();
+        comp.setURL (URL (file));
+        const double firstWave = waitFor ([&] { return comp.getThumbnail().getNumSamplesFinished() > 0; }, start, 60000.0);
+        const bool fullLength = std::abs (comp.getThumbnail().getTotalLength() - numFrames / 48000.0) < 0.001;
+        results.set ("large_first_waveform_ms", fullLength ? firstWave : -1.0);
+      }
+
+      if (! WavCueChunks::isWavFile (file))
+        return;
+
+      // markers up to the end, past 2^31 samples; the RF64 sizes must survive the rewrite
+      Array<WavCueChunks::CueMarker> cues, readBack;
+      for (int i = 0; i < 100; ++i)
+        cues.add ({ (double) numFrames * i / 100 / 48000.0, "Marker " + String (i) });
+
+      String error;
+      start = Time::getMillisecondCounterHiRes();
+      const bool written = WavCueChunks::write (file, cues, error) && WavCueChunks::read (file, readBack);
+      const double cuesMs = Time::getMillisecondCounterHiRes() - start;
+
+      reader = formatManager.createReaderFor (file);
+      const bool intact = written && readBack.size() == cues.size()
+                            && std::abs (readBack.getLast().time - cues.getLast().time) < 1.0 / 48000.0
+                            && reader != nullptr && reader->lengthInSamples == numFrames;
+      if (! intact)
+        std::cerr << "cue round trip failed " << error << std::endl;
+      results.set ("large_cues_ms", intact ? cuesMs : -1.0);
+    }
+
+    File file;
+    AudioFormatManager formatManager;
+  };
+}
+
+
+int main (int argc, char* argv[])
+{
+  ScopedJuceInitialiser_GUI juceInit;
+
+  StringArray args;
+  for (int i = 1; i < argc; ++i)
+    args.add (argv[i]);
+
+  FixtureSpec spec;
+  spec.seconds     = getOption (args, "--seconds",  String (spec.seconds)).getDoubleValue();
+  spec.numChannels = getOption (args, "--channels", String (spec.numChannels)).getIntValue();
+  spec.sampleRate  = getOption (args, "--rate",     String (spec.sampleRate)).getDoubleValue();
+  spec.numMarkers  = jlimit (0, 100000, getOption (args, "--markers", String (spec.numMarkers)).getIntValue());
+  const int iterations = jmax (1, getOption (args, "--iterations", "5").getIntValue());
+  const String formatOption = getOption (args, "--format", "both");
+
+  File workDir (getFileOption (args, "--workdir", File::getSpecialLocation (File::tempDirectory)
+                                                    .getChildFile ("EasyAudioMarkerBenchmark")));
+  workDir.createDirectory();
+
+  StringArray formats;
+  if (formatOption == "both")
+  {
+    formats.add ("wav");
+    formats.add ("flac");
+  }
+  else
+    formats.add (formatOption);
+
+  DynamicObject::Ptr config = new DynamicObject();
+  config->setProperty ("seconds", spec.seconds);
+  config->setProperty ("channels", spec.numChannels);
+  config->setProperty ("sample_rate", spec.sampleRate);
+  config->setProperty ("markers", spec.numMarkers);
+  config->setProperty ("iterations", iterations);
+
+  var thresholds;
+  File thresholdsFile (getFileOption (args, "--thresholds"));
+  if (thresholdsFile.existsAsFile())
+    thresholds = JSON::parse (thresholdsFile);
+
+  DynamicObject::Ptr output = new DynamicObject();
+  output->setProperty ("config", var (config.get()));
+  Array<var> runs;
+  bool regressed = false;
+
+  auto addRun = [&] (const String& formatName, const NamedValueSet& results)
+  {
+    DynamicObject::Ptr run = new DynamicObject();
+    run->setProperty ("format", formatName);
+    Array<var> metrics;
+
+    for (auto& r : results)
+    {
+      DynamicObject::Ptr metric = new DynamicObject();
+      metric->setProperty ("name", r.name.toString());
+      metric->setProperty ("value", r.value);
+
+      auto limit = thresholds.getProperty (formatName, var()).getProperty (r.name, var());
+      if (limit.isVoid())
+        limit = thresholds.getProperty ("default", var()).getProperty (r.name, var());
+
+      if (! limit.isVoid())
+      {
+        const bool pass = (double) r.value >= 0.0 && (double) r.value <= (double) limit;
+        metric->setProperty ("threshold", limit);
+        metric->setProperty ("pass", pass);
+        regressed = regressed || ! pass;
+      }
+
+      std::cerr << formatName << " " << r.name.toString() << ": " << (double) r.value
+                << (r.name.toString().endsWith ("_pct") ? " %" : r.name.toString().endsWith ("_us") ? " us" : " ms") << std::endl;
+      metrics.add (var (metric.get()));
+    }
+
+    run->setProperty ("metrics", metrics);
+    runs.add (var (run.get()));
+  };
+
+  for (auto& formatName : formats)
+  {
+    auto audioFile = workDir.getChildFile ("fixture_" + String (spec.numChannels) + "ch_"
+                                           + String ((int) spec.seconds) + "s." + formatName);
+
+    std::cerr << "generating " << audioFile.getFullPathName() << std::endl;
+    if (! SyntheticFixtures::writeAudioFile (audioFile, formatName, spec)
+        || ! SyntheticFixtures::writeMarkerSidecar (audioFile, spec))
+    {
+      std::cerr << "cannot write fixture " << audioFile.getFullPathName() << std::endl;
+      return 2;
+    }
+
+    NamedValueSet results;
+    BenchmarkRun benchmarkRun (audioFile);
+    benchmarkRun.measure (iterations, results);
+    benchmarkRun.measureAlignment (results);
+    benchmarkRun.measureQc (results);
+    benchmarkRun.measureCompareLanes (results);
+    benchmarkRun.measureSidecarMerge (results);
+    benchmarkRun.measureRam (results);
+    measureResampler (results);
+    measurePreviewChain (results);
+    measureDenoiser (results);
+    measureRegions (results);
+
+    const String remoteBase = getOption (args, "--remote-base", {});
+    if (remoteBase.isNotEmpty())
+      benchmarkRun.measureRemote (URL (remoteBase).getChildURL (audioFile.getFileName()), iterations, results);
+
+    addRun (formatName, results);
+  }
+
+  if (args.contains ("--large"))
+  {
+    const int64 numFrames = ((int64) 1 << 31) + 48000;
+
+    for (auto wave64 : { false, true })
+    {
+      auto largeFile = workDir.getChildFile (wave64 ? "large_8gb.w64" : "large_8gb.wav");
+
+      std::cerr << "generating " << largeFile.getFullPathName() << std::endl;
+      if (! SyntheticFixtures::writeLargeFile (largeFile, wave64, numFrames))
+      {
+        std::cerr << "cannot write fixture " << largeFile.getFullPathName() << std::endl;
+        return 2;
+      }
+
+      NamedValueSet results;
+      {
+        BenchmarkRun benchmarkRun (largeFile);
+        benchmarkRun.measureLarge (numFrames, results);
+      }
+      largeFile.deleteFile();
+      addRun (wave64 ? "w64" : "rf64", results);
+    }
+  }
+
+  output->setProperty ("runs", runs);
+  output->setProperty ("passed", ! regressed);
+
+  const String json = JSON::toString (var (output.get()));
+  File outFile (getFileOption (args, "--out"));
+  if (outFile != File())
+    outFile.replaceWithText (json);
+  else
+    std::cout << json << std::endl;
+
+  return regressed ? 1 : 0;
+}
@@ -0,0 +1,152 @@
+/*
+  ==============================================================================
+
+    SyntheticFixtures.cpp
+
+  ==============================================================================
+*/
+
+#include "SyntheticFixtures.h"
+
+
+using namespace juce;
+
+
+bool SyntheticFixtures::writeAudioFile (const File& target, const String& formatName, const FixtureSpec& spec)
+{
+  ScopedPointer<AudioFormat> format;
+
+  if (formatName == "flac")
+    format = new FlacAudioFormat();
+  else
+    format = new WavAudioFormat();
+
+  target.deleteFile();
+  ScopedPointer<FileOutputStream> out (target.createOutputStream());
+  if (out == nullptr)
+    return false;
+
+  ScopedPointer<AudioFormatWriter> writer (format->createWriterFor (out, spec.sampleRate, (unsigned int) spec.numChannels,
+                                                                   jmin (spec.bitDepth, 24), {}, 0));
+  if (writer == nullptr)
+    return false;
+  out.release(); // owned by the writer now
+
+  const int blockSize = 65536;
+  AudioBuffer<float> block (spec.numChannels, blockSize);
+  Random random (spec.seed);
+  const int64 totalSamples = (int64) (spec.seconds * spec.sampleRate);
+
+  for (int64 pos = 0; pos < totalSamples; pos += blockSize)
+  {
+    const int num = (int) jmin ((int64) blockSize, totalSamples - pos);
+
+    for (int ch = 0; ch < spec.numChannels; ++ch)
+    {
+      const double freq = 220.0 * (1.0 + ch * 0.25);
+      const double step = 2.0 * double_Pi * freq / spec.sampleRate;
+      float* data = block.getWritePointer (ch);
+
+      for (int i = 0; i < num; ++i)
+      {
+        // slow amplitude envelope so the waveform is not a flat band
+        const double t = (double) (pos + i) / spec.sampleRate;
+        const double env = 0.5 + 0.4 * std::sin (t * 0.5);
+        data[i] = (float) (env * 0.7 * std::sin ((double) (pos + i) * step))
+                + (random.nextFloat() - 0.5f) * 0.05f;
+      }
+    }
+
+    if (! writer->writeFromAudioSampleBuffer (block, 0, num))
+      return false;
+  }
+
+  return true;
+}
+
+bool SyntheticFixtures::writeMarkerSidecar (const File& audioFile, const FixtureSpec& spec)
+{
+  XmlElement root ("Markers");
+  Random random (spec.seed);
+
+  for (int i = 0; i < spec.numMarkers; ++i)
+  {
+    auto m = root.createNewChildElement ("Marker");
+    m->setAttribute ("Time", spec.seconds * (i + random.nextDouble()) / jmax (1, spec.numMarkers));
+    m->setAttribute ("Title", "Marker " + String (i) + " take " + String (random.nextInt (100)));
+  }
+
+  return root.writeToFile (File (audioFile.getFullPathName() + MarkerFilesExt), "");
+}
+
+bool SyntheticFixtures::writeLargeFile (const File& target, bool wave64, int64 numFrames)
+{
+  static const uint8 riffGuid[16] = { 'r', 'i', 'f', 'f', 0x2e, 0x91, 0xcf, 0x11, 0xa5, 0xd6, 0x28, 0xdb, 0x04, 0xc1, 0x00, 0x00 };
+  static const uint8 waveGuid[16] = { 'w', 'a', 'v', 'e', 0xf3, 0xac, 0xd3, 0x11, 0x8c, 0xd1, 0x00, 0xc0, 0x4f, 0x8e, 0xdb, 0x8a };
+  static const uint8 fmtGuid[16]  = { 'f', 'm', 't', ' ', 0xf3, 0xac, 0xd3, 0x11, 0x8c, 0xd1, 0x00, 0xc0, 0x4f, 0x8e, 0xdb, 0x8a };
+  static const uint8 dataGuid[16] = { 'd', 'a', 't', 'a', 0xf3, 0xac, 0xd3, 0x11, 0x8c, 0xd1, 0x00, 0xc0, 0x4f, 0x8e, 0xdb, 0x8a };
+
+  const int sampleRate = 48000, blockAlign = 4;
+  const int64 dataSize = numFrames * blockAlign;
+
+  MemoryOutputStream fmt;
+  fmt.writeShort (1);                 // PCM
+  fmt.writeShort (2);
+  fmt.writeInt (sampleRate);
+  fmt.writeInt (sampleRate * blockAlign);
+  fmt.writeShort (blockAlign);
+  fmt.writeShort (16);
+
+  MemoryOutputStream header;
+  if (wave64)
+  {
+    const int64 headerSize = 16 + 8 + 16 + 24 + (int64) fmt.getDataSize() + 24;
+    header.write (riffGuid, 16);
+    header.writeInt64 (headerSize + dataSize);
+    header.write (waveGuid, 16);
+    header.write (fmtGuid, 16);
+    header.writeInt64 (24 + (int64) fmt.getDataSize());
+    header << fmt;
+    header.write (dataGuid, 16);
+    header.writeInt64 (24 + dataSize);
+  }
+  else
+  {
+    const int64 headerSize = 12 + 8 + 28 + 8 + (int64) fmt.getDataSize() + 8;
+    header.write ("RF64", 4);
+    header.writeInt (-1);
+    header.write ("WAVE", 4);
+    header.write ("ds64", 4);
+    header.writeInt (28);
+    header.writeInt64 (headerSize + dataSize - 8);
+    header.writeInt64 (dataSize);
+    header.writeInt64 (numFrames);
+    header.writeInt (0);              // no table
+    header.write ("fmt ", 4);
+    header.writeInt ((int) fmt.getDataSize());
+    header << fmt;
+    header.write ("data", 4);
+    header.writeInt (-1);
+  }
+
+  target.deleteFile();
+  FileOutputStream out (target);
+  if (out.failedToOpen())
+    return false;
+
+  out << header;
+
+  const int toneFrames = jmin ((int64) sampleRate, numFrames);
+  if (! out.setPosition ((int64) header.getDataSize() + (numFrames - toneFrames) * blockAlign))
+    return false;
+
+  for (int i = 0; i < toneFrames; ++i)
+  {
+    const auto value = (short) (16000.0 * std::sin (2.0 * double_Pi * 1000.0 * i / sampleRate));
+    out.writeShort (value);
+    out.writeShort (value);
+  }
+
+  out.flush();
+  return out.getStatus().wasOk();
+}
@@ -0,0 +1,40 @@
+/*
+  ==============================================================================
+
+    SyntheticFixtures.h
+
+    Deterministic audio files and marker sidecars used by the benchmark.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../../Source/MainComponent.h"
+
+
+struct FixtureSpec
+{
+  double  seconds     = 600.0;
+  int     numChannels = 2;
+  double  sampleRate  = 48000.0;
+  int     bitDepth    = 24;
+  int     numMarkers  = 1000;
+  int     seed        = 1234;
+};
+
+
+namespace SyntheticFixtures
+{
+  // Writes a sine + noise signal, one slightly detuned tone per channel.
+  // formatName is "wav" or "flac". Returns false if the writer could not be created.
+  bool writeAudioFile (const juce::File& target, const juce::String& formatName, const FixtureSpec& spec);
+
+  // Writes "<audio>.easymarkers" next to the audio file, markers spread evenly over the length.
+  bool writeMarkerSidecar (const juce::File& audioFile, const FixtureSpec& spec);
+
+  // Writes 16-bit stereo at 48 kHz, silent but for a 1 kHz tone in the last second, as
+  // RF64 WAV or as Wave64. The silence is seeked over rather than written, so the file
+  // is sparse where the file system allows it.
+  bool writeLargeFile (const juce::File& target, bool wave64, juce::int64 numFrames);
+}
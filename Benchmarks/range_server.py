@@ -0,0 +1,87 @@
+#!/usr/bin/env python3
+"""Serves a folder over HTTP with byte-range support, as a local stand-in for
+a remote file server when trying or benchmarking remote playback.
+
+    python3 Benchmarks/range_server.py [--port 8000] [--dir <folder>]
+
+Every request is logged with the range it asked for, so the ranges fetched
+while seeking and scrubbing can be followed.
+"""
+
+import argparse
+import email.utils
+import http.server
+import os
+import re
+
+
+class RangeHandler(http.server.SimpleHTTPRequestHandler):
+    def send_head(self):
+        path = self.translate_path(self.path)
+        if not os.path.isfile(path):
+            self.send_error(404, "File not found")
+            return None
+
+        stat = os.stat(path)
+        size = stat.st_size
+        etag = '"%x-%x"' % (int(stat.st_mtime), size)
+        start, end = 0, size - 1
+
+        match = re.match(r"bytes=(\d*)-(\d*)$", self.headers.get("Range", ""))
+        if match and (match.group(1) or match.group(2)):
+            if match.group(1):
+                start = int(match.group(1))
+                if match.group(2):
+                    end = min(int(match.group(2)), size - 1)
+            else:
+                start = max(0, size - int(match.group(2)))
+
+            if start > end:
+                self.send_response(416)
+                self.send_header("Content-Range", "bytes */%d" % size)
+                self.end_headers()
+                return None
+
+            self.send_response(206)
+            self.send_header("Content-Range", "bytes %d-%d/%d" % (start, end, size))
+        else:
+            self.send_response(200)
+
+        self.send_header("Content-Type", self.guess_type(path))
+        self.send_header("Content-Length", str(end - start + 1))
+        self.send_header("Accept-Ranges", "bytes")
+        self.send_header("ETag", etag)
+        self.send_header("Last-Modified", email.utils.formatdate(stat.st_mtime, usegmt=True))
+        self.end_headers()
+
+        f = open(path, "rb")
+        f.seek(start)
+        self.remaining = end - start + 1
+        return f
+
+    def copyfile(self, source, outputfile):
+        while self.remaining > 0:
+            data = source.read(min(65536, self.remaining))
+            if not data:
+                break
+            outputfile.write(data)
+            self.remaining -= len(data)
+
+    def log_request(self, code="-", size="-"):
+        self.log_message('"%s" %s %s', self.requestline, code, self.headers.get("Range", "full"))
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--port", type=int, default=8000)
+    parser.add_argument("--dir", default=os.getcwd())
+    args = parser.parse_args()
+
+    os.chdir(args.dir)
+    server = http.server.ThreadingHTTPServer(("", args.port), RangeHandler)
+    print("serving %s on http://localhost:%d" % (args.dir, args.port))
+    server.serve_forever()
+
+
+if __name__ == "__main__":
+    main()
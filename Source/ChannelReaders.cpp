@@ -0,0 +1,200 @@
+/*
+  ==============================================================================
+
+    ChannelReaders.cpp
+
+  ==============================================================================
+*/
+
+#include "ChannelReaders.h"
+
+
+using namespace juce;
+
+
+static void copyFormatProperties (AudioFormatReader& dest, const AudioFormatReader& source)
+{
+  dest.sampleRate            = source.sampleRate;
+  dest.bitsPerSample         = source.bitsPerSample;
+  dest.lengthInSamples       = source.lengthInSamples;
+  dest.usesFloatingPointData = source.usesFloatingPointData;
+  dest.metadataValues        = source.metadataValues;
+}
+
+
+AudioFormatReader* MappedChannelReader::createFor (AudioFormatManager& formats, const File& file)
+{
+  auto* reader = formats.createReaderFor (file);
+  auto* format = formats.findFormatForFileExtension (file.getFileExtension());
+
+  if (reader == nullptr || format == nullptr)
+    return reader;
+
+  ScopedPointer<MemoryMappedAudioFormatReader> map (format->createMemoryMappedReader (file));
+  if (map == nullptr || map->numChannels != reader->numChannels || ! map->mapEntireFile()
+       || map->getMappedSection().isEmpty())
+    return reader;
+
+  return new MappedChannelReader (reader, map.release());
+}
+
+MappedChannelReader::MappedChannelReader (AudioFormatReader* sourceToOwn, MemoryMappedAudioFormatReader* mappedToOwn)
+: AudioFormatReader (nullptr, sourceToOwn->getFormatName()), source (sourceToOwn), mapped (mappedToOwn)
+{
+  copyFormatProperties (*this, *source);
+  numChannels = source->numChannels;
+}
+
+bool MappedChannelReader::readSamples (int** destSamples, int numDestChannels, int startOffsetInDestBuffer,
+                                       int64 startSampleInFile, int numSamples)
+{
+  // a file that grows is extended from outside, by setting the length on this reader
+  source->lengthInSamples = lengthInSamples;
+
+  if (mapped->getMappedSection().contains (Range<int64> (startSampleInFile, startSampleInFile + numSamples)))
+    return mapped->readSamples (destSamples, numDestChannels, startOffsetInDestBuffer, startSampleInFile, numSamples);
+
+  return source->readSamples (destSamples, numDestChannels, startOffsetInDestBuffer, startSampleInFile, numSamples);
+}
+
+
+ChannelSubsetReader::ChannelSubsetReader (AudioFormatReader* sourceToOwn, const Array<int>& c)
+: AudioFormatReader (nullptr, sourceToOwn->getFormatName()), source (sourceToOwn),
+  publishedLength (sourceToOwn->lengthInSamples), channels (c)
+{
+  copyFormatProperties (*this, *source);
+  numChannels = (unsigned int) channels.size();
+  sourceChannels.allocate (source->numChannels, true);
+}
+
+bool ChannelSubsetReader::readSamples (int** destSamples, int numDestChannels, int startOffsetInDestBuffer,
+                                       int64 startSampleInFile, int numSamples)
+{
+  // only the reading thread writes the lengths; others publish through setLengthInSamples()
+  lengthInSamples = source->lengthInSamples = publishedLength.load();
+
+  for (int ch = 0; ch < (int) source->numChannels; ++ch)
+    sourceChannels[ch] = nullptr;
+
+  bool anyWanted = false;
+  for (int i = 0; i < jmin (numDestChannels, channels.size()); ++i)
+  {
+    if (isPositiveAndBelow (channels[i], (int) source->numChannels) && destSamples[i] != nullptr)
+    {
+      sourceChannels[channels[i]] = destSamples[i];
+      anyWanted = true;
+    }
+  }
+
+  // every lane hidden: nothing to read
+  if (! anyWanted)
+    return true;
+
+  return source->readSamples (sourceChannels, (int) source->numChannels, startOffsetInDestBuffer,
+                              startSampleInFile, numSamples);
+}
+
+
+ChannelMixdownReader::ChannelMixdownReader (AudioFormatReader* sourceToOwn)
+: AudioFormatReader (nullptr, sourceToOwn->getFormatName()), source (sourceToOwn),
+  publishedLength (sourceToOwn->lengthInSamples)
+{
+  copyFormatProperties (*this, *source);
+  bitsPerSample = 32;
+  usesFloatingPointData = true;
+  numChannels = jmin (2u, source->numChannels);
+  sourceChannels.allocate (source->numChannels, true);
+
+  Array<int> all;
+  for (int ch = 0; ch < (int) source->numChannels; ++ch)
+    all.add (ch);
+  setAudibleChannels (all);
+}
+
+void ChannelMixdownReader::setAudibleChannels (const Array<int>& channels)
+{
+  Array<float> left, right;
+  const int n = channels.size();
+
+  for (int k = 0; k < n; ++k)
+  {
+    if (n == 1)
+    {
+      left.add (1.0f);
+      right.add (1.0f);
+    }
+    else if (n == 2)
+    {
+      left.add (k == 0 ? 1.0f : 0.0f);
+      right.add (k == 0 ? 0.0f : 1.0f);
+    }
+    else
+    {
+      // equal-power pan, scaled so the sum of many channels keeps roughly the level of a stereo pair
+      const double angle = k / (double) (n - 1) * double_Pi * 0.5;
+      const double scale = std::sqrt (2.0 / n);
+      left.add ((float) (std::cos (angle) * scale));
+      right.add ((float) (std::sin (angle) * scale));
+    }
+  }
+
+  const ScopedLock sl (lock);
+  audible = channels;
+  leftGains.swapWith (left);
+  rightGains.swapWith (right);
+}
+
+bool ChannelMixdownReader::readSamples (int** destSamples, int numDestChannels, int startOffsetInDestBuffer,
+                                        int64 startSampleInFile, int numSamples)
+{
+  lengthInSamples = source->lengthInSamples = publishedLength.load();
+
+  float* out[2] = { nullptr, nullptr };
+  for (int i = 0; i < jmin (2, numDestChannels); ++i)
+    if (destSamples[i] != nullptr)
+      out[i] = reinterpret_cast<float*> (destSamples[i]) + startOffsetInDestBuffer;
+
+  for (auto* o : out)
+    if (o != nullptr)
+      FloatVectorOperations::clear (o, numSamples);
+
+  const ScopedLock sl (lock);
+  const int n = audible.size();
+
+  if (n == 0)
+    return true;
+
+  scratch.setSize (n, numSamples, false, false, true);
+
+  for (int ch = 0; ch < (int) source->numChannels; ++ch)
+    sourceChannels[ch] = nullptr;
+  for (int k = 0; k < n; ++k)
+    sourceChannels[audible[k]] = reinterpret_cast<int*> (scratch.getWritePointer (k));
+
+  if (! source->readSamples (sourceChannels, (int) source->numChannels, 0, startSampleInFile, numSamples))
+    return false;
+
+  for (int k = 0; k < n; ++k)
+  {
+    float* samples = scratch.getWritePointer (k);
+
+    if (! source->usesFloatingPointData)
+      FloatVectorOperations::convertFixedToFloat (samples, reinterpret_cast<const int*> (samples),
+                                                  1.0f / (float) 0x7fffffff, numSamples);
+
+    // a mono output gets the plain sum
+    if (numChannels == 1 || out[1] == nullptr)
+    {
+      if (out[0] != nullptr)
+        FloatVectorOperations::add (out[0], samples, numSamples);
+      continue;
+    }
+
+    if (out[0] != nullptr && leftGains[k] != 0.0f)
+      FloatVectorOperations::addWithMultiply (out[0], samples, leftGains[k], numSamples);
+    if (rightGains[k] != 0.0f)
+      FloatVectorOperations::addWithMultiply (out[1], samples, rightGains[k], numSamples);
+  }
+
+  return true;
+}
@@ -0,0 +1,97 @@
+/*
+  ==============================================================================
+
+    ChannelReaders.h
+
+    Reader wrappers that only decode the channels somebody looks at or
+    listens to. Channels that are not requested are passed to the wrapped
+    reader as null destinations, so they are never converted or stored.
+    Uncompressed files are read through a memory map, which copies only
+    the requested channels out of each frame. The frames themselves are
+    interleaved, so the pages holding them are still read whole, and FLAC
+    codes its channels jointly, so it still decodes them all.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <atomic>
+
+
+// Serves reads from a memory map of the file where its format allows one, and
+// from the stream reader past the mapped length, as in a file still growing.
+class MappedChannelReader : public juce::AudioFormatReader
+{
+public:
+  // Returns the plain stream reader when the file cannot be mapped.
+  static juce::AudioFormatReader* createFor (juce::AudioFormatManager& formats, const juce::File& file);
+
+  bool readSamples (int** destSamples, int numDestChannels, int startOffsetInDestBuffer,
+                    juce::int64 startSampleInFile, int numSamples) override;
+
+private:
+  MappedChannelReader (juce::AudioFormatReader* sourceToOwn, juce::MemoryMappedAudioFormatReader* mappedToOwn);
+
+  juce::ScopedPointer<juce::AudioFormatReader>            source;
+  juce::ScopedPointer<juce::MemoryMappedAudioFormatReader> mapped;
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MappedChannelReader)
+};
+
+
+// Exposes a subset of the source channels, in the given order. Used to feed
+// the thumbnail with the visible lanes only.
+class ChannelSubsetReader : public juce::AudioFormatReader
+{
+public:
+  ChannelSubsetReader (juce::AudioFormatReader* sourceToOwn, const juce::Array<int>& channels);
+
+  // For files that are still growing; also extends the wrapped reader. Thread-safe:
+  // lengthInSamples takes the new value at the start of the next read.
+  void setLengthInSamples (juce::int64 newLength) noexcept   { publishedLength = newLength; }
+  juce::int64 getPublishedLength() const noexcept            { return publishedLength.load(); }
+
+  bool readSamples (int** destSamples, int numDestChannels, int startOffsetInDestBuffer,
+                    juce::int64 startSampleInFile, int numSamples) override;
+
+private:
+  juce::ScopedPointer<juce::AudioFormatReader>  source;
+  std::atomic<juce::int64>                      publishedLength;
+  juce::Array<int>                              channels;
+  juce::HeapBlock<int*>                         sourceChannels;
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ChannelSubsetReader)
+};
+
+
+// Mixes the audible source channels down to stereo, spread evenly from left
+// to right with equal-power gains. Mono and stereo files play unchanged.
+class ChannelMixdownReader : public juce::AudioFormatReader
+{
+public:
+  ChannelMixdownReader (juce::AudioFormatReader* sourceToOwn);
+
+  // Thread-safe; takes effect on the next block read.
+  void setAudibleChannels (const juce::Array<int>& channels);
+
+  // For files that are still growing; also extends the wrapped reader. Thread-safe:
+  // lengthInSamples takes the new value at the start of the next read.
+  void setLengthInSamples (juce::int64 newLength) noexcept   { publishedLength = newLength; }
+  juce::int64 getPublishedLength() const noexcept            { return publishedLength.load(); }
+
+  bool readSamples (int** destSamples, int numDestChannels, int startOffsetInDestBuffer,
+                    juce::int64 startSampleInFile, int numSamples) override;
+
+private:
+  juce::ScopedPointer<juce::AudioFormatReader>  source;
+  std::atomic<juce::int64>                      publishedLength;
+  juce::CriticalSection                         lock;
+  juce::Array<int>                              audible;
+  juce::Array<float>                            leftGains, rightGains;
+  juce::HeapBlock<int*>                         sourceChannels;
+  juce::AudioBuffer<float>                      scratch;
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ChannelMixdownReader)
+};
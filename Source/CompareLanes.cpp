@@ -0,0 +1,413 @@
+/*
+  ==============================================================================
+
+    CompareLanes.cpp
+
+  ==============================================================================
+*/
+
+#include "CompareLanes.h"
+#include "ChannelReaders.h"
+#include "PolyphaseResampler.h"
+
+
+using namespace juce;
+
+
+// the least a lane is waited for: on short blocks a decode may take longer
+// without being slow
+static const int laneMinTimeoutMs = 20;
+
+// how often removed lanes are checked for being free to delete
+static const int releaseIntervalMs = 250;
+
+
+// One comparison file: decoded on the pool into a block of its own, which the
+// reading thread copies into the lane's pair once the job is done.
+class LaneStackSource::Lane : public ThreadPoolJob,
+                              public ReferenceCountedObject
+{
+public:
+  using Ptr = ReferenceCountedObjectPtr<Lane>;
+
+  Lane (ThreadPool& p, AudioFormatReader* reader, double targetRate)
+  : ThreadPoolJob ("compare lane"),
+    pool (p),
+    ratio (reader->sampleRate / targetRate),
+    outputRate (targetRate),
+    source (new ChannelMixdownReader (reader), true),
+    resampler (&source)
+  {
+    resampler.setSourceSampleRate (reader->sampleRate);
+  }
+
+  // a block that timed out may still be decoding
+  ~Lane()
+  {
+    pool.removeJob (this, false, -1);
+  }
+
+  // The resampler passes the lane straight through when its rate is the open file's.
+  void prepareToPlay (int blockSize)
+  {
+    pool.waitForJobToFinish (this, -1);
+    resampler.prepareToPlay (blockSize, outputRate);
+    decoded.setSize (2, blockSize);
+  }
+
+  void releaseResources()
+  {
+    pool.waitForJobToFinish (this, -1);
+    resampler.releaseResources();
+  }
+
+  // Safe from any thread: the job moves the source before it decodes again.
+  void setNextReadPosition (int64 position) noexcept
+  {
+    pendingPosition = position;
+  }
+
+  // Reading thread only.
+  void start (int numSamples)
+  {
+    numToDecode = numSamples;
+    pool.addJob (this, false);
+  }
+
+  void copyTo (AudioBuffer<float>& buffer, int firstChannel, int startSample, int numSamples) const
+  {
+    for (int side = 0; side < 2 && firstChannel + side < buffer.getNumChannels(); ++side)
+      buffer.copyFrom (firstChannel + side, startSample, decoded, side, 0, numSamples);
+  }
+
+  // set when the reading thread gave up waiting for a block, which put the lane out of step
+  bool late = false;
+
+  JobStatus runJob() override
+  {
+    const int64 position = pendingPosition.exchange (-1);
+    if (position >= 0)
+    {
+      source.setNextReadPosition ((int64) (position * ratio));
+      resampler.flushBuffers();
+    }
+
+    // on the pool, where allocating is fine; prepareToPlay sized it for the usual block
+    decoded.setSize (2, numToDecode, false, false, true);
+    resampler.getNextAudioBlock (AudioSourceChannelInfo (&decoded, 0, numToDecode));
+    return jobHasFinished;
+  }
+
+private:
+  ThreadPool&                   pool;
+  const double                  ratio;      // lane samples per main sample
+  const double                  outputRate;
+  AudioFormatReaderSource       source;
+  PolyphaseResamplingSource     resampler;
+  AudioBuffer<float>            decoded;
+  int                           numToDecode = 0;
+  std::atomic<int64>            pendingPosition { -1 };
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Lane)
+};
+
+
+LaneStackSource::LaneStackSource (ThreadPool& decodePool) : pool (decodePool)
+{
+}
+
+LaneStackSource::~LaneStackSource()
+{
+  stopTimer();
+}
+
+void LaneStackSource::setMainSource (PositionableAudioSource* source, double sampleRate)
+{
+  const ScopedLock sl (lock);
+  mainSource = source;
+  mainSampleRate = sampleRate;
+
+  for (auto* lane : lanes)
+    released.add (lane);
+
+  lanes.clear();
+  numLanes = 1;
+
+  if (! released.isEmpty())
+    startTimer (releaseIntervalMs);
+
+  if (mainSource != nullptr && preparedSampleRate > 0)
+    mainSource->prepareToPlay (preparedBlockSize, preparedSampleRate);
+}
+
+bool LaneStackSource::addLane (AudioFormatReader* reader)
+{
+  ScopedPointer<AudioFormatReader> owned (reader);
+
+  const ScopedLock sl (lock);
+  if (reader == nullptr || mainSource == nullptr || mainSampleRate <= 0 || lanes.size() + 1 >= maxLanes)
+    return false;
+
+  auto* lane = lanes.add (new Lane (pool, owned.release(), mainSampleRate));
+
+  if (preparedSampleRate > 0)
+    lane->prepareToPlay (preparedBlockSize);
+  lane->setNextReadPosition (mainSource->getNextReadPosition());
+
+  numLanes = lanes.size() + 1;
+  return true;
+}
+
+void LaneStackSource::removeLane (int index)
+{
+  const ScopedLock sl (lock);
+  if (! isPositiveAndBelow (index - 1, lanes.size()))
+    return;
+
+  released.add (lanes.getUnchecked (index - 1));
+  lanes.remove (index - 1);
+  numLanes = lanes.size() + 1;
+  startTimer (releaseIntervalMs);
+}
+
+// The reading thread may still hold a removed lane it started, and dropping the last
+// reference there would close the file and wait for the pool on the audio thread. So
+// removed lanes are deleted here, once nothing else holds them and their job is over.
+void LaneStackSource::timerCallback()
+{
+  ReferenceCountedArray<Lane> unused;
+
+  {
+    const ScopedLock sl (lock);
+
+    for (int i = released.size(); --i >= 0;)
+    {
+      auto* lane = released.getUnchecked (i);
+      if (lane->getReferenceCount() == 1 && ! pool.contains (lane))
+      {
+        unused.add (lane);
+        released.remove (i);
+      }
+    }
+
+    if (released.isEmpty())
+      stopTimer();
+  }
+}
+
+void LaneStackSource::prepareToPlay (int samplesPerBlockExpected, double sampleRate)
+{
+  const ScopedLock sl (lock);
+  preparedBlockSize = samplesPerBlockExpected;
+  preparedSampleRate = sampleRate;
+
+  if (mainSource != nullptr)
+    mainSource->prepareToPlay (samplesPerBlockExpected, sampleRate);
+
+  for (auto* lane : lanes)
+    lane->prepareToPlay (samplesPerBlockExpected);
+}
+
+void LaneStackSource::releaseResources()
+{
+  const ScopedLock sl (lock);
+  preparedSampleRate = 0;
+
+  if (mainSource != nullptr)
+    mainSource->releaseResources();
+
+  for (auto* lane : lanes)
+    lane->releaseResources();
+}
+
+// The lock covers the open file's block and starting the lanes, never the wait
+// for them: a lane that takes longer than the block lasts is given up on, so
+// one slow file cannot stall the others, nor a seek or a lane being removed.
+void LaneStackSource::getNextAudioBlock (const AudioSourceChannelInfo& info)
+{
+  // these references keep a lane alive that is removed while it decodes
+  Lane::Ptr started[maxLanes];
+  const int numBufferChannels = info.buffer->getNumChannels();
+  int numPairs = 1;
+  int timeoutMs = 0;
+
+  {
+    const ScopedLock sl (lock);
+
+    if (mainSource == nullptr)
+    {
+      info.clearActiveBufferRegion();
+      return;
+    }
+
+    // a read-ahead set up before the last lane was added has room for fewer pairs
+    numPairs = jlimit (1, lanes.size() + 1, numBufferChannels / 2);
+    timeoutMs = jmax (laneMinTimeoutMs, roundToInt (1000.0 * info.numSamples / mainSampleRate));
+    const int64 position = mainSource->getNextReadPosition();
+
+    for (int i = 1; i < numPairs; ++i)
+    {
+      auto* lane = lanes.getUnchecked (i - 1);
+
+      // still busy with a block it was late for: silent once more
+      if (pool.contains (lane))
+        continue;
+
+      if (lane->late)
+      {
+        lane->setNextReadPosition (position);
+        lane->late = false;
+      }
+
+      lane->start (info.numSamples);
+      started[i] = lane;
+    }
+
+    // the open file is read here, while the pool decodes the others
+    float* channels[2];
+    for (int ch = 0; ch < jmin (2, numBufferChannels); ++ch)
+      channels[ch] = info.buffer->getWritePointer (ch, info.startSample);
+
+    AudioBuffer<float> mainPair (channels, jmin (2, numBufferChannels), info.numSamples);
+    mainSource->getNextAudioBlock (AudioSourceChannelInfo (&mainPair, 0, info.numSamples));
+
+    // lanes that were dropped or not read keep still
+    for (int i = numPairs; i <= lanes.size(); ++i)
+      lanes.getUnchecked (i - 1)->setNextReadPosition (mainSource->getNextReadPosition());
+  }
+
+  for (int i = 1; i < numPairs; ++i)
+  {
+    auto& lane = started[i];
+
+    if (lane != nullptr && pool.waitForJobToFinish (lane, timeoutMs))
+    {
+      lane->copyTo (*info.buffer, 2 * i, info.startSample, info.numSamples);
+      continue;
+    }
+
+    if (lane != nullptr)
+      lane->late = true;
+
+    for (int ch = 2 * i; ch < jmin (2 * i + 2, numBufferChannels); ++ch)
+      info.buffer->clear (ch, info.startSample, info.numSamples);
+  }
+
+  for (int ch = 2 * numPairs; ch < numBufferChannels; ++ch)
+    info.buffer->clear (ch, info.startSample, info.numSamples);
+}
+
+void LaneStackSource::setNextReadPosition (int64 newPosition)
+{
+  const ScopedLock sl (lock);
+
+  if (mainSource != nullptr)
+    mainSource->setNextReadPosition (newPosition);
+
+  for (auto* lane : lanes)
+    lane->setNextReadPosition (newPosition);
+}
+
+int64 LaneStackSource::getNextReadPosition() const
+{
+  const ScopedLock sl (lock);
+  return mainSource != nullptr ? mainSource->getNextReadPosition() : 0;
+}
+
+// the timeline is the open file's; comparison files are cut or padded to it
+int64 LaneStackSource::getTotalLength() const
+{
+  const ScopedLock sl (lock);
+  return mainSource != nullptr ? mainSource->getTotalLength() : 0;
+}
+
+
+LaneSelectorSource::LaneSelectorSource (AudioSource* i) : input (i)
+{
+}
+
+LaneSelectorSource::~LaneSelectorSource()
+{
+}
+
+void LaneSelectorSource::setNumLanes (int newNumLanes)
+{
+  numLanes = jlimit (1, LaneStackSource::maxLanes, newNumLanes);
+}
+
+void LaneSelectorSource::selectLane (int index)
+{
+  selected = jlimit (0, LaneStackSource::maxLanes - 1, index);
+}
+
+void LaneSelectorSource::prepareToPlay (int samplesPerBlockExpected, double sampleRate)
+{
+  lanesBuffer.setSize (2 * LaneStackSource::maxLanes, samplesPerBlockExpected);
+  input->prepareToPlay (samplesPerBlockExpected, sampleRate);
+}
+
+void LaneSelectorSource::releaseResources()
+{
+  input->releaseResources();
+  lanesBuffer.setSize (0, 0);
+}
+
+// The lanes are read into the buffer prepareToPlay made, in pieces if a block
+// is longer than it; the crossfade still runs over the whole block.
+void LaneSelectorSource::getNextAudioBlock (const AudioSourceChannelInfo& info)
+{
+  const int lanesNow = numLanes.load();
+
+  if (lanesNow <= 1)
+  {
+    current = 0;
+    input->getNextAudioBlock (info);
+    return;
+  }
+
+  const int capacity = lanesBuffer.getNumSamples();
+  if (capacity == 0)
+  {
+    info.clearActiveBufferRegion();
+    return;
+  }
+
+  // fewer than 32 channels: this view of the buffer allocates nothing
+  AudioBuffer<float> lanesView (lanesBuffer.getArrayOfWritePointers(), 2 * lanesNow, capacity);
+
+  const int target = jmin (selected.load(), lanesNow - 1);
+  const int previous = jmin (current, lanesNow - 1);
+  const int numOutput = jmin (2, info.buffer->getNumChannels());
+
+  for (int done = 0; done < info.numSamples;)
+  {
+    const int num = jmin (capacity, info.numSamples - done);
+    lanesView.clear (0, num);
+    input->getNextAudioBlock (AudioSourceChannelInfo (&lanesView, 0, num));
+
+    const float fadeStart = done / (float) info.numSamples;
+    const float fadeEnd = (done + num) / (float) info.numSamples;
+
+    for (int side = 0; side < numOutput; ++side)
+    {
+      const int start = info.startSample + done;
+
+      if (target == previous)
+      {
+        info.buffer->copyFrom (side, start, lanesView, 2 * target + side, 0, num);
+      }
+      else
+      {
+        info.buffer->copyFromWithRamp (side, start, lanesView.getReadPointer (2 * previous + side), num, 1.0f - fadeStart, 1.0f - fadeEnd);
+        info.buffer->addFromWithRamp (side, start, lanesView.getReadPointer (2 * target + side), num, fadeStart, fadeEnd);
+      }
+    }
+
+    done += num;
+  }
+
+  for (int ch = numOutput; ch < info.buffer->getNumChannels(); ++ch)
+    info.buffer->clear (ch, info.startSample, info.numSamples);
+
+  current = target;
+}
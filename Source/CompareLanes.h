@@ -0,0 +1,102 @@
+/*
+  ==============================================================================
+
+    CompareLanes.h
+
+    A/B comparison of several files on one transport. LaneStackSource reads
+    the open file and every comparison file at the same position and hands
+    them on as consecutive stereo pairs, so one read-ahead buffer and one
+    loop source carry all of them and the lanes cannot drift apart: they
+    are locked to the sample. The extra lanes decode in parallel on a pool
+    shared by all of them; a lane not decoded in time stays silent for
+    that block and is put back in step. After the transport,
+    LaneSelectorSource passes on the pair of the lane being listened to;
+    switching crossfades over one block, with nothing to refill.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <atomic>
+
+
+class LaneStackSource : public juce::PositionableAudioSource,
+                        private juce::Timer
+{
+public:
+  // the open file included
+  static constexpr int maxLanes = 8;
+
+  LaneStackSource (juce::ThreadPool& decodePool);
+  ~LaneStackSource();
+
+  // The open file, not owned. Its sample rate is the one every lane is converted to,
+  // so the comparison lanes are dropped whenever it changes.
+  void setMainSource (juce::PositionableAudioSource* source, double sampleRate);
+
+  // Takes the reader; all its channels are mixed to stereo. Returns false when full or
+  // when there is no open file to compare with.
+  bool addLane (juce::AudioFormatReader* reader);
+  void removeLane (int index);
+
+  int getNumLanes() const noexcept                  { return numLanes.load(); }
+  int getNumChannels() const noexcept               { return getNumLanes() * 2; }
+
+  void prepareToPlay (int samplesPerBlockExpected, double sampleRate) override;
+  void releaseResources() override;
+  void getNextAudioBlock (const juce::AudioSourceChannelInfo& info) override;
+
+  void setNextReadPosition (juce::int64 newPosition) override;
+  juce::int64 getNextReadPosition() const override;
+  juce::int64 getTotalLength() const override;
+  bool isLooping() const override                   { return false; }
+
+private:
+  class Lane;
+
+  void timerCallback() override;
+
+  juce::ThreadPool&                 pool;
+  juce::CriticalSection             lock;
+  juce::PositionableAudioSource*    mainSource = nullptr;
+  double                            mainSampleRate = 0;
+  juce::ReferenceCountedArray<Lane> lanes;          // the comparison files, lane 1 onwards
+  juce::ReferenceCountedArray<Lane> released;       // removed, maybe still held by the reading thread
+  std::atomic<int>                  numLanes { 1 };
+  int                               preparedBlockSize = 0;
+  double                            preparedSampleRate = 0;
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LaneStackSource)
+};
+
+
+// Picks one stereo pair out of the lanes its input delivers.
+class LaneSelectorSource : public juce::AudioSource
+{
+public:
+  // The input is not owned.
+  LaneSelectorSource (juce::AudioSource* input);
+  ~LaneSelectorSource();
+
+  // Call once the input delivers this many lanes. With one, the input plays straight through.
+  void setNumLanes (int newNumLanes);
+  int getNumLanes() const noexcept                  { return numLanes.load(); }
+
+  void selectLane (int index);
+  int getSelectedLane() const noexcept              { return selected.load(); }
+
+  void prepareToPlay (int samplesPerBlockExpected, double sampleRate) override;
+  void releaseResources() override;
+  void getNextAudioBlock (const juce::AudioSourceChannelInfo& info) override;
+
+private:
+  juce::AudioSource*            input;
+  juce::AudioBuffer<float>      lanesBuffer;
+  std::atomic<int>              numLanes { 1 };
+  std::atomic<int>              selected { 0 };
+  int                           current = 0;        // audio thread only
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LaneSelectorSource)
+};
@@ -0,0 +1,199 @@
+/*
+  ==============================================================================
+
+    CompareLanesPanel.cpp
+
+  ==============================================================================
+*/
+
+#include "CompareLanesPanel.h"
+#include "MainComponent.h"
+
+
+using namespace juce;
+
+
+static const int mainStripHeight = 20;
+static const int laneStripHeight = 48;
+static const int letterWidth = 24;
+
+
+static String laneLetter (int index)
+{
+  return String::charToString ((juce_wchar) ('A' + index));
+}
+
+
+class CompareLanesPanel::LaneStrip : private ChangeListener
+{
+public:
+  LaneStrip (CompareLanesPanel& o, const File& f)
+  : file (f), owner (o),
+    thumbnail (512, o.formatManager, o.waveform.getThumbnailCache())
+  {
+    thumbnail.setSource (new FileInputSource (file));
+    thumbnail.addChangeListener (this);
+  }
+
+  ~LaneStrip()
+  {
+    thumbnail.removeChangeListener (this);
+  }
+
+  void draw (Graphics& g, Rectangle<int> area, Range<double> range)
+  {
+    g.setColour (ColorWaveThumbnailBkg);
+    g.fillRect (area);
+
+    if (thumbnail.getTotalLength() > 0 && ! range.isEmpty())
+    {
+      g.setColour (ColorWaveThumbnailForm.brighter());
+      thumbnail.drawChannels (g, area.reduced (0, 2), range.getStart(), range.getEnd(), 1.0f);
+    }
+
+    g.setColour (ColorText1);
+    g.setFont (Font (13.0f));
+    g.drawText (file.getFileName(), area.reduced (4, 0), Justification::topLeft, true);
+  }
+
+  const File file;
+
+private:
+  CompareLanesPanel&    owner;
+  AudioThumbnail        thumbnail;
+
+  void changeListenerCallback (ChangeBroadcaster*) override
+  {
+    owner.repaint();
+  }
+};
+
+
+CompareLanesPanel::CompareLanesPanel (WaveMarkerComp& w, AudioFormatManager& f)
+: waveform (w), formatManager (f)
+{
+  startTimerHz (30);
+}
+
+CompareLanesPanel::~CompareLanesPanel()
+{
+  lanes.clear();
+}
+
+void CompareLanesPanel::addLane (const File& file)
+{
+  lanes.add (new LaneStrip (*this, file));
+  repaint();
+}
+
+void CompareLanesPanel::removeLane (int index)
+{
+  lanes.remove (index - 1);
+  if (selected >= getNumLanes())
+    selected = 0;
+  repaint();
+}
+
+void CompareLanesPanel::clear()
+{
+  lanes.clear();
+  selected = 0;
+  repaint();
+}
+
+void CompareLanesPanel::setSelectedLane (int index)
+{
+  selected = jlimit (0, lanes.size(), index);
+  repaint();
+}
+
+int CompareLanesPanel::getIdealHeight() const noexcept
+{
+  return mainStripHeight + lanes.size() * laneStripHeight;
+}
+
+Rectangle<int> CompareLanesPanel::getStripBounds (int index) const
+{
+  if (index == 0)
+    return { 0, 0, getWidth(), mainStripHeight };
+
+  return { 0, mainStripHeight + (index - 1) * laneStripHeight, getWidth(), laneStripHeight };
+}
+
+void CompareLanesPanel::paint (Graphics& g)
+{
+  g.fillAll (ColorDefaultBkg);
+
+  const auto range = waveform.getVisibleRange();
+  g.setFont (Font (13.0f));
+
+  for (int i = 0; i < getNumLanes(); ++i)
+  {
+    auto strip = getStripBounds (i).reduced (0, 1);
+    auto letter = strip.removeFromLeft (letterWidth);
+
+    g.setColour (i == selected ? ColorWavePlayheadPlay : ColorWaveThumbnailBkg);
+    g.fillRect (letter);
+    g.setColour (i == selected ? Colours::black : ColorText1);
+    g.drawText (laneLetter (i), letter, Justification::centred, false);
+
+    if (i == 0)
+    {
+      g.setColour (ColorText1);
+      g.drawText (waveform.getAudioFile().getFileName(), strip.reduced (4, 0), Justification::centredLeft, true);
+      continue;
+    }
+
+    lanes[i - 1]->draw (g, strip, range);
+
+    // every lane is read at the same position, so one playhead serves all of them
+    if (range.contains (lastPosition))
+    {
+      const float x = (float) strip.getX() + (float) ((lastPosition - range.getStart()) * strip.getWidth() / range.getLength());
+      g.setColour (ColorWavePlayheadPlay);
+      g.drawVerticalLine (roundToInt (x), (float) strip.getY(), (float) strip.getBottom());
+    }
+  }
+}
+
+void CompareLanesPanel::mouseDown (const MouseEvent& e)
+{
+  for (int i = 0; i < getNumLanes(); ++i)
+  {
+    if (! getStripBounds (i).contains (e.getPosition()))
+      continue;
+
+    if (e.mods.isPopupMenu())
+    {
+      if (i == 0)
+        return;
+
+      PopupMenu menu;
+      menu.addItem (1, "Remove " + laneLetter (i) + ": " + lanes[i - 1]->file.getFileName());
+      if (menu.show() == 1 && onRemove != nullptr)
+        onRemove (i);
+    }
+    else if (onSelect != nullptr)
+    {
+      onSelect (i);
+    }
+
+    return;
+  }
+}
+
+void CompareLanesPanel::timerCallback()
+{
+  if (! isShowing())
+    return;
+
+  const auto range = waveform.getVisibleRange();
+  const double position = waveform.getHeardPosition();
+
+  if (range != lastRange || position != lastPosition)
+  {
+    lastRange = range;
+    lastPosition = position;
+    repaint();
+  }
+}
@@ -0,0 +1,58 @@
+/*
+  ==============================================================================
+
+    CompareLanesPanel.h
+
+    The comparison lanes under the waveform: one strip per file, lettered
+    A (the open file), B, C..., each drawn over the waveform's visible range
+    with the shared playhead. Clicking a strip, or pressing its number,
+    switches what is heard. The thumbnails share the waveform's cache.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+class WaveMarkerComp;
+
+
+class CompareLanesPanel : public juce::Component,
+                          private juce::Timer
+{
+public:
+  CompareLanesPanel (WaveMarkerComp& waveform, juce::AudioFormatManager& formatManager);
+  ~CompareLanesPanel();
+
+  void addLane (const juce::File& file);
+  void removeLane (int index);
+  void clear();
+  int getNumLanes() const noexcept                  { return lanes.size() + 1; }
+
+  void setSelectedLane (int index);
+
+  // the height that shows every lane
+  int getIdealHeight() const noexcept;
+
+  std::function<void(int)> onSelect;
+  std::function<void(int)> onRemove;
+
+  void paint (juce::Graphics& g) override;
+  void mouseDown (const juce::MouseEvent& e) override;
+
+private:
+  class LaneStrip;
+
+  WaveMarkerComp&               waveform;
+  juce::AudioFormatManager&     formatManager;
+  juce::OwnedArray<LaneStrip>   lanes;            // B onwards; A is the waveform above
+  int                           selected = 0;
+  juce::Range<double>           lastRange;
+  double                        lastPosition = -1;
+
+  juce::Rectangle<int> getStripBounds (int index) const;
+  void timerCallback() override;
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (CompareLanesPanel)
+};
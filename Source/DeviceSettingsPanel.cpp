@@ -0,0 +1,124 @@
+/*
+  ==============================================================================
+
+    DeviceSettingsPanel.cpp
+
+  ==============================================================================
+*/
+
+#include "DeviceSettingsPanel.h"
+#include "MainComponent.h"
+
+
+using namespace juce;
+
+
+// below this, most ALSA setups start to drop out
+static const int lowLatencyMinBuffer = 128;
+
+
+DeviceSettingsPanel::DeviceSettingsPanel (AudioDeviceManager& m)
+: manager (m),
+  selector (m, 0, 0, 2, 2, false, false, true, false)   // inputs are opened by Rec only
+{
+  addAndMakeVisible (selector);
+
+  lowLatencyButton.onClick = [this]
+  {
+    const String error (applyLowLatencyPreset (manager));
+    if (error.isNotEmpty())
+      AlertWindow::showMessageBoxAsync (AlertWindow::WarningIcon, "Low latency", error);
+  };
+  addAndMakeVisible (lowLatencyButton);
+
+  latencyLabel.setFont (Font (13.0f));
+  addAndMakeVisible (latencyLabel);
+
+  manager.addChangeListener (this);
+  updateLatencyLabel();
+
+  setSize (500, 420);
+}
+
+DeviceSettingsPanel::~DeviceSettingsPanel()
+{
+  manager.removeChangeListener (this);
+}
+
+void DeviceSettingsPanel::getDeviceLatency (AudioDeviceManager& m, double& outputSeconds, double& inputSeconds)
+{
+  outputSeconds = inputSeconds = 0;
+
+  if (auto* device = m.getCurrentAudioDevice())
+  {
+    const double rate = device->getCurrentSampleRate();
+    if (rate > 0)
+    {
+      outputSeconds = device->getOutputLatencyInSamples() / rate;
+      inputSeconds = device->getInputLatencyInSamples() / rate;
+    }
+  }
+}
+
+String DeviceSettingsPanel::applyLowLatencyPreset (AudioDeviceManager& m)
+{
+  auto* device = m.getCurrentAudioDevice();
+  if (device == nullptr)
+    return "No audio device is open";
+
+  auto sizes = device->getAvailableBufferSizes();
+  if (sizes.isEmpty())
+    return {};
+
+  sizes.sort();
+  int size = sizes.getLast();
+  for (auto s : sizes)
+    if (s >= lowLatencyMinBuffer)
+    {
+      size = s;
+      break;
+    }
+
+  AudioDeviceManager::AudioDeviceSetup setup;
+  m.getAudioDeviceSetup (setup);
+  setup.bufferSize = size;
+  return m.setAudioDeviceSetup (setup, true);
+}
+
+void DeviceSettingsPanel::paint (Graphics& g)
+{
+  g.fillAll (ColorDefaultBkg);
+}
+
+void DeviceSettingsPanel::resized()
+{
+  auto r = getLocalBounds().reduced (4);
+  auto bottom = r.removeFromBottom (24);
+  lowLatencyButton.setBounds (bottom.removeFromLeft (100));
+  bottom.removeFromLeft (8);
+  latencyLabel.setBounds (bottom);
+  selector.setBounds (r);
+}
+
+void DeviceSettingsPanel::changeListenerCallback (ChangeBroadcaster*)
+{
+  updateLatencyLabel();
+}
+
+void DeviceSettingsPanel::updateLatencyLabel()
+{
+  auto* device = manager.getCurrentAudioDevice();
+  if (device == nullptr)
+  {
+    latencyLabel.setText ("no device open", dontSendNotification);
+    return;
+  }
+
+  double output, input;
+  getDeviceLatency (manager, output, input);
+
+  latencyLabel.setText (manager.getCurrentAudioDeviceType() + ", " + String (device->getCurrentBufferSizeSamples())
+                          + " samples per block, output latency " + String (output * 1000.0, 1)
+                          + " ms, input " + String (input * 1000.0, 1) + " ms",
+                        dontSendNotification);
+}
@@ -0,0 +1,45 @@
+/*
+  ==============================================================================
+
+    DeviceSettingsPanel.h
+
+    Audio backend (ALSA / JACK where available), device, sample rate and
+    buffer size, with a low-latency preset and the latency the device
+    reports, which the waveform subtracts from the drawn playhead and the
+    marker times.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+
+class DeviceSettingsPanel : public juce::Component,
+                            private juce::ChangeListener
+{
+public:
+  DeviceSettingsPanel (juce::AudioDeviceManager& manager);
+  ~DeviceSettingsPanel();
+
+  // Output and input latency of the open device, in seconds.
+  static void getDeviceLatency (juce::AudioDeviceManager& manager, double& outputSeconds, double& inputSeconds);
+
+  // Switches to the smallest buffer of at least lowLatencyMinBuffer samples.
+  static juce::String applyLowLatencyPreset (juce::AudioDeviceManager& manager);
+
+  void paint (juce::Graphics& g) override;
+  void resized() override;
+
+private:
+  juce::AudioDeviceManager&             manager;
+  juce::AudioDeviceSelectorComponent    selector;
+  juce::TextButton                      lowLatencyButton { "Low latency" };
+  juce::Label                           latencyLabel;
+
+  void changeListenerCallback (juce::ChangeBroadcaster*) override;
+  void updateLatencyLabel();
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DeviceSettingsPanel)
+};
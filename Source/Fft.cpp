@@ -0,0 +1,146 @@
+/*
+  ==============================================================================
+
+    Fft.cpp
+
+  ==============================================================================
+*/
+
+#include "Fft.h"
+
+#if defined (__SSE__) || defined (_M_X64) || (defined (_M_IX86_FP) && _M_IX86_FP >= 1)
+ #include <xmmintrin.h>
+ #define EAM_FFT_SSE 1
+#elif defined (__ARM_NEON) || defined (__ARM_NEON__)
+ #include <arm_neon.h>
+ #define EAM_FFT_NEON 1
+#endif
+
+
+using namespace juce;
+
+
+namespace
+{
+  // The butterflies of the interleaved floats k from start to end, one complex value at a time.
+  inline void scalarButterflies (float* a, float* b, const float* w, int start, int end, bool inverse) noexcept
+  {
+    for (int k = start; k < end; k += 2)
+    {
+      const float wr = w[k], wi = inverse ? -w[k + 1] : w[k + 1];
+      const float tr = wr * b[k] - wi * b[k + 1];
+      const float ti = wr * b[k + 1] + wi * b[k];
+      b[k] = a[k] - tr;
+      b[k + 1] = a[k + 1] - ti;
+      a[k] += tr;
+      a[k + 1] += ti;
+    }
+  }
+
+  // a[k] += w[k] * b[k] and b[k] = old a[k] - w[k] * b[k], for an even count of k
+  inline void butterflies (float* a, float* b, const float* w, int count, bool inverse) noexcept
+  {
+   #if EAM_FFT_SSE
+    // conjugating the twiddle flips the sign of its imaginary parts
+    const __m128 conjugate = inverse ? _mm_set_ps (-0.0f, 0.0f, -0.0f, 0.0f) : _mm_setzero_ps();
+    const __m128 signs = _mm_set_ps (0.0f, -0.0f, 0.0f, -0.0f);
+
+    for (int k = 0; k < count * 2; k += 4)
+    {
+      const __m128 tw = _mm_xor_ps (_mm_loadu_ps (w + k), conjugate);
+      const __m128 d = _mm_loadu_ps (b + k);
+      const __m128 re = _mm_shuffle_ps (tw, tw, _MM_SHUFFLE (2, 2, 0, 0));
+      const __m128 im = _mm_shuffle_ps (tw, tw, _MM_SHUFFLE (3, 3, 1, 1));
+      const __m128 swapped = _mm_shuffle_ps (d, d, _MM_SHUFFLE (2, 3, 0, 1));
+      const __m128 t = _mm_add_ps (_mm_mul_ps (re, d), _mm_xor_ps (_mm_mul_ps (im, swapped), signs));
+      const __m128 x = _mm_loadu_ps (a + k);
+      _mm_storeu_ps (a + k, _mm_add_ps (x, t));
+      _mm_storeu_ps (b + k, _mm_sub_ps (x, t));
+    }
+   #elif EAM_FFT_NEON
+    const float imSign = inverse ? -1.0f : 1.0f;
+    int k = 0;
+
+    // four complex values, eight floats, per step; the stage of half-size 2 has only two
+    for (; k + 8 <= count * 2; k += 8)
+    {
+      // deinterleaved: val[0] real parts, val[1] imaginary parts
+      const float32x4x2_t tw = vld2q_f32 (w + k);
+      const float32x4x2_t d = vld2q_f32 (b + k);
+      float32x4x2_t x = vld2q_f32 (a + k);
+      const float32x4_t wi = vmulq_n_f32 (tw.val[1], imSign);
+      const float32x4_t tr = vmlsq_f32 (vmulq_f32 (tw.val[0], d.val[0]), wi, d.val[1]);
+      const float32x4_t ti = vmlaq_f32 (vmulq_f32 (tw.val[0], d.val[1]), wi, d.val[0]);
+      float32x4x2_t y;
+      y.val[0] = vsubq_f32 (x.val[0], tr);
+      y.val[1] = vsubq_f32 (x.val[1], ti);
+      x.val[0] = vaddq_f32 (x.val[0], tr);
+      x.val[1] = vaddq_f32 (x.val[1], ti);
+      vst2q_f32 (a + k, x);
+      vst2q_f32 (b + k, y);
+    }
+
+    scalarButterflies (a, b, w, k, count * 2, inverse);
+   #else
+    scalarButterflies (a, b, w, 0, count * 2, inverse);
+   #endif
+  }
+}
+
+
+Fft::Fft (int order) : size (1 << order)
+{
+  twiddles.allocate ((size_t) jmax (1, size / 2), false);
+  for (int i = 0; i < size / 2; ++i)
+  {
+    const double angle = -2.0 * double_Pi * i / size;
+    twiddles[i] = Complex ((float) std::cos (angle), (float) std::sin (angle));
+  }
+
+  stageTwiddles.allocate ((size_t) jmax (1, size), true);
+  for (int half = 1; half < size; half <<= 1)
+    for (int k = 0; k < half; ++k)
+      stageTwiddles[half - 1 + k] = twiddles[k * (size / (half * 2))];
+
+  bitReversed.allocate ((size_t) size, false);
+  for (int i = 0; i < size; ++i)
+  {
+    int r = 0;
+    for (int bit = 0; bit < order; ++bit)
+      r |= ((i >> bit) & 1) << (order - 1 - bit);
+    bitReversed[i] = r;
+  }
+}
+
+int Fft::getOrderFor (int64 numSamples) noexcept
+{
+  int order = 0;
+  while (((int64) 1 << order) < numSamples)
+    ++order;
+  return order;
+}
+
+void Fft::perform (Complex* data, bool inverse) const noexcept
+{
+  for (int i = 0; i < size; ++i)
+    if (i < bitReversed[i])
+      std::swap (data[i], data[bitReversed[i]]);
+
+  // the first stage only adds and subtracts
+  for (int start = 0; start + 1 < size; start += 2)
+  {
+    const Complex d = data[start + 1];
+    data[start + 1] = data[start] - d;
+    data[start] += d;
+  }
+
+  for (int half = 2; half < size; half <<= 1)
+  {
+    // std::complex is laid out as two floats, real part first
+    const float* w = reinterpret_cast<const float*> (stageTwiddles.get() + half - 1);
+
+    for (int start = 0; start < size; start += half * 2)
+      butterflies (reinterpret_cast<float*> (data + start), reinterpret_cast<float*> (data + start + half),
+                   w, half, inverse);
+  }
+}
@@ -0,0 +1,42 @@
+/*
+  ==============================================================================
+
+    Fft.h
+
+    In-place radix-2 complex FFT with precomputed twiddles and bit-reversal.
+    One instance per size can be shared between threads: perform() only
+    reads its tables. The butterflies run two at a time with SSE and four
+    at a time with NEON, using twiddles laid out contiguously per stage.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <complex>
+
+
+class Fft
+{
+public:
+  using Complex = std::complex<float>;
+
+  explicit Fft (int order);
+
+  int getSize() const noexcept        { return size; }
+
+  // The inverse is not scaled: a round trip multiplies by getSize().
+  void perform (Complex* data, bool inverse) const noexcept;
+
+  // Smallest order whose size holds numSamples.
+  static int getOrderFor (juce::int64 numSamples) noexcept;
+
+private:
+  const int                   size;
+  juce::HeapBlock<Complex>    twiddles;
+  juce::HeapBlock<Complex>    stageTwiddles;    // the stage of half-size h starts at h - 1
+  juce::HeapBlock<int>        bitReversed;
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Fft)
+};
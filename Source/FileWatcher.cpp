@@ -0,0 +1,242 @@
+/*
+  ==============================================================================
+
+    FileWatcher.cpp
+
+  ==============================================================================
+*/
+
+#include "FileWatcher.h"
+
+#if JUCE_LINUX
+ #include <sys/inotify.h>
+ #include <poll.h>
+ #include <unistd.h>
+#endif
+
+
+using namespace juce;
+
+
+#if JUCE_LINUX
+enum { folderWatch = 1, recursiveWatch = 2 };
+#endif
+
+
+FileWatcher::FileWatcher (const String& name, std::function<void (const File&)> callback)
+: Thread (name), onFileChanged (std::move (callback))
+{
+ #if JUCE_LINUX
+  inotifyFd = inotify_init1 (IN_NONBLOCK | IN_CLOEXEC);
+  jassert (inotifyFd >= 0);
+ #endif
+
+  startThread (2);
+}
+
+FileWatcher::~FileWatcher()
+{
+  stopThread (2000);
+  clear();
+
+ #if JUCE_LINUX
+  if (inotifyFd >= 0)
+    ::close (inotifyFd);
+ #endif
+}
+
+void FileWatcher::watchFolder (const File& folder, bool recursive)
+{
+  const ScopedLock sl (lock);
+  folders.add (folder);
+  folderIsRecursive.add (recursive);
+
+ #if JUCE_LINUX
+  addWatch (folder, folderWatch | (recursive ? recursiveWatch : 0));
+ #endif
+}
+
+void FileWatcher::watchFile (const File& file)
+{
+  const ScopedLock sl (lock);
+  WatchedFile w;
+  if (file.existsAsFile())
+  {
+    w.size = file.getSize();
+    w.modified = file.getLastModificationTime();
+  }
+  files[file.getFullPathName()] = w;
+
+ #if JUCE_LINUX
+  addWatch (file.getParentDirectory(), 0);
+ #endif
+}
+
+void FileWatcher::unwatchFile (const File& file)
+{
+  const ScopedLock sl (lock);
+  files.erase (file.getFullPathName());
+}
+
+void FileWatcher::clear()
+{
+  const ScopedLock sl (lock);
+  folders.clear();
+  folderIsRecursive.clear();
+  files.clear();
+
+ #if JUCE_LINUX
+  for (auto& w : watchDescriptors)
+    inotify_rm_watch (inotifyFd, w.first);
+  watchDescriptors.clear();
+  watchFlags.clear();
+ #else
+  folderSnapshot.clear();
+  folderSnapshotPrimed = false;
+ #endif
+}
+
+void FileWatcher::run()
+{
+  while (! threadShouldExit())
+  {
+    Array<File> changed;
+
+   #if JUCE_LINUX
+    pollfd pfd { inotifyFd, POLLIN, 0 };
+    if (::poll (&pfd, 1, 250) > 0)
+      readEvents (changed);
+   #else
+    wait (1000);
+    pollForChanges (changed);
+   #endif
+
+    // delivered outside the lock so the callback may add or remove watches
+    if (onFileChanged != nullptr)
+      for (auto& f : changed)
+        onFileChanged (f);
+  }
+}
+
+#if JUCE_LINUX
+
+void FileWatcher::addWatch (const File& dir, int flags)
+{
+  const int wd = inotify_add_watch (inotifyFd, dir.getFullPathName().toRawUTF8(),
+                                    IN_CLOSE_WRITE | IN_MODIFY | IN_CREATE | IN_DELETE
+                                    | IN_MOVED_TO | IN_MOVED_FROM);
+  if (wd < 0)
+    return;
+
+  // the same directory may be watched both for single files and as a folder
+  watchDescriptors[wd] = dir;
+  watchFlags[wd] |= flags;
+
+  if ((flags & recursiveWatch) != 0)
+  {
+    DirectoryIterator it (dir, false, "*", File::findDirectories);
+    while (it.next())
+      addWatch (it.getFile(), flags);
+  }
+}
+
+void FileWatcher::readEvents (Array<File>& changed)
+{
+  alignas (inotify_event) char buffer[8192];
+
+  for (;;)
+  {
+    auto numRead = ::read (inotifyFd, buffer, sizeof (buffer));
+    if (numRead <= 0)
+      break;
+
+    const ScopedLock sl (lock);
+
+    for (char* p = buffer; p < buffer + numRead;)
+    {
+      auto* ev = reinterpret_cast<inotify_event*> (p);
+      p += sizeof (inotify_event) + ev->len;
+
+      if ((ev->mask & IN_IGNORED) != 0)
+      {
+        watchDescriptors.erase (ev->wd);
+        watchFlags.erase (ev->wd);
+        continue;
+      }
+
+      auto dir = watchDescriptors.find (ev->wd);
+      if (dir == watchDescriptors.end() || ev->len == 0)
+        continue;
+
+      const int flags = watchFlags[ev->wd];
+      auto f = dir->second.getChildFile (String::fromUTF8 (ev->name));
+
+      if ((ev->mask & IN_ISDIR) != 0)
+      {
+        if ((flags & recursiveWatch) != 0 && (ev->mask & (IN_CREATE | IN_MOVED_TO)) != 0)
+          addWatch (f, flags);
+        if ((flags & folderWatch) != 0)
+          changed.addIfNotAlreadyThere (f);
+        continue;
+      }
+
+      if ((flags & folderWatch) != 0 || files.find (f.getFullPathName()) != files.end())
+        changed.addIfNotAlreadyThere (f);
+    }
+  }
+}
+
+#else
+
+void FileWatcher::pollForChanges (Array<File>& changed)
+{
+  const ScopedLock sl (lock);
+
+  auto hasChanged = [] (const File& f, WatchedFile& w)
+  {
+    WatchedFile now;
+    if (f.existsAsFile())
+    {
+      now.size = f.getSize();
+      now.modified = f.getLastModificationTime();
+    }
+
+    if (now.size == w.size && now.modified == w.modified)
+      return false;
+
+    w = now;
+    return true;
+  };
+
+  for (auto& w : files)
+    if (hasChanged (File (w.first), w.second))
+      changed.addIfNotAlreadyThere (File (w.first));
+
+  std::map<String, WatchedFile> snapshot;
+
+  for (int i = 0; i < folders.size(); ++i)
+  {
+    DirectoryIterator it (folders[i], folderIsRecursive[i], "*", File::findFiles);
+    while (it.next())
+    {
+      auto path = it.getFile().getFullPathName();
+      auto previous = folderSnapshot.find (path);
+      WatchedFile w = previous != folderSnapshot.end() ? previous->second : WatchedFile();
+
+      // the first pass only records what is already there
+      if (hasChanged (it.getFile(), w) && folderSnapshotPrimed)
+        changed.addIfNotAlreadyThere (it.getFile());
+
+      snapshot[path] = w;
+    }
+  }
+
+  for (auto& w : folderSnapshot)
+    if (snapshot.find (w.first) == snapshot.end())
+      changed.addIfNotAlreadyThere (File (w.first));
+
+  folderSnapshot.swap (snapshot);
+  folderSnapshotPrimed = true;
+}
+
+#endif
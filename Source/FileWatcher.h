@@ -0,0 +1,62 @@
+/*
+  ==============================================================================
+
+    FileWatcher.h
+
+    Reports files that are created, modified or removed under watched folders,
+    or watched individual files. Uses inotify on Linux and falls back to
+    polling modification times and sizes elsewhere.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <map>
+
+
+class FileWatcher : private juce::Thread
+{
+public:
+  // The callback is called on the watcher thread, which starts here. A directory is
+  // reported when it appears inside a watched folder, so its contents can be rescanned.
+  FileWatcher (const juce::String& name, std::function<void (const juce::File&)> callback);
+  ~FileWatcher();
+
+  void watchFolder (const juce::File& folder, bool recursive);
+  void watchFile (const juce::File& file);
+  void unwatchFile (const juce::File& file);
+  void clear();
+
+private:
+  struct WatchedFile
+  {
+    juce::int64  size = -1;
+    juce::Time   modified;
+  };
+
+  // set before the thread starts and never changed, so it is read without the lock
+  const std::function<void (const juce::File&)> onFileChanged;
+
+  juce::CriticalSection                 lock;
+  juce::Array<juce::File>               folders;
+  juce::Array<bool>                     folderIsRecursive;
+  std::map<juce::String, WatchedFile>   files;
+
+ #if JUCE_LINUX
+  int                                   inotifyFd = -1;
+  std::map<int, juce::File>             watchDescriptors;
+  std::map<int, int>                    watchFlags;
+  void addWatch (const juce::File& dir, int flags);
+  void readEvents (juce::Array<juce::File>& changed);
+ #else
+  std::map<juce::String, WatchedFile>   folderSnapshot;
+  bool                                  folderSnapshotPrimed = false;
+  void pollForChanges (juce::Array<juce::File>& changed);
+ #endif
+
+  void run() override;
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (FileWatcher)
+};
@@ -0,0 +1,367 @@
+/*
+  ==============================================================================
+
+    LibraryIndex.cpp
+
+  ==============================================================================
+*/
+
+#include "LibraryIndex.h"
+#include "MainComponent.h"
+#include "MarkerEditLog.h"
+
+
+using namespace juce;
+
+
+// the journal of an open file holds its latest edits, so it counts as part of the sidecar
+static int64 getStampSize (const File& sidecar)
+{
+  return sidecar.getSize() + MarkerEditLog::getJournalFile (sidecar).getSize();
+}
+
+static int64 getStampTime (const File& sidecar)
+{
+  return jmax (sidecar.getLastModificationTime().toMilliseconds(),
+               MarkerEditLog::getJournalFile (sidecar).getLastModificationTime().toMilliseconds());
+}
+
+
+class LibraryIndex::ParseJob : public ThreadPoolJob
+{
+public:
+  ParseJob (const File& f, Recording& r, bool& ok, Atomic<int>& remaining, WaitableEvent& done)
+  : ThreadPoolJob ("parse " + f.getFileName()), file (f), result (r), succeeded (ok),
+    jobsRemaining (remaining), allDone (done)
+  {
+  }
+
+  JobStatus runJob() override
+  {
+    succeeded = parseSidecar (file, result);
+    if (--jobsRemaining == 0)
+      allDone.signal();
+    return jobHasFinished;
+  }
+
+private:
+  File            file;
+  Recording&      result;
+  bool&           succeeded;
+  Atomic<int>&    jobsRemaining;
+  WaitableEvent&  allDone;
+};
+
+
+LibraryIndex::LibraryIndex (const File& f)
+: Thread ("library index"),
+indexFile (f),
+parsePool (jmax (1, SystemStats::getNumCpus())),
+watcher ("library watcher", [this] (const File& changed)
+{
+  const ScopedLock sl (pendingLock);
+  pending.addIfNotAlreadyThere (changed);
+  notify();
+})
+{
+  loadIndex();
+
+  if (rootFolder.isDirectory())
+  {
+    watcher.watchFolder (rootFolder, true);
+    needsFullScan = true;
+  }
+
+  startThread (3);
+}
+
+LibraryIndex::~LibraryIndex()
+{
+  stopThread (10000);
+}
+
+File LibraryIndex::getDefaultIndexFile()
+{
+  return File::getSpecialLocation (File::userApplicationDataDirectory)
+           .getChildFile ("EasyAudioMarker").getChildFile ("LibraryIndex.xml");
+}
+
+void LibraryIndex::setRootFolder (const File& folder)
+{
+  {
+    const ScopedLock sl (lock);
+    if (folder == rootFolder)
+      return;
+
+    rootFolder = folder;
+    recordings.clear();
+  }
+
+  watcher.clear();
+  watcher.watchFolder (folder, true);
+
+  {
+    const ScopedLock sl (pendingLock);
+    pending.clear();
+    needsFullScan = true;
+  }
+  notify();
+  sendChangeMessage();
+}
+
+File LibraryIndex::getRootFolder() const
+{
+  const ScopedLock sl (lock);
+  return rootFolder;
+}
+
+int LibraryIndex::getNumRecordings() const
+{
+  const ScopedLock sl (lock);
+  return (int) recordings.size();
+}
+
+int LibraryIndex::getNumMarkers() const
+{
+  const ScopedLock sl (lock);
+  int total = 0;
+  for (auto& r : recordings)
+    total += r.second.times.size();
+  return total;
+}
+
+void LibraryIndex::search (const String& query, int maxHits, Array<Hit>& hits) const
+{
+  hits.clearQuick();
+  const auto lowerQuery = query.toLowerCase();
+  const ScopedLock sl (lock);
+
+  for (auto& r : recordings)
+  {
+    auto& rec = r.second;
+    for (int i = 0; i < rec.lowerTitles.size(); ++i)
+    {
+      if (rec.lowerTitles[i].contains (lowerQuery))
+      {
+        hits.add ({ audioFileFor (r.first), rec.times[i], rec.titles[i] });
+        if (hits.size() >= maxHits)
+          return;
+      }
+    }
+  }
+}
+
+void LibraryIndex::run()
+{
+  while (! threadShouldExit())
+  {
+    bool full;
+    Array<File> changed;
+    {
+      const ScopedLock sl (pendingLock);
+      full = needsFullScan;
+      needsFullScan = false;
+      changed.swapWith (pending);
+    }
+
+    if (! full && changed.isEmpty())
+    {
+      wait (-1);
+      wait (200); // let bursts of writes settle before reparsing
+      continue;
+    }
+
+    scanning = 1;
+    sendChangeMessage();
+
+    if (full)
+      fullScan();
+    else
+      applyChanges (changed);
+
+    saveIndex();
+    scanning = 0;
+    sendChangeMessage();
+  }
+}
+
+void LibraryIndex::fullScan()
+{
+  const File root (getRootFolder());
+  Array<File> toParse;
+  std::map<String, Recording> kept;
+
+  DirectoryIterator it (root, true, String ("*") + MarkerFilesExt, File::findFiles);
+  while (it.next() && ! threadShouldExit())
+  {
+    auto sidecar = it.getFile();
+    auto path = sidecar.getFullPathName();
+
+    const ScopedLock sl (lock);
+    auto existing = recordings.find (path);
+
+    // unchanged sidecars keep their cached markers
+    if (existing != recordings.end()
+        && existing->second.size == getStampSize (sidecar)
+        && existing->second.modified == getStampTime (sidecar))
+      kept[path] = std::move (existing->second);
+    else
+      toParse.add (sidecar);
+  }
+
+  {
+    const ScopedLock sl (lock);
+    recordings.swap (kept);
+  }
+
+  parseInParallel (toParse);
+}
+
+void LibraryIndex::applyChanges (const Array<File>& changed)
+{
+  Array<File> toParse;
+
+  for (auto& f : changed)
+  {
+    if (f.isDirectory())
+    {
+      DirectoryIterator it (f, true, String ("*") + MarkerFilesExt, File::findFiles);
+      while (it.next())
+        toParse.addIfNotAlreadyThere (it.getFile());
+    }
+    else if (f.getFullPathName().endsWith (String (MarkerFilesExt) + MarkerEditLog::journalSuffix))
+    {
+      // edits of a file that is open: the sidecar is read again with them
+      const File sidecar (f.getFullPathName().dropLastCharacters ((int) strlen (MarkerEditLog::journalSuffix)));
+      if (sidecar.existsAsFile())
+        toParse.addIfNotAlreadyThere (sidecar);
+    }
+    else if (f.getFullPathName().endsWith (MarkerFilesExt))
+    {
+      if (f.existsAsFile())
+        toParse.addIfNotAlreadyThere (f);
+      else
+      {
+        const ScopedLock sl (lock);
+        recordings.erase (f.getFullPathName());
+      }
+    }
+    else if (! f.exists())
+    {
+      // a removed folder takes all of its sidecars with it
+      const auto prefix = f.getFullPathName() + File::separatorString;
+      const ScopedLock sl (lock);
+
+      for (auto r = recordings.begin(); r != recordings.end();)
+      {
+        if (r->first.startsWith (prefix))
+          r = recordings.erase (r);
+        else
+          ++r;
+      }
+    }
+  }
+
+  parseInParallel (toParse);
+}
+
+void LibraryIndex::parseInParallel (const Array<File>& sidecars)
+{
+  if (sidecars.isEmpty())
+    return;
+
+  std::vector<Recording> results ((size_t) sidecars.size());
+  std::unique_ptr<bool[]> ok (new bool[(size_t) sidecars.size()]());
+  Atomic<int> remaining (sidecars.size());
+  WaitableEvent allDone;
+
+  for (int i = 0; i < sidecars.size(); ++i)
+    parsePool.addJob (new ParseJob (sidecars[i], results[(size_t) i], ok[i], remaining, allDone), true);
+
+  allDone.wait();
+
+  const ScopedLock sl (lock);
+  for (int i = 0; i < sidecars.size(); ++i)
+    if (ok[i])
+      recordings[sidecars[i].getFullPathName()] = std::move (results[(size_t) i]);
+}
+
+bool LibraryIndex::parseSidecar (const File& sidecar, Recording& result)
+{
+  ScopedPointer<XmlElement> root (XmlDocument::parse (sidecar));
+  if (root == nullptr)
+    return false;
+
+  result.size = getStampSize (sidecar);
+  result.modified = getStampTime (sidecar);
+
+  forEachXmlChildElementWithTagName (*root, m, "Marker")
+  {
+    result.times.add (m->getDoubleAttribute ("Time"));
+    result.titles.add (m->getStringAttribute ("Title"));
+  }
+
+  MarkerEditLog::replayJournal (sidecar, result.times, result.titles);
+
+  for (auto& title : result.titles)
+    result.lowerTitles.add (title.toLowerCase());
+  return true;
+}
+
+File LibraryIndex::audioFileFor (const String& sidecarPath)
+{
+  return File (sidecarPath.dropLastCharacters (String (MarkerFilesExt).length()));
+}
+
+void LibraryIndex::loadIndex()
+{
+  ScopedPointer<XmlElement> root (XmlDocument::parse (indexFile));
+  if (root == nullptr || ! root->hasTagName ("LibraryIndex"))
+    return;
+
+  const ScopedLock sl (lock);
+  rootFolder = File (root->getStringAttribute ("Root"));
+
+  forEachXmlChildElementWithTagName (*root, r, "Recording")
+  {
+    Recording rec;
+    rec.size = r->getStringAttribute ("Size").getLargeIntValue();
+    rec.modified = r->getStringAttribute ("Modified").getLargeIntValue();
+
+    forEachXmlChildElementWithTagName (*r, m, "Marker")
+    {
+      auto title = m->getStringAttribute ("Title");
+      rec.times.add (m->getDoubleAttribute ("Time"));
+      rec.titles.add (title);
+      rec.lowerTitles.add (title.toLowerCase());
+    }
+    recordings[r->getStringAttribute ("Sidecar")] = std::move (rec);
+  }
+}
+
+void LibraryIndex::saveIndex()
+{
+  XmlElement root ("LibraryIndex");
+  {
+    const ScopedLock sl (lock);
+    root.setAttribute ("Root", rootFolder.getFullPathName());
+
+    for (auto& r : recordings)
+    {
+      auto e = root.createNewChildElement ("Recording");
+      e->setAttribute ("Sidecar", r.first);
+      e->setAttribute ("Size", String (r.second.size));
+      e->setAttribute ("Modified", String (r.second.modified));
+
+      for (int i = 0; i < r.second.times.size(); ++i)
+      {
+        auto m = e->createNewChildElement ("Marker");
+        m->setAttribute ("Time", r.second.times[i]);
+        m->setAttribute ("Title", r.second.titles[i]);
+      }
+    }
+  }
+
+  indexFile.getParentDirectory().createDirectory();
+  root.writeToFile (indexFile, "");
+}
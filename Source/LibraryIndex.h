@@ -0,0 +1,81 @@
+/*
+  ==============================================================================
+
+    LibraryIndex.h
+
+    Index of every marker sidecar found under a root folder. Sidecars are
+    parsed in parallel, the result is cached on disk together with each
+    sidecar's size and modification time, and a FileWatcher keeps it current.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "FileWatcher.h"
+#include <map>
+
+
+class LibraryIndex : public juce::ChangeBroadcaster,
+                     private juce::Thread
+{
+public:
+  struct Hit
+  {
+    juce::File    audioFile;
+    double        time;
+    juce::String  title;
+  };
+
+  LibraryIndex (const juce::File& indexFile = getDefaultIndexFile());
+  ~LibraryIndex();
+
+  static juce::File getDefaultIndexFile();
+
+  void setRootFolder (const juce::File& folder);
+  juce::File getRootFolder() const;
+
+  bool isScanning() const noexcept        { return scanning.get() != 0; }
+  int getNumRecordings() const;
+  int getNumMarkers() const;
+
+  // Case-insensitive substring search over all marker titles of the library.
+  void search (const juce::String& query, int maxHits, juce::Array<Hit>& hits) const;
+
+private:
+  struct Recording
+  {
+    juce::int64           size = 0;
+    juce::int64           modified = 0;
+    juce::Array<double>   times;
+    juce::StringArray     titles;
+    juce::StringArray     lowerTitles;
+  };
+
+  class ParseJob;
+
+  const juce::File                      indexFile;
+  juce::File                            rootFolder;
+  std::map<juce::String, Recording>     recordings;     // keyed by sidecar path
+  juce::CriticalSection                 lock;
+
+  juce::ThreadPool                      parsePool;
+  juce::Array<juce::File>               pending;
+  juce::CriticalSection                 pendingLock;
+  bool                                  needsFullScan = false;
+  juce::Atomic<int>                     scanning;
+  FileWatcher                           watcher;      // last, so its thread stops first
+
+  void run() override;
+  void fullScan();
+  void applyChanges (const juce::Array<juce::File>& changed);
+  void parseInParallel (const juce::Array<juce::File>& sidecars);
+  static bool parseSidecar (const juce::File& sidecar, Recording& result);
+  static juce::File audioFileFor (const juce::String& sidecarPath);
+
+  void loadIndex();
+  void saveIndex();
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LibraryIndex)
+};
@@ -0,0 +1,133 @@
+/*
+  ==============================================================================
+
+    LibrarySearchPanel.cpp
+
+  ==============================================================================
+*/
+
+#include "LibrarySearchPanel.h"
+#include "MainComponent.h"
+
+
+using namespace juce;
+
+
+LibrarySearchPanel::LibrarySearchPanel (LibraryIndex& i) : index (i)
+{
+  folderButton.onClick = [this] { chooseFolder(); };
+  addAndMakeVisible (folderButton);
+
+  statusLabel.setFont (Font (13.0f));
+  addAndMakeVisible (statusLabel);
+
+  searchBox.setTextToShowWhenEmpty ("search all markers", ColorText1.withAlpha (0.5f));
+  searchBox.addListener (this);
+  addAndMakeVisible (searchBox);
+
+  list.setColour (ListBox::backgroundColourId, ColorWaveThumbnailBkg);
+  list.setRowHeight (18);
+  addAndMakeVisible (list);
+
+  index.addChangeListener (this);
+  refresh();
+
+  setSize (500, 400);
+}
+
+LibrarySearchPanel::~LibrarySearchPanel()
+{
+  index.removeChangeListener (this);
+  searchBox.removeListener (this);
+}
+
+void LibrarySearchPanel::paint (Graphics& g)
+{
+  g.fillAll (ColorDefaultBkg);
+}
+
+void LibrarySearchPanel::resized()
+{
+  auto r = getLocalBounds().reduced (4);
+  auto top = r.removeFromTop (24);
+  folderButton.setBounds (top.removeFromLeft (80));
+  statusLabel .setBounds (top);
+  r.removeFromTop (4);
+  searchBox.setBounds (r.removeFromTop (22));
+  r.removeFromTop (4);
+  list.setBounds (r);
+}
+
+void LibrarySearchPanel::chooseFolder()
+{
+  FileChooser chooser ("Library folder", index.getRootFolder());
+  if (chooser.browseForDirectory())
+    index.setRootFolder (chooser.getResult());
+}
+
+void LibrarySearchPanel::refresh()
+{
+  auto root = index.getRootFolder();
+  String status = root == File() ? String ("no library folder")
+                                 : root.getFullPathName() + "  -  " + String (index.getNumRecordings())
+                                   + " recordings, " + String (index.getNumMarkers()) + " markers";
+  if (index.isScanning())
+    status << " (scanning)";
+  statusLabel.setText (status, dontSendNotification);
+
+  index.search (searchBox.getText(), 5000, hits);
+  list.updateContent();
+  list.repaint();
+}
+
+int LibrarySearchPanel::getNumRows()
+{
+  return hits.size();
+}
+
+void LibrarySearchPanel::paintListBoxItem (int row, Graphics& g, int width, int height, bool rowIsSelected)
+{
+  if (! isPositiveAndBelow (row, hits.size()))
+    return;
+
+  auto& hit = hits.getReference (row);
+
+  if (rowIsSelected)
+    g.fillAll (ColorWaveMarker.withAlpha (0.3f));
+
+  auto ms = (int64) (hit.time * 1000.0);
+  g.setFont (13.0f);
+  g.setColour (ColorWaveMarker);
+  g.drawText (String::formatted ("%d:%02d.%03d", (int) (ms / 60000), (int) ((ms / 1000) % 60), (int) (ms % 1000)),
+              2, 0, 70, height, Justification::centredLeft);
+  g.setColour (ColorText1);
+  g.drawText (hit.title, 74, 0, width / 2 - 76, height, Justification::centredLeft);
+  g.setColour (ColorText1.withAlpha (0.6f));
+  g.drawText (hit.audioFile.getFileName(), width / 2, 0, width / 2 - 2, height, Justification::centredRight);
+}
+
+void LibrarySearchPanel::listBoxItemDoubleClicked (int row, const MouseEvent&)
+{
+  openRow (row);
+}
+
+void LibrarySearchPanel::returnKeyPressed (int lastRowSelected)
+{
+  openRow (lastRowSelected);
+}
+
+void LibrarySearchPanel::textEditorTextChanged (TextEditor&)
+{
+  refresh();
+}
+
+void LibrarySearchPanel::changeListenerCallback (ChangeBroadcaster*)
+{
+  refresh();
+}
+
+void LibrarySearchPanel::openRow (int row)
+{
+  if (isPositiveAndBelow (row, hits.size()) && onOpenMarker != nullptr)
+    onOpenMarker (hits[row].audioFile, hits[row].time);
+}
@@ -0,0 +1,52 @@
+/*
+  ==============================================================================
+
+    LibrarySearchPanel.h
+
+    Searches the markers of every recording under the library folder.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "LibraryIndex.h"
+
+
+class LibrarySearchPanel : public juce::Component,
+                           private juce::ListBoxModel,
+                           private juce::TextEditor::Listener,
+                           private juce::ChangeListener
+{
+public:
+  LibrarySearchPanel (LibraryIndex& index);
+  ~LibrarySearchPanel();
+
+  // Called with the recording and the marker time when a hit is opened.
+  std::function<void (const juce::File&, double)> onOpenMarker;
+
+  void paint (juce::Graphics& g) override;
+  void resized() override;
+
+private:
+  LibraryIndex&                       index;
+  juce::TextButton                    folderButton { "Folder..." };
+  juce::Label                         statusLabel;
+  juce::TextEditor                    searchBox;
+  juce::ListBox                       list { {}, this };
+  juce::Array<LibraryIndex::Hit>      hits;
+
+  int getNumRows() override;
+  void paintListBoxItem (int row, juce::Graphics& g, int width, int height, bool rowIsSelected) override;
+  void listBoxItemDoubleClicked (int row, const juce::MouseEvent&) override;
+  void returnKeyPressed (int lastRowSelected) override;
+
+  void textEditorTextChanged (juce::TextEditor&) override;
+  void changeListenerCallback (juce::ChangeBroadcaster*) override;
+
+  void chooseFolder();
+  void refresh();
+  void openRow (int row);
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LibrarySearchPanel)
+};
@@ -0,0 +1,121 @@
+/*
+  ==============================================================================
+
+    LiveRecorder.cpp
+
+  ==============================================================================
+*/
+
+#include "LiveRecorder.h"
+
+
+using namespace juce;
+
+
+static const double recordFifoSeconds = 4.0;
+
+
+LiveRecorder::LiveRecorder()
+{
+  writerThread.startThread (7);
+}
+
+LiveRecorder::~LiveRecorder()
+{
+  stop();
+  writerThread.stopThread (2000);
+}
+
+bool LiveRecorder::start (const File& file, AudioFormatWriter::ThreadedWriter::IncomingDataReceiver* receiver,
+                          String& error)
+{
+  stop();
+
+  const double rate = sampleRate;
+  const int channels = numInputChannels;
+
+  if (rate <= 0 || channels <= 0)
+  {
+    error = "No audio input is open";
+    return false;
+  }
+
+  file.deleteFile();
+  ScopedPointer<FileOutputStream> stream (file.createOutputStream());
+  if (stream == nullptr)
+  {
+    error = "Cannot write " + file.getFullPathName();
+    return false;
+  }
+
+  WavAudioFormat wav;
+  auto* writer = wav.createWriterFor (stream, rate, (unsigned int) channels, 24, {}, 0);
+  if (writer == nullptr)
+  {
+    error = "Cannot create a WAV writer for " + file.getFullPathName();
+    return false;
+  }
+  stream.release(); // owned by the writer now
+
+  // the FIFO is allocated here, once; the audio thread only copies into it
+  threadedWriter = new AudioFormatWriter::ThreadedWriter (writer, writerThread, (int) (rate * recordFifoSeconds));
+  threadedWriter->setDataReceiver (receiver);
+
+  writerChannels = channels;
+  recordingSampleRate = rate;
+  samplesRecorded = 0;
+  droppedBlocks = 0;
+  activeWriter = threadedWriter.get();
+  return true;
+}
+
+void LiveRecorder::stop()
+{
+  activeWriter = nullptr;
+
+  // a callback that picked up the writer before the line above may still be writing to it
+  while (callbacksInFlight.load() > 0)
+    Thread::yield();
+
+  // flushes what is left in the FIFO and closes the file
+  threadedWriter = nullptr;
+}
+
+double LiveRecorder::getRecordedSeconds() const noexcept
+{
+  return recordingSampleRate > 0 ? samplesRecorded.load() / recordingSampleRate : 0.0;
+}
+
+void LiveRecorder::audioDeviceIOCallback (const float** inputChannelData, int numInputs,
+                                          float** outputChannelData, int numOutputs, int numSamples)
+{
+  ++callbacksInFlight;
+
+  if (auto* writer = activeWriter.load())
+  {
+    // a device restarted with another channel count mid-take is not recorded
+    if (numInputs == writerChannels && writer->write (inputChannelData, numSamples))
+      samplesRecorded += numSamples;
+    else
+      ++droppedBlocks;
+  }
+
+  --callbacksInFlight;
+
+  // recording is not monitored; the player's callback provides the output
+  for (int i = 0; i < numOutputs; ++i)
+    if (outputChannelData[i] != nullptr)
+      FloatVectorOperations::clear (outputChannelData[i], numSamples);
+}
+
+void LiveRecorder::audioDeviceAboutToStart (AudioIODevice* device)
+{
+  sampleRate = device->getCurrentSampleRate();
+  numInputChannels = device->getActiveInputChannels().countNumberOfSetBits();
+}
+
+void LiveRecorder::audioDeviceStopped()
+{
+  sampleRate = 0;
+  numInputChannels = 0;
+}
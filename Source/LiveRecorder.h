@@ -0,0 +1,60 @@
+/*
+  ==============================================================================
+
+    LiveRecorder.h
+
+    Records every input of the device to a WAV file, one channel each. The
+    audio callback only copies samples into the lock-free FIFO of a
+    ThreadedWriter; the disk writes and the thumbnail updates happen on the
+    writer thread, so nothing is allocated and no file is touched on the
+    audio thread.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <atomic>
+
+
+class LiveRecorder : public juce::AudioIODeviceCallback
+{
+public:
+  LiveRecorder();
+  ~LiveRecorder();
+
+  // Message thread only. The receiver (usually a thumbnail) is fed from the writer thread.
+  bool start (const juce::File& file, juce::AudioFormatWriter::ThreadedWriter::IncomingDataReceiver* receiver,
+              juce::String& error);
+  void stop();
+
+  bool isRecording() const noexcept                 { return activeWriter.load() != nullptr; }
+  double getRecordedSeconds() const noexcept;
+  int getNumDroppedBlocks() const noexcept          { return droppedBlocks.load(); }
+  int getNumInputChannels() const noexcept          { return numInputChannels; }
+
+  void audioDeviceIOCallback (const float** inputChannelData, int numInputChannels,
+                              float** outputChannelData, int numOutputChannels, int numSamples) override;
+  void audioDeviceAboutToStart (juce::AudioIODevice* device) override;
+  void audioDeviceStopped() override;
+
+private:
+  juce::TimeSliceThread                                       writerThread { "live recording writer" };
+  juce::ScopedPointer<juce::AudioFormatWriter::ThreadedWriter> threadedWriter;
+
+  std::atomic<juce::AudioFormatWriter::ThreadedWriter*>       activeWriter { nullptr };
+  std::atomic<int>                                            callbacksInFlight { 0 };
+  std::atomic<juce::int64>                                    samplesRecorded { 0 };
+  std::atomic<int>                                            droppedBlocks { 0 };
+
+  // set by the device callbacks, read by start() on the message thread
+  std::atomic<double>                                         sampleRate { 0 };
+  std::atomic<int>                                            numInputChannels { 0 };
+
+  // set by start() before it publishes activeWriter, which the audio thread loads first
+  double        recordingSampleRate = 0;
+  int           writerChannels = 0;
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LiveRecorder)
+};
@@ -0,0 +1,226 @@
+/*
+  ==============================================================================
+
+    LoopRegionSource.cpp
+
+  ==============================================================================
+*/
+
+#include "LoopRegionSource.h"
+
+
+using namespace juce;
+
+
+static const double loopCrossfadeSeconds = 0.01;
+static const double loopHeadSeconds      = 0.5;
+static const int    decodeChunkSize      = 8192;   // samples read per turn of the input lock
+
+
+LoopRegionSource::LoopRegionSource (PositionableAudioSource* in, double rate, int channels)
+: input (in), sampleRate (rate), numChannels (channels)
+{
+  jassert (input != nullptr && sampleRate > 0);
+}
+
+void LoopRegionSource::setLoopRegion (Range<double> seconds)
+{
+  const int64 start = (int64) (seconds.getStart() * sampleRate);
+  const int64 end   = jmin ((int64) (seconds.getEnd() * sampleRate), input->getTotalLength());
+
+  // one crossfade must fit twice into the loop, or there is nothing to play between wraps
+  const int64 fade = jmin ((int64) (loopCrossfadeSeconds * sampleRate), (end - start) / 4);
+  if (fade <= 0)
+    return clearLoopRegion();
+
+  const int64 headLength = jmin ((int64) (loopHeadSeconds * sampleRate), end - fade - start);
+
+  // decoded before taking the lock, which the reading thread needs for every block
+  AudioBuffer<float> newHead (numChannels, (int) headLength);
+  AudioBuffer<float> newTail (numChannels, (int) fade);
+  decode (start, newHead);
+  decode (end - fade, newTail);
+
+  const ScopedLock sl (lock);
+  const int64 filePos = toFilePosition (nextPosition);
+
+  std::swap (head, newHead);
+  std::swap (tail, newTail);
+
+  loopStart  = start;
+  loopEnd    = end;
+  fadeLength = fade;
+  looping    = true;
+
+  nextPosition = jmin (filePos, loopEnd - 1);
+}
+
+void LoopRegionSource::clearLoopRegion()
+{
+  const ScopedLock sl (lock);
+  nextPosition = toFilePosition (nextPosition);
+  looping = false;
+  head.setSize (0, 0);
+  tail.setSize (0, 0);
+}
+
+Range<double> LoopRegionSource::getLoopRegion() const
+{
+  const ScopedLock sl (lock);
+  return looping ? Range<double> (loopStart / sampleRate, loopEnd / sampleRate) : Range<double>();
+}
+
+void LoopRegionSource::redecodeEdges()
+{
+  int64 start, end, fade;
+  int headLength;
+
+  {
+    const ScopedLock sl (lock);
+    if (! looping)
+      return;
+
+    start = loopStart;
+    end = loopEnd;
+    fade = fadeLength;
+    headLength = head.getNumSamples();
+  }
+
+  AudioBuffer<float> newHead (numChannels, headLength);
+  AudioBuffer<float> newTail (numChannels, (int) fade);
+  decode (start, newHead);
+  decode (end - fade, newTail);
+
+  // the region may have been changed or cleared meanwhile
+  const ScopedLock sl (lock);
+  if (looping && loopStart == start && loopEnd == end && fadeLength == fade)
+  {
+    std::swap (head, newHead);
+    std::swap (tail, newTail);
+  }
+}
+
+double LoopRegionSource::toFileTime (double transportSeconds) const
+{
+  const ScopedLock sl (lock);
+  return toFilePosition ((int64) (transportSeconds * sampleRate)) / sampleRate;
+}
+
+int64 LoopRegionSource::toFilePosition (int64 position) const noexcept
+{
+  if (! looping || position < loopEnd)
+    return position;
+
+  // after a wrap playback resumes at loopStart + fadeLength: the first
+  // fadeLength samples of the loop were already heard inside the crossfade
+  const int64 period = loopEnd - loopStart - fadeLength;
+  return loopStart + fadeLength + (position - loopEnd) % period;
+}
+
+void LoopRegionSource::prepareToPlay (int samplesPerBlockExpected, double rate)
+{
+  input->prepareToPlay (samplesPerBlockExpected, rate);
+}
+
+void LoopRegionSource::releaseResources()
+{
+  input->releaseResources();
+}
+
+void LoopRegionSource::setNextReadPosition (int64 newPosition)
+{
+  const ScopedLock sl (lock);
+  nextPosition = newPosition;
+}
+
+int64 LoopRegionSource::getTotalLength() const
+{
+  // while looping the stream never ends
+  return looping ? std::numeric_limits<int64>::max() / 2 : input->getTotalLength();
+}
+
+// Reads in chunks, so the reading thread waits for one chunk at most when it needs the input.
+void LoopRegionSource::decode (int64 start, AudioBuffer<float>& dest)
+{
+  for (int done = 0; done < dest.getNumSamples();)
+  {
+    const int n = jmin (decodeChunkSize, dest.getNumSamples() - done);
+
+    const ScopedLock sl (inputLock);
+    input->setNextReadPosition (start + done);
+    input->getNextAudioBlock (AudioSourceChannelInfo (&dest, done, n));
+    done += n;
+  }
+}
+
+void LoopRegionSource::readInput (int64 filePos, const AudioSourceChannelInfo& info)
+{
+  const ScopedLock sl (inputLock);
+  if (input->getNextReadPosition() != filePos)
+    input->setNextReadPosition (filePos);
+  input->getNextAudioBlock (info);
+}
+
+void LoopRegionSource::getNextAudioBlock (const AudioSourceChannelInfo& info)
+{
+  const ScopedLock sl (lock);
+
+  if (! looping)
+  {
+    readInput (nextPosition, info);
+    nextPosition += info.numSamples;
+    return;
+  }
+
+  const int64 fadeStart = loopEnd - fadeLength;
+  const int64 headEnd   = loopStart + head.getNumSamples();
+  const int channels    = jmin (info.buffer->getNumChannels(), numChannels);
+  int done = 0;
+
+  while (done < info.numSamples)
+  {
+    const int64 filePos = toFilePosition (nextPosition);
+    const int remaining = info.numSamples - done;
+    const int outPos = info.startSample + done;
+    int n;
+
+    if (filePos >= fadeStart)
+    {
+      // equal-gain crossfade from the end of the loop into its start, both from memory
+      n = (int) jmin ((int64) remaining, loopEnd - filePos);
+      const int offset = (int) (filePos - fadeStart);
+
+      for (int ch = 0; ch < channels; ++ch)
+      {
+        auto* out = info.buffer->getWritePointer (ch, outPos);
+        auto* from = tail.getReadPointer (ch, offset);
+        auto* to = head.getReadPointer (ch, offset);
+
+        for (int i = 0; i < n; ++i)
+        {
+          const float g = (float) (offset + i) / (float) fadeLength;
+          out[i] = from[i] * (1.0f - g) + to[i] * g;
+        }
+      }
+    }
+    else if (filePos >= loopStart + fadeLength && filePos < headEnd)
+    {
+      // right after a wrap: served from the pre-decoded head, no disk seek
+      n = (int) jmin ((int64) remaining, jmin (headEnd, fadeStart) - filePos);
+
+      for (int ch = 0; ch < channels; ++ch)
+        info.buffer->copyFrom (ch, outPos, head, ch, (int) (filePos - loopStart), n);
+    }
+    else
+    {
+      n = (int) jmin ((int64) remaining, fadeStart - filePos);
+      readInput (filePos, AudioSourceChannelInfo (info.buffer, outPos, n));
+    }
+
+    for (int ch = channels; ch < info.buffer->getNumChannels(); ++ch)
+      info.buffer->clear (ch, outPos, n);
+
+    nextPosition += n;
+    done += n;
+  }
+}
@@ -0,0 +1,64 @@
+/*
+  ==============================================================================
+
+    LoopRegionSource.h
+
+    Sits between the file reader and the transport's read-ahead buffer and
+    repeats a region seamlessly. The read position seen by the transport keeps
+    increasing while the region loops, so the read-ahead never restarts; the
+    audio around both loop boundaries is decoded once when the region is set
+    and the wraparound is crossfaded from memory.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <atomic>
+
+
+class LoopRegionSource : public juce::PositionableAudioSource
+{
+public:
+  LoopRegionSource (juce::PositionableAudioSource* input, double sampleRate, int numChannels = 2);
+
+  void setLoopRegion (juce::Range<double> seconds);
+  void clearLoopRegion();
+  bool isLoopActive() const noexcept                  { return looping; }
+  juce::Range<double> getLoopRegion() const;
+
+  // Decodes the audio around the loop boundaries again, after the input changed.
+  void redecodeEdges();
+
+  // Maps a transport position (which keeps growing while looping) back to the file.
+  double toFileTime (double transportSeconds) const;
+
+  void prepareToPlay (int samplesPerBlockExpected, double sampleRate) override;
+  void releaseResources() override;
+  void getNextAudioBlock (const juce::AudioSourceChannelInfo& info) override;
+
+  void setNextReadPosition (juce::int64 newPosition) override;
+  juce::int64 getNextReadPosition() const override    { return nextPosition; }
+  juce::int64 getTotalLength() const override;
+  bool isLooping() const override                     { return false; }
+
+private:
+  juce::PositionableAudioSource*  input;
+  const double                    sampleRate;
+  const int                       numChannels;
+
+  juce::CriticalSection           lock;
+  juce::CriticalSection           inputLock;   // a seek and the read after it; taken after lock
+  std::atomic<bool>               looping { false };   // read unlocked by isLoopActive() and getTotalLength()
+  juce::int64                     loopStart = 0, loopEnd = 0, fadeLength = 0;
+  juce::int64                     nextPosition = 0;
+  juce::AudioBuffer<float>        head;   // [loopStart, loopStart + head length)
+  juce::AudioBuffer<float>        tail;   // [loopEnd - fadeLength, loopEnd)
+
+  juce::int64 toFilePosition (juce::int64 position) const noexcept;
+  void decode (juce::int64 start, juce::AudioBuffer<float>& dest);
+  void readInput (juce::int64 filePos, const juce::AudioSourceChannelInfo& info);
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LoopRegionSource)
+};
@@ -10,6 +10,11 @@
 
 #include "../JuceLibraryCode/JuceHeader.h"
 #include "MainComponent.h"
+#include "SegmentExporter.h"
+#include "SingleInstance.h"
+#include "StartupTimer.h"
+#include "TakeAligner.h"
+#include "QcAnalyzer.h"
 
 //==============================================================================
 class  MyApplication  : public JUCEApplication
@@ -26,14 +31,76 @@ public:
     void initialise (const String& commandLine) override
     {
         // This method is where you should put your application's initialisation code..
+        const auto args = getCommandLineParameterArray();
+        if (args.contains ("--export-segments"))
+        {
+            // headless batch export, no window
+            setApplicationReturnValue (SegmentExporter::runFromCommandLine (args));
+            quit();
+            return;
+        }
+
+        if (args.contains ("--align-markers"))
+        {
+            setApplicationReturnValue (TakeAligner::runFromCommandLine (args));
+            quit();
+            return;
+        }
+
+        if (args.contains ("--qc"))
+        {
+            setApplicationReturnValue (QcAnalyzer::runFromCommandLine (args));
+            quit();
+            return;
+        }
+
+        // --startup-report <file> times a full startup, written as JSON, then quits
+        const int reportIndex = args.indexOf ("--startup-report");
+        if (reportIndex >= 0)
+        {
+            const String reportPath (args[reportIndex + 1].unquoted());
+            if (reportPath.isEmpty() || reportPath.startsWith ("-"))
+            {
+                std::cerr << "usage: EasyAudioMarker --startup-report <file> [files...]" << std::endl;
+                setApplicationReturnValue (1);
+                quit();
+                return;
+            }
+
+            StartupTimer::setReportFile (File::getCurrentWorkingDirectory().getChildFile (reportPath));
+        }
+
+        // a later launch hands its files to the running player and exits;
+        // --new-instance opens a separate window instead
+        auto fileArgs = args;
+        if (reportIndex >= 0)
+            fileArgs.removeRange (reportIndex, 2);
+
+        const auto files = SingleInstance::getFilesFromCommandLine (fileArgs);
+        if (! args.contains ("--new-instance") && reportIndex < 0)
+        {
+            if (SingleInstance::forwardToRunningInstance (files))
+            {
+                quit();
+                return;
+            }
+
+            singleInstance = new SingleInstance();
+            singleInstance->onFilesReceived = [this] (const StringArray& received) { openFiles (received); };
+            if (! singleInstance->startListening())
+                singleInstance = nullptr;
+        }
+
         mainWindow = new MainWindow (getApplicationName());
         mainWindow->setResizable(true, false);
+        openFiles (files);
     }
 
     void shutdown() override
     {
         // Add your application's shutdown code here..
 
+        singleInstance = nullptr;
         mainWindow = nullptr; // (deletes our window)
     }
 
@@ -50,6 +117,21 @@ public:
         // When another instance of the app is launched while this one is running,
         // this method is invoked, and the commandLine parameter tells you what
         // the other instance's command-line arguments were.
+        StringArray args;
+        args.addTokens (commandLine, true);
+        openFiles (SingleInstance::getFilesFromCommandLine (args));
+    }
+
+    void openFiles (const StringArray& files)
+    {
+        if (mainWindow == nullptr)
+            return;
+
+        if (auto* content = dynamic_cast<MainComponent*> (mainWindow->getContentComponent()))
+            content->openFiles (files);
+
+        mainWindow->setMinimised (false);
+        mainWindow->toFront (true);
     }
 
     //==============================================================================
@@ -93,6 +175,7 @@ public:
 
 private:
     ScopedPointer<MainWindow> mainWindow;
+    ScopedPointer<SingleInstance> singleInstance;
 };
 
 //==============================================================================
@@ -1,20 +1,40 @@
 
 
 #include "MainComponent.h"
+#include "MarkerListPanel.h"
+#include "LibrarySearchPanel.h"
+#include "WavCueChunks.h"
+#include "SegmentExporter.h"
+#include "ChannelReaders.h"
+#include "StartupTimer.h"
+#include "TakeAligner.h"
+#include "DeviceSettingsPanel.h"
+#include "PreviewChainPanel.h"
+#include "CompareLanesPanel.h"
+#include <unordered_set>
 
 
 using namespace juce;
 
 
+static const int minMarkerSpacing = 8;    // pixels per marker in view, on average, below which they are clustered
+static const int clusterWidth = 24;       // pixels
+static const int64 maxThumbnailPoints = 1 << 23;   // per channel: at 512 samples a point, 23 hours at 48 kHz
+static const int minEditsPerCompaction = 4096; // journal entries before the sidecar is rewritten, at least
+
+
 WaveMarkerComp::WaveMarkerComp (AudioFormatManager& formatManager,
                                       AudioTransportSource& source,
                                       Slider& slider)
-: transportSource (source),
+: formatManager (formatManager),
+transportSource (source),
 zoomSlider (slider),
-thumbnail (512, formatManager, thumbnailCache),
-currentPositionMarker(source)
+thumbnail (new AudioThumbnail (thumbnailResolution, formatManager, thumbnailCache)),
+currentPositionMarker(source),
+// on the watcher thread: merged on the next timer tick
+sidecarWatcher ("sidecar watcher", [this] (const juce::File&) { sidecarChanged = true; })
 {
-  thumbnail.addChangeListener (this);
+  thumbnail->addChangeListener (this);
   
   addAndMakeVisible (scrollbar);
   scrollbar.setRangeLimits (visibleRange);
@@ -26,39 +46,75 @@ currentPositionMarker(source)
   addAndMakeVisible (addMarker);
   addMarker.addListener (this);
   
-  
-  
   setOpaque(true);
 }
 
 WaveMarkerComp::~WaveMarkerComp()
 {
+  if (journalEntries > 0)
+    saveMarkers();
+  
   scrollbar.removeListener (this);
-  thumbnail.removeChangeListener (this);
+  thumbnail->removeChangeListener (this);
 }
 
 void WaveMarkerComp::setURL (const URL& url)
 {
+  stopTailFollow();
+  
+  if (journalEntries > 0)
+    saveMarkers();
+  
   markersLocation = File();
-  InputSource* inputSource = nullptr;
+  audioLocation = File();
+  remoteCache = nullptr;
+  sidecarWatcher.clear();
+  laneHeaders.clear();
+  hiddenChannels.clear();
+  soloChannels.clear();
 
   if (url.isLocalFile())
   {
-    inputSource = new FileInputSource (url.getLocalFile());
     markersLocation = url.getLocalFile().getFullPathName() + MarkerFilesExt;
+    audioLocation = url.getLocalFile();
   }
-  else
+  else if (! url.isEmpty())
   {
-    juce::AlertWindow::showMessageBox(juce::AlertWindow::WarningIcon, "Cannot open file", "Is not a local file");
- //   if (inputSource == nullptr)
- //     inputSource = new URLInputSource (url);
+    // opened and probed beforehand, off the message thread; the markers are kept
+    // outside the chunk folder, which a new version of the file empties
+    remoteCache = RemoteChunkCache::getOpen(url);
+    if (remoteCache != nullptr)
+    {
+      markersLocation = remoteCache->getMarkersFolder().getChildFile(remoteCache->getFolder().getFileName() + MarkerFilesExt);
+      markersLocation.getParentDirectory().createDirectory();
+      
+      const File oldLocation (remoteCache->getFolder().getChildFile(juce::String("markers") + MarkerFilesExt));
+      if (oldLocation.existsAsFile() && ! markersLocation.exists())
+      {
+        oldLocation.moveFileTo(markersLocation);
+        MarkerEditLog::getJournalFile(oldLocation).moveFileTo(MarkerEditLog::getJournalFile(markersLocation));
+      }
+    }
+    else
+      juce::AlertWindow::showMessageBoxAsync(juce::AlertWindow::WarningIcon, "Cannot open URL", url.toString(false) + " is not open");
   }
   
-  if (inputSource != nullptr)
+  ScopedPointer<AudioFormatReader> reader (createReader());
+  
+  if (reader != nullptr)
   {
-    thumbnail.setSource (inputSource);
+    for (int ch = 0; ch < (int) reader->numChannels; ++ch)
+    {
+      auto* header = laneHeaders.add (new ChannelLaneHeader (ch));
+      header->onSolo = [this] (int channel, bool solo) { setChannelSolo (channel, solo); };
+      header->onHide = [this] (int channel) { setChannelHidden (channel, true); };
+      addChildComponent (header);
+    }
+    reader = nullptr;
     
-    Range<double> newRange (0.0, thumbnail.getTotalLength());
+    updateThumbnailSource();
+    
+    Range<double> newRange (0.0, thumbnail->getTotalLength());
     scrollbar.setRangeLimits (newRange);
     setRange (newRange);
     
@@ -73,9 +129,9 @@ URL WaveMarkerComp::getLastDroppedFile() const noexcept { return lastFileDropped
 
 void WaveMarkerComp::setZoomFactor (double amount)
 {
-  if (thumbnail.getTotalLength() > 0)
+  if (thumbnail->getTotalLength() > 0)
   {
-    auto newScale = jmax (0.001, thumbnail.getTotalLength() * (1.0 - jlimit (0.0, 0.99, amount)));
+    auto newScale = jmax (0.001, thumbnail->getTotalLength() * (1.0 - jlimit (0.0, 0.99, amount)));
     auto timeAtCentre = xToTime (getWidth() / 2.0f);
     
     auto timeAtCursor = xToTime (currentPositionMarker.getX());
@@ -104,21 +160,58 @@ void WaveMarkerComp::paint (Graphics& g)
   g.fillAll (ColorWaveThumbnailBkg);
   
   
-  g.setColour (ColorText1);
+  g.setColour (liveRecorder != nullptr ? ColorRecording : ColorText1);
   g.setFont (20.0f);
-  juce::Time time(transportSource.getCurrentPosition()*1000);
+  juce::Time time(getHeardPosition()*1000);
   juce::String timeStr = juce::String(time.getMinutes()) + juce::String(":") + juce::String(time.getSeconds()) + juce::String(".") + juce::String(time.getMilliseconds());
   g.drawText(timeStr, 0, 0, getWidth(), addMarker.getHeight(), juce::Justification::centred);
   
-  if (thumbnail.getTotalLength() > 0.0)
+  // the regions under the playhead, right of the time
+  regionIndex.getRegionsAt (getHeardPosition(), shownRegions);
+  if (shownRegions.size() > 0)
+  {
+    StringArray titles;
+    for (auto* region : shownRegions)
+      titles.add (region->title);
+    
+    g.setColour (ColorWaveRegion);
+    g.setFont (14.0f);
+    g.drawText (titles.joinIntoString (" / "), getWidth() / 2 + 80, 0, getWidth() / 2 - 84, addMarker.getHeight(),
+                Justification::centredRight, true);
+  }
+  
+  if (loopSource != nullptr && loopSource->isLoopActive())
   {
-  g.setColour(ColorWaveThumbnailForm);
-  //draw thumb
-    auto thumbArea = getLocalBounds().removeFromBottom(getHeight()*0.50);
+    auto loop = loopSource->getLoopRegion();
+    g.setColour (ColorWaveLoopRegion);
+    g.fillRect ((float) timeToX (loop.getStart()), (float) addMarker.getBottom(),
+                timeToX (loop.getEnd()) - timeToX (loop.getStart()),
+                (float) (getHeight() - scrollbar.getHeight() - addMarker.getBottom()));
+  }
+  
+  if (thumbnail->getTotalLength() > 0.0)
+  {
+    //draw thumb: one lane per visible channel, the thumbnail only holds those
+    paintRegions (g);
+    
+    auto lanes = getLaneArea();
+    const int numLanes = thumbnail->getNumChannels();
     
-    thumbArea.removeFromBottom (scrollbar.getHeight() + 4);
-    thumbnail.drawChannels (g, thumbArea.reduced (2),
-                            visibleRange.getStart(), visibleRange.getEnd(), 1.0f);
+    for (int i = 0; i < numLanes; ++i)
+    {
+      auto lane = lanes.withTrimmedTop (lanes.getHeight() * i / numLanes)
+                       .withHeight (lanes.getHeight() / numLanes);
+      
+      g.setColour(ColorLaneSeparator);
+      if (i > 0)
+        g.drawHorizontalLine (lane.getY(), 0.0f, (float) getWidth());
+      
+      g.setColour(ColorWaveThumbnailForm);
+      thumbnail->drawChannel (g, lane.reduced (2), visibleRange.getStart(), visibleRange.getEnd(), i, 1.0f);
+    }
+    
+    if (showsClusters)
+      paintClusters (g);
   }
   else
   {
@@ -127,10 +220,96 @@ void WaveMarkerComp::paint (Graphics& g)
   }
 }
 
+// one shaded span over the lanes per region in view, with its title in a row above them;
+// regions in view together take turns over a few rows so overlapping titles stay apart
+void WaveMarkerComp::paintRegions (Graphics& g)
+{
+  static const int numRows = 3;
+  static const float rowHeight = 14.0f;
+  const auto lanes = getLaneArea().toFloat();
+  
+  regionIndex.getRegionsOverlapping (visibleRange, shownRegions);
+  
+  g.setFont (12.0f);
+  for (int i = 0; i < shownRegions.size(); ++i)
+  {
+    auto* region = shownRegions.getUnchecked (i);
+    const float x = jmax (0.0f, timeToX (region->start));
+    const float width = jmax (1.0f, jmin ((float) getWidth(), timeToX (region->end)) - x);
+    const float titleY = lanes.getY() - (i % numRows + 1) * rowHeight;
+    
+    g.setColour (ColorWaveRegion.withAlpha (0.12f));
+    g.fillRect (x, lanes.getY(), width, lanes.getHeight());
+    g.setColour (ColorWaveRegion.withAlpha (0.35f));
+    g.fillRect (x, titleY, width, rowHeight);
+    g.setColour (ColorText1);
+    g.drawText (region->title, Rectangle<float> (x + 2, titleY, width - 4, rowHeight), Justification::centredLeft, true);
+  }
+  
+  if (isDraggingRegion)
+  {
+    g.setColour (ColorWaveRegion.withAlpha (0.3f));
+    g.fillRect (timeToX (regionDrag.getStart()), lanes.getY(),
+                timeToX (regionDrag.getEnd()) - timeToX (regionDrag.getStart()), lanes.getHeight());
+  }
+}
+
+// one shaded span per cluster of markers, from its first to its last, with their count
+void WaveMarkerComp::paintClusters (Graphics& g)
+{
+  const float top = (float) addMarker.getBottom();
+  const float height = (float) (getHeight() - scrollbar.getHeight()) - top;
+  markerDensity.getClusters (visibleRange, clusterWidth * visibleRange.getLength() / jmax (1, getWidth()), clusters);
+  
+  g.setFont (12.0f);
+  for (auto& cluster : clusters)
+  {
+    const float x = timeToX (cluster.span.getStart());
+    const float width = jmax (1.0f, timeToX (cluster.span.getEnd()) - x);
+    
+    g.setColour (ColorWaveMarker.withAlpha (0.25f));
+    g.fillRect (x, top, width, height);
+    g.setColour (ColorWaveMarker);
+    g.fillRect (x, top, 1.0f, height);
+    if (cluster.count > 1)
+      g.drawText (String (cluster.count), (int) x + 2, (int) top, 2 * clusterWidth, 16, Justification::topLeft, false);
+  }
+}
+
+// where the markers are along the whole file, over the scrollbar
+void WaveMarkerComp::paintOverChildren (Graphics& g)
+{
+  const auto bar = scrollbar.getBounds();
+  const auto limits = scrollbar.getRangeLimit();
+  if (markers.empty() || bar.isEmpty() || limits.isEmpty())
+    return;
+  
+  if (stripRevision != markerDensity.getRevision() || stripRange != limits || stripCounts.size() != bar.getWidth())
+  {
+    markerDensity.getDensity (limits, bar.getWidth(), stripCounts);
+    stripRevision = markerDensity.getRevision();
+    stripRange = limits;
+  }
+  
+  int maxCount = 1;
+  for (auto count : stripCounts)
+    maxCount = jmax (maxCount, count);
+  
+  for (int x = 0; x < stripCounts.size(); ++x)
+  {
+    if (stripCounts[x] == 0)
+      continue;
+    
+    g.setColour (ColorWaveMarker.withAlpha (0.3f + 0.7f * stripCounts[x] / (float) maxCount));
+    g.drawVerticalLine (bar.getX() + x, (float) bar.getY(), (float) bar.getBottom());
+  }
+}
+
 void WaveMarkerComp::resized()
 {
   addMarker.setBounds(1, 1, 25, 25);
   scrollbar.setBounds (getLocalBounds().removeFromBottom (14).reduced (2));
+  layoutLanes();
   repaint();
 }
 
@@ -155,19 +334,30 @@ void WaveMarkerComp::buttonClicked (juce::Button *btn)
 {
   if (&addMarker == btn)
   {
-    addMarkerToList(transportSource.getCurrentPosition(), "NEW MARKER", true);
+    addMarkerToList(getHeardPosition(), "NEW MARKER", true);
   }
   else
   {
     for (auto it = markers.begin(); it != markers.end(); ++it)
     {
-      if (&(*it)->editMarker == btn)
+      MarkerInfo *marker = *it;
+      
+      // a title edit is committed when the "e" button is toggled off
+      if (&marker->editMarker == btn && ! marker->editMarker.getToggleState()
+          && marker->editTitle.getText() != marker->committedTitle)
       {
-        saveMarkers();
+        editLog.beginTransaction();
+        recordEdit({ MarkerEditLog::Command::retitleMarker, marker->id, marker->pos,
+                     marker->editTitle.getText(), marker->committedTitle });
+        marker->committedTitle = marker->editTitle.getText();
+        markerIndex.update(marker, marker->pos, marker->committedTitle);
+        flushJournal();
+        markersChanged();
+        break;
       }
-      if (&(*it)->delMarker == btn)
+      if (&marker->delMarker == btn)
       {
-        markers.erase(it);
+        removeMarkers({ marker });
         break;
       }
     }
@@ -176,155 +366,1143 @@ void WaveMarkerComp::buttonClicked (juce::Button *btn)
 }
 
 
-void WaveMarkerComp::addMarkerToList(double time, const juce::String &title, bool saveXML)
+MarkerInfo* WaveMarkerComp::createMarker(double time, const juce::String &title, juce::int64 id)
 {
-  MarkerInfo *newMarker = new MarkerInfo(time, title);
+  if (id == 0)
+    id = nextMarkerId++;
+  
+  MarkerInfo *newMarker = new MarkerInfo(time, title, id);
   newMarker->delMarker.addListener(this);
   newMarker->editMarker.addListener(this);
 
   addChildComponent(newMarker);
   markers.push_back(newMarker);
-  resized();
-  if (saveXML)
-    saveMarkers();
+  markersById[id] = std::prev(markers.end());
+  markerIndex.add(newMarker, time, title);
+  markerDensity.add(newMarker, time);
+  return newMarker;
 }
 
 
-void WaveMarkerComp::saveMarkers()
+void WaveMarkerComp::eraseMarker(juce::int64 id)
 {
-  juce::XmlElement root("Markers");
-  for (auto &marker: markers)
+  auto found = markersById.find(id);
+  if (found == markersById.end())
+    return;
+  
+  markerIndex.remove(*found->second);
+  markerDensity.remove(*found->second);
+  shownMarkers.removeFirstMatchingValue(*found->second);
+  markers.erase(found->second);
+  markersById.erase(found);
+}
+
+
+void WaveMarkerComp::addMarkerToList(double time, const juce::String &title, bool saveXML)
+{
+  MarkerInfo *marker = createMarker(time, title);
+  if (saveXML)
   {
-    auto m = root.createNewChildElement("Marker");
-    m->setAttribute("Time", marker->pos);
-    m->setAttribute("Title", marker->editTitle.getText());
+    editLog.beginTransaction();
+    recordEdit({ MarkerEditLog::Command::addMarker, marker->id, time, title, {} });
+    flushJournal();
   }
-  bool res = root.writeToFile(markersLocation, "");
-  jassert(res);
+  resized();
+  markersChanged();
 }
 
 
-void WaveMarkerComp::loadMarkers()
+// adds all of them, and the regions, as one undoable step
+void WaveMarkerComp::addMarkers (const juce::Array<double>& times, const juce::StringArray& titles,
+                                 const juce::Array<MarkerRegion>& regions)
 {
-  XmlElement *root = XmlDocument::parse(markersLocation);
-  if (!root)
+  if (times.isEmpty() && regions.isEmpty())
     return;
- 
-  markers.clear();
   
-  for (int i = 0; i < root->getNumChildElements(); ++i)
+  editLog.beginTransaction();
+  
+  for (int i = 0; i < times.size(); ++i)
   {
-    auto m = root->getChildElement(i);
-    if (m->getTagName() == "Marker")
-    {
-      double time = m->getDoubleAttribute("Time");
-      juce::String title = m->getStringAttribute("Title");
-      addMarkerToList(time, title);
-    }
+    MarkerInfo *marker = createMarker(times[i], titles[i]);
+    recordEdit({ MarkerEditLog::Command::addMarker, marker->id, times[i], titles[i], {} });
   }
-  delete root;
+  
+  for (auto &r : regions)
+  {
+    const MarkerRegion region { r.start, r.end, r.title, nextMarkerId++ };
+    regionIndex.add(region);
+    recordEdit({ MarkerEditLog::Command::addRegion, region.id, region.start, region.title, {}, region.end });
+  }
+  
+  flushJournal();
   resized();
+  repaint();
+  markersChanged();
 }
 
 
-
-void WaveMarkerComp::mouseDown (const MouseEvent& e)
+// removes all of them as one undoable step
+void WaveMarkerComp::removeMarkers (const juce::Array<MarkerInfo*>& markersToRemove)
 {
-  mouseDrag (e);
+  if (markersToRemove.isEmpty())
+    return;
+  
+  editLog.beginTransaction();
+  
+  for (auto *marker : markersToRemove)
+  {
+    const MarkerEditLog::Command command { MarkerEditLog::Command::removeMarker, marker->id, marker->pos,
+                                          marker->committedTitle, {} };
+    eraseMarker(marker->id);
+    recordEdit(command);
+  }
+  
+  flushJournal();
+  resized();
+  markersChanged();
 }
 
-void WaveMarkerComp::mouseDrag (const MouseEvent& e)
+
+juce::int64 WaveMarkerComp::addRegion (double start, double end, const juce::String &title)
 {
-  if (canMoveTransport())
-    transportSource.setPosition (jmax (0.0, xToTime ((float) e.x)));
+  if (! (start < end))
+    return 0;
+  
+  const MarkerRegion region { start, end, title, nextMarkerId++ };
+  regionIndex.add(region);
+  
+  editLog.beginTransaction();
+  recordEdit({ MarkerEditLog::Command::addRegion, region.id, start, title, {}, end });
+  flushJournal();
+  repaint();
+  return region.id;
 }
 
-void WaveMarkerComp::mouseMove(const MouseEvent& e)
+
+void WaveMarkerComp::removeRegion (juce::int64 id)
 {
-  lastMousePos = e.getPosition();
+  auto *region = regionIndex.find(id);
+  if (region == nullptr)
+    return;
+  
+  const MarkerEditLog::Command command { MarkerEditLog::Command::removeRegion, id, region->start,
+                                        region->title, {}, region->end };
+  regionIndex.remove(id);
+  
+  editLog.beginTransaction();
+  recordEdit(command);
+  flushJournal();
+  repaint();
 }
 
 
-void WaveMarkerComp::mouseUp (const MouseEvent&)
+void WaveMarkerComp::retitleRegion (juce::int64 id, const juce::String &title)
 {
- // transportSource.start();
+  auto *region = regionIndex.find(id);
+  if (region == nullptr || region->title == title)
+    return;
+  
+  editLog.beginTransaction();
+  recordEdit({ MarkerEditLog::Command::retitleRegion, id, region->start, title, region->title, region->end });
+  regionIndex.setTitle(id, title);
+  flushJournal();
+  repaint();
 }
 
-void WaveMarkerComp::mouseWheelMove (const MouseEvent&, const MouseWheelDetails& wheel)
+
+void WaveMarkerComp::showRegionMenu (juce::int64 id)
 {
-  if (thumbnail.getTotalLength() > 0.0)
+  auto *region = regionIndex.find(id);
+  if (region == nullptr)
+    return;
+  
+  const juce::String title = region->title;
+  PopupMenu menu;
+  menu.addSectionHeader(title);
+  menu.addItem(1, "Rename...");
+  menu.addItem(2, "Remove");
+  
+  const int result = menu.show();
+  
+  if (result == 1)
   {
-    auto newStart = visibleRange.getStart() - wheel.deltaX * (visibleRange.getLength()) / 10.0;
-    newStart = jlimit (0.0, jmax (0.0, thumbnail.getTotalLength() - (visibleRange.getLength())), newStart);
-    
-    if (canMoveTransport())
-      setRange ({ newStart, newStart + visibleRange.getLength() });
-    
-    if (wheel.deltaY != 0.0f)
-      zoomSlider.setValue (zoomSlider.getValue() - wheel.deltaY);
+    AlertWindow window ("Rename region", {}, AlertWindow::NoIcon);
+    window.addTextEditor ("title", title, "Title:");
+    window.addButton ("Rename", 1, KeyPress (KeyPress::returnKey));
+    window.addButton ("Cancel", 0, KeyPress (KeyPress::escapeKey));
     
-    repaint();
+    if (window.runModalLoop() != 0)
+      retitleRegion(id, window.getTextEditorContents ("title"));
+  }
+  else if (result == 2)
+  {
+    removeRegion(id);
   }
 }
 
 
-float WaveMarkerComp::timeToX (const double time) const
+bool WaveMarkerComp::undo()
 {
-  if (visibleRange.getLength() <= 0)
-    return 0;
+  if (! editLog.undo(*this))
+    return false;
   
-  return getWidth() * (float) ((time - visibleRange.getStart()) / visibleRange.getLength());
-}
-
-double WaveMarkerComp::xToTime (const float x) const
-{
-  return (x / getWidth()) * (visibleRange.getLength()) + visibleRange.getStart();
-}
-
-bool WaveMarkerComp::canMoveTransport() const noexcept
-{
-  return ! (isFollowingTransport && transportSource.isPlaying());
+  flushJournal();
+  resized();
+  markersChanged();
+  return true;
 }
 
-void WaveMarkerComp::scrollBarMoved (ScrollBar* scrollBarThatHasMoved, double newRangeStart)
-{
-  if (scrollBarThatHasMoved == &scrollbar)
-    if (! (isFollowingTransport && transportSource.isPlaying()))
-      setRange (visibleRange.movedToStartAt (newRangeStart));
-}
 
-void WaveMarkerComp::timerCallback()
+bool WaveMarkerComp::redo()
 {
+  if (! editLog.redo(*this))
+    return false;
   
-  repaint(0, 0, getWidth(), addMarker.getHeight());
-  
-  if (canMoveTransport())
-    updateCursorPosition();
-  else
-    setRange (visibleRange.movedToStartAt (transportSource.getCurrentPosition() - (visibleRange.getLength() / 2.0)));
+  flushJournal();
+  resized();
+  markersChanged();
+  return true;
 }
 
-void WaveMarkerComp::updateCursorPosition()
-{
 
-  currentPositionMarker.setBounds(timeToX (transportSource.getCurrentPosition()) - 0.75f, addMarker.getBottom(),
-                                                        50.f, (float) (getHeight() - scrollbar.getHeight() - addMarker.getBottom()));
-  
-  if (thumbnail.getTotalLength() > 0.0)
+void WaveMarkerComp::applyEdit (const MarkerEditLog::Command& command, bool forward)
+{
+  switch (command.type)
   {
-    for (auto &marker : markers)
+    case MarkerEditLog::Command::addMarker:
+    case MarkerEditLog::Command::removeMarker:
+      if ((command.type == MarkerEditLog::Command::addMarker) == forward)
+        createMarker(command.time, command.title, command.markerId);
+      else
+        eraseMarker(command.markerId);
+      break;
+      
+    case MarkerEditLog::Command::retitleMarker:
     {
-      if (marker->pos >= visibleRange.getStart() && marker->pos < visibleRange.getEnd())
+      auto found = markersById.find(command.markerId);
+      if (found != markersById.end())
       {
-        float curPos = timeToX(marker->pos) - 0.75f;
-        marker->setVisible(true);
-        marker->setBounds(curPos, addMarker.getBottom(), 200, getHeight() - scrollbar.getHeight() - addMarker.getBottom());
+        MarkerInfo *marker = *found->second;
+        marker->committedTitle = forward ? command.title : command.previousTitle;
+        marker->editTitle.setText(marker->committedTitle, false);
+        markerIndex.update(marker, marker->pos, marker->committedTitle);
+        marker->repaint();
       }
-      else
-        marker->setVisible(false);
+      break;
     }
+      
+    case MarkerEditLog::Command::addRegion:
+    case MarkerEditLog::Command::removeRegion:
+      if ((command.type == MarkerEditLog::Command::addRegion) == forward)
+        regionIndex.add({ command.time, command.endTime, command.title, command.markerId });
+      else
+        regionIndex.remove(command.markerId);
+      break;
+      
+    case MarkerEditLog::Command::retitleRegion:
+      regionIndex.setTitle(command.markerId, forward ? command.title : command.previousTitle);
+      break;
   }
-
+  
+  pendingJournal << MarkerEditLog::toJournalLine(command, forward);
+  ++journalEntries;
+}
+
+
+void WaveMarkerComp::recordEdit (const MarkerEditLog::Command& command)
+{
+  editLog.record(command);
+  pendingJournal << MarkerEditLog::toJournalLine(command, true);
+  ++journalEntries;
+}
+
+
+// appends the edits of one user action to the journal; the sidecar itself is
+// only rewritten when the journal gets long (see timerCallback) and on close
+void WaveMarkerComp::flushJournal()
+{
+  if (markersLocation == File())
+  {
+    pendingJournal.clear();
+    journalEntries = 0;
+    return;
+  }
+  
+  if (pendingJournal.isEmpty())
+    return;
+  
+  FileOutputStream out (MarkerEditLog::getJournalFile(markersLocation));
+  if (out.openedOk())
+    out << pendingJournal;
+  pendingJournal.clear();
+  lastEditTime = Time::getMillisecondCounter();
+}
+
+
+void WaveMarkerComp::clearMarkers()
+{
+  markerIndex.clear();
+  markerDensity.clear();
+  shownMarkers.clear();
+  markersById.clear();
+  markers.clear();
+  regionIndex.clear();
+}
+
+
+void WaveMarkerComp::markersChanged()
+{
+  if (onMarkersChanged)
+    onMarkersChanged();
+}
+
+
+void WaveMarkerComp::saveMarkers()
+{
+  // the watcher may not have reported a write made just before this one yet, and
+  // off Linux it only looks once a second: what it would merge is merged here first
+  if (SidecarMerge::mayHaveChanged(markersLocation, sidecarStamp))
+    mergeSidecar();
+  
+  juce::XmlElement root("Markers");
+  juce::Array<SidecarMerge::Marker> saved;
+  for (auto &marker: markers)
+  {
+    auto m = root.createNewChildElement("Marker");
+    m->setAttribute("Time", marker->pos);
+    m->setAttribute("Title", marker->committedTitle);
+    
+    // findings of a QC pass keep the type the sidecar gave them; a marker added or
+    // retitled here is the user's, whatever its title says
+    const auto type = SidecarMerge::getType(sidecarBase, marker->pos, marker->committedTitle);
+    if (type.isNotEmpty())
+      m->setAttribute("Type", type);
+    saved.add({ marker->pos, marker->committedTitle, type });
+  }
+  
+  juce::Array<const MarkerRegion*> regions;
+  juce::Array<SidecarMerge::Region> savedRegions;
+  regionIndex.getAllRegions(regions);
+  for (auto *region : regions)
+  {
+    auto r = root.createNewChildElement("Region");
+    r->setAttribute("Start", region->start);
+    r->setAttribute("End", region->end);
+    r->setAttribute("Title", region->title);
+    savedRegions.add({ region->start, region->end, region->title });
+  }
+  
+  bool res = root.writeToFile(markersLocation, "");
+  jassert(res);
+  
+  // the sidecar now holds everything the journal recorded
+  if (res)
+  {
+    MarkerEditLog::getJournalFile(markersLocation).deleteFile();
+    
+    sidecarBase.swapWith(saved);
+    SidecarMerge::sort(sidecarBase);
+    sidecarRegionBase.swapWith(savedRegions);
+    SidecarMerge::sort(sidecarRegionBase);
+    sidecarStamp = SidecarMerge::getStamp(markersLocation);
+  }
+  journalEntries = 0;
+}
+
+
+// the sidecar, or the cue markers written into the WAV itself when there is no
+// sidecar yet, plus any journal left behind by edits that were not saved in full
+void WaveMarkerComp::loadMarkers()
+{
+  juce::Array<double> times;
+  juce::StringArray titles, types;
+  juce::Array<MarkerRegion> regions;
+  
+  // stamped before reading, so a write in between is looked at again
+  sidecarStamp = SidecarMerge::getStamp(markersLocation);
+  ScopedPointer<XmlElement> root (XmlDocument::parse(markersLocation));
+  
+  if (root != nullptr)
+  {
+    for (int i = 0; i < root->getNumChildElements(); ++i)
+    {
+      auto m = root->getChildElement(i);
+      if (m->getTagName() == "Marker")
+      {
+        times.add(m->getDoubleAttribute("Time"));
+        titles.add(m->getStringAttribute("Title"));
+        types.add(m->getStringAttribute("Type"));
+      }
+      else if (m->getTagName() == "Region")
+      {
+        regions.add({ m->getDoubleAttribute("Start"), m->getDoubleAttribute("End"), m->getStringAttribute("Title") });
+      }
+    }
+  }
+  else
+  {
+    juce::Array<WavCueChunks::CueMarker> cues;
+    WavCueChunks::read(audioLocation, cues);
+    for (auto &cue : cues)
+    {
+      times.add(cue.time);
+      titles.add(cue.title);
+    }
+  }
+  
+  sidecarBase.clearQuick();
+  sidecarRegionBase.clearQuick();
+  if (root != nullptr)
+  {
+    for (int i = 0; i < times.size(); ++i)
+      sidecarBase.add({ times[i], titles[i], types[i] });
+    SidecarMerge::sort(sidecarBase);
+    
+    for (auto &region : regions)
+      sidecarRegionBase.add({ region.start, region.end, region.title });
+    SidecarMerge::sort(sidecarRegionBase);
+  }
+  
+  const bool hadJournal = MarkerEditLog::replayJournal(markersLocation, times, titles, &regions) > 0;
+  
+  clearMarkers();
+  editLog.clear();
+  pendingJournal.clear();
+  journalEntries = 0;
+  
+  for (int i = 0; i < times.size(); ++i)
+    createMarker(times[i], titles[i]);
+  
+  for (auto &region : regions)
+  {
+    if (! (region.start < region.end))
+      continue;
+    region.id = nextMarkerId++;
+    regionIndex.add(region);
+  }
+  
+  if (hadJournal)
+    saveMarkers();
+  
+  watchSidecar();
+  resized();
+  markersChanged();
+}
+
+
+void WaveMarkerComp::watchSidecar()
+{
+  sidecarWatcher.clear();
+  sidecarChanged = false;
+  
+  if (markersLocation != File())
+    sidecarWatcher.watchFile(markersLocation);
+}
+
+
+// Applies what another program changed in the sidecar since it was last read or
+// written here, marker by marker and region by region. The external changes are
+// not undoable and not journaled: the sidecar holds them already.
+void WaveMarkerComp::mergeSidecar()
+{
+  const auto stamp = SidecarMerge::getStamp(markersLocation);
+  juce::Array<SidecarMerge::Marker> theirs;
+  juce::Array<SidecarMerge::Region> theirRegions;
+  if (! SidecarMerge::read(markersLocation, theirs, &theirRegions))
+    return;   // removed, or caught half written: the write's next event brings the rest
+  
+  sidecarStamp = stamp;
+  juce::Array<SidecarMerge::Change> changes;
+  juce::Array<SidecarMerge::RegionChange> regionChanges;
+  SidecarMerge::diff(sidecarBase, theirs, changes);
+  SidecarMerge::diff(sidecarRegionBase, theirRegions, regionChanges);
+  sidecarBase.swapWith(theirs);
+  sidecarRegionBase.swapWith(theirRegions);
+  
+  if (changes.isEmpty() && regionChanges.isEmpty())
+    return;   // our own save
+  
+  juce::StringArray conflicts;
+  juce::Array<MarkerInfo*> atTime;
+  std::unordered_set<MarkerInfo*> matched;
+  
+  auto describe = [] (double time) { return juce::String(time, 3) + " s: "; };
+  
+  // a marker here at that time, with that title unless null, not matched to a change yet
+  auto findAt = [&] (double time, const juce::String* title) -> MarkerInfo*
+  {
+    markerDensity.getMarkersInRange({ time - SidecarMerge::timeTolerance, time + 2 * SidecarMerge::timeTolerance }, atTime);
+    for (auto *marker : atTime)
+      if (matched.count(marker) == 0 && (title == nullptr || marker->committedTitle == *title))
+        return marker;
+    return nullptr;
+  };
+  
+  // every change is matched against the markers as they were before any is applied;
+  // an add is applied when there is no target, the others when there is one
+  juce::Array<MarkerInfo*> targets;
+  for (auto &change : changes)
+  {
+    MarkerInfo *target = nullptr;
+    
+    switch (change.type)
+    {
+      case SidecarMerge::Change::add:
+        // made here as well when found
+        target = findAt(change.time, &change.title);
+        break;
+        
+      case SidecarMerge::Change::remove:
+        target = findAt(change.time, &change.title);
+        if (target == nullptr)
+          if (auto *renamed = findAt(change.time, nullptr))
+            conflicts.add(describe(change.time) + "\"" + change.title + "\" was removed from the file but renamed here to \""
+                          + renamed->committedTitle + "\"; kept");
+        break;
+        
+      case SidecarMerge::Change::retitle:
+        target = findAt(change.time, &change.previousTitle);
+        if (target == nullptr && findAt(change.time, &change.title) == nullptr)
+        {
+          if (auto *renamed = findAt(change.time, nullptr))
+            conflicts.add(describe(change.time) + "renamed to \"" + change.title + "\" in the file but to \""
+                          + renamed->committedTitle + "\" here; kept \"" + renamed->committedTitle + "\"");
+          else
+            conflicts.add(describe(change.time) + "renamed to \"" + change.title + "\" in the file but removed here");
+        }
+        break;
+    }
+    
+    targets.add(target);
+    if (target != nullptr)
+      matched.insert(target);
+  }
+  
+  for (int i = 0; i < changes.size(); ++i)
+  {
+    const auto &change = changes.getReference(i);
+    MarkerInfo *target = targets[i];
+    
+    switch (change.type)
+    {
+      case SidecarMerge::Change::add:
+        if (target == nullptr)
+          createMarker(change.time, change.title);
+        break;
+        
+      case SidecarMerge::Change::remove:
+        if (target != nullptr)
+          eraseMarker(target->id);
+        break;
+        
+      case SidecarMerge::Change::retitle:
+        if (target != nullptr)
+        {
+          target->committedTitle = change.title;
+          target->editTitle.setText(change.title, false);
+          markerIndex.update(target, target->pos, target->committedTitle);
+          target->repaint();
+        }
+        break;
+    }
+  }
+  
+  mergeRegions(regionChanges, conflicts);
+  
+  resized();
+  markersChanged();
+  
+  if (conflicts.size() > 0 && onSidecarConflicts)
+    onSidecarConflicts(conflicts);
+}
+
+
+// A region retitled in the file comes as a removal and an addition with the same
+// bounds; when it was renamed or removed here as well, this side is kept.
+void WaveMarkerComp::mergeRegions (const juce::Array<SidecarMerge::RegionChange> &changes, juce::StringArray &conflicts)
+{
+  auto sameBounds = [] (const SidecarMerge::Region &a, double start, double end)
+  {
+    return std::abs(a.start - start) <= SidecarMerge::timeTolerance && std::abs(a.end - end) <= SidecarMerge::timeTolerance;
+  };
+  
+  // the region here with those bounds, with that title unless null
+  juce::Array<const MarkerRegion*> found;
+  auto findRegion = [&] (const SidecarMerge::Region &r, const juce::String *title) -> const MarkerRegion*
+  {
+    regionIndex.getRegionsOverlapping({ r.start - SidecarMerge::timeTolerance, r.start + SidecarMerge::timeTolerance }, found);
+    for (auto *region : found)
+      if (sameBounds(r, region->start, region->end) && (title == nullptr || region->title == *title))
+        return region;
+    return nullptr;
+  };
+  
+  // the other half of a retitle in the file
+  auto findPair = [&] (int index) -> const SidecarMerge::Region*
+  {
+    const auto &change = changes.getReference(index);
+    for (auto &other : changes)
+      if (other.type != change.type && sameBounds(other.region, change.region.start, change.region.end))
+        return &other.region;
+    return nullptr;
+  };
+  
+  auto describe = [] (const SidecarMerge::Region &r)
+  {
+    return juce::String(r.start, 3) + " - " + juce::String(r.end, 3) + " s: ";
+  };
+  
+  // every change is matched against the regions as they were before any is applied,
+  // by id, as adding and removing moves them
+  juce::Array<juce::int64> targets;
+  juce::Array<bool> skipped;
+  for (int i = 0; i < changes.size(); ++i)
+  {
+    const auto &change = changes.getReference(i);
+    const auto *target = findRegion(change.region, &change.region.title);
+    const auto *other = target == nullptr ? findRegion(change.region, nullptr) : nullptr;
+    const auto *pair = findPair(i);
+    bool skip = false;
+    
+    if (change.type == SidecarMerge::RegionChange::remove && target == nullptr && other != nullptr)
+    {
+      conflicts.add(describe(change.region) + "\"" + change.region.title
+                    + (pair != nullptr ? "\" was renamed to \"" + pair->title + "\" in the file" : "\" was removed from the file")
+                    + " but renamed here to \"" + other->title + "\"; kept");
+    }
+    else if (change.type == SidecarMerge::RegionChange::add && target == nullptr && pair != nullptr)
+    {
+      // the retitle's removal reports a rename here; this reports a removal here
+      skip = findRegion(*pair, &pair->title) == nullptr;
+      if (skip && findRegion(*pair, nullptr) == nullptr)
+        conflicts.add(describe(change.region) + "renamed to \"" + change.region.title + "\" in the file but removed here");
+    }
+    
+    targets.add(target != nullptr ? target->id : 0);
+    skipped.add(skip);
+  }
+  
+  for (int i = 0; i < changes.size(); ++i)
+  {
+    const auto &change = changes.getReference(i);
+    
+    if (change.type == SidecarMerge::RegionChange::remove)
+      regionIndex.remove(targets[i]);
+    else if (targets[i] == 0 && ! skipped[i] && change.region.start < change.region.end)
+      regionIndex.add({ change.region.start, change.region.end, change.region.title, nextMarkerId++ });
+  }
+  
+  if (! changes.isEmpty())
+    repaint();
+}
+
+
+bool WaveMarkerComp::embedMarkersInFile (juce::String& error)
+{
+  if (! WavCueChunks::isWavFile(audioLocation))
+  {
+    error = "Cue markers can only be embedded into WAV files";
+    return false;
+  }
+  
+  juce::Array<WavCueChunks::CueMarker> cues;
+  for (auto &marker : markers)
+    cues.add({ marker->pos, marker->committedTitle });
+  
+  std::sort(cues.begin(), cues.end(),
+            [] (const WavCueChunks::CueMarker& a, const WavCueChunks::CueMarker& b) { return a.time < b.time; });
+  
+  return WavCueChunks::write(audioLocation, cues, error);
+}
+
+juce::Rectangle<int> WaveMarkerComp::getLaneArea() const
+{
+  auto area = getLocalBounds().removeFromBottom(getHeight()*0.50);
+  area.removeFromBottom (scrollbar.getHeight() + 4);
+  return area;
+}
+
+void WaveMarkerComp::layoutLanes()
+{
+  auto visible = getVisibleChannels();
+  auto lanes = getLaneArea();
+  
+  for (auto* header : laneHeaders)
+  {
+    const int lane = visible.indexOf (header->channel);
+    header->setVisible (lane >= 0 && laneHeaders.size() > 1);
+    
+    if (lane >= 0)
+      header->setBounds (2, lanes.getY() + lanes.getHeight() * lane / visible.size() + 2, 56, 16);
+  }
+}
+
+juce::Array<int> WaveMarkerComp::getVisibleChannels() const
+{
+  juce::Array<int> channels;
+  for (int ch = 0; ch < laneHeaders.size(); ++ch)
+    if (! hiddenChannels[ch])
+      channels.add (ch);
+  return channels;
+}
+
+juce::Array<int> WaveMarkerComp::getAudibleChannels() const
+{
+  juce::Array<int> channels;
+  for (auto ch : getVisibleChannels())
+    if (soloChannels.isZero() || soloChannels[ch])
+      channels.add (ch);
+  return channels;
+}
+
+void WaveMarkerComp::setChannelHidden (int channel, bool shouldBeHidden)
+{
+  if (! isPositiveAndBelow (channel, laneHeaders.size()) || hiddenChannels[channel] == shouldBeHidden)
+    return;
+  
+  // the last visible lane stays
+  if (shouldBeHidden && getVisibleChannels().size() <= 1)
+    return;
+  
+  hiddenChannels.setBit (channel, shouldBeHidden);
+  updateThumbnailSource();
+  audibleChannelsChanged();
+}
+
+void WaveMarkerComp::setChannelSolo (int channel, bool shouldBeSoloed)
+{
+  if (! isPositiveAndBelow (channel, laneHeaders.size()))
+    return;
+  
+  soloChannels.setBit (channel, shouldBeSoloed);
+  laneHeaders[channel]->soloButton.setToggleState (shouldBeSoloed, dontSendNotification);
+  audibleChannelsChanged();
+}
+
+void WaveMarkerComp::showAllChannels()
+{
+  if (hiddenChannels.isZero())
+    return;
+  
+  hiddenChannels.clear();
+  updateThumbnailSource();
+  audibleChannelsChanged();
+}
+
+void WaveMarkerComp::updateThumbnailSource()
+{
+  if (tailFollower.isFollowing())
+  {
+    // other lanes: their peaks are read from the start
+    String error;
+    tailFollower.start (audioLocation, *thumbnail, getVisibleChannels(), 0, error);
+    liveLength = 0;
+    layoutLanes();
+    repaint();
+    return;
+  }
+  
+  AudioFormatReader* reader = createReader();
+  if (reader == nullptr)
+    return;
+  
+  // the peaks of a remote file come from a few ranged reads rather than the whole file
+  if (remoteCache != nullptr)
+    reader = new RemoteOverviewReader (reader, remoteCache->getTotalLength());
+  
+  // peaks of multi-day files are coarser, which keeps the thumbnail to a few tens of MB
+  int resolution = 512;
+  while (reader->lengthInSamples / resolution > maxThumbnailPoints)
+    resolution *= 2;
+  
+  if (resolution != thumbnailResolution && liveRecorder == nullptr)
+  {
+    thumbnail->removeChangeListener (this);
+    thumbnail = new AudioThumbnail (resolution, formatManager, thumbnailCache);
+    thumbnail->addChangeListener (this);
+    thumbnailResolution = resolution;
+  }
+  
+  // the cache key covers the file and the set of lanes whose peaks it holds
+  auto visible = getVisibleChannels();
+  String channelKey;
+  for (auto ch : visible)
+    channelKey << ch << ",";
+  
+  const int64 fileKey = remoteCache != nullptr ? remoteCache->getCacheKey()
+                                               : audioLocation.hashCode64() ^ audioLocation.getLastModificationTime().toMilliseconds();
+  const int64 hash = fileKey ^ channelKey.hashCode64() ^ thumbnailResolution;
+  
+  thumbnail->setReader (new ChannelSubsetReader (reader, visible), hash);
+  layoutLanes();
+  repaint();
+}
+
+AudioFormatReader* WaveMarkerComp::createReader()
+{
+  if (remoteCache != nullptr)
+    return formatManager.createReaderFor (new RemoteInputStream (remoteCache));
+  
+  if (audioLocation.existsAsFile())
+    return MappedChannelReader::createFor (formatManager, audioLocation);
+  
+  return nullptr;
+}
+
+void WaveMarkerComp::audibleChannelsChanged()
+{
+  if (onAudibleChannelsChanged)
+    onAudibleChannelsChanged();
+}
+
+bool WaveMarkerComp::startLiveRecording (const juce::File& file, LiveRecorder& recorder, juce::String& error)
+{
+  if (journalEntries > 0)
+    saveMarkers();
+  
+  audioLocation = file;
+  markersLocation = file.getFullPathName() + MarkerFilesExt;
+  markersLocation.deleteFile();
+  MarkerEditLog::getJournalFile(markersLocation).deleteFile();
+  
+  laneHeaders.clear();
+  hiddenChannels.clear();
+  soloChannels.clear();
+  clearMarkers();
+  editLog.clear();
+  pendingJournal.clear();
+  journalEntries = 0;
+  sidecarBase.clearQuick();
+  sidecarRegionBase.clearQuick();
+  sidecarStamp = SidecarMerge::getStamp(markersLocation);
+  watchSidecar();
+  
+  // resets the thumbnail and has the writer thread append every block it writes
+  if (! recorder.start (file, thumbnail.get(), error))
+    return false;
+  
+  liveRecorder = &recorder;
+  liveLength = 0;
+  
+  const Range<double> initialView (0.0, 30.0);
+  scrollbar.setRangeLimits (initialView);
+  setRange (initialView);
+  startTimerHz (40);
+  
+  resized();
+  markersChanged();
+  return true;
+}
+
+void WaveMarkerComp::stopLiveRecording()
+{
+  liveRecorder = nullptr;
+  repaint();
+}
+
+void WaveMarkerComp::followGrowingLength (double newLength)
+{
+  const double previousLength = liveLength;
+  liveLength = newLength;
+  scrollbar.setRangeLimits ({ 0.0, jmax (liveLength, visibleRange.getLength()) });
+  
+  // keeps following the end only while it was in view
+  if (liveLength > visibleRange.getEnd() && previousLength <= visibleRange.getEnd())
+    setRange (visibleRange.movedToEndAt (liveLength));
+}
+
+bool WaveMarkerComp::startTailFollow (juce::String& error)
+{
+  if (! audioLocation.existsAsFile())
+  {
+    error = "No local file is open";
+    return false;
+  }
+  
+  // the peaks of what was read at open are kept, but for the last point, which may
+  // have been cut short by the end of the file; only what follows is read
+  const auto visible = getVisibleChannels();
+  int64 peaked = 0;
+  if (thumbnail->isFullyLoaded() && thumbnail->getNumChannels() == visible.size())
+    peaked = jmax ((int64) 0, thumbnail->getNumSamplesFinished() - thumbnailResolution);
+  
+  if (! tailFollower.start (audioLocation, *thumbnail, visible, peaked, error))
+    return false;
+  
+  liveLength = 0;
+  return true;
+}
+
+void WaveMarkerComp::stopTailFollow()
+{
+  tailFollower.stop();
+}
+
+void WaveMarkerComp::getMarkers (juce::Array<double>& times, juce::StringArray& titles) const
+{
+  for (auto &marker : markers)
+  {
+    times.add(marker->pos);
+    titles.add(marker->committedTitle);
+  }
+}
+
+
+
+void WaveMarkerComp::showMarker (double time)
+{
+  transportSource.setPosition (jmax (0.0, time));
+  if (onSeek)
+    onSeek();
+  
+  if (! visibleRange.contains (time))
+    setRange (visibleRange.movedToStartAt (jmax (0.0, time - visibleRange.getLength() / 2.0)));
+  else
+    updateCursorPosition();
+}
+
+
+
+bool WaveMarkerComp::getMarkersAround (double time, Range<double>& region) const
+{
+  double start = 0.0;
+  double end = thumbnail->getTotalLength();
+  
+  for (auto &marker : markers)
+  {
+    if (marker->pos <= time)
+      start = jmax (start, marker->pos);
+    else
+      end = jmin (end, marker->pos);
+  }
+  
+  region = { start, end };
+  return end > start;
+}
+
+
+void WaveMarkerComp::setLoopSource (LoopRegionSource* source)
+{
+  loopSource = source;
+  repaint();
+}
+
+
+double WaveMarkerComp::getPlayPosition() const
+{
+  if (liveRecorder != nullptr)
+    return liveRecorder->getRecordedSeconds();
+  
+  if (loopSource != nullptr)
+    return loopSource->toFileTime (transportSource.getCurrentPosition());
+  
+  return transportSource.getCurrentPosition();
+}
+
+void WaveMarkerComp::setDeviceLatency (double outputSeconds, double inputSeconds)
+{
+  outputLatency = outputSeconds;
+  inputLatency = inputSeconds;
+  updateCursorPosition();
+}
+
+double WaveMarkerComp::getHeardPosition() const
+{
+  // what is happening now reaches the file inputSeconds later
+  if (liveRecorder != nullptr)
+    return liveRecorder->getRecordedSeconds() + inputLatency;
+  
+  // a stopped transport is heard where it stands
+  if (! transportSource.isPlaying())
+    return getPlayPosition();
+  
+  const double heard = jmax (0.0, transportSource.getCurrentPosition() - outputLatency);
+  return loopSource != nullptr ? loopSource->toFileTime (heard) : heard;
+}
+
+
+
+void WaveMarkerComp::mouseDown (const MouseEvent& e)
+{
+  if (e.mods.isPopupMenu())
+  {
+    // the innermost region under the mouse
+    regionIndex.getRegionsAt (xToTime ((float) e.x), shownRegions);
+    const MarkerRegion* hit = nullptr;
+    for (auto* region : shownRegions)
+      if (hit == nullptr || region->end - region->start < hit->end - hit->start)
+        hit = region;
+    
+    if (hit != nullptr)
+    {
+      showRegionMenu (hit->id);
+      return;
+    }
+  }
+  
+  if (e.mods.isShiftDown() && thumbnail->getTotalLength() > 0.0)
+  {
+    isDraggingRegion = true;
+    regionDrag = Range<double>::emptyRange (xToTime ((float) e.x));
+    return;
+  }
+  
+  mouseDrag (e);
+}
+
+void WaveMarkerComp::mouseDrag (const MouseEvent& e)
+{
+  if (isDraggingRegion)
+  {
+    regionDrag = Range<double>::between (xToTime ((float) e.getMouseDownX()), xToTime ((float) e.x))
+                   .getIntersectionWith ({ 0.0, thumbnail->getTotalLength() });
+    repaint();
+    return;
+  }
+  
+  if (canMoveTransport())
+  {
+    transportSource.setPosition (jmax (0.0, xToTime ((float) e.x)));
+    if (onSeek)
+      onSeek();
+  }
+}
+
+void WaveMarkerComp::mouseMove(const MouseEvent& e)
+{
+  lastMousePos = e.getPosition();
+}
+
+
+void WaveMarkerComp::mouseUp (const MouseEvent&)
+{
+  if (isDraggingRegion)
+  {
+    isDraggingRegion = false;
+    
+    // a shift-click without a drag makes none
+    if (timeToX (regionDrag.getEnd()) - timeToX (regionDrag.getStart()) >= 2.0f)
+      addRegion (regionDrag.getStart(), regionDrag.getEnd(), "NEW REGION");
+    repaint();
+  }
+  
+ // transportSource.start();
+}
+
+void WaveMarkerComp::mouseWheelMove (const MouseEvent&, const MouseWheelDetails& wheel)
+{
+  if (thumbnail->getTotalLength() > 0.0)
+  {
+    auto newStart = visibleRange.getStart() - wheel.deltaX * (visibleRange.getLength()) / 10.0;
+    newStart = jlimit (0.0, jmax (0.0, thumbnail->getTotalLength() - (visibleRange.getLength())), newStart);
+    
+    if (canMoveTransport())
+      setRange ({ newStart, newStart + visibleRange.getLength() });
+    
+    if (wheel.deltaY != 0.0f)
+      zoomSlider.setValue (zoomSlider.getValue() - wheel.deltaY);
+    
+    repaint();
+  }
+}
+
+
+float WaveMarkerComp::timeToX (const double time) const
+{
+  if (visibleRange.getLength() <= 0)
+    return 0;
+  
+  return getWidth() * (float) ((time - visibleRange.getStart()) / visibleRange.getLength());
+}
+
+double WaveMarkerComp::xToTime (const float x) const
+{
+  return (x / getWidth()) * (visibleRange.getLength()) + visibleRange.getStart();
+}
+
+bool WaveMarkerComp::canMoveTransport() const noexcept
+{
+  return ! (isFollowingTransport && transportSource.isPlaying());
+}
+
+void WaveMarkerComp::scrollBarMoved (ScrollBar* scrollBarThatHasMoved, double newRangeStart)
+{
+  if (scrollBarThatHasMoved == &scrollbar)
+    if (! (isFollowingTransport && transportSource.isPlaying()))
+      setRange (visibleRange.movedToStartAt (newRangeStart));
+}
+
+void WaveMarkerComp::timerCallback()
+{
+  // the thumbnail is appended to by the writer or tail thread; only the view follows here
+  if (liveRecorder != nullptr)
+    followGrowingLength (liveRecorder->getRecordedSeconds());
+  
+  if (tailFollower.isFollowing())
+  {
+    const int64 samples = tailFollower.getLengthInSamples();
+    if (samples / tailFollower.getSampleRate() > liveLength)
+    {
+      followGrowingLength (samples / tailFollower.getSampleRate());
+      if (onLengthExtended)
+        onLengthExtended (samples);
+    }
+  }
+  
+  // merged before any save of ours, which would overwrite the external changes
+  if (sidecarChanged.exchange(false))
+    mergeSidecar();
+  
+  // edits only append to the journal; the sidecar is rewritten once the journal has
+  // grown large against it, at a pause, so each rewrite of the list covers many edits
+  if (journalEntries > jmax (minEditsPerCompaction, (int) (markers.size() / 4))
+       && Time::getMillisecondCounter() - lastEditTime > 2000)
+    saveMarkers();
+  
+  repaint(0, 0, getWidth(), addMarker.getHeight());
+  
+  if (canMoveTransport())
+    updateCursorPosition();
+  else
+    setRange (visibleRange.movedToStartAt (getHeardPosition() - (visibleRange.getLength() / 2.0)));
+}
+
+void WaveMarkerComp::updateCursorPosition()
+{
+
+  currentPositionMarker.setBounds(timeToX (getHeardPosition()) - 0.75f, addMarker.getBottom(),
+                                                        50.f, (float) (getHeight() - scrollbar.getHeight() - addMarker.getBottom()));
+  
+  if (thumbnail->getTotalLength() > 0.0)
+  {
+    // only the markers in view are laid out, and none once they would crowd each other:
+    // then paint() draws clusters from the density summary
+    markerDensity.setLength (jmax (thumbnail->getTotalLength(), liveLength));
+    const bool crowded = markerDensity.countInRange (visibleRange) > getWidth() / minMarkerSpacing;
+    
+    if (crowded != showsClusters)
+    {
+      showsClusters = crowded;
+      repaint();
+    }
+    
+    for (auto *marker : shownMarkers)
+      if (showsClusters || ! (marker->pos >= visibleRange.getStart() && marker->pos < visibleRange.getEnd()))
+        marker->setVisible(false);
+    
+    if (showsClusters)
+      shownMarkers.clearQuick();
+    else
+      markerDensity.getMarkersInRange(visibleRange, shownMarkers);
+    
+    for (auto *marker : shownMarkers)
+    {
+      float curPos = timeToX(marker->pos) - 0.75f;
+      marker->setVisible(true);
+      marker->setBounds(curPos, addMarker.getBottom(), 200, getHeight() - scrollbar.getHeight() - addMarker.getBottom());
+    }
+  }
+
 }
 
 
@@ -344,183 +1522,1243 @@ void WaveMarkerComp::updateCursorPosition()
 
 //*********************************************************************************
 //*********************************************************************************
-//*********************************************************************************
-//*********************************************************************************
-//*********************************************************************************
-//*********************************************************************************
-//*********************************************************************************
+//*********************************************************************************
+//*********************************************************************************
+//*********************************************************************************
+//*********************************************************************************
+//*********************************************************************************
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+PlayerActionsComponent::PlayerActionsComponent()
+{
+  addAndMakeVisible (zoomLabel);
+  zoomLabel.setFont (Font (15.00f, Font::plain));
+  zoomLabel.setJustificationType (Justification::centredRight);
+  zoomLabel.setEditable (false, false, false);
+
+  addAndMakeVisible(gainLabel);
+  gainLabel.setFont(Font(15.00f, Font::plain));
+  gainLabel.setJustificationType(Justification::centredRight);
+  gainLabel.setEditable(false, false, false);
+  
+  addAndMakeVisible (followTransportButton);
+  followTransportButton.onClick = [this] { updateFollowTransportState(); };
+  
+  addAndMakeVisible (zoomSlider);
+  zoomSlider.setRange (0, 1, 0);
+  zoomSlider.onValueChange = [this] { waveMarkerComp->setZoomFactor (zoomSlider.getValue()); };
+  zoomSlider.setSkewFactor (2);
+  
+  addAndMakeVisible (libraryButton);
+  libraryButton.onClick = [this] { showLibrary(); };
+  
+  addAndMakeVisible (embedCuesButton);
+  embedCuesButton.onClick = [this] { embedCues(); };
+  
+  addAndMakeVisible (exportButton);
+  exportButton.onClick = [this] { exportSegments(); };
+  
+  addAndMakeVisible (openURLButton);
+  openURLButton.onClick = [this] { openURL(); };
+  
+  addAndMakeVisible (alignButton);
+  alignButton.onClick = [this] { alignMarkers(); };
+  
+  addAndMakeVisible (resamplerButton);
+  resamplerButton.onClick = [this] { showResamplerMenu(); };
+  
+  addAndMakeVisible (deviceButton);
+  deviceButton.onClick = [this] { showDeviceSettings(); };
+  
+  addAndMakeVisible (previewButton);
+  previewButton.onClick = [this] { showPreviewChain(); };
+  
+  addAndMakeVisible (denoiseButton);
+  denoiseButton.onClick = [this] { showDenoiseMenu(); };
+  
+  addAndMakeVisible(gainSlider);
+  gainSlider.setRange(0, 500, 1);
+  gainSlider.setValue(100.);
+  gainSlider.setPopupDisplayEnabled(true, true, getTopLevelComponent(), 1000);
+  gainSlider.setDoubleClickReturnValue(true, 100.);
+  gainSlider.onValueChange = [this] { audioSourcePlayer.setGain((double)gainSlider.getValue() / 100.); };
+  gainSlider.setSkewFactor(0.4);
+
+
+  waveMarkerComp.reset (new WaveMarkerComp (formatManager, transportSource, zoomSlider));
+  addAndMakeVisible (waveMarkerComp.get());
+  waveMarkerComp->addChangeListener (this);
+  
+  addAndMakeVisible (startPauseButton);
+  startPauseButton.onClick = [this] { startOrPause(); };
+  
+  addAndMakeVisible (stopButton);
+  stopButton.onClick = [this] { stop(); };
+  
+  markerListPanel.reset (new MarkerListPanel (*waveMarkerComp));
+  addChildComponent (markerListPanel.get());
+  
+  compareLanesPanel.reset (new CompareLanesPanel (*waveMarkerComp, formatManager));
+  addChildComponent (compareLanesPanel.get());
+  compareLanesPanel->onSelect = [this] (int index) { selectCompareLane (index); };
+  compareLanesPanel->onRemove = [this] (int index) { removeCompareLane (index); };
+  
+  addAndMakeVisible (showMarkerListButton);
+  showMarkerListButton.onClick = [this] { updateMarkerListVisibility(); };
+  
+  addAndMakeVisible (loopButton);
+  loopButton.onClick = [this] { updateLoopState(); };
+  
+  addAndMakeVisible (recordButton);
+  recordButton.setClickingTogglesState (true);
+  recordButton.setColour (TextButton::buttonOnColourId, ColorRecording);
+  recordButton.onClick = [this] { toggleRecording(); };
+  
+  addAndMakeVisible (tailButton);
+  tailButton.onClick = [this] { updateTailState(); };
+  waveMarkerComp->onLengthExtended = [this] (int64 numSamples) { extendPlayback (numSamples); };
+  waveMarkerComp->onSeek = [this] { if (ramRoutingPending) updateLaneRouting(); };
+  
+  addAndMakeVisible (channelsButton);
+  channelsButton.onClick = [this] { showChannelMenu(); };
+  waveMarkerComp->onAudibleChannelsChanged = [this] { updateAudibleChannels(); };
+  waveMarkerComp->onSidecarConflicts = [] (const StringArray& conflicts)
+  {
+    const int maxShown = 20;
+    StringArray shown (conflicts.begin(), jmin (maxShown, conflicts.size()));
+    if (conflicts.size() > maxShown)
+      shown.add ("... and " + String (conflicts.size() - maxShown) + " more");
+    
+    AlertWindow::showMessageBoxAsync (AlertWindow::WarningIcon, "Markers changed by another program",
+                                      "Merged the changes to the marker file, except where they conflicted with edits made here:\n\n"
+                                      + shown.joinIntoString ("\n"));
+  };
+  
+  addAndMakeVisible (undoButton);
+  undoButton.onClick = [this] { waveMarkerComp->undo(); };
+  addAndMakeVisible (redoButton);
+  redoButton.onClick = [this] { waveMarkerComp->redo(); };
+  
+  addAndMakeVisible (compareButton);
+  compareButton.onClick = [this] { addCompareFiles(); };
+  
+  addAndMakeVisible (ramButton);
+  ramButton.onClick = [this] { updateRamState(); };
+  Component::SafePointer<PlayerActionsComponent> safeThis (this);
+  ramDecoder.onProgress = [safeThis]
+  {
+    if (safeThis != nullptr)
+      safeThis->ramProgressChanged();
+  };
+  
+  // audio setup: registering the formats only creates a few objects; the read-ahead
+  // thread starts with the first file and the device opens after the first paint
+  Wave64AudioFormat::registerFormats (formatManager);
+  
+  audioDeviceManager.addAudioCallback (&audioSourcePlayer);
+  audioDeviceManager.addAudioCallback (&liveRecorder);
+  audioSourcePlayer.setSource (&previewChain);
+  audioDeviceManager.addChangeListener (this);
+  transportSource.addChangeListener (this);
+
+  setSize (500, 500);
+}
+
+PlayerActionsComponent::~PlayerActionsComponent()
+{
+  exportThread = nullptr;
+  urlOpener = nullptr;
+  audioDeviceManager.removeChangeListener (this);
+  transportSource.removeChangeListener (this);
+  
+  transportSource  .setSource (nullptr);
+  audioSourcePlayer.setSource (nullptr);
+  ramDecoder.stop();
+  
+  liveRecorder.stop();
+  waveMarkerComp->stopLiveRecording();
+  audioDeviceManager.removeAudioCallback (&liveRecorder);
+  audioDeviceManager.removeAudioCallback (&audioSourcePlayer);
+
+  if (libraryWindow != nullptr)
+    delete libraryWindow.getComponent();
+  libraryIndex = nullptr;
+  
+  if (deviceWindow != nullptr)
+    delete deviceWindow.getComponent();
+  
+  if (previewWindow != nullptr)
+    delete previewWindow.getComponent();
+  
+  markerListPanel = nullptr;
+  compareLanesPanel = nullptr;
+  waveMarkerComp->removeChangeListener (this);
+}
+
+void PlayerActionsComponent::paint (Graphics& g)
+{
+  if (! deviceOpenPosted)
+  {
+    deviceOpenPosted = true;
+    Component::SafePointer<PlayerActionsComponent> safeThis (this);
+    MessageManager::callAsync ([safeThis]
+    {
+      if (safeThis != nullptr)
+        safeThis->openAudioDevice();
+    });
+  }
+}
+
+void PlayerActionsComponent::resized()
+{
+  auto r = getLocalBounds().reduced (4);
+  
+  auto zoom = r.removeFromTop (25);
+  zoomLabel .setBounds (zoom.removeFromLeft (50));
+  libraryButton.setBounds (zoom.removeFromRight (80));
+  embedCuesButton.setBounds (zoom.removeFromRight (90));
+  exportButton.setBounds (zoom.removeFromRight (70));
+  openURLButton.setBounds (zoom.removeFromRight (80));
+  alignButton.setBounds (zoom.removeFromRight (60));
+  resamplerButton.setBounds (zoom.removeFromRight (80));
+  deviceButton.setBounds (zoom.removeFromRight (60));
+  previewButton.setBounds (zoom.removeFromRight (40));
+  denoiseButton.setBounds (zoom.removeFromRight (70));
+  zoomSlider.setBounds (zoom);
+  
+  auto controls = r.removeFromBottom (25);
+
+  startPauseButton      .setBounds (controls.removeFromLeft(80));
+  stopButton            .setBounds (controls.removeFromLeft(80));
+  followTransportButton.setBounds (controls.removeFromLeft (100));
+  showMarkerListButton.setBounds (controls.removeFromLeft (80));
+  loopButton.setBounds (controls.removeFromLeft (60));
+  recordButton.setBounds (controls.removeFromLeft (50));
+  tailButton.setBounds (controls.removeFromLeft (60));
+  channelsButton.setBounds (controls.removeFromLeft (80));
+  undoButton.setBounds (controls.removeFromLeft (50));
+  redoButton.setBounds (controls.removeFromLeft (50));
+  compareButton.setBounds (controls.removeFromLeft (70));
+  ramButton.setBounds (controls.removeFromLeft (110));
+
+  auto gain = controls.removeFromRight(200);
+  gainLabel.setBounds(gain.removeFromLeft(30));
+  gainSlider.setBounds(gain);
+
+  if (markerListPanel->isVisible())
+    markerListPanel->setBounds (r.removeFromRight (jmin (260, r.getWidth() / 2)));
+
+  compareLanesPanel->setVisible (compareLanesPanel->getNumLanes() > 1);
+  if (compareLanesPanel->isVisible())
+    compareLanesPanel->setBounds (r.removeFromBottom (jmin (compareLanesPanel->getIdealHeight(), r.getHeight() / 2)));
+
+  waveMarkerComp->setBounds (r);
+}
+
+
+
+bool PlayerActionsComponent::keyPressed (const KeyPress& key)
+{
+  if (key == KeyPress ('z', ModifierKeys::commandModifier, 0))
+    return waveMarkerComp->undo();
+  
+  if (key == KeyPress ('z', ModifierKeys::commandModifier | ModifierKeys::shiftModifier, 0)
+      || key == KeyPress ('y', ModifierKeys::commandModifier, 0))
+    return waveMarkerComp->redo();
+  
+  // 1 is the open file, 2 onwards the compare lanes
+  const juce_wchar c = key.getTextCharacter();
+  if (laneStack.getNumLanes() > 1 && ! key.getModifiers().isAnyModifierKeyDown()
+      && c >= '1' && c < '1' + laneStack.getNumLanes())
+  {
+    selectCompareLane ((int) (c - '1'));
+    return true;
+  }
+  
+  return false;
+}
+
+
+
+void PlayerActionsComponent::showAudioResource (URL resource)
+{
+  if (liveRecorder.isRecording())
+    stopRecording();
+  
+  if (loadURLIntoTransport (resource))
+    currentAudioFile = static_cast<URL&&> (resource);
+  
+  zoomSlider.setValue (0, dontSendNotification);
+  waveMarkerComp->setURL (currentAudioFile);
+  
+  // the RAM mode stays on from file to file
+  updateRamState();
+}
+
+void PlayerActionsComponent::openFiles (const StringArray& files)
+{
+  // the first file given is opened; further local files are added as compare lanes
+  if (files.isEmpty())
+    return;
+  
+  const String& first = files[0];
+  if (first.contains ("://"))
+    openRemote (URL (first));
+  else
+    showAudioResource (URL (File (first)));
+  
+  for (int i = 1; i < files.size(); ++i)
+    if (! files[i].contains ("://"))
+      addCompareLane (File (files[i]));
+}
+
+void PlayerActionsComponent::unloadTransport()
+{
+  transportSource.stop();
+  transportSource.setSource (nullptr);
+  ramDecoder.stop();
+  ramStore = nullptr;
+  ramReader = nullptr;
+  playsFromRam = false;
+  ramRoutingPending = false;
+  ramButton.setButtonText ("RAM");
+  waveMarkerComp->setLoopSource (nullptr);
+  loopSource.reset();
+  laneStack.setMainSource (nullptr, 0);
+  laneSelector.setNumLanes (1);
+  laneSelector.selectLane (0);
+  compareLanesPanel->clear();
+  currentAudioFileSource.reset();
+  mixdownReader = nullptr;
+  resized();
+  loopButton.setToggleState (false, dontSendNotification);
+  tailButton.setToggleState (false, dontSendNotification);
+}
+
+bool PlayerActionsComponent::loadURLIntoTransport (const URL& audioURL)
+{
+  // unload the previous file source and delete it..
+  unloadTransport();
+  
+  if (! thread.isThreadRunning())
+    thread.startThread (5);
+  
+  AudioFormatReader* reader = createReader (audioURL);
+  
+  if (reader != nullptr)
+  {
+    // every channel is decoded and mixed to stereo until lanes are hidden or soloed;
+    // in RAM mode the decoded file is read from memory underneath
+    ramReader = new RamAudioReader (reader);
+    mixdownReader = new ChannelMixdownReader (ramReader);
+    currentAudioFileSource.reset (new AudioFormatReaderSource (mixdownReader, true));
+    currentSampleRate = reader->sampleRate;
+    laneStack.setMainSource (currentAudioFileSource.get(), currentSampleRate);
+    loopSource.reset (new LoopRegionSource (&laneStack, currentSampleRate));
+    waveMarkerComp->setLoopSource (loopSource.get());
+    
+    // ..and plug it into our transport source; rate conversion happens after it,
+    // in the resampler stage, unless JUCE's own interpolation is selected
+    resamplerSource.setSourceSampleRate (reader->sampleRate);
+    transportSource.setSource (loopSource.get(),
+                               getReadAheadSize(),      // tells it to buffer this many samples ahead
+                               &thread,                 // this is the background thread to use for reading-ahead
+                               resamplerSource.getRateForTransport());
+    
+    return true;
+  }
+  
+  return false;
+}
+
+AudioFormatReader* PlayerActionsComponent::createReader (const URL& audioURL)
+{
+  if (audioURL.isLocalFile())
+    return MappedChannelReader::createFor (formatManager, audioURL.getLocalFile());
+  
+  if (! audioURL.isEmpty())
+  {
+    // fetched in chunks as the read-ahead needs them; opened beforehand by openRemote()
+    if (auto cache = RemoteChunkCache::getOpen (audioURL))
+      return formatManager.createReaderFor (new RemoteInputStream (cache));
+  }
+  
+  return nullptr;
+}
+
+// Decode-to-RAM: the open file is decoded into memory once, on a second reader, and every
+// block is played from there as soon as it is in.
+void PlayerActionsComponent::updateRamState()
+{
+  if (ramButton.getToggleState() && ramReader != nullptr && ramStore == nullptr)
+  {
+    ramStore = ramDecoder.start (createReader (currentAudioFile));
+    ramReader->setStore (ramStore.get());
+    
+    if (ramStore == nullptr)
+    {
+      ramButton.setToggleState (false, dontSendNotification);
+      const String error (ramDecoder.getError());
+      AlertWindow::showMessageBoxAsync (AlertWindow::WarningIcon, "Cannot decode into memory",
+                                        error.isNotEmpty() ? error : "The file cannot be read");
+    }
+  }
+  else if (! ramButton.getToggleState() && ramStore != nullptr)
+  {
+    ramDecoder.stop();
+    if (ramReader != nullptr)
+      ramReader->setStore (nullptr);
+    ramStore = nullptr;
+    ramRoutingPending = false;
+    
+    // now: the reads would go to disk on the audio thread
+    if (playsFromRam)
+      updateLaneRouting();
+  }
+  
+  ramProgressChanged();
+}
+
+void PlayerActionsComponent::ramProgressChanged()
+{
+  if (ramStore == nullptr)
+  {
+    ramButton.setButtonText ("RAM");
+    return;
+  }
+  
+  if (! ramDecoder.isDecoding() && ramDecoder.getError().isNotEmpty())
+  {
+    const String error (ramDecoder.getError());
+    ramButton.setToggleState (false, dontSendNotification);
+    updateRamState();
+    AlertWindow::showMessageBoxAsync (AlertWindow::WarningIcon, "Cannot decode into memory", error);
+    return;
+  }
+  
+  if (! ramStore->isComplete())
+  {
+    ramButton.setButtonText ("RAM " + String (ramStore->getNumBlocksStored() * 100 / jmax (1, ramStore->getNumBlocks())) + "%");
+    return;
+  }
+  
+  ramButton.setButtonText ("RAM " + File::descriptionOfSizeInBytes (ramStore->getCompressedBytes()));
+  
+  if (! playsFromRam && canPlayFromRam())
+    routeToRamWhenIdle();
+}
+
+// Once the whole file is in memory a read costs less than the read-ahead copying it, so
+// the transport reads straight from it. Comparison lanes still come from disk and keep it,
+// and so does tail mode, where the reads go past the end of the store as the file grows.
+bool PlayerActionsComponent::canPlayFromRam()
+{
+  return ramStore != nullptr && ramStore->isComplete() && laneStack.getNumLanes() == 1
+      && ! waveMarkerComp->isTailFollowing();
+}
+
+// Dropping the read-ahead rebuilds the transport, which would break into playback: while
+// playing, it waits for the next stop or seek.
+void PlayerActionsComponent::routeToRamWhenIdle()
+{
+  if (transportSource.isPlaying())
+    ramRoutingPending = true;
+  else
+    updateLaneRouting();
+}
+
+int PlayerActionsComponent::getReadAheadSize()
+{
+  playsFromRam = canPlayFromRam();
+  ramRoutingPending = false;
+  return playsFromRam ? 0 : 32768;
+}
+
+
+void PlayerActionsComponent::startOrPause()
+{
+  if (transportSource.isPlaying())
+    transportSource.stop();
+  else
+    transportSource.start();
+}
+
+void PlayerActionsComponent::stop()
+{
+  if (transportSource.isPlaying())
+    transportSource.stop();
+  transportSource.setPosition (0);
+}
+
+
+void PlayerActionsComponent::updateFollowTransportState()
+{
+  waveMarkerComp->setFollowsTransport (followTransportButton.getToggleState());
+}
+
 
+void PlayerActionsComponent::updateMarkerListVisibility()
+{
+  markerListPanel->setVisible (showMarkerListButton.getToggleState());
+  resized();
+}
+
+
+void PlayerActionsComponent::showLibrary()
+{
+  if (libraryWindow != nullptr)
+  {
+    libraryWindow->toFront (true);
+    return;
+  }
+  
+  if (libraryIndex == nullptr)
+    libraryIndex = new LibraryIndex();
+  
+  auto* panel = new LibrarySearchPanel (*libraryIndex);
+  panel->onOpenMarker = [this] (const File& file, double time)
+  {
+    showAudioResource (URL (file));
+    waveMarkerComp->showMarker (time);
+  };
+  
+  DialogWindow::LaunchOptions options;
+  options.content.setOwned (panel);
+  options.dialogTitle = "Library";
+  options.dialogBackgroundColour = ColorDefaultBkg;
+  options.escapeKeyTriggersCloseButton = true;
+  options.useNativeTitleBar = true;
+  options.resizable = true;
+  libraryWindow = options.launchAsync();
+}
+
+void PlayerActionsComponent::showDeviceSettings()
+{
+  if (deviceWindow != nullptr)
+  {
+    deviceWindow->toFront (true);
+    return;
+  }
+  
+  openAudioDevice();
+  
+  DialogWindow::LaunchOptions options;
+  options.content.setOwned (new DeviceSettingsPanel (audioDeviceManager));
+  options.dialogTitle = "Audio device";
+  options.dialogBackgroundColour = ColorDefaultBkg;
+  options.escapeKeyTriggersCloseButton = true;
+  options.useNativeTitleBar = true;
+  options.resizable = true;
+  deviceWindow = options.launchAsync();
+}
 
+void PlayerActionsComponent::showPreviewChain()
+{
+  if (previewWindow != nullptr)
+  {
+    previewWindow->toFront (true);
+    return;
+  }
+  
+  DialogWindow::LaunchOptions options;
+  options.content.setOwned (new PreviewChainPanel (previewChain));
+  options.dialogTitle = "Preview processing";
+  options.dialogBackgroundColour = ColorDefaultBkg;
+  options.escapeKeyTriggersCloseButton = true;
+  options.useNativeTitleBar = true;
+  options.resizable = true;
+  previewWindow = options.launchAsync();
+}
 
+void PlayerActionsComponent::showDenoiseMenu()
+{
+  static const float reductions[] = { 6.0f, 12.0f, 18.0f, 24.0f };
+  
+  PopupMenu menu;
+  const File audioFile = waveMarkerComp->getAudioFile();
+  menu.addItem (1, "Learn noise from this segment", audioFile.existsAsFile());
+  
+  auto profile = denoiseSource.getProfile();
+  menu.addItem (2, "Reduce noise", profile != nullptr, denoiseSource.isEnabled());
+  menu.addSeparator();
+  
+  for (int i = 0; i < numElementsInArray (reductions); ++i)
+    menu.addItem (10 + i, "Reduction " + String (roundToInt (reductions[i])) + " dB", true,
+                  denoiseSource.getReductionDb() == reductions[i]);
+  
+  menu.addSeparator();
+  String status;
+  
+  if (profile == nullptr)
+    status = "No noise profile";
+  else if (! denoiseSource.isActive())
+    status = "Profile of " + String (profile->getLengthSeconds(), 1) + " s, off";
+  else
+    status = "Profile of " + String (profile->getLengthSeconds(), 1) + " s, "
+             + String (roundToInt (denoiseSource.getLatencySeconds() * 1000.0)) + " ms delay, "
+             + String (denoiseSource.getCpuLoad() * 100.0f, 2) + "% CPU";
+  
+  menu.addItem (-1, status, false);
+  
+  const int result = menu.showAt (&denoiseButton);
+  
+  if (result == 1)
+  {
+    Range<double> region;
+    if (! waveMarkerComp->getMarkersAround (waveMarkerComp->getPlayPosition(), region))
+    {
+      AlertWindow::showMessageBoxAsync (AlertWindow::WarningIcon, "Noise reduction",
+                                        "Place the play position between two markers that enclose only noise.");
+      return;
+    }
+    
+    ScopedPointer<AudioFormatReader> reader (formatManager.createReaderFor (audioFile));
+    String error = "Cannot open " + audioFile.getFileName();
+    SpectralDenoiser::Profile::Ptr learned;
+    
+    if (reader != nullptr)
+      learned = SpectralDenoiser::Profile::learn (*reader, (int64) (region.getStart() * reader->sampleRate),
+                                                  (int64) (region.getEnd() * reader->sampleRate), error);
+    
+    if (learned == nullptr)
+    {
+      AlertWindow::showMessageBoxAsync (AlertWindow::WarningIcon, "Noise reduction", error);
+      return;
+    }
+    
+    denoiseSource.setProfile (learned);
+    denoiseSource.setEnabled (true);
+  }
+  else if (result == 2)
+  {
+    denoiseSource.setEnabled (! denoiseSource.isEnabled());
+  }
+  else if (result >= 10)
+  {
+    denoiseSource.setReductionDb (reductions[result - 10]);
+  }
+  else
+  {
+    return;
+  }
+  
+  denoiseButton.setToggleState (denoiseSource.isActive(), dontSendNotification);
+  updateDeviceLatency();
+}
 
+// the device reports its latency once opened and again after every change of buffer or backend
+void PlayerActionsComponent::updateDeviceLatency()
+{
+  openAudioDevice();
+  
+  double output, input;
+  DeviceSettingsPanel::getDeviceLatency (audioDeviceManager, output, input);
+  
+  // the denoiser holds back one frame of what is heard
+  waveMarkerComp->setDeviceLatency (output + denoiseSource.getLatencySeconds(), input);
+}
 
 
+void PlayerActionsComponent::updateLoopState()
+{
+  if (loopSource == nullptr)
+  {
+    loopButton.setToggleState (false, dontSendNotification);
+    return;
+  }
+  
+  const double position = waveMarkerComp->getPlayPosition();
+  Range<double> region;
+  
+  if (loopButton.getToggleState() && waveMarkerComp->getMarkersAround (position, region))
+    loopSource->setLoopRegion (region);
+  else
+    loopSource->clearLoopRegion();
+  
+  loopButton.setToggleState (loopSource->isLoopActive(), dontSendNotification);
+  
+  // the read-ahead may already hold audio from past the new loop end, so it is
+  // refilled once here; the wraps themselves never touch it
+  const bool wasPlaying = transportSource.isPlaying();
+  transportSource.setSource (loopSource.get(), getReadAheadSize(), &thread, resamplerSource.getRateForTransport(),
+                             laneStack.getNumChannels());
+  transportSource.setPosition (position);
+  if (wasPlaying)
+    transportSource.start();
+  
+  waveMarkerComp->repaint();
+}
 
 
+// inputs are only opened while recording, so playback alone never asks for microphone access;
+// a recording takes every input the device has
+bool PlayerActionsComponent::setInputsEnabled (bool shouldBeEnabled, String& error)
+{
+  openAudioDevice();
+  
+  AudioDeviceManager::AudioDeviceSetup setup;
+  audioDeviceManager.getAudioDeviceSetup (setup);
+  
+  setup.useDefaultInputChannels = false;
+  setup.inputChannels.clear();
+  if (shouldBeEnabled)
+  {
+    auto* device = audioDeviceManager.getCurrentAudioDevice();
+    setup.inputChannels.setRange (0, device != nullptr ? device->getInputChannelNames().size() : 2, true);
+  }
+  
+  error = audioDeviceManager.setAudioDeviceSetup (setup, true);
+  return error.isEmpty();
+}
 
+// Device probing can take seconds on some ALSA / JACK setups, so it waits until the window
+// has been drawn, or until a menu needs the device. It stays on the message thread, which
+// owns the device manager. Callbacks registered before the device opens start with it, and
+// a transport started meanwhile begins playing as soon as it does.
+void PlayerActionsComponent::openAudioDevice()
+{
+  if (deviceOpened)
+    return;
+  
+  deviceOpened = true;
+  MouseCursor::showWaitCursor();
+  
+  const String error (audioDeviceManager.initialise (0, 2, nullptr, true, {}, nullptr));
+  if (error.isNotEmpty())
+    Logger::writeToLog ("cannot open the audio device: " + error);
+  
+  MouseCursor::hideWaitCursor();
+  StartupTimer::markReady();
+}
 
 
+void PlayerActionsComponent::toggleRecording()
+{
+  if (liveRecorder.isRecording())
+  {
+    // reopen the finished take like any other file
+    showAudioResource (URL (waveMarkerComp->getAudioFile()));
+    return;
+  }
+  
+  String error;
+  
+  auto folder = File::getSpecialLocation (File::userMusicDirectory).getChildFile ("EasyAudioMarker Recordings");
+  folder.createDirectory();
+  auto file = folder.getNonexistentChildFile ("Recording " + Time::getCurrentTime().formatted ("%Y-%m-%d %H-%M-%S"), ".wav", false);
+  
+  unloadTransport();
+  
+  if (! setInputsEnabled (true, error) || ! waveMarkerComp->startLiveRecording (file, liveRecorder, error))
+  {
+    String ignored;
+    setInputsEnabled (false, ignored);
+    recordButton.setToggleState (false, dontSendNotification);
+    AlertWindow::showMessageBoxAsync (AlertWindow::WarningIcon, "Cannot record", error);
+    return;
+  }
+  
+  recordButton.setToggleState (true, dontSendNotification);
+}
 
 
+void PlayerActionsComponent::stopRecording()
+{
+  liveRecorder.stop();
+  waveMarkerComp->stopLiveRecording();
+  recordButton.setToggleState (false, dontSendNotification);
+  
+  String error;
+  setInputsEnabled (false, error);
+}
 
 
+void PlayerActionsComponent::updateTailState()
+{
+  if (! tailButton.getToggleState())
+  {
+    waveMarkerComp->stopTailFollow();
+    if (! playsFromRam && canPlayFromRam())
+      routeToRamWhenIdle();
+    return;
+  }
+  
+  String error;
+  if (! waveMarkerComp->startTailFollow (error))
+  {
+    tailButton.setToggleState (false, dontSendNotification);
+    AlertWindow::showMessageBoxAsync (AlertWindow::WarningIcon, "Cannot follow file", error);
+    return;
+  }
+  
+  // the read-ahead is back before the file grows past what is in memory
+  if (playsFromRam)
+    updateLaneRouting();
+}
 
 
+void PlayerActionsComponent::extendPlayback (int64 numSamples)
+{
+  if (mixdownReader == nullptr || numSamples <= mixdownReader->getPublishedLength())
+    return;
+  
+  const double oldEnd = mixdownReader->getPublishedLength() / currentSampleRate;
+  mixdownReader->setLengthInSamples (numSamples);
+  
+  // the read-ahead may already hold silence from past the old end: refill it
+  const double position = transportSource.getCurrentPosition();
+  if (transportSource.isPlaying() && oldEnd - position < 32768 / currentSampleRate + 0.1)
+    transportSource.setPosition (position);
+}
 
 
-PlayerActionsComponent::PlayerActionsComponent()
+void PlayerActionsComponent::showChannelMenu()
 {
-  addAndMakeVisible (zoomLabel);
-  zoomLabel.setFont (Font (15.00f, Font::plain));
-  zoomLabel.setJustificationType (Justification::centredRight);
-  zoomLabel.setEditable (false, false, false);
-
-  addAndMakeVisible(gainLabel);
-  gainLabel.setFont(Font(15.00f, Font::plain));
-  gainLabel.setJustificationType(Justification::centredRight);
-  gainLabel.setEditable(false, false, false);
+  const int numChannels = waveMarkerComp->getNumFileChannels();
+  if (numChannels == 0)
+    return;
   
-  addAndMakeVisible (followTransportButton);
-  followTransportButton.onClick = [this] { updateFollowTransportState(); };
+  PopupMenu menu;
+  menu.addItem (1, "Show all channels");
+  menu.addSeparator();
   
-  addAndMakeVisible (zoomSlider);
-  zoomSlider.setRange (0, 1, 0);
-  zoomSlider.onValueChange = [this] { waveMarkerComp->setZoomFactor (zoomSlider.getValue()); };
-  zoomSlider.setSkewFactor (2);
+  for (int ch = 0; ch < numChannels; ++ch)
+    menu.addItem (100 + ch, "Channel " + String (ch + 1), true, ! waveMarkerComp->isChannelHidden (ch));
   
-  addAndMakeVisible(gainSlider);
-  gainSlider.setRange(0, 500, 1);
-  gainSlider.setValue(100.);
-  gainSlider.setPopupDisplayEnabled(true, true, getTopLevelComponent(), 1000);
-  gainSlider.setDoubleClickReturnValue(true, 100.);
-  gainSlider.onValueChange = [this] { audioSourcePlayer.setGain((double)gainSlider.getValue() / 100.); };
-  gainSlider.setSkewFactor(0.4);
+  const int result = menu.showAt (&channelsButton);
+  if (result == 1)
+    waveMarkerComp->showAllChannels();
+  else if (result >= 100)
+    waveMarkerComp->setChannelHidden (result - 100, ! waveMarkerComp->isChannelHidden (result - 100));
+}
 
 
-  waveMarkerComp.reset (new WaveMarkerComp (formatManager, transportSource, zoomSlider));
-  addAndMakeVisible (waveMarkerComp.get());
-  waveMarkerComp->addChangeListener (this);
+void PlayerActionsComponent::showResamplerMenu()
+{
+  PopupMenu menu;
+  const auto names = PolyphaseResampler::getQualityNames();
   
-  addAndMakeVisible (startPauseButton);
-  startPauseButton.onClick = [this] { startOrPause(); };
+  for (int i = 0; i < names.size(); ++i)
+    menu.addItem (1 + i, names[i], true, (int) resamplerSource.getQuality() == i);
   
-  addAndMakeVisible (stopButton);
-  stopButton.onClick = [this] { stop(); };
+  menu.addSeparator();
+  
+  openAudioDevice();
+  auto* device = audioDeviceManager.getCurrentAudioDevice();
+  const double deviceRate = device != nullptr ? device->getCurrentSampleRate() : 0;
+  String status;
   
-  // audio setup
-  formatManager.registerBasicFormats();
+  if (currentSampleRate <= 0 || deviceRate <= 0)
+    status = "No file or device";
+  else if (resamplerSource.getQuality() == PolyphaseResampler::Quality::builtIn)
+    status = String (currentSampleRate, 0) + " -> " + String (deviceRate, 0) + " Hz in the transport";
+  else if (resamplerSource.isBypassed())
+    status = String (currentSampleRate, 0) + " Hz on both sides: bypassed";
+  else
+    status = String (currentSampleRate, 0) + " -> " + String (deviceRate, 0) + " Hz, "
+             + String (resamplerSource.getCpuLoadPerChannel() * 100.0f, 2) + "% CPU per channel";
   
-  thread.startThread (5);
+  menu.addItem (-1, status, false);
   
-  audioDeviceManager.initialise (0, 2, nullptr, true, {}, nullptr);
+  const int result = menu.showAt (&resamplerButton);
+  if (result <= 0 || result - 1 == (int) resamplerSource.getQuality())
+    return;
   
-  audioDeviceManager.addAudioCallback (&audioSourcePlayer);
-  audioSourcePlayer.setSource (&transportSource);
-
-  setSize (500, 500);
+  resamplerSource.setQuality ((PolyphaseResampler::Quality) (result - 1));
+  
+  // the transport converts the rate itself only with the built-in quality
+  updateLoopState();
 }
 
-PlayerActionsComponent::~PlayerActionsComponent()
+
+void PlayerActionsComponent::updateAudibleChannels()
 {
-  transportSource  .setSource (nullptr);
-  audioSourcePlayer.setSource (nullptr);
+  if (mixdownReader == nullptr)
+    return;
   
-  audioDeviceManager.removeAudioCallback (&audioSourcePlayer);
+  mixdownReader->setAudibleChannels (waveMarkerComp->getAudibleChannels());
+  
+  // playback goes on: the new mix is heard once the read-ahead has played out the
+  // blocks it holds, while the pre-decoded loop edges are decoded again right away
+  if (loopSource != nullptr)
+    loopSource->redecodeEdges();
+}
 
-  waveMarkerComp->removeChangeListener (this);
+
+void PlayerActionsComponent::addCompareFiles()
+{
+  if (currentAudioFileSource == nullptr)
+  {
+    AlertWindow::showMessageBoxAsync (AlertWindow::WarningIcon, "Compare", "Open a file to compare with first.");
+    return;
+  }
+  
+  FileChooser chooser ("Compare with...", waveMarkerComp->getAudioFile().getParentDirectory(),
+                       formatManager.getWildcardForAllFormats());
+  if (! chooser.browseForMultipleFilesToOpen())
+    return;
+  
+  for (auto& file : chooser.getResults())
+    if (! addCompareLane (file))
+      break;
 }
 
-void PlayerActionsComponent::paint (Graphics& g)
+bool PlayerActionsComponent::addCompareLane (const File& file)
 {
+  if (laneStack.getNumLanes() >= LaneStackSource::maxLanes)
+  {
+    AlertWindow::showMessageBoxAsync (AlertWindow::WarningIcon, "Compare",
+                                      "At most " + String (LaneStackSource::maxLanes) + " files can be compared at once.");
+    return false;
+  }
+  
+  if (! laneStack.addLane (MappedChannelReader::createFor (formatManager, file)))
+  {
+    AlertWindow::showMessageBoxAsync (AlertWindow::WarningIcon, "Compare", "Could not add " + file.getFileName() + ".");
+    return false;
+  }
+  
+  compareLanesPanel->addLane (file);
+  updateLaneRouting();
+  return true;
 }
 
-void PlayerActionsComponent::resized()
+void PlayerActionsComponent::removeCompareLane (int index)
 {
-  auto r = getLocalBounds().reduced (4);
+  laneStack.removeLane (index);
+  compareLanesPanel->removeLane (index);
   
-  auto zoom = r.removeFromTop (25);
-  zoomLabel .setBounds (zoom.removeFromLeft (50));
-  zoomSlider.setBounds (zoom);
+  // the lanes after it move up one pair
+  const int selected = laneSelector.getSelectedLane();
+  selectCompareLane (selected == index ? 0 : selected > index ? selected - 1 : selected);
   
-  auto controls = r.removeFromBottom (25);
+  updateLaneRouting();
+}
 
-  startPauseButton      .setBounds (controls.removeFromLeft(80));
-  stopButton            .setBounds (controls.removeFromLeft(80));
-  followTransportButton.setBounds (controls.removeFromLeft (100));
+void PlayerActionsComponent::selectCompareLane (int index)
+{
+  laneSelector.selectLane (index);
+  compareLanesPanel->setSelectedLane (laneSelector.getSelectedLane());
+}
 
-  auto gain = controls.removeFromRight(200);
-  gainLabel.setBounds(gain.removeFromLeft(30));
-  gainSlider.setBounds(gain);
+// The lanes travel as channel pairs through the loop source and the read-ahead, which
+// are both sized for a channel count when created: rebuild them for the new count.
+void PlayerActionsComponent::updateLaneRouting()
+{
+  if (loopSource == nullptr)
+    return;
+  
+  const double position = waveMarkerComp->getPlayPosition();
+  const bool wasPlaying = transportSource.isPlaying();
+  const bool wasLooping = loopSource->isLoopActive();
+  const auto region = loopSource->getLoopRegion();
+  
+  transportSource.setSource (nullptr);
+  waveMarkerComp->setLoopSource (nullptr);
+  loopSource.reset (new LoopRegionSource (&laneStack, currentSampleRate, laneStack.getNumChannels()));
+  if (wasLooping)
+    loopSource->setLoopRegion (region);
+  waveMarkerComp->setLoopSource (loopSource.get());
+  
+  laneSelector.setNumLanes (laneStack.getNumLanes());
+  transportSource.setSource (loopSource.get(), getReadAheadSize(), &thread, resamplerSource.getRateForTransport(),
+                             laneStack.getNumChannels());
+  transportSource.setPosition (position);
+  if (wasPlaying)
+    transportSource.start();
+  
+  resized();
+}
 
-  waveMarkerComp->setBounds (r);
+
+void PlayerActionsComponent::embedCues()
+{
+  String error;
+  if (! waveMarkerComp->embedMarkersInFile (error))
+    AlertWindow::showMessageBoxAsync (AlertWindow::WarningIcon, "Cannot embed cue markers", error);
 }
 
 
+// Runs an export behind the export button, which shows its progress and cancels it.
+// A cancel only flags the segment jobs, so the message thread never waits for them.
+class PlayerActionsComponent::SegmentExportThread : private Thread
+{
+public:
+  SegmentExportThread (PlayerActionsComponent& o, SegmentExporter* e)
+  : Thread ("segment export"), owner (&o), exporter (e)
+  {
+    startThread();
+  }
+  
+  ~SegmentExportThread()
+  {
+    exporter->cancel();
+    stopThread (10000);
+  }
+  
+  void cancel()                           { exporter->cancel(); cancelled = true; }
+  bool isCancelled() const noexcept       { return cancelled; }
+  bool isFinished() const noexcept        { return finished; }
+  double getProgress() const noexcept     { return progress; }
+  
+  bool ok = false;
+  String error;                           // valid once finished
+  
+private:
+  Component::SafePointer<PlayerActionsComponent> owner;
+  ScopedPointer<SegmentExporter> exporter;
+  std::atomic<double> progress { 0 };
+  std::atomic<bool> cancelled { false }, finished { false };
+  
+  void run() override
+  {
+    ok = exporter->run ([this] (double p)
+                        {
+                          if (p != progress)
+                          {
+                            progress = p;
+                            postUpdate();
+                          }
+                          return true;
+                        }, error);
+    finished = true;
+    postUpdate();
+  }
+  
+  void postUpdate()
+  {
+    auto safeOwner = owner;
+    MessageManager::callAsync ([safeOwner] { if (safeOwner != nullptr) safeOwner->exportProgressChanged(); });
+  }
+};
+
+
+class AlignThread : public ThreadWithProgressWindow
+{
+public:
+  AlignThread (TakeAligner& a) : ThreadWithProgressWindow ("Aligning takes...", true, true), aligner (a) {}
+  
+  void run() override
+  {
+    ok = aligner.run ([this] (double progress)
+                      {
+                        setProgress (progress);
+                        return ! threadShouldExit();
+                      }, error);
+  }
+  
+  TakeAligner& aligner;
+  String error;
+  bool ok = false;
+};
+
 
-void PlayerActionsComponent::showAudioResource (URL resource)
+// carries the markers of another version of this recording over to it
+void PlayerActionsComponent::alignMarkers()
 {
-  if (loadURLIntoTransport (resource))
-    currentAudioFile = static_cast<URL&&> (resource);
+  const File audioFile (waveMarkerComp->getAudioFile());
+  if (! audioFile.existsAsFile())
+    return;
   
-  zoomSlider.setValue (0, dontSendNotification);
-  waveMarkerComp->setURL (currentAudioFile);
+  FileChooser chooser ("Take markers from...", audioFile.getParentDirectory(), formatManager.getWildcardForAllFormats());
+  if (! chooser.browseForFileToOpen())
+    return;
+  
+  const File referenceFile (chooser.getResult());
+  Array<double> times;
+  StringArray titles;
+  Array<MarkerRegion> regions;
+  if (! SegmentExporter::loadMarkers (referenceFile, times, titles, &regions) || (times.isEmpty() && regions.isEmpty()))
+  {
+    AlertWindow::showMessageBoxAsync (AlertWindow::WarningIcon, "Align markers", referenceFile.getFileName() + " has no markers");
+    return;
+  }
+  
+  TakeAligner aligner (referenceFile, audioFile, {});
+  AlignThread thread (aligner);
+  thread.runThread();
+  
+  if (! thread.ok)
+  {
+    AlertWindow::showMessageBoxAsync (AlertWindow::WarningIcon, "Align markers", thread.error);
+    return;
+  }
+  
+  Array<double> mappedTimes;
+  StringArray mappedTitles;
+  Array<MarkerRegion> mappedRegions;
+  const int dropped = aligner.mapMarkers (times, titles, mappedTimes, mappedTitles)
+                        + aligner.mapRegions (regions, mappedRegions);
+  waveMarkerComp->addMarkers (mappedTimes, mappedTitles, mappedRegions);
+  
+  String summary;
+  summary << mappedTimes.size() << " markers and " << mappedRegions.size() << " regions added (undo removes them all)." << newLine
+          << "Offset " << String (aligner.getOffset(), 3) << " s, drift " << String (aligner.getDriftPpm(), 1) << " ppm";
+  if (dropped > 0)
+    summary << newLine << dropped << " markers or regions lie outside this file and were skipped.";
+  
+  AlertWindow::showMessageBoxAsync (AlertWindow::InfoIcon, "Align markers", summary);
 }
 
-bool PlayerActionsComponent::loadURLIntoTransport (const URL& audioURL)
+
+void PlayerActionsComponent::openURL()
 {
-  // unload the previous file source and delete it..
-  transportSource.stop();
-  transportSource.setSource (nullptr);
-  currentAudioFileSource.reset();
+  AlertWindow window ("Open URL", "Streams the file with HTTP range requests; fetched parts are cached.", AlertWindow::NoIcon);
+  window.addTextEditor ("url", "http://", "URL:");
+  window.addButton ("Open", 1, KeyPress (KeyPress::returnKey));
+  window.addButton ("Cancel", 0, KeyPress (KeyPress::escapeKey));
+  
+  if (window.runModalLoop() == 0)
+    return;
   
-  AudioFormatReader* reader = nullptr;
+  const URL url (window.getTextEditorContents ("url").trim());
+  if (! url.isWellFormed())
+    return;
   
-  if (audioURL.isLocalFile())
+  openRemote (url);
+}
+
+// The probe of a URL is a request that can block for seconds: it runs here, and the file
+// is shown once its cache is open. A probe cannot be interrupted, so the owner waits for it.
+class PlayerActionsComponent::URLOpenThread : private Thread
+{
+public:
+  URLOpenThread (PlayerActionsComponent& o, const URL& u) : Thread ("url probe"), owner (&o), url (u)
   {
-    reader = formatManager.createReaderFor (audioURL.getLocalFile());
+    startThread();
   }
-  else
+  
+  ~URLOpenThread()
   {
-    if (reader == nullptr)
-      reader = formatManager.createReaderFor (audioURL.createInputStream (false));
+    waitForThreadToExit (-1);
   }
   
-  if (reader != nullptr)
+private:
+  Component::SafePointer<PlayerActionsComponent> owner;
+  const URL url;
+  
+  void run() override
   {
-    currentAudioFileSource.reset (new AudioFormatReaderSource (reader, true));
-    
-    // ..and plug it into our transport source
-    transportSource.setSource (currentAudioFileSource.get(),
-                               32768,                   // tells it to buffer this many samples ahead
-                               &thread,                 // this is the background thread to use for reading-ahead
-                               reader->sampleRate);     // allows for sample rate correction
+    String error;
+    RemoteChunkCache::open (url, error);
     
-    return true;
+    auto safeOwner = owner;
+    auto opened = url;
+    MessageManager::callAsync ([safeOwner, opened, error]
+                               {
+                                 if (safeOwner != nullptr)
+                                   safeOwner->remoteOpened (opened, error);
+                               });
   }
+};
+
+void PlayerActionsComponent::openRemote (const URL& url)
+{
+  // one probe at a time: the button stays off until it is done
+  if (urlOpener != nullptr)
+    return;
   
-  return false;
+  openURLButton.setEnabled (false);
+  urlOpener = new URLOpenThread (*this, url);
 }
 
-
-void PlayerActionsComponent::startOrPause()
+void PlayerActionsComponent::remoteOpened (const URL& url, const String& error)
 {
-  if (transportSource.isPlaying())
-    transportSource.stop();
+  urlOpener = nullptr;
+  openURLButton.setEnabled (true);
+  
+  if (error.isNotEmpty())
+    AlertWindow::showMessageBoxAsync (AlertWindow::WarningIcon, "Cannot open URL", error);
   else
-    transportSource.start();
+    showAudioResource (url);
 }
 
-void PlayerActionsComponent::stop()
+
+void PlayerActionsComponent::exportSegments()
 {
-  if (transportSource.isPlaying())
-    transportSource.stop();
-  transportSource.setPosition (0);
+  if (exportThread != nullptr)
+  {
+    exportThread->cancel();
+    exportProgressChanged();
+    return;
+  }
+  
+  const File audioFile (waveMarkerComp->getAudioFile());
+  if (! audioFile.existsAsFile())
+    return;
+  
+  AlertWindow settings ("Export segments", "One WAV file is written per marker segment.", AlertWindow::NoIcon);
+  settings.addComboBox ("rate", { "Keep sample rate", "44100 Hz", "48000 Hz", "16000 Hz" }, "Sample rate");
+  
+  auto profile = denoiseSource.getProfile();
+  if (profile != nullptr)
+    settings.addComboBox ("denoise", { "No noise reduction", "Reduce noise 6 dB", "Reduce noise 12 dB",
+                                       "Reduce noise 18 dB", "Reduce noise 24 dB" }, "Noise reduction");
+  settings.addButton ("Export", 1, KeyPress (KeyPress::returnKey));
+  settings.addButton ("Cancel", 0, KeyPress (KeyPress::escapeKey));
+  
+  if (settings.runModalLoop() == 0)
+    return;
+  
+  SegmentExporter::Options options;
+  options.targetSampleRate = settings.getComboBoxComponent ("rate")->getText().getDoubleValue();
+  
+  if (auto* denoise = settings.getComboBoxComponent ("denoise"))
+  {
+    if (denoise->getSelectedItemIndex() > 0)
+    {
+      options.denoiseProfile = profile;
+      options.denoiseReductionDb = (float) denoise->getText().fromFirstOccurrenceOf ("Reduce noise ", false, false).getIntValue();
+    }
+  }
+  
+  FileChooser chooser ("Export segments to...", audioFile.getParentDirectory());
+  if (! chooser.browseForDirectory())
+    return;
+  options.outputFolder = chooser.getResult();
+  
+  Array<double> times;
+  StringArray titles;
+  waveMarkerComp->getMarkers (times, titles);
+  
+  exportThread = new SegmentExportThread (*this, new SegmentExporter (audioFile, times, titles, options));
+  exportProgressChanged();
 }
 
-
-void PlayerActionsComponent::updateFollowTransportState()
+void PlayerActionsComponent::exportProgressChanged()
 {
-  waveMarkerComp->setFollowsTransport (followTransportButton.getToggleState());
+  if (exportThread == nullptr)
+    return;
+  
+  if (exportThread->isFinished())
+  {
+    ScopedPointer<SegmentExportThread> finished (exportThread.release());
+    exportButton.setButtonText ("Export");
+    
+    if (! finished->ok && ! finished->isCancelled())
+      AlertWindow::showMessageBoxAsync (AlertWindow::WarningIcon, "Segment export failed", finished->error);
+    return;
+  }
+  
+  exportButton.setButtonText (exportThread->isCancelled() ? "Cancelling"
+                                                          : "Stop " + String (roundToInt (exportThread->getProgress() * 100.0)) + "%");
 }
 
 
@@ -537,6 +2775,10 @@ void PlayerActionsComponent::changeListenerCallback (ChangeBroadcaster* source)
 {
   if (source == waveMarkerComp.get())
     showAudioResource (URL (waveMarkerComp->getLastDroppedFile()));
+  else if (source == &audioDeviceManager)
+    updateDeviceLatency();
+  else if (source == &transportSource && ! transportSource.isPlaying() && ramRoutingPending)
+    updateLaneRouting();
 }
 
 
@@ -616,12 +2858,18 @@ void MainComponent::paintOverChildren(Graphics& g)
 void MainComponent::paint (Graphics& g)
 {
   g.fillAll (ColorDefaultBkg);
+  StartupTimer::markFirstPaint();
 }
 
 void MainComponent::resized()
 {
   playerActionsComponent->setSize(getWidth(), getHeight());
 }
+
+void MainComponent::openFiles (const StringArray& files)
+{
+  playerActionsComponent->openFiles (files);
+}
 
 
 
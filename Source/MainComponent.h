@@ -10,6 +10,29 @@
 
 #include "../JuceLibraryCode/JuceHeader.h"
 #include "list"
+#include "MarkerIndex.h"
+#include "MarkerDensity.h"
+#include "SidecarMerge.h"
+#include "RegionIndex.h"
+#include "FileWatcher.h"
+#include "LoopRegionSource.h"
+#include "MarkerEditLog.h"
+#include "LiveRecorder.h"
+#include "TailFollower.h"
+#include "RemoteAudioStream.h"
+#include "PolyphaseResampler.h"
+#include "PreviewChain.h"
+#include "SpectralDenoiser.h"
+#include "Wave64Format.h"
+#include "CompareLanes.h"
+#include "RamAudioStore.h"
+#include <unordered_map>
+#include <atomic>
+
+class MarkerListPanel;
+class LibraryIndex;
+class ChannelMixdownReader;
+class CompareLanesPanel;
 
 #define MarkerFilesExt ".easymarkers"
 
@@ -19,7 +42,11 @@
 #define ColorWavePlayheadPlay  Colours::orange
 #define ColorWavePlayheadStop  Colours::orange
 #define ColorWaveMarker         Colours::yellow
+#define ColorWaveLoopRegion     Colours::orange.withAlpha(0.15f)
 #define ColorText1              Colours::white
+#define ColorRecording          Colours::red
+#define ColorLaneSeparator      Colours::grey.withAlpha(0.4f)
+#define ColorWaveRegion         Colours::cyan
 
 
 class MarkerInfo : public juce::Component, private juce::Button::Listener, private juce::TextEditor::Listener
@@ -27,7 +54,7 @@ class MarkerInfo : public juce::Component, private juce::Button::Listener, priva
 public:
 
 
-  MarkerInfo(double p, const juce::String &t) : pos(p)
+  MarkerInfo(double p, const juce::String &t, juce::int64 i) : pos(p), id(i), committedTitle(t)
   {
     setInterceptsMouseClicks(false, true);
     editMarker.setClickingTogglesState(true);
@@ -92,6 +119,8 @@ public:
 
 
    double       pos;
+  const juce::int64     id;
+  juce::String          committedTitle;   // as last recorded in the edit log
   TextEditor            editTitle;
   TextButton            editMarker { "e" };
   TextButton            delMarker { "-" };
@@ -120,6 +149,41 @@ private:
 
 
 
+struct ChannelLaneHeader : public juce::Component
+{
+  ChannelLaneHeader (int ch) : channel(ch)
+  {
+    soloButton.setClickingTogglesState(true);
+    soloButton.setColour(TextButton::buttonOnColourId, Colours::orange);
+    soloButton.onClick = [this] { if (onSolo) onSolo(channel, soloButton.getToggleState()); };
+    hideButton.onClick = [this] { if (onHide) onHide(channel); };
+    
+    addAndMakeVisible(soloButton);
+    addAndMakeVisible(hideButton);
+  }
+  
+  void resized() override
+  {
+    soloButton.setBounds(20, 0, 16, 16);
+    hideButton.setBounds(38, 0, 16, 16);
+  }
+  
+  void paint(juce::Graphics &g) override
+  {
+    g.setColour(ColorText1);
+    g.setFont(12.0f);
+    g.drawText(juce::String(channel + 1), 0, 0, 18, 16, juce::Justification::centredRight);
+  }
+  
+  const int channel;
+  TextButton soloButton { "S" };
+  TextButton hideButton { "H" };
+  std::function<void(int, bool)> onSolo;
+  std::function<void(int)> onHide;
+};
+
+
+
 
 
 
@@ -131,7 +195,8 @@ public FileDragAndDropTarget,
 public ChangeBroadcaster,
 private ScrollBar::Listener,
 private Button::Listener,
-private Timer
+private Timer,
+private MarkerEditLog::Target
 {
 public:
     WaveMarkerComp (AudioFormatManager& formatManager,
@@ -144,6 +209,7 @@ public:
     void setRange (Range<double> newRange);
     void setFollowsTransport (bool shouldFollow);
     void paint (Graphics& g) override;
+    void paintOverChildren (Graphics& g) override;
     void resized() override;
     void changeListenerCallback (ChangeBroadcaster*) override;
     bool isInterestedInFileDrag (const StringArray& /*files*/) override;
@@ -156,31 +222,147 @@ public:
     void buttonClicked (Button*) override;
   
   void addMarkerToList(double time, const juce::String &title, bool saveXML = false);
+  void addMarkers (const juce::Array<double>& times, const juce::StringArray& titles,
+                   const juce::Array<MarkerRegion>& regions = {});
+  void removeMarkers (const juce::Array<MarkerInfo*>& markersToRemove);
+  bool undo();
+  bool redo();
   
   void saveMarkers();
   void loadMarkers();
+  bool embedMarkersInFile (juce::String& error);
+  void getMarkers (juce::Array<double>& times, juce::StringArray& titles) const;
+  juce::File getAudioFile() const noexcept { return audioLocation; }
+  void updateCursorPosition();
+  void showMarker (double time);
+  bool getMarkersAround (double time, Range<double>& region) const;
+  void setLoopSource (LoopRegionSource* source);
+  double getPlayPosition() const;
+  
+  // Audio reaches the speakers outputSeconds after the transport reads it, and
+  // live input arrives in the file inputSeconds after it happened; the playhead and
+  // new markers use the time actually heard.
+  void setDeviceLatency (double outputSeconds, double inputSeconds);
+  double getHeardPosition() const;
+  
+  const AudioThumbnail& getThumbnail() const noexcept { return *thumbnail; }
+  AudioThumbnailCache& getThumbnailCache() noexcept { return thumbnailCache; }
+  Range<double> getVisibleRange() const noexcept { return visibleRange; }
+  MarkerIndex& getMarkerIndex() noexcept { return markerIndex; }
+  
+  // regions: spans with a title, drawn shaded over the lanes. Shift-drag makes one,
+  // right-click on one renames or removes it. Undoable and journaled like markers.
+  juce::int64 addRegion (double start, double end, const juce::String& title);
+  void removeRegion (juce::int64 id);
+  void retitleRegion (juce::int64 id, const juce::String& title);
+  RegionIndex& getRegionIndex() noexcept { return regionIndex; }
+  
+  std::function<void()> onMarkersChanged;
+  
+  // The sidecar is watched while open: markers another program adds, removes or
+  // renames in it are merged in. Edits made here to the same markers are kept,
+  // and listed here as conflicts.
+  std::function<void(const juce::StringArray&)> onSidecarConflicts;
+  
+  // channel lanes: hidden channels are neither drawn, decoded for peaks nor played;
+  // once any channel is soloed only the soloed visible channels are played
+  int getNumFileChannels() const noexcept { return laneHeaders.size(); }
+  bool isChannelHidden (int channel) const { return hiddenChannels[channel]; }
+  void setChannelHidden (int channel, bool shouldBeHidden);
+  void setChannelSolo (int channel, bool shouldBeSoloed);
+  void showAllChannels();
+  juce::Array<int> getVisibleChannels() const;
+  juce::Array<int> getAudibleChannels() const;
+  
+  std::function<void()> onAudibleChannelsChanged;
+  
+  // live mode: the waveform grows from the recorder and markers are placed at the recorded time
+  bool startLiveRecording (const juce::File& file, LiveRecorder& recorder, juce::String& error);
+  void stopLiveRecording();
+  
+  // tail mode: the file keeps being written by another process and is re-read as it grows
+  bool startTailFollow (juce::String& error);
+  void stopTailFollow();
+  bool isTailFollowing() const noexcept { return tailFollower.isFollowing(); }
+  std::function<void(juce::int64)> onLengthExtended;
+  
+  // after a click or a marker moved the transport
+  std::function<void()> onSeek;
   
 private:
+    AudioFormatManager&   formatManager;
     AudioTransportSource& transportSource;
     Slider&               zoomSlider;
     ScrollBar             scrollbar { false };
     TextButton            addMarker { "+" };
-    AudioThumbnailCache   thumbnailCache  { 5 };
-    AudioThumbnail        thumbnail;
+    AudioThumbnailCache   thumbnailCache  { 5 + LaneStackSource::maxLanes };   // shared with the compare lanes
+    int                   thumbnailResolution = 512;   // samples per peak, coarser for very long files
+    ScopedPointer<AudioThumbnail> thumbnail;
     Range<double>         visibleRange;
     bool                  isFollowingTransport = false;
     URL                   lastFileDropped;
     PlayHead              currentPositionMarker;
     juce::File            markersLocation;
+    juce::File            audioLocation;
     std::list<juce::ScopedPointer<MarkerInfo> > markers;
+    std::unordered_map<juce::int64, std::list<juce::ScopedPointer<MarkerInfo> >::iterator> markersById;
+    juce::int64           nextMarkerId = 1;
+    MarkerEditLog         editLog;
+    juce::String          pendingJournal;
+    int                   journalEntries = 0;
+    juce::uint32          lastEditTime = 0;
+    MarkerIndex           markerIndex;
+    MarkerDensity         markerDensity;
+    juce::Array<MarkerInfo*> shownMarkers;        // the marker components laid out in the view
+    bool                  showsClusters = false;  // too many markers in view: drawn as clusters instead
+    juce::Array<MarkerDensity::Cluster> clusters;
+    juce::Array<int>      stripCounts;            // markers per pixel of the scrollbar
+    int                   stripRevision = -1;
+    Range<double>         stripRange;
+    RegionIndex           regionIndex;
+    juce::Array<const MarkerRegion*> shownRegions;   // scratch for paint()
+    Range<double>         regionDrag;             // the region being made by a shift-drag
+    bool                  isDraggingRegion = false;
     juce::Point<int>      lastMousePos;
+    LoopRegionSource*     loopSource = nullptr;
+    LiveRecorder*         liveRecorder = nullptr;
+    double                liveLength = 0;
+    double                outputLatency = 0;
+    double                inputLatency = 0;
+    TailFollower          tailFollower;
+    RemoteChunkCache::Ptr remoteCache;
+    juce::OwnedArray<ChannelLaneHeader> laneHeaders;
+    juce::BigInteger      hiddenChannels, soloChannels;
+    juce::Array<SidecarMerge::Marker> sidecarBase;   // the sidecar as last read or written here
+    juce::Array<SidecarMerge::Region> sidecarRegionBase;
+    SidecarMerge::Stamp   sidecarStamp;           // and when
+    std::atomic<bool>     sidecarChanged { false };
+    FileWatcher           sidecarWatcher;         // last, so its thread stops first
   
     float timeToX (const double time) const;
     double xToTime (const float x) const;
     bool canMoveTransport() const noexcept;
     void scrollBarMoved (ScrollBar* scrollBarThatHasMoved, double newRangeStart) override;
     void timerCallback() override;
-    void updateCursorPosition();
+    MarkerInfo* createMarker (double time, const juce::String &title, juce::int64 id = 0);
+    void eraseMarker (juce::int64 id);
+    void applyEdit (const MarkerEditLog::Command& command, bool forward) override;
+    void recordEdit (const MarkerEditLog::Command& command);
+    void flushJournal();
+    void markersChanged();
+    void updateThumbnailSource();
+    AudioFormatReader* createReader();
+    juce::Rectangle<int> getLaneArea() const;
+    void clearMarkers();
+    void watchSidecar();
+    void mergeSidecar();
+    void mergeRegions (const juce::Array<SidecarMerge::RegionChange> &changes, juce::StringArray &conflicts);
+    void paintClusters (Graphics& g);
+    void paintRegions (Graphics& g);
+    void showRegionMenu (juce::int64 id);
+    void layoutLanes();
+    void audibleChannelsChanged();
+    void followGrowingLength (double newLength);
 };
 
 
@@ -209,9 +391,16 @@ public:
     ~PlayerActionsComponent();
     void paint (Graphics& g) override;
     void resized() override;
+    bool keyPressed (const KeyPress& key) override;
+    
+    void openFiles (const StringArray& files);
     
 private:
+    class SegmentExportThread;
+    class URLOpenThread;
+    
     AudioDeviceManager audioDeviceManager;
+    bool deviceOpenPosted = false, deviceOpened = false;
     
     AudioFormatManager formatManager;
     TimeSliceThread thread  { "audio file preview" };
@@ -219,26 +408,102 @@ private:
     URL currentAudioFile;
     AudioSourcePlayer audioSourcePlayer;
     AudioTransportSource transportSource;
+    ThreadPool decodePool { jlimit (1, 4, SystemStats::getNumCpus() / 2) };   // decodes the compare lanes
+    LaneStackSource laneStack { decodePool };
+    LaneSelectorSource laneSelector { &transportSource };
+    PolyphaseResamplingSource resamplerSource { &laneSelector };
+    DenoisingAudioSource denoiseSource { &resamplerSource };
+    PreviewChain previewChain { &denoiseSource };
     ScopedPointer<AudioFormatReaderSource> currentAudioFileSource;
+    ScopedPointer<LoopRegionSource> loopSource;
+    ChannelMixdownReader* mixdownReader = nullptr;   // owned by currentAudioFileSource
+    RamAudioReader* ramReader = nullptr;             // owned by mixdownReader
+    RamAudioDecoder ramDecoder;
+    RamAudioStore::Ptr ramStore;                     // the open file, in memory
+    bool playsFromRam = false;                       // the transport reads without a read-ahead
+    bool ramRoutingPending = false;                  // it could, from the next stop or seek
+    double currentSampleRate = 0;
     
     ScopedPointer<WaveMarkerComp> waveMarkerComp;
+    ScopedPointer<MarkerListPanel> markerListPanel;
+    ScopedPointer<CompareLanesPanel> compareLanesPanel;
+    ScopedPointer<LibraryIndex> libraryIndex;
+    Component::SafePointer<DialogWindow> libraryWindow;
+    Component::SafePointer<DialogWindow> deviceWindow;
+    Component::SafePointer<DialogWindow> previewWindow;
     Label zoomLabel   { {}, "zoom:" };
     Slider zoomSlider                   { Slider::LinearHorizontal, Slider::NoTextBox };
+    TextButton libraryButton             { "Library" };
+    TextButton embedCuesButton           { "Embed cues" };
+    TextButton exportButton              { "Export" };
+    ScopedPointer<SegmentExportThread> exportThread;
+    TextButton openURLButton             { "Open URL" };
+    ScopedPointer<URLOpenThread> urlOpener;
+    TextButton alignButton               { "Align" };
+    TextButton resamplerButton           { "Resampler" };
+    TextButton deviceButton              { "Device" };
+    TextButton previewButton             { "FX" };
+    TextButton denoiseButton             { "Denoise" };
 
     Label gainLabel{ {}, "vol:" };
     Slider gainSlider                   { Slider::LinearHorizontal, Slider::NoTextBox };
     ToggleButton followTransportButton  { "Follow Transport" };
     TextButton startPauseButton          { "Play/Pause" };
     TextButton stopButton                { "Stop" };
+    ToggleButton showMarkerListButton    { "Markers" };
+    ToggleButton loopButton              { "Loop" };
+    TextButton recordButton              { "Rec" };
+    ToggleButton tailButton              { "Tail" };
+    LiveRecorder liveRecorder;
+    TextButton channelsButton            { "Channels" };
+    TextButton undoButton                { "Undo" };
+    TextButton redoButton                { "Redo" };
+    TextButton compareButton             { "Compare" };
+    ToggleButton ramButton               { "RAM" };
     
     void showAudioResource (URL resource);
     
     bool loadURLIntoTransport (const URL& audioURL);
+    AudioFormatReader* createReader (const URL& audioURL);
     
     void startOrPause();
     void stop();
     
     void updateFollowTransportState();
+    void updateMarkerListVisibility();
+    void updateLoopState();
+    void showLibrary();
+    void embedCues();
+    void exportSegments();
+    void exportProgressChanged();
+    void openURL();
+    void openRemote (const URL& url);
+    void remoteOpened (const URL& url, const String& error);
+    void alignMarkers();
+    void showChannelMenu();
+    void showResamplerMenu();
+    void showDeviceSettings();
+    void showPreviewChain();
+    void showDenoiseMenu();
+    void updateDeviceLatency();
+    void unloadTransport();
+    void toggleRecording();
+    void stopRecording();
+    void updateTailState();
+    void extendPlayback (juce::int64 numSamples);
+    bool setInputsEnabled (bool shouldBeEnabled, String& error);
+    void openAudioDevice();
+    void updateAudibleChannels();
+    void addCompareFiles();
+    bool addCompareLane (const File& file);
+    void removeCompareLane (int index);
+    void selectCompareLane (int index);
+    void updateLaneRouting();
+    void updateRamState();
+    void ramProgressChanged();
+    bool canPlayFromRam();
+    void routeToRamWhenIdle();
+    int getReadAheadSize();
     
     void selectionChanged() override;
     
@@ -270,6 +535,9 @@ public:
     void paintOverChildren (Graphics&) override;
     void resized() override;
 
+    // Files and URLs from the command line or a later launch.
+    void openFiles (const StringArray& files);
+
 private:
     juce::ScopedPointer<PlayerActionsComponent> playerActionsComponent;
 
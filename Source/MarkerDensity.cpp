@@ -0,0 +1,170 @@
+/*
+  ==============================================================================
+
+    MarkerDensity.cpp
+
+  ==============================================================================
+*/
+
+#include "MarkerDensity.h"
+#include <algorithm>
+
+
+using namespace juce;
+
+
+static const double minimumSpan = 64.0;    // seconds
+
+
+void MarkerDensity::clear()
+{
+  positions.clear();
+  dirty = true;
+  ++revision;
+}
+
+void MarkerDensity::add (MarkerInfo* marker, double pos)
+{
+  positions[marker] = pos;
+  dirty = true;
+  ++revision;
+}
+
+void MarkerDensity::remove (MarkerInfo* marker)
+{
+  if (positions.erase (marker) > 0)
+  {
+    dirty = true;
+    ++revision;
+  }
+}
+
+void MarkerDensity::setLength (double seconds)
+{
+  requiredLength = seconds;
+  if (seconds >= span && ! dirty)
+  {
+    dirty = true;
+    ++revision;
+  }
+}
+
+double MarkerDensity::getBinWidth (size_t level) const noexcept
+{
+  return span / (double) (1 << (finestLevelBits - (int) level));
+}
+
+void MarkerDensity::rebuild()
+{
+  sorted.clear();
+  sorted.reserve (positions.size());
+  for (auto& p : positions)
+    sorted.emplace_back (p.second, p.first);
+  std::sort (sorted.begin(), sorted.end());
+
+  // a power of two seconds, so a file growing while recorded rebuilds at each doubling only
+  const double needed = jmax (requiredLength, sorted.empty() ? 0.0 : sorted.back().first);
+  span = minimumSpan;
+  while (span <= needed)
+    span *= 2.0;
+
+  levels.resize (finestLevelBits + 1);
+  auto& finest = levels[0];
+  finest.assign ((size_t) 1 << finestLevelBits, Bin());
+  const double width = getBinWidth (0);
+
+  for (auto& entry : sorted)
+  {
+    auto& bin = finest[(size_t) jlimit (0, (int) finest.size() - 1, (int) (entry.first / width))];
+    if (bin.count++ == 0)
+      bin.first = entry.first;
+    bin.last = entry.first;
+  }
+
+  for (size_t level = 1; level < levels.size(); ++level)
+  {
+    const auto& below = levels[level - 1];
+    auto& bins = levels[level];
+    bins.assign (below.size() / 2, Bin());
+
+    for (size_t i = 0; i < bins.size(); ++i)
+    {
+      const auto& a = below[2 * i];
+      const auto& b = below[2 * i + 1];
+      bins[i].count = a.count + b.count;
+      bins[i].first = a.count > 0 ? a.first : b.first;
+      bins[i].last  = b.count > 0 ? b.last : a.last;
+    }
+  }
+
+  dirty = false;
+}
+
+int MarkerDensity::countInRange (Range<double> range)
+{
+  prepare();
+  auto lo = std::lower_bound (sorted.begin(), sorted.end(), std::make_pair (range.getStart(), (MarkerInfo*) nullptr));
+  auto hi = std::lower_bound (lo, sorted.end(), std::make_pair (range.getEnd(), (MarkerInfo*) nullptr));
+  return (int) (hi - lo);
+}
+
+void MarkerDensity::getMarkersInRange (Range<double> range, Array<MarkerInfo*>& results)
+{
+  prepare();
+  results.clearQuick();
+
+  auto it = std::lower_bound (sorted.begin(), sorted.end(), std::make_pair (range.getStart(), (MarkerInfo*) nullptr));
+  for (; it != sorted.end() && it->first < range.getEnd(); ++it)
+    results.add (it->second);
+}
+
+void MarkerDensity::getClusters (Range<double> range, double minSeconds, Array<Cluster>& results)
+{
+  prepare();
+  results.clearQuick();
+
+  size_t level = 0;
+  while (level + 1 < levels.size() && getBinWidth (level) < minSeconds)
+    ++level;
+
+  const auto& bins = levels[level];
+  const double width = getBinWidth (level);
+  const int first = jlimit (0, (int) bins.size(), (int) (range.getStart() / width));
+  const int last  = jlimit (0, (int) bins.size(), (int) std::ceil (range.getEnd() / width));
+
+  for (int i = first; i < last; ++i)
+    if (bins[(size_t) i].count > 0)
+      results.add ({ { bins[(size_t) i].first, bins[(size_t) i].last }, bins[(size_t) i].count });
+}
+
+void MarkerDensity::getDensity (Range<double> range, int numColumns, Array<int>& counts)
+{
+  prepare();
+  counts.clearQuick();
+  counts.insertMultiple (0, 0, jmax (0, numColumns));
+
+  if (numColumns <= 0 || range.isEmpty() || sorted.empty())
+    return;
+
+  // the coarsest level still finer than a column: between one and two bins per column
+  const double columnWidth = range.getLength() / numColumns;
+  size_t level = 0;
+  while (level + 1 < levels.size() && getBinWidth (level + 1) <= columnWidth)
+    ++level;
+
+  const auto& bins = levels[level];
+  const double width = getBinWidth (level);
+  const int first = jlimit (0, (int) bins.size(), (int) (range.getStart() / width));
+  const int last  = jlimit (0, (int) bins.size(), (int) std::ceil (range.getEnd() / width));
+
+  for (int i = first; i < last; ++i)
+  {
+    const auto& bin = bins[(size_t) i];
+    if (bin.count == 0)
+      continue;
+
+    const int column = (int) ((bin.first - range.getStart()) / columnWidth);
+    if (column >= 0 && column < numColumns)
+      counts.getReference (column) += bin.count;
+  }
+}
@@ -0,0 +1,78 @@
+/*
+  ==============================================================================
+
+    MarkerDensity.h
+
+    Marker counts at every zoom level, kept in sync by WaveMarkerComp. The
+    timeline is cut into 2^14 bins, and each coarser level pairs up the bins
+    of the one below, so a view is summed from the level whose bins are
+    about a cluster (or a pixel) wide: drawing costs the width in pixels,
+    however many markers there are. Rebuilt on the first query after a change.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <vector>
+#include <unordered_map>
+
+class MarkerInfo;
+
+
+class MarkerDensity
+{
+public:
+  struct Cluster
+  {
+    juce::Range<double>   span;       // first to last marker in it
+    int                   count;
+  };
+
+  MarkerDensity() = default;
+
+  void clear();
+  void add (MarkerInfo* marker, double pos);
+  void remove (MarkerInfo* marker);
+
+  // The summary covers at least this long; it doubles when a growing file passes it.
+  void setLength (double seconds);
+
+  int countInRange (juce::Range<double> range);
+
+  // ordered by time
+  void getMarkersInRange (juce::Range<double> range, juce::Array<MarkerInfo*>& results);
+
+  // Non-empty bins of the first level at least minSeconds wide.
+  void getClusters (juce::Range<double> range, double minSeconds, juce::Array<Cluster>& results);
+
+  // Markers per column, with range cut into numColumns.
+  void getDensity (juce::Range<double> range, int numColumns, juce::Array<int>& counts);
+
+  // changes with every marker added or removed, and when the covered length grows
+  int getRevision() const noexcept              { return revision; }
+
+private:
+  struct Bin
+  {
+    int       count = 0;
+    double    first = 0, last = 0;
+  };
+
+  static constexpr int finestLevelBits = 14;
+
+  std::unordered_map<MarkerInfo*, double>       positions;
+  std::vector<std::pair<double, MarkerInfo*>>   sorted;
+  std::vector<std::vector<Bin>>                 levels;   // levels[0] is the finest
+  double                                        span = 0;
+  double                                        requiredLength = 0;
+  bool                                          dirty = true;
+  int                                           revision = 0;
+
+  void rebuild();
+  void prepare()                                { if (dirty) rebuild(); }
+  double getBinWidth (size_t level) const noexcept;
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MarkerDensity)
+};
@@ -0,0 +1,243 @@
+/*
+  ==============================================================================
+
+    MarkerEditLog.cpp
+
+  ==============================================================================
+*/
+
+#include "MarkerEditLog.h"
+#include <map>
+
+
+using namespace juce;
+
+
+MarkerEditLog::MarkerEditLog (size_t max) : maxCommands (max)
+{
+}
+
+void MarkerEditLog::record (const Command& command)
+{
+  // a new edit after some undos: the undone commands can no longer be redone
+  commands.erase (commands.begin() + (std::ptrdiff_t) appliedCommands, commands.end());
+  transactionSizes.erase (transactionSizes.begin() + (std::ptrdiff_t) appliedTransactions, transactionSizes.end());
+
+  commands.push_back (command);
+  ++appliedCommands;
+
+  if (startNewTransaction || transactionSizes.empty())
+  {
+    transactionSizes.push_back (1);
+    ++appliedTransactions;
+    startNewTransaction = false;
+  }
+  else
+  {
+    ++transactionSizes.back();
+  }
+
+  // forget the oldest transactions, but never the one being recorded
+  while (commands.size() > maxCommands && transactionSizes.size() > 1)
+  {
+    const size_t n = transactionSizes.front();
+    commands.erase (commands.begin(), commands.begin() + (std::ptrdiff_t) n);
+    transactionSizes.pop_front();
+    appliedCommands -= n;
+    --appliedTransactions;
+  }
+}
+
+bool MarkerEditLog::undo (Target& target)
+{
+  if (! canUndo())
+    return false;
+
+  const size_t n = transactionSizes[appliedTransactions - 1];
+  for (size_t i = 0; i < n; ++i)
+    target.applyEdit (commands[appliedCommands - 1 - i], false);
+
+  appliedCommands -= n;
+  --appliedTransactions;
+  startNewTransaction = true;
+  return true;
+}
+
+bool MarkerEditLog::redo (Target& target)
+{
+  if (! canRedo())
+    return false;
+
+  const size_t n = transactionSizes[appliedTransactions];
+  for (size_t i = 0; i < n; ++i)
+    target.applyEdit (commands[appliedCommands + i], true);
+
+  appliedCommands += n;
+  ++appliedTransactions;
+  startNewTransaction = true;
+  return true;
+}
+
+void MarkerEditLog::clear()
+{
+  commands.clear();
+  transactionSizes.clear();
+  appliedCommands = appliedTransactions = 0;
+  startNewTransaction = true;
+}
+
+File MarkerEditLog::getJournalFile (const File& sidecar)
+{
+  return sidecar.getSiblingFile (sidecar.getFileName() + journalSuffix);
+}
+
+String MarkerEditLog::toJournalLine (const Command& command, bool forward)
+{
+  const bool retitles = command.type == Command::retitleMarker || command.type == Command::retitleRegion;
+  const bool adds = (command.type == Command::addMarker || command.type == Command::addRegion) == forward;
+
+  String tag (retitles ? "Retitle" : (adds ? "Add" : "Remove"));
+  if (command.isRegion())
+    tag << "Region";
+
+  XmlElement e (tag);
+  e.setAttribute ("Time", command.time);
+  if (command.isRegion())
+    e.setAttribute ("End", command.endTime);
+
+  if (retitles)
+  {
+    e.setAttribute ("From", forward ? command.previousTitle : command.title);
+    e.setAttribute ("To", forward ? command.title : command.previousTitle);
+  }
+  else
+  {
+    e.setAttribute ("Title", command.title);
+  }
+
+  return e.createDocument ({}, true, false) + "\n";
+}
+
+int MarkerEditLog::replayJournal (const File& sidecar, Array<double>& times, StringArray& titles,
+                                  Array<MarkerRegion>* regions)
+{
+  StringArray lines;
+  getJournalFile (sidecar).readLines (lines);
+  lines.removeEmptyStrings();
+
+  if (lines.isEmpty())
+    return 0;
+
+  // markers are identified by time and title; the time index keeps each lookup logarithmic
+  std::multimap<double, int> byTime;
+  std::vector<bool> removed ((size_t) times.size(), false);
+  for (int i = 0; i < times.size(); ++i)
+    byTime.insert ({ times[i], i });
+
+  auto find = [&] (double time, const String& title) -> std::multimap<double, int>::iterator
+  {
+    const double tolerance = 1.0e-9;
+    for (auto it = byTime.lower_bound (time - tolerance); it != byTime.end() && it->first <= time + tolerance; ++it)
+      if (titles[it->second] == title)
+        return it;
+    return byTime.end();
+  };
+
+  // regions are few: found by a scan, on start, end and title
+  auto findRegion = [&] (double start, double end, const String& title) -> int
+  {
+    const double tolerance = 1.0e-9;
+    for (int i = 0; i < regions->size(); ++i)
+    {
+      auto& r = regions->getReference (i);
+      if (std::abs (r.start - start) <= tolerance && std::abs (r.end - end) <= tolerance && r.title == title)
+        return i;
+    }
+    return -1;
+  };
+
+  int replayed = 0;
+
+  for (auto& line : lines)
+  {
+    ScopedPointer<XmlElement> e (XmlDocument::parse (line));
+    if (e == nullptr)
+      continue;
+
+    const double time = e->getDoubleAttribute ("Time");
+
+    if (e->getTagName().endsWith ("Region"))
+    {
+      if (regions == nullptr)
+        continue;
+
+      const double end = e->getDoubleAttribute ("End");
+
+      if (e->hasTagName ("AddRegion"))
+      {
+        regions->add ({ time, end, e->getStringAttribute ("Title") });
+      }
+      else if (e->hasTagName ("RemoveRegion"))
+      {
+        const int i = findRegion (time, end, e->getStringAttribute ("Title"));
+        if (i < 0)
+          continue;
+        regions->remove (i);
+      }
+      else if (e->hasTagName ("RetitleRegion"))
+      {
+        const int i = findRegion (time, end, e->getStringAttribute ("From"));
+        if (i < 0)
+          continue;
+        regions->getReference (i).title = e->getStringAttribute ("To");
+      }
+      else
+      {
+        continue;
+      }
+    }
+    else if (e->hasTagName ("Add"))
+    {
+      byTime.insert ({ time, times.size() });
+      times.add (time);
+      titles.add (e->getStringAttribute ("Title"));
+      removed.push_back (false);
+    }
+    else if (e->hasTagName ("Remove"))
+    {
+      auto it = find (time, e->getStringAttribute ("Title"));
+      if (it == byTime.end())
+        continue;
+      removed[(size_t) it->second] = true;
+      byTime.erase (it);
+    }
+    else if (e->hasTagName ("Retitle"))
+    {
+      auto it = find (time, e->getStringAttribute ("From"));
+      if (it == byTime.end())
+        continue;
+      titles.set (it->second, e->getStringAttribute ("To"));
+    }
+    else
+    {
+      continue;
+    }
+
+    ++replayed;
+  }
+
+  Array<double> keptTimes;
+  StringArray keptTitles;
+  for (int i = 0; i < times.size(); ++i)
+  {
+    if (! removed[(size_t) i])
+    {
+      keptTimes.add (times[i]);
+      keptTitles.add (titles[i]);
+    }
+  }
+
+  times.swapWith (keptTimes);
+  titles.swapWith (keptTitles);
+  return replayed;
+}
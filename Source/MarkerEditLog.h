@@ -0,0 +1,85 @@
+/*
+  ==============================================================================
+
+    MarkerEditLog.h
+
+    Undo/redo history of marker edits, kept as a log of small commands rather
+    than copies of the marker list. Undoing or redoing replays only the
+    commands of one transaction.
+
+    The same commands are appended to a journal next to the sidecar, one XML
+    element per line, so an edit writes a few bytes instead of the whole
+    marker list. Readers of the sidecar replay the journal on top of it.
+    The sidecar is only saved in full once the journal has grown long
+    against it, and when the file is closed; that folds the journal in and
+    deletes it.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "RegionIndex.h"
+#include <deque>
+
+
+class MarkerEditLog
+{
+public:
+  struct Command
+  {
+    enum Type : juce::uint8 { addMarker, removeMarker, retitleMarker, addRegion, removeRegion, retitleRegion };
+
+    Type          type;
+    juce::int64   markerId;
+    double        time;             // the start, for regions
+    juce::String  title;            // the new title for retitles
+    juce::String  previousTitle;    // retitles only
+    double        endTime = 0;      // regions only
+
+    bool isRegion() const noexcept  { return type >= addRegion; }
+  };
+
+  struct Target
+  {
+    virtual ~Target() {}
+
+    // Applies a command, or its inverse when forward is false.
+    virtual void applyEdit (const Command& command, bool forward) = 0;
+  };
+
+  explicit MarkerEditLog (size_t maxCommands = 1000000);
+
+  // The commands recorded after this call are undone and redone together.
+  void beginTransaction() noexcept            { startNewTransaction = true; }
+
+  // Records a command that has already been applied; drops anything redoable.
+  void record (const Command& command);
+
+  bool canUndo() const noexcept               { return appliedTransactions > 0; }
+  bool canRedo() const noexcept               { return appliedTransactions < transactionSizes.size(); }
+  bool undo (Target& target);
+  bool redo (Target& target);
+  void clear();
+
+  static constexpr const char* journalSuffix = ".journal";   // appended to the sidecar name
+  static juce::File getJournalFile (const juce::File& sidecar);
+  static juce::String toJournalLine (const Command& command, bool forward);
+
+  // Applies the journal of a sidecar to markers loaded from it, and to its regions
+  // unless null. Returns the number of entries replayed. Markers are matched by
+  // time and title: identical ones are interchangeable, so whichever a line picks
+  // the resulting list is the same.
+  static int replayJournal (const juce::File& sidecar, juce::Array<double>& times, juce::StringArray& titles,
+                            juce::Array<MarkerRegion>* regions = nullptr);
+
+private:
+  std::deque<Command>   commands;
+  std::deque<size_t>    transactionSizes;
+  size_t                appliedCommands = 0, appliedTransactions = 0;
+  bool                  startNewTransaction = true;
+  const size_t          maxCommands;
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MarkerEditLog)
+};
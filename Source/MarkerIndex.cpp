@@ -0,0 +1,191 @@
+/*
+  ==============================================================================
+
+    MarkerIndex.cpp
+
+  ==============================================================================
+*/
+
+#include "MarkerIndex.h"
+#include <algorithm>
+
+
+using namespace juce;
+
+
+void MarkerIndex::clear()
+{
+  entries.clear();
+  slots.clear();
+  timeOrder.clear();
+  prefixOrder.clear();
+  tagNames.clear();
+  invalidate();
+}
+
+void MarkerIndex::add (MarkerInfo* marker, double pos, const String& title)
+{
+  jassert (slots.find (marker) == slots.end());
+
+  auto lower = title.toLowerCase();
+  slots[marker] = entries.size();
+  entries.push_back ({ marker, pos, title, lower, parseTags (lower) });
+  invalidate();
+}
+
+void MarkerIndex::update (MarkerInfo* marker, double pos, const String& title)
+{
+  auto it = slots.find (marker);
+  if (it == slots.end())
+    return add (marker, pos, title);
+
+  auto& e = entries[it->second];
+  if (e.pos == pos && e.title == title)
+    return;
+
+  e.pos = pos;
+  e.title = title;
+  e.lowerTitle = title.toLowerCase();
+  e.tags = parseTags (e.lowerTitle);
+  invalidate();
+}
+
+void MarkerIndex::remove (MarkerInfo* marker)
+{
+  auto it = slots.find (marker);
+  if (it == slots.end())
+    return;
+
+  // swap with the last entry so removal stays O(1)
+  const size_t slot = it->second;
+  slots.erase (it);
+
+  if (slot != entries.size() - 1)
+  {
+    entries[slot] = std::move (entries.back());
+    slots[entries[slot].marker] = slot;
+  }
+  entries.pop_back();
+  invalidate();
+}
+
+uint64 MarkerIndex::getTagBit (const String& tag) const
+{
+  const int i = tagNames.indexOf (tag.toLowerCase());
+  return i >= 0 ? ((uint64) 1 << i) : 0;
+}
+
+uint64 MarkerIndex::parseTags (const String& lowerTitle)
+{
+  uint64 bits = 0;
+  auto text = lowerTitle.getCharPointer();
+
+  while (! text.isEmpty())
+  {
+    if (*text == '#')
+    {
+      auto start = ++text;
+      while (! text.isEmpty() && (text.isLetterOrDigit() || *text == '_' || *text == '-'))
+        ++text;
+
+      if (text != start)
+      {
+        String tag (start, text);
+        int bit = tagNames.indexOf (tag);
+
+        if (bit < 0 && tagNames.size() < maxTags)
+        {
+          bit = tagNames.size();
+          tagNames.add (tag);
+        }
+
+        if (bit >= 0)
+          bits |= (uint64) 1 << bit;
+      }
+    }
+    else
+    {
+      ++text;
+    }
+  }
+
+  return bits;
+}
+
+void MarkerIndex::rebuildOrders()
+{
+  const int n = (int) entries.size();
+  timeOrder.resize ((size_t) n);
+  prefixOrder.resize ((size_t) n);
+
+  for (int i = 0; i < n; ++i)
+    timeOrder[(size_t) i] = prefixOrder[(size_t) i] = i;
+
+  std::sort (timeOrder.begin(), timeOrder.end(),
+             [this] (int a, int b) { return entries[(size_t) a].pos < entries[(size_t) b].pos; });
+  std::sort (prefixOrder.begin(), prefixOrder.end(),
+             [this] (int a, int b) { return entries[(size_t) a].lowerTitle < entries[(size_t) b].lowerTitle; });
+
+  ordersDirty = false;
+}
+
+bool MarkerIndex::matches (const Entry& e, const String& lowerQuery, uint64 requiredTags, MatchMode mode) const
+{
+  if ((e.tags & requiredTags) != requiredTags)
+    return false;
+
+  if (lowerQuery.isEmpty())
+    return true;
+
+  return mode == MatchMode::prefix ? e.lowerTitle.startsWith (lowerQuery)
+                                   : e.lowerTitle.contains (lowerQuery);
+}
+
+void MarkerIndex::search (const String& query, uint64 requiredTags, MatchMode mode, Array<int>& results)
+{
+  if (ordersDirty)
+    rebuildOrders();
+
+  const auto lowerQuery = query.toLowerCase();
+
+  // type-ahead: a longer query with the same filters can only narrow the previous result set
+  const bool refine = lastResultsValid && mode == lastMode
+                   && (requiredTags & lastTags) == lastTags
+                   && lowerQuery.startsWith (lastQuery);
+
+  results.clearQuick();
+
+  if (refine)
+  {
+    results.ensureStorageAllocated (lastResults.size());
+    for (auto i : lastResults)
+      if (matches (entries[(size_t) i], lowerQuery, requiredTags, mode))
+        results.add (i);
+  }
+  else if (mode == MatchMode::prefix && lowerQuery.isNotEmpty())
+  {
+    // titles are sorted, so all prefix matches are one contiguous run
+    auto first = std::lower_bound (prefixOrder.begin(), prefixOrder.end(), lowerQuery,
+                                   [this] (int i, const String& q) { return entries[(size_t) i].lowerTitle < q; });
+
+    for (auto it = first; it != prefixOrder.end() && entries[(size_t) *it].lowerTitle.startsWith (lowerQuery); ++it)
+      if ((entries[(size_t) *it].tags & requiredTags) == requiredTags)
+        results.add (*it);
+
+    std::sort (results.begin(), results.end(),
+               [this] (int a, int b) { return entries[(size_t) a].pos < entries[(size_t) b].pos; });
+  }
+  else
+  {
+    results.ensureStorageAllocated ((int) timeOrder.size());
+    for (auto i : timeOrder)
+      if (matches (entries[(size_t) i], lowerQuery, requiredTags, mode))
+        results.add (i);
+  }
+
+  lastQuery = lowerQuery;
+  lastTags = requiredTags;
+  lastMode = mode;
+  lastResults = results;
+  lastResultsValid = true;
+}
@@ -0,0 +1,70 @@
+/*
+  ==============================================================================
+
+    MarkerIndex.h
+
+    In-memory search index over marker titles, kept in sync by WaveMarkerComp.
+    Tags are the "#words" found in a title; each distinct tag gets one bit.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <vector>
+#include <unordered_map>
+
+class MarkerInfo;
+
+
+class MarkerIndex
+{
+public:
+  enum class MatchMode { substring, prefix };
+
+  struct Entry
+  {
+    MarkerInfo*   marker;
+    double        pos;
+    juce::String  title;
+    juce::String  lowerTitle;
+    juce::uint64  tags;
+  };
+
+  static constexpr int maxTags = 64;
+
+  void clear();
+  void add (MarkerInfo* marker, double pos, const juce::String& title);
+  void update (MarkerInfo* marker, double pos, const juce::String& title);
+  void remove (MarkerInfo* marker);
+
+  int size() const noexcept                    { return (int) entries.size(); }
+  const Entry& getEntry (int index) const      { return entries[(size_t) index]; }
+
+  // Fills results with entry indices, ordered by marker time. When the query
+  // extends the previous one (type-ahead) only the previous results are rescanned.
+  void search (const juce::String& query, juce::uint64 requiredTags, MatchMode mode, juce::Array<int>& results);
+
+  const juce::StringArray& getTagNames() const noexcept { return tagNames; }
+  juce::uint64 getTagBit (const juce::String& tag) const;
+
+private:
+  std::vector<Entry>                          entries;
+  std::unordered_map<MarkerInfo*, size_t>     slots;
+  std::vector<int>                            timeOrder;
+  std::vector<int>                            prefixOrder;
+  bool                                        ordersDirty = true;
+  juce::StringArray                           tagNames;
+
+  juce::String                                lastQuery;
+  juce::uint64                                lastTags = 0;
+  MatchMode                                   lastMode = MatchMode::substring;
+  juce::Array<int>                            lastResults;
+  bool                                        lastResultsValid = false;
+
+  juce::uint64 parseTags (const juce::String& lowerTitle);
+  void rebuildOrders();
+  void invalidate() noexcept { ordersDirty = true; lastResultsValid = false; }
+  bool matches (const Entry& e, const juce::String& lowerQuery, juce::uint64 requiredTags, MatchMode mode) const;
+};
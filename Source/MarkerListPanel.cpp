@@ -0,0 +1,161 @@
+/*
+  ==============================================================================
+
+    MarkerListPanel.cpp
+
+  ==============================================================================
+*/
+
+#include "MarkerListPanel.h"
+
+
+using namespace juce;
+
+
+static String formatMarkerTime (double seconds)
+{
+  auto ms = (int64) (seconds * 1000.0);
+  return String::formatted ("%d:%02d.%03d", (int) (ms / 60000), (int) ((ms / 1000) % 60), (int) (ms % 1000));
+}
+
+
+MarkerListPanel::MarkerListPanel (WaveMarkerComp& comp) : waveMarkerComp (comp)
+{
+  searchBox.setTextToShowWhenEmpty ("search markers", ColorText1.withAlpha (0.5f));
+  searchBox.addListener (this);
+  addAndMakeVisible (searchBox);
+
+  prefixButton.onClick = [this] { refresh(); };
+  addAndMakeVisible (prefixButton);
+
+  tagsButton.onClick = [this] { showTagsMenu(); };
+  addAndMakeVisible (tagsButton);
+
+  deleteButton.onClick = [this] { deleteShownMarkers(); };
+  addAndMakeVisible (deleteButton);
+
+  list.setColour (ListBox::backgroundColourId, ColorWaveThumbnailBkg);
+  list.setRowHeight (18);
+  addAndMakeVisible (list);
+
+  waveMarkerComp.onMarkersChanged = [this] { refresh(); };
+  refresh();
+}
+
+MarkerListPanel::~MarkerListPanel()
+{
+  waveMarkerComp.onMarkersChanged = nullptr;
+  searchBox.removeListener (this);
+}
+
+void MarkerListPanel::refresh()
+{
+  auto mode = prefixButton.getToggleState() ? MarkerIndex::MatchMode::prefix
+                                            : MarkerIndex::MatchMode::substring;
+  waveMarkerComp.getMarkerIndex().search (searchBox.getText(), requiredTags, mode, results);
+  list.updateContent();
+  list.repaint();
+}
+
+void MarkerListPanel::paint (Graphics& g)
+{
+  g.fillAll (ColorDefaultBkg);
+}
+
+void MarkerListPanel::resized()
+{
+  auto r = getLocalBounds().reduced (2);
+  auto top = r.removeFromTop (22);
+  tagsButton  .setBounds (top.removeFromRight (22));
+  prefixButton.setBounds (top.removeFromRight (60));
+  searchBox   .setBounds (top);
+  r.removeFromTop (2);
+  deleteButton.setBounds (r.removeFromBottom (22).removeFromRight (100));
+  r.removeFromBottom (2);
+  list.setBounds (r);
+}
+
+int MarkerListPanel::getNumRows()
+{
+  return results.size();
+}
+
+void MarkerListPanel::paintListBoxItem (int row, Graphics& g, int width, int height, bool rowIsSelected)
+{
+  auto& index = waveMarkerComp.getMarkerIndex();
+  if (! isPositiveAndBelow (results[row], index.size()))
+    return;
+
+  auto& entry = index.getEntry (results[row]);
+
+  if (rowIsSelected)
+    g.fillAll (ColorWaveMarker.withAlpha (0.3f));
+
+  g.setFont (13.0f);
+  g.setColour (ColorWaveMarker);
+  g.drawText (formatMarkerTime (entry.pos), 2, 0, 70, height, Justification::centredLeft);
+  g.setColour (ColorText1);
+  g.drawText (entry.title, 74, 0, width - 76, height, Justification::centredLeft);
+}
+
+void MarkerListPanel::listBoxItemDoubleClicked (int row, const MouseEvent&)
+{
+  jumpToRow (row);
+}
+
+void MarkerListPanel::returnKeyPressed (int lastRowSelected)
+{
+  jumpToRow (lastRowSelected);
+}
+
+void MarkerListPanel::textEditorTextChanged (TextEditor&)
+{
+  refresh();
+}
+
+void MarkerListPanel::textEditorReturnKeyPressed (TextEditor&)
+{
+  jumpToRow (jmax (0, list.getSelectedRow()));
+}
+
+// one undoable step, however many markers the search matched
+void MarkerListPanel::deleteShownMarkers()
+{
+  auto& index = waveMarkerComp.getMarkerIndex();
+  Array<MarkerInfo*> shown;
+
+  for (auto i : results)
+    if (isPositiveAndBelow (i, index.size()))
+      shown.add (index.getEntry (i).marker);
+
+  waveMarkerComp.removeMarkers (shown);
+}
+
+void MarkerListPanel::jumpToRow (int row)
+{
+  auto& index = waveMarkerComp.getMarkerIndex();
+  if (isPositiveAndBelow (results[row], index.size()))
+    waveMarkerComp.showMarker (index.getEntry (results[row]).pos);
+}
+
+void MarkerListPanel::showTagsMenu()
+{
+  auto& tagNames = waveMarkerComp.getMarkerIndex().getTagNames();
+  PopupMenu menu;
+  menu.addItem (1, "all markers", requiredTags != 0, requiredTags == 0);
+  menu.addSeparator();
+
+  for (int i = 0; i < tagNames.size(); ++i)
+    menu.addItem (i + 2, "#" + tagNames[i], true, (requiredTags & ((uint64) 1 << i)) != 0);
+
+  const int result = menu.showAt (&tagsButton);
+  if (result == 1)
+    requiredTags = 0;
+  else if (result > 1)
+    requiredTags ^= (uint64) 1 << (result - 2);
+  else
+    return;
+
+  tagsButton.setButtonText (requiredTags == 0 ? "#" : "#*");
+  refresh();
+}
@@ -0,0 +1,52 @@
+/*
+  ==============================================================================
+
+    MarkerListPanel.h
+
+    Type-ahead list of the markers of the current file, with #tag filtering.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "MainComponent.h"
+
+
+class MarkerListPanel : public juce::Component,
+                        private juce::ListBoxModel,
+                        private juce::TextEditor::Listener
+{
+public:
+  MarkerListPanel (WaveMarkerComp& waveMarkerComp);
+  ~MarkerListPanel();
+
+  void refresh();
+
+  void paint (juce::Graphics& g) override;
+  void resized() override;
+
+private:
+  WaveMarkerComp&       waveMarkerComp;
+  juce::TextEditor      searchBox;
+  juce::ToggleButton    prefixButton  { "prefix" };
+  juce::TextButton      tagsButton    { "#" };
+  juce::TextButton      deleteButton  { "Delete shown" };
+  juce::ListBox         list          { {}, this };
+  juce::Array<int>      results;
+  juce::uint64          requiredTags = 0;
+
+  int getNumRows() override;
+  void paintListBoxItem (int row, juce::Graphics& g, int width, int height, bool rowIsSelected) override;
+  void listBoxItemDoubleClicked (int row, const juce::MouseEvent&) override;
+  void returnKeyPressed (int lastRowSelected) override;
+
+  void textEditorTextChanged (juce::TextEditor&) override;
+  void textEditorReturnKeyPressed (juce::TextEditor&) override;
+
+  void showTagsMenu();
+  void deleteShownMarkers();
+  void jumpToRow (int row);
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MarkerListPanel)
+};
@@ -0,0 +1,322 @@
+/*
+  ==============================================================================
+
+    PolyphaseResampler.cpp
+
+  ==============================================================================
+*/
+
+#include "PolyphaseResampler.h"
+
+#if defined (__SSE__) || defined (_M_X64) || (defined (_M_IX86_FP) && _M_IX86_FP >= 1)
+ #include <xmmintrin.h>
+ #define EAM_RESAMPLER_SSE 1
+#elif defined (__ARM_NEON) || defined (__ARM_NEON__)
+ #include <arm_neon.h>
+ #define EAM_RESAMPLER_NEON 1
+#endif
+
+
+using namespace juce;
+
+
+namespace
+{
+  struct QualitySettings
+  {
+    int     numTaps;
+    double  kaiserBeta;
+    double  passband;     // fraction of the output Nyquist frequency kept flat
+  };
+
+  QualitySettings getSettings (PolyphaseResampler::Quality quality)
+  {
+    switch (quality)
+    {
+      case PolyphaseResampler::Quality::fast:   return { 16, 6.0, 0.85 };
+      case PolyphaseResampler::Quality::best:   return { 64, 10.0, 0.945 };
+      default:                                  return { 32, 8.0, 0.9 };
+    }
+  }
+
+  double besselI0 (double x)
+  {
+    double sum = 1.0, term = 1.0;
+    for (int k = 1; k < 50 && term > sum * 1.0e-12; ++k)
+    {
+      term *= (x / (2.0 * k)) * (x / (2.0 * k));
+      sum += term;
+    }
+    return sum;
+  }
+
+  // both phases share the input loads; numTaps is a multiple of 4
+  inline void dotProducts (const float* x, const float* a, const float* b, int numTaps, float& dotA, float& dotB) noexcept
+  {
+   #if EAM_RESAMPLER_SSE
+    __m128 sumA = _mm_setzero_ps(), sumB = _mm_setzero_ps();
+    for (int k = 0; k < numTaps; k += 4)
+    {
+      const __m128 v = _mm_loadu_ps (x + k);
+      sumA = _mm_add_ps (sumA, _mm_mul_ps (v, _mm_loadu_ps (a + k)));
+      sumB = _mm_add_ps (sumB, _mm_mul_ps (v, _mm_loadu_ps (b + k)));
+    }
+    float lanesA[4], lanesB[4];
+    _mm_storeu_ps (lanesA, sumA);
+    _mm_storeu_ps (lanesB, sumB);
+    dotA = (lanesA[0] + lanesA[1]) + (lanesA[2] + lanesA[3]);
+    dotB = (lanesB[0] + lanesB[1]) + (lanesB[2] + lanesB[3]);
+   #elif EAM_RESAMPLER_NEON
+    float32x4_t sumA = vdupq_n_f32 (0.0f), sumB = vdupq_n_f32 (0.0f);
+    for (int k = 0; k < numTaps; k += 4)
+    {
+      const float32x4_t v = vld1q_f32 (x + k);
+      sumA = vmlaq_f32 (sumA, v, vld1q_f32 (a + k));
+      sumB = vmlaq_f32 (sumB, v, vld1q_f32 (b + k));
+    }
+    float lanesA[4], lanesB[4];
+    vst1q_f32 (lanesA, sumA);
+    vst1q_f32 (lanesB, sumB);
+    dotA = (lanesA[0] + lanesA[1]) + (lanesA[2] + lanesA[3]);
+    dotB = (lanesB[0] + lanesB[1]) + (lanesB[2] + lanesB[3]);
+   #else
+    float sumA[4] = {}, sumB[4] = {};
+    for (int k = 0; k < numTaps; k += 4)
+      for (int j = 0; j < 4; ++j)
+      {
+        sumA[j] += x[k + j] * a[k + j];
+        sumB[j] += x[k + j] * b[k + j];
+      }
+    dotA = (sumA[0] + sumA[1]) + (sumA[2] + sumA[3]);
+    dotB = (sumB[0] + sumB[1]) + (sumB[2] + sumB[3]);
+   #endif
+  }
+}
+
+
+StringArray PolyphaseResampler::getQualityNames()
+{
+  return { "Built-in (JUCE)", "Fast (16 taps)", "Balanced (32 taps)", "Best (64 taps)" };
+}
+
+PolyphaseResampler::PolyphaseResampler (Quality quality, double inputToOutputRatio)
+: ratio (inputToOutputRatio)
+{
+  const auto settings = getSettings (quality);
+  numTaps = settings.numTaps;
+
+  // cycles per input sample; converting down moves it below the output Nyquist frequency
+  const double cutoff = 0.5 * settings.passband * jmin (1.0, 1.0 / ratio);
+  const double halfLength = numTaps / 2.0;
+  const double windowScale = 1.0 / besselI0 (settings.kaiserBeta);
+
+  coefficients.allocate ((size_t) ((numPhases + 1) * numTaps), true);
+
+  for (int phase = 0; phase <= numPhases; ++phase)
+  {
+    float* row = coefficients + phase * numTaps;
+    const double fraction = phase / (double) numPhases;
+    double sum = 0;
+
+    for (int k = 0; k < numTaps; ++k)
+    {
+      // tap k sits this far from the output position, which is centred between the middle taps
+      const double d = k - (halfLength - 1.0) - fraction;
+      const double t = d / halfLength;
+      if (std::abs (t) >= 1.0)
+        continue;
+
+      const double x = 2.0 * cutoff * d;
+      const double sinc = x == 0.0 ? 1.0 : std::sin (double_Pi * x) / (double_Pi * x);
+      const double window = besselI0 (settings.kaiserBeta * std::sqrt (1.0 - t * t)) * windowScale;
+
+      row[k] = (float) (sinc * window);
+      sum += row[k];
+    }
+
+    // unity gain at DC for every phase
+    for (int k = 0; k < numTaps; ++k)
+      row[k] = (float) (row[k] / sum);
+  }
+}
+
+void PolyphaseResampler::process (const float* input, double pos, float* output, int numOutput) const noexcept
+{
+  for (int n = 0; n < numOutput; ++n)
+  {
+    const double p = pos + n * ratio;
+    const int index = (int) p;
+    const double phase = (p - index) * numPhases;
+    const int row = (int) phase;
+    const float between = (float) (phase - row);
+
+    const float* c = coefficients + row * numTaps;
+    float a, b;
+    dotProducts (input + index, c, c + numTaps, numTaps, a, b);
+    output[n] = a + between * (b - a);
+  }
+}
+
+
+PolyphaseResamplingSource::PolyphaseResamplingSource (AudioSource* i) : input (i)
+{
+}
+
+PolyphaseResamplingSource::~PolyphaseResamplingSource()
+{
+}
+
+void PolyphaseResamplingSource::setSourceSampleRate (double newRate)
+{
+  const ScopedLock ul (updateLock);
+  sourceRate = newRate;
+  update (false);
+}
+
+void PolyphaseResamplingSource::setQuality (Quality newQuality)
+{
+  const ScopedLock ul (updateLock);
+  quality = newQuality;
+  update (false);
+}
+
+double PolyphaseResamplingSource::getRateForTransport() const noexcept
+{
+  return quality == Quality::builtIn ? sourceRate : 0.0;
+}
+
+// blockSize and deviceRate only change here, while the device is stopped and
+// no callback reads them.
+void PolyphaseResamplingSource::prepareToPlay (int samplesPerBlockExpected, double sampleRate)
+{
+  const ScopedLock ul (updateLock);
+  blockSize = jmax (1, samplesPerBlockExpected);
+  deviceRate = sampleRate;
+  update (true);
+}
+
+void PolyphaseResamplingSource::releaseResources()
+{
+  const ScopedLock ul (updateLock);
+  input->releaseResources();
+  deviceRate = 0;
+  inputRate = 0;
+
+  ScopedPointer<PolyphaseResampler> oldResampler;
+  {
+    const ScopedLock sl (lock);
+    resampler.swapWith (oldResampler);
+  }
+  bypassed = true;
+}
+
+void PolyphaseResamplingSource::flushBuffers()
+{
+  const ScopedLock sl (lock);
+
+  if (resampler != nullptr)
+  {
+    history.clear();
+    numBuffered = resampler->getNumTaps() / 2 - 1;
+    position = 0;
+  }
+}
+
+// Called with updateLock held. The input is prepared and the filter built
+// without the audio lock, which only guards the swap, so a callback never
+// waits for either. Until the device is open the input is still prepared at
+// the file rate, so the transport converts seconds correctly.
+void PolyphaseResamplingSource::update (bool inputMustBePrepared)
+{
+  const double newInputRate = quality == Quality::builtIn || sourceRate <= 0 ? deviceRate : sourceRate;
+
+  if (newInputRate > 0 && (inputMustBePrepared || newInputRate != inputRate))
+    input->prepareToPlay (blockSize, newInputRate);
+  inputRate = newInputRate;
+
+  ScopedPointer<PolyphaseResampler> newResampler;
+  AudioBuffer<float> newHistory;
+  double newRatio = 1.0;
+
+  if (deviceRate > 0 && inputRate > 0 && inputRate != deviceRate)
+  {
+    newRatio = inputRate / deviceRate;
+    newResampler = new PolyphaseResampler (quality == Quality::builtIn ? Quality::balanced : quality, newRatio);
+    newHistory.setSize (maxChannels, (int) std::ceil (blockSize * newRatio) + newResampler->getNumTaps() + 8);
+    newHistory.clear();
+  }
+
+  {
+    const ScopedLock sl (lock);
+    resampler.swapWith (newResampler);
+    std::swap (history, newHistory);
+    ratio = newRatio;
+
+    // half a filter of silence puts output time 0 on input time 0
+    numBuffered = resampler != nullptr ? resampler->getNumTaps() / 2 - 1 : 0;
+    position = 0;
+  }
+
+  // the old filter and history are freed here, outside the audio lock
+  bypassed = resampler == nullptr;
+  cpuLoad = 0.0f;
+}
+
+void PolyphaseResamplingSource::getNextAudioBlock (const AudioSourceChannelInfo& info)
+{
+  const ScopedLock sl (lock);
+
+  if (resampler == nullptr)
+  {
+    input->getNextAudioBlock (info);
+    return;
+  }
+
+  // the history holds maxChannels already: this view of it allocates nothing
+  const int numChannels = jmin (info.buffer->getNumChannels(), history.getNumChannels());
+  AudioBuffer<float> used (history.getArrayOfWritePointers(), numChannels, history.getNumSamples());
+
+  for (int ch = numChannels; ch < info.buffer->getNumChannels(); ++ch)
+    info.buffer->clear (ch, info.startSample, info.numSamples);
+
+  const int taps = resampler->getNumTaps();
+  int64 filterTicks = 0;
+
+  for (int done = 0; done < info.numSamples;)
+  {
+    const int num = jmin (blockSize, info.numSamples - done);
+
+    // the last output of this pass needs every tap around its position
+    const int needed = (int) std::ceil (position + num * ratio) + taps + 1;
+    if (needed > numBuffered)
+    {
+      AudioSourceChannelInfo in (&used, numBuffered, needed - numBuffered);
+      input->getNextAudioBlock (in);
+      numBuffered = needed;
+    }
+
+    const int64 start = Time::getHighResolutionTicks();
+    for (int ch = 0; ch < numChannels; ++ch)
+      resampler->process (used.getReadPointer (ch), position,
+                          info.buffer->getWritePointer (ch, info.startSample + done), num);
+    filterTicks += Time::getHighResolutionTicks() - start;
+
+    position += num * ratio;
+    const int consumed = jmin ((int) position, numBuffered);
+
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+      float* data = used.getWritePointer (ch);
+      memmove (data, data + consumed, (size_t) (numBuffered - consumed) * sizeof (float));
+    }
+
+    numBuffered -= consumed;
+    position -= consumed;
+    done += num;
+  }
+
+  // smoothed over roughly a second of callbacks
+  const double audioSeconds = info.numSamples / deviceRate;
+  const float load = (float) (Time::highResolutionTicksToSeconds (filterTicks) / audioSeconds / jmax (1, numChannels));
+  cpuLoad = cpuLoad.load() + (load - cpuLoad.load()) * 0.05f;
+}
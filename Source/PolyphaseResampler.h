@@ -0,0 +1,112 @@
+/*
+  ==============================================================================
+
+    PolyphaseResampler.h
+
+    Sample rate conversion for playback. A Kaiser-windowed sinc is tabulated
+    at 256 phases per input sample; each output sample interpolates between
+    the two nearest phases, so any ratio works, and the inner products run
+    four taps at a time with SSE or NEON. When converting down, the cutoff
+    follows the output rate so nothing aliases.
+
+    PolyphaseResamplingSource sits between the transport and the device. It
+    does no work at all when the file and device rates match, and it
+    measures what the filtering costs per channel.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <atomic>
+
+
+class PolyphaseResampler
+{
+public:
+  enum class Quality
+  {
+    builtIn,      // JUCE's own interpolation in the transport, kept for comparison
+    fast,
+    balanced,
+    best
+  };
+
+  static juce::StringArray getQualityNames();
+
+  PolyphaseResampler (Quality quality, double inputToOutputRatio);
+
+  int getNumTaps() const noexcept                 { return numTaps; }
+
+  // Writes numOutput samples starting at fractional input position 'position',
+  // measured from 'input'. The input must hold the taps around every position
+  // used, i.e. up to position + numOutput * ratio + getNumTaps().
+  void process (const float* input, double position, float* output, int numOutput) const noexcept;
+
+private:
+  static constexpr int numPhases = 256;
+
+  int                       numTaps = 0;
+  double                    ratio = 1.0;
+  juce::HeapBlock<float>    coefficients;   // (numPhases + 1) rows of numTaps
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PolyphaseResampler)
+};
+
+
+class PolyphaseResamplingSource : public juce::AudioSource
+{
+public:
+  using Quality = PolyphaseResampler::Quality;
+
+  // Channels filtered; further channels of the device are left silent.
+  static constexpr int maxChannels = 32;
+
+  // The input is not owned. It is prepared at the source rate, except with the
+  // built-in quality, where it gets the device rate and converts itself.
+  PolyphaseResamplingSource (juce::AudioSource* input);
+  ~PolyphaseResamplingSource();
+
+  void setSourceSampleRate (double newRate);
+  void setQuality (Quality newQuality);
+  Quality getQuality() const noexcept                 { return quality; }
+
+  // Rate the transport must convert from itself: the file rate with the
+  // built-in quality, otherwise 0 as this stage does it.
+  double getRateForTransport() const noexcept;
+
+  bool isBypassed() const noexcept                    { return bypassed.load(); }
+
+  // Forgets the input buffered so far; call after moving the input.
+  void flushBuffers();
+
+  // Filtering time per channel, as a fraction of the audio time it produced.
+  float getCpuLoadPerChannel() const noexcept         { return cpuLoad.load(); }
+
+  void prepareToPlay (int samplesPerBlockExpected, double sampleRate) override;
+  void releaseResources() override;
+  void getNextAudioBlock (const juce::AudioSourceChannelInfo& info) override;
+
+private:
+  juce::AudioSource*                        input;
+  juce::CriticalSection                     updateLock;     // settings, never taken by the callback
+  juce::CriticalSection                     lock;           // the filter state the callback uses
+  Quality                                   quality = Quality::balanced;
+  double                                    sourceRate = 0;
+  double                                    deviceRate = 0;
+  double                                    inputRate = 0;
+  double                                    ratio = 1.0;
+  int                                       blockSize = 512;
+
+  juce::ScopedPointer<PolyphaseResampler>   resampler;
+  juce::AudioBuffer<float>                  history;
+  int                                       numBuffered = 0;
+  double                                    position = 0;
+  std::atomic<float>                        cpuLoad { 0.0f };
+  std::atomic<bool>                         bypassed { true };
+
+  void update (bool inputMustBePrepared);
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PolyphaseResamplingSource)
+};
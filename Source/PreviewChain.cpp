@@ -0,0 +1,432 @@
+/*
+  ==============================================================================
+
+    PreviewChain.cpp
+
+  ==============================================================================
+*/
+
+#include "PreviewChain.h"
+
+
+using namespace juce;
+
+
+PreviewParameter::PreviewParameter (const String& n, const String& l, NormalisableRange<float> r, float defaultValue)
+: name (n), label (l), range (r), defaultNormalised (r.convertTo0to1 (defaultValue)), normalised (defaultNormalised)
+{
+}
+
+float PreviewParameter::getValue() const                  { return normalised.load(); }
+void PreviewParameter::setValue (float newValue)          { normalised = jlimit (0.0f, 1.0f, newValue); }
+float PreviewParameter::getDefaultValue() const           { return defaultNormalised; }
+String PreviewParameter::getName (int maximumStringLength) const  { return name.substring (0, maximumStringLength); }
+String PreviewParameter::getLabel() const                 { return label; }
+
+String PreviewParameter::getText (float value, int maximumStringLength) const
+{
+  return String (range.convertFrom0to1 (value), 1).substring (0, maximumStringLength);
+}
+
+float PreviewParameter::getValueForText (const String& text) const
+{
+  return range.convertTo0to1 (jlimit (range.start, range.end, text.getFloatValue()));
+}
+
+
+namespace
+{
+  // designs are kept clear of the Nyquist frequency
+  float limitFrequency (float frequency, double sampleRate)
+  {
+    return (float) jmin ((double) frequency, sampleRate * 0.45);
+  }
+
+  float timeToCoefficient (float milliseconds, double sampleRate)
+  {
+    return (float) std::exp (-1.0 / (jmax (0.01, (double) milliseconds) * 0.001 * sampleRate));
+  }
+
+
+  // 24 dB per octave Butterworth, as two biquads
+  class HighPassNode : public PreviewNode
+  {
+  public:
+    HighPassNode()
+    {
+      frequency = addFloat ("Frequency", "Hz", { 20.0f, 500.0f, 0.0f, 0.5f }, 80.0f);
+    }
+
+    const String getName() const override           { return "High-pass"; }
+
+    void prepareToPlay (double rate, int) override
+    {
+      sampleRate = rate;
+      designed = -1.0f;
+      for (auto& stage : filters)
+        for (auto& filter : stage)
+          filter.reset();
+    }
+
+  protected:
+    void process (AudioBuffer<float>& buffer, int numChannels) override
+    {
+      const float f = frequency->get();
+      if (f != designed)
+      {
+        static const double q[2] = { 0.5412, 1.3066 };
+        for (int s = 0; s < 2; ++s)
+        {
+          const auto c = IIRCoefficients::makeHighPass (sampleRate, limitFrequency (f, sampleRate), q[s]);
+          for (auto& filter : filters[s])
+            filter.setCoefficients (c);
+        }
+        designed = f;
+      }
+
+      for (int ch = 0; ch < numChannels; ++ch)
+        for (auto& stage : filters)
+          stage[ch].processSamples (buffer.getWritePointer (ch), buffer.getNumSamples());
+    }
+
+  private:
+    PreviewParameter*   frequency;
+    double              sampleRate = 44100.0;
+    float               designed = -1.0f;
+    IIRFilter           filters[2][maxChannels];
+  };
+
+
+  // low shelf, bell and high shelf; a band at 0 dB is skipped
+  class EqualizerNode : public PreviewNode
+  {
+  public:
+    EqualizerNode()
+    {
+      const NormalisableRange<float> gain (-12.0f, 12.0f);
+
+      params[lowGain]   = addFloat ("Low gain", "dB", gain, 0.0f);
+      params[lowFreq]   = addFloat ("Low frequency", "Hz", { 40.0f, 500.0f, 0.0f, 0.5f }, 150.0f);
+      params[midGain]   = addFloat ("Mid gain", "dB", gain, 0.0f);
+      params[midFreq]   = addFloat ("Mid frequency", "Hz", { 200.0f, 8000.0f, 0.0f, 0.4f }, 2500.0f);
+      params[midQ]      = addFloat ("Mid Q", {}, { 0.3f, 4.0f, 0.0f, 0.5f }, 1.0f);
+      params[highGain]  = addFloat ("High gain", "dB", gain, 0.0f);
+      params[highFreq]  = addFloat ("High frequency", "Hz", { 2000.0f, 16000.0f, 0.0f, 0.5f }, 6000.0f);
+
+      for (auto& d : designed)
+        d = -1.0e6f;
+    }
+
+    const String getName() const override           { return "EQ"; }
+
+    void prepareToPlay (double rate, int) override
+    {
+      sampleRate = rate;
+      for (auto& d : designed)
+        d = -1.0e6f;
+      for (auto& band : filters)
+        for (auto& filter : band)
+          filter.reset();
+    }
+
+  protected:
+    void process (AudioBuffer<float>& buffer, int numChannels) override
+    {
+      float values[numParams];
+      bool changed = false;
+      for (int p = 0; p < numParams; ++p)
+      {
+        values[p] = params[p]->get();
+        changed = changed || values[p] != designed[p];
+      }
+
+      if (changed)
+        redesign (values);
+
+      for (int band = 0; band < 3; ++band)
+        if (active[band])
+          for (int ch = 0; ch < numChannels; ++ch)
+            filters[band][ch].processSamples (buffer.getWritePointer (ch), buffer.getNumSamples());
+    }
+
+  private:
+    enum { lowGain, lowFreq, midGain, midFreq, midQ, highGain, highFreq, numParams };
+
+    PreviewParameter*   params[numParams];
+    float               designed[numParams];
+    bool                active[3] = {};
+    double              sampleRate = 44100.0;
+    IIRFilter           filters[3][maxChannels];
+
+    void redesign (const float* values)
+    {
+      const float gains[3] = { values[lowGain], values[midGain], values[highGain] };
+
+      for (int band = 0; band < 3; ++band)
+      {
+        const bool nowActive = std::abs (gains[band]) >= 0.05f;
+        if (nowActive && ! active[band])
+          for (auto& filter : filters[band])
+            filter.reset();
+        active[band] = nowActive;
+      }
+
+      const auto low = IIRCoefficients::makeLowShelf (sampleRate, limitFrequency (values[lowFreq], sampleRate), 0.707,
+                                                      Decibels::decibelsToGain (values[lowGain]));
+      const auto mid = IIRCoefficients::makePeakFilter (sampleRate, limitFrequency (values[midFreq], sampleRate), values[midQ],
+                                                        Decibels::decibelsToGain (values[midGain]));
+      const auto high = IIRCoefficients::makeHighShelf (sampleRate, limitFrequency (values[highFreq], sampleRate), 0.707,
+                                                        Decibels::decibelsToGain (values[highGain]));
+
+      for (int ch = 0; ch < maxChannels; ++ch)
+      {
+        filters[0][ch].setCoefficients (low);
+        filters[1][ch].setCoefficients (mid);
+        filters[2][ch].setCoefficients (high);
+      }
+
+      for (int p = 0; p < numParams; ++p)
+        designed[p] = values[p];
+    }
+  };
+
+
+  // Feed-forward compressor on the loudest channel, so the stereo image stays
+  // put, followed by a limiter that catches what is left above the ceiling on
+  // the very sample (no look-ahead, so it adds no latency).
+  class CompressorNode : public PreviewNode
+  {
+  public:
+    CompressorNode()
+    {
+      threshold = addFloat ("Threshold", "dB", { -60.0f, 0.0f }, -24.0f);
+      ratio     = addFloat ("Ratio", ":1", { 1.0f, 20.0f, 0.0f, 0.5f }, 4.0f);
+      attack    = addFloat ("Attack", "ms", { 0.1f, 100.0f, 0.0f, 0.4f }, 5.0f);
+      release   = addFloat ("Release", "ms", { 10.0f, 1000.0f, 0.0f, 0.4f }, 150.0f);
+      makeup    = addFloat ("Makeup", "dB", { 0.0f, 24.0f }, 6.0f);
+      ceiling   = addFloat ("Limiter ceiling", "dBFS", { -12.0f, 0.0f }, -1.0f);
+    }
+
+    const String getName() const override           { return "Compressor"; }
+
+    void prepareToPlay (double rate, int) override
+    {
+      sampleRate = rate;
+      reduction = 0.0f;
+      limiterGain = 1.0f;
+    }
+
+  protected:
+    void process (AudioBuffer<float>& buffer, int numChannels) override
+    {
+      const float thresholdDb = threshold->get();
+      const float thresholdGain = Decibels::decibelsToGain (thresholdDb);
+      const float slope = 1.0f - 1.0f / ratio->get();
+      const float attackCoefficient = timeToCoefficient (attack->get(), sampleRate);
+      const float releaseCoefficient = timeToCoefficient (release->get(), sampleRate);
+      const float makeupGain = Decibels::decibelsToGain (makeup->get());
+      const float ceilingGain = Decibels::decibelsToGain (ceiling->get());
+
+      float* const* data = buffer.getArrayOfWritePointers();
+      const int numSamples = buffer.getNumSamples();
+
+      for (int i = 0; i < numSamples; ++i)
+      {
+        float peak = 0.0f;
+        for (int ch = 0; ch < numChannels; ++ch)
+          peak = jmax (peak, std::abs (data[ch][i]));
+
+        // the logarithms are only needed above the threshold
+        const float target = peak > thresholdGain ? (Decibels::gainToDecibels (peak) - thresholdDb) * slope : 0.0f;
+        const float coefficient = target > reduction ? attackCoefficient : releaseCoefficient;
+        reduction = target + coefficient * (reduction - target);
+
+        float gain = reduction > 1.0e-4f ? makeupGain * Decibels::decibelsToGain (-reduction) : makeupGain;
+
+        const float out = peak * gain;
+        const float limit = out > ceilingGain ? ceilingGain / out : 1.0f;
+        limiterGain = limit < limiterGain ? limit : limit + releaseCoefficient * (limiterGain - limit);
+        gain *= limiterGain;
+
+        for (int ch = 0; ch < numChannels; ++ch)
+          data[ch][i] *= gain;
+      }
+    }
+
+  private:
+    PreviewParameter*   threshold;
+    PreviewParameter*   ratio;
+    PreviewParameter*   attack;
+    PreviewParameter*   release;
+    PreviewParameter*   makeup;
+    PreviewParameter*   ceiling;
+    double              sampleRate = 44100.0;
+    float               reduction = 0.0f;       // dB
+    float               limiterGain = 1.0f;
+  };
+}
+
+
+StringArray PreviewNode::getTypeNames()
+{
+  return { "High-pass", "EQ", "Compressor / limiter" };
+}
+
+PreviewNode* PreviewNode::create (Type type)
+{
+  switch (type)
+  {
+    case Type::highPass:    return new HighPassNode();
+    case Type::equalizer:   return new EqualizerNode();
+    default:                return new CompressorNode();
+  }
+}
+
+AudioProcessorEditor* PreviewNode::createEditor()
+{
+  return new GenericAudioProcessorEditor (this);
+}
+
+PreviewParameter* PreviewNode::addFloat (const String& name, const String& label,
+                                         NormalisableRange<float> range, float defaultValue)
+{
+  auto* parameter = new PreviewParameter (name, label, range, defaultValue);
+  addParameter (parameter);
+  return parameter;
+}
+
+void PreviewNode::getStateInformation (MemoryBlock& destData)
+{
+  XmlElement xml ("PreviewNode");
+  for (auto* parameter : getParameters())
+    xml.setAttribute ("p" + String (parameter->getParameterIndex()), parameter->getValue());
+  copyXmlToBinary (xml, destData);
+}
+
+void PreviewNode::setStateInformation (const void* data, int sizeInBytes)
+{
+  ScopedPointer<XmlElement> xml (getXmlFromBinary (data, sizeInBytes));
+  if (xml == nullptr)
+    return;
+
+  for (auto* parameter : getParameters())
+  {
+    const String key ("p" + String (parameter->getParameterIndex()));
+    if (xml->hasAttribute (key))
+      parameter->setValueNotifyingHost ((float) xml->getDoubleAttribute (key));
+  }
+}
+
+void PreviewNode::processBlock (AudioBuffer<float>& buffer, MidiBuffer&)
+{
+  ScopedNoDenormals noDenormals;
+  process (buffer, jmin (buffer.getNumChannels(), maxChannels));
+}
+
+
+PreviewChain::PreviewChain (AudioSource* i) : input (i)
+{
+}
+
+PreviewChain::~PreviewChain()
+{
+}
+
+PreviewNode* PreviewChain::insertNode (PreviewNode::Type type, int index)
+{
+  auto* node = PreviewNode::create (type);
+
+  const ScopedLock sl (lock);
+  if (sampleRate > 0)
+  {
+    node->setRateAndBufferSizeDetails (sampleRate, blockSize);
+    node->prepareToPlay (sampleRate, blockSize);
+  }
+
+  nodes.insert (index, node);
+  countEnabled();
+  return node;
+}
+
+void PreviewChain::removeNode (int index)
+{
+  ScopedPointer<PreviewNode> removed;
+  {
+    const ScopedLock sl (lock);
+    removed = nodes.removeAndReturn (index);
+    countEnabled();
+  }
+  // deleted once the audio thread can no longer reach it
+}
+
+void PreviewChain::setNodeEnabled (int index, bool shouldBeEnabled)
+{
+  const ScopedLock sl (lock);
+  if (auto* node = nodes[index])
+    node->enabled = shouldBeEnabled;
+  countEnabled();
+}
+
+void PreviewChain::countEnabled()
+{
+  int n = 0;
+  for (auto* node : nodes)
+    if (node->isEnabled())
+      ++n;
+  numEnabled = n;
+}
+
+void PreviewChain::prepareToPlay (int samplesPerBlockExpected, double newSampleRate)
+{
+  input->prepareToPlay (samplesPerBlockExpected, newSampleRate);
+
+  const ScopedLock sl (lock);
+  sampleRate = newSampleRate;
+  blockSize = jmax (1, samplesPerBlockExpected);
+
+  for (auto* node : nodes)
+  {
+    node->setRateAndBufferSizeDetails (sampleRate, blockSize);
+    node->prepareToPlay (sampleRate, blockSize);
+  }
+}
+
+void PreviewChain::releaseResources()
+{
+  input->releaseResources();
+
+  const ScopedLock sl (lock);
+  for (auto* node : nodes)
+    node->releaseResources();
+}
+
+void PreviewChain::getNextAudioBlock (const AudioSourceChannelInfo& info)
+{
+  input->getNextAudioBlock (info);
+
+  if (numEnabled.load() == 0)
+    return;
+
+  const ScopedLock sl (lock);
+  if (sampleRate <= 0)
+    return;
+
+  ScopedNoDenormals noDenormals;
+
+  const int numChannels = jmin (info.buffer->getNumChannels(), (int) PreviewNode::maxChannels);
+  AudioBuffer<float> block (info.buffer->getArrayOfWritePointers(), numChannels, info.startSample, info.numSamples);
+  const double audioSeconds = info.numSamples / sampleRate;
+
+  for (auto* node : nodes)
+  {
+    if (! node->isEnabled())
+      continue;
+
+    const int64 start = Time::getHighResolutionTicks();
+    node->process (block, numChannels);
+    const float load = (float) (Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - start) / audioSeconds);
+
+    // smoothed over roughly a second of callbacks, like the resampler's
+    node->cpuLoad = node->cpuLoad.load() + (load - node->cpuLoad.load()) * 0.05f;
+  }
+}
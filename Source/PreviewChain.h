@@ -0,0 +1,136 @@
+/*
+  ==============================================================================
+
+    PreviewChain.h
+
+    Processing for listening only, between the resampler and the device: a
+    high-pass, a three band EQ and a compressor with a limiter, to make
+    speech easier to follow. Nodes are AudioProcessors, so their parameters
+    get the generic editor; parameter values are atomics the audio thread
+    reads each block, and filters are redesigned there when they change.
+    With no node switched on the chain costs nothing but one atomic load.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <atomic>
+
+
+// A float parameter whose value can be set from any thread while the audio thread reads it.
+class PreviewParameter : public juce::AudioProcessorParameter
+{
+public:
+  PreviewParameter (const juce::String& name, const juce::String& label,
+                    juce::NormalisableRange<float> range, float defaultValue);
+
+  // the value in the units of the range, for the audio thread
+  float get() const noexcept          { return range.convertFrom0to1 (normalised.load (std::memory_order_relaxed)); }
+
+  float getValue() const override;
+  void setValue (float newValue) override;
+  float getDefaultValue() const override;
+  juce::String getName (int maximumStringLength) const override;
+  juce::String getLabel() const override;
+  juce::String getText (float value, int maximumStringLength) const override;
+  float getValueForText (const juce::String& text) const override;
+
+private:
+  const juce::String                    name, label;
+  const juce::NormalisableRange<float>  range;
+  const float                           defaultNormalised;
+  std::atomic<float>                    normalised;
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PreviewParameter)
+};
+
+
+class PreviewNode : public juce::AudioProcessor
+{
+public:
+  enum class Type
+  {
+    highPass,
+    equalizer,
+    compressor
+  };
+
+  static juce::StringArray getTypeNames();
+  static PreviewNode* create (Type type);
+
+  // channels beyond this pass through
+  static constexpr int maxChannels = 8;
+
+  bool isEnabled() const noexcept                       { return enabled.load(); }
+
+  // Processing time, as a fraction of the audio time it produced.
+  float getCpuLoad() const noexcept                     { return cpuLoad.load(); }
+
+  bool hasEditor() const override                       { return true; }
+  juce::AudioProcessorEditor* createEditor() override;
+  double getTailLengthSeconds() const override          { return 0; }
+  bool acceptsMidi() const override                     { return false; }
+  bool producesMidi() const override                    { return false; }
+  int getNumPrograms() override                         { return 1; }
+  int getCurrentProgram() override                      { return 0; }
+  void setCurrentProgram (int) override                 {}
+  const juce::String getProgramName (int) override      { return {}; }
+  void changeProgramName (int, const juce::String&) override {}
+  void getStateInformation (juce::MemoryBlock& destData) override;
+  void setStateInformation (const void* data, int sizeInBytes) override;
+  void releaseResources() override                      {}
+  void processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer&) override;
+  using juce::AudioProcessor::processBlock;
+
+protected:
+  PreviewNode() = default;
+
+  PreviewParameter* addFloat (const juce::String& name, const juce::String& label,
+                              juce::NormalisableRange<float> range, float defaultValue);
+
+  virtual void process (juce::AudioBuffer<float>& buffer, int numChannels) = 0;
+
+private:
+  friend class PreviewChain;
+
+  std::atomic<bool>   enabled { true };
+  std::atomic<float>  cpuLoad { 0.0f };
+};
+
+
+class PreviewChain : public juce::AudioSource
+{
+public:
+  // The input is not owned.
+  PreviewChain (juce::AudioSource* input);
+  ~PreviewChain();
+
+  // Message thread only. The node is prepared before it is heard.
+  PreviewNode* insertNode (PreviewNode::Type type, int index = -1);
+  void removeNode (int index);
+  void setNodeEnabled (int index, bool shouldBeEnabled);
+
+  int getNumNodes() const noexcept                      { return nodes.size(); }
+  PreviewNode* getNode (int index) const noexcept       { return nodes[index]; }
+
+  // True while no node is switched on: the audio goes straight through.
+  bool isBypassed() const noexcept                      { return numEnabled.load() == 0; }
+
+  void prepareToPlay (int samplesPerBlockExpected, double sampleRate) override;
+  void releaseResources() override;
+  void getNextAudioBlock (const juce::AudioSourceChannelInfo& info) override;
+
+private:
+  juce::AudioSource*                input;
+  juce::CriticalSection             lock;
+  juce::OwnedArray<PreviewNode>     nodes;
+  std::atomic<int>                  numEnabled { 0 };
+  double                            sampleRate = 0;
+  int                               blockSize = 512;
+
+  void countEnabled();
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PreviewChain)
+};
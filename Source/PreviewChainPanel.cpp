@@ -0,0 +1,182 @@
+/*
+  ==============================================================================
+
+    PreviewChainPanel.cpp
+
+  ==============================================================================
+*/
+
+#include "PreviewChainPanel.h"
+#include "MainComponent.h"
+
+
+using namespace juce;
+
+
+class PreviewChainPanel::NodeRow : public Component
+{
+public:
+  NodeRow (PreviewChainPanel& o, int i) : owner (o), index (i)
+  {
+    auto* node = owner.chain.getNode (index);
+
+    enabledButton.setButtonText (node->getName());
+    enabledButton.setToggleState (node->isEnabled(), dontSendNotification);
+    enabledButton.onClick = [this] { owner.chain.setNodeEnabled (index, enabledButton.getToggleState()); };
+    addAndMakeVisible (enabledButton);
+
+    removeButton.onClick = [this] { owner.removeNode (index); };
+    addAndMakeVisible (removeButton);
+
+    cpuLabel.setFont (Font (13.0f));
+    cpuLabel.setJustificationType (Justification::centredRight);
+    addAndMakeVisible (cpuLabel);
+
+    editor = node->createEditor();
+    addAndMakeVisible (editor);
+
+    setSize (400, headerHeight + editor->getHeight());
+  }
+
+  void updateCpu()
+  {
+    auto* node = owner.chain.getNode (index);
+    cpuLabel.setText (node->isEnabled() ? String (node->getCpuLoad() * 100.0f, 2) + "% CPU" : String ("off"),
+                      dontSendNotification);
+  }
+
+  void resized() override
+  {
+    auto r = getLocalBounds();
+    auto header = r.removeFromTop (headerHeight).reduced (0, 2);
+    enabledButton.setBounds (header.removeFromLeft (180));
+    removeButton.setBounds (header.removeFromRight (70));
+    cpuLabel.setBounds (header);
+    editor->setBounds (r.withHeight (editor->getHeight()));
+  }
+
+private:
+  static const int headerHeight = 26;
+
+  PreviewChainPanel&                      owner;
+  const int                               index;
+  ToggleButton                            enabledButton;
+  TextButton                              removeButton { "Remove" };
+  Label                                   cpuLabel;
+  ScopedPointer<AudioProcessorEditor>     editor;
+};
+
+
+PreviewChainPanel::PreviewChainPanel (PreviewChain& c) : chain (c)
+{
+  addButton.onClick = [this] { showAddMenu(); };
+  addAndMakeVisible (addButton);
+
+  statusLabel.setFont (Font (13.0f));
+  addAndMakeVisible (statusLabel);
+
+  viewport.setViewedComponent (&content, false);
+  viewport.setScrollBarsShown (true, false);
+  addAndMakeVisible (viewport);
+
+  rebuildRows();
+  startTimerHz (4);
+
+  setSize (440, 480);
+}
+
+PreviewChainPanel::~PreviewChainPanel()
+{
+  rows.clear();
+}
+
+void PreviewChainPanel::paint (Graphics& g)
+{
+  g.fillAll (ColorDefaultBkg);
+}
+
+void PreviewChainPanel::resized()
+{
+  auto r = getLocalBounds().reduced (4);
+  auto top = r.removeFromTop (24);
+  addButton.setBounds (top.removeFromLeft (80));
+  top.removeFromLeft (8);
+  statusLabel.setBounds (top);
+  r.removeFromTop (4);
+  viewport.setBounds (r);
+  layoutRows();
+}
+
+void PreviewChainPanel::showAddMenu()
+{
+  PopupMenu menu;
+  const auto names = PreviewNode::getTypeNames();
+  for (int i = 0; i < names.size(); ++i)
+    menu.addItem (1 + i, names[i]);
+
+  const int result = menu.showAt (&addButton);
+  if (result <= 0)
+    return;
+
+  chain.insertNode ((PreviewNode::Type) (result - 1));
+  rebuildRows();
+  timerCallback();
+}
+
+void PreviewChainPanel::removeNode (int index)
+{
+  // called from the row's own button: the row must outlive the click, and the
+  // editors go before the node they show
+  Component::SafePointer<PreviewChainPanel> safeThis (this);
+
+  MessageManager::callAsync ([safeThis, index]
+  {
+    if (safeThis == nullptr)
+      return;
+
+    safeThis->rows.clear();
+    safeThis->chain.removeNode (index);
+    safeThis->rebuildRows();
+    safeThis->timerCallback();
+  });
+}
+
+void PreviewChainPanel::rebuildRows()
+{
+  rows.clear();
+
+  for (int i = 0; i < chain.getNumNodes(); ++i)
+    content.addAndMakeVisible (rows.add (new NodeRow (*this, i)));
+
+  layoutRows();
+}
+
+void PreviewChainPanel::layoutRows()
+{
+  const int width = viewport.getMaximumVisibleWidth();
+  int y = 0;
+
+  for (auto* row : rows)
+  {
+    row->setBounds (0, y, width, row->getHeight());
+    y += row->getHeight() + 8;
+  }
+
+  content.setSize (width, jmax (y, 1));
+}
+
+void PreviewChainPanel::timerCallback()
+{
+  float total = 0;
+  for (int i = 0; i < chain.getNumNodes(); ++i)
+    if (chain.getNode (i)->isEnabled())
+      total += chain.getNode (i)->getCpuLoad();
+
+  for (auto* row : rows)
+    row->updateCpu();
+
+  statusLabel.setText (chain.getNumNodes() == 0 ? String ("empty: playback is not processed")
+                         : chain.isBypassed() ? String ("all nodes off: bypassed")
+                                              : String (total * 100.0f, 2) + "% CPU in total",
+                       dontSendNotification);
+}
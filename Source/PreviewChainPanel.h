@@ -0,0 +1,44 @@
+/*
+  ==============================================================================
+
+    PreviewChainPanel.h
+
+    Adds, switches and removes the nodes of the preview chain, shows their
+    parameters and what each costs.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "PreviewChain.h"
+
+
+class PreviewChainPanel : public juce::Component,
+                          private juce::Timer
+{
+public:
+  PreviewChainPanel (PreviewChain& chain);
+  ~PreviewChainPanel();
+
+  void paint (juce::Graphics& g) override;
+  void resized() override;
+
+private:
+  class NodeRow;
+
+  PreviewChain&                   chain;
+  juce::TextButton                addButton { "Add..." };
+  juce::Label                     statusLabel;
+  juce::Viewport                  viewport;
+  juce::Component                 content;
+  juce::OwnedArray<NodeRow>       rows;
+
+  void showAddMenu();
+  void removeNode (int index);
+  void rebuildRows();
+  void layoutRows();
+  void timerCallback() override;
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PreviewChainPanel)
+};
@@ -0,0 +1,691 @@
+/*
+  ==============================================================================
+
+    QcAnalyzer.cpp
+
+  ==============================================================================
+*/
+
+#include "QcAnalyzer.h"
+#include "MainComponent.h"
+#include "SegmentExporter.h"
+#include "MarkerEditLog.h"
+#include "SidecarMerge.h"
+
+#if defined (__SSE__) || defined (_M_X64) || (defined (_M_IX86_FP) && _M_IX86_FP >= 1)
+ #include <xmmintrin.h>
+ #define EAM_QC_SSE 1
+#elif defined (__ARM_NEON) || defined (__ARM_NEON__)
+ #include <arm_neon.h>
+ #define EAM_QC_NEON 1
+#endif
+
+
+using namespace juce;
+
+
+static const int blockSize = 65536;
+static const char* const markerPrefix = "QC ";
+
+
+namespace
+{
+  // running sum and peak of four interleaved lanes
+  struct Lanes
+  {
+   #if EAM_QC_SSE
+    __m128 sum = _mm_setzero_ps(), peak = _mm_setzero_ps();
+   #elif EAM_QC_NEON
+    float32x4_t sum = vdupq_n_f32 (0.0f), peak = vdupq_n_f32 (0.0f);
+   #else
+    float sum[4] = {}, peak[4] = {};
+   #endif
+  };
+
+  // Adds four samples to the lanes. Returns true when any of them is an exact
+  // zero or at least at the limit, i.e. when they need a look one by one.
+  inline bool addFour (Lanes& lanes, const float* x, float limit) noexcept
+  {
+   #if EAM_QC_SSE
+    const __m128 v = _mm_loadu_ps (x);
+    const __m128 a = _mm_andnot_ps (_mm_set1_ps (-0.0f), v);
+    lanes.sum = _mm_add_ps (lanes.sum, v);
+    lanes.peak = _mm_max_ps (lanes.peak, a);
+    const __m128 flagged = _mm_or_ps (_mm_cmpge_ps (a, _mm_set1_ps (limit)), _mm_cmpeq_ps (v, _mm_setzero_ps()));
+    return _mm_movemask_ps (flagged) != 0;
+   #elif EAM_QC_NEON
+    const float32x4_t v = vld1q_f32 (x);
+    const float32x4_t a = vabsq_f32 (v);
+    lanes.sum = vaddq_f32 (lanes.sum, v);
+    lanes.peak = vmaxq_f32 (lanes.peak, a);
+    const uint32x4_t flagged = vorrq_u32 (vcgeq_f32 (a, vdupq_n_f32 (limit)), vceqq_f32 (v, vdupq_n_f32 (0.0f)));
+    const uint32x2_t halves = vorr_u32 (vget_low_u32 (flagged), vget_high_u32 (flagged));
+    return (vget_lane_u32 (halves, 0) | vget_lane_u32 (halves, 1)) != 0;
+   #else
+    bool flagged = false;
+    for (int j = 0; j < 4; ++j)
+    {
+      const float a = std::abs (x[j]);
+      lanes.sum[j] += x[j];
+      lanes.peak[j] = jmax (lanes.peak[j], a);
+      flagged = flagged || a >= limit || x[j] == 0.0f;
+    }
+    return flagged;
+   #endif
+  }
+
+  inline void reduce (const Lanes& lanes, double& sum, float& peak) noexcept
+  {
+    float s[4], p[4];
+   #if EAM_QC_SSE
+    _mm_storeu_ps (s, lanes.sum);
+    _mm_storeu_ps (p, lanes.peak);
+   #elif EAM_QC_NEON
+    vst1q_f32 (s, lanes.sum);
+    vst1q_f32 (p, lanes.peak);
+   #else
+    for (int j = 0; j < 4; ++j)
+    {
+      s[j] = lanes.sum[j];
+      p[j] = lanes.peak[j];
+    }
+   #endif
+    sum += (double) (s[0] + s[1]) + (double) (s[2] + s[3]);
+    peak = jmax (peak, jmax (p[0], p[1]), jmax (p[2], p[3]));
+  }
+
+  // runs of one channel that are still open at the end of a block
+  struct ChannelState
+  {
+    int64   clipStart = -1, overStart = -1, zeroStart = -1;
+    float   clipMax = 0, overMax = 0;
+    bool    overHadClip = false;
+    bool    seenSignal = false;
+    double  sum = 0;
+    float   peak = 0;
+  };
+
+  class ChannelSweep
+  {
+  public:
+    ChannelSweep (const QcAnalyzer::Options& o, int channel, float peakLimit, Array<QcAnalyzer::Issue>& found)
+    : options (o), bit (channel < 32 ? 1u << channel : 0u), limit (peakLimit), issues (found) {}
+
+    void process (const float* x, int num, int64 offset) noexcept
+    {
+      Lanes lanes;
+      int i = 0;
+
+      for (; i + 4 <= num; i += 4)
+      {
+        if (! addFour (lanes, x + i, limit))
+        {
+          // nothing but ordinary signal: any open run ends here
+          if (state.overStart >= 0 || state.zeroStart >= 0)
+            closeRuns (offset + i);
+          state.seenSignal = true;
+          continue;
+        }
+
+        for (int j = 0; j < 4; ++j)
+          step (x[i + j], offset + i + j);
+      }
+
+      reduce (lanes, state.sum, state.peak);
+
+      for (; i < num; ++i)
+      {
+        state.sum += x[i];
+        state.peak = jmax (state.peak, std::abs (x[i]));
+        step (x[i], offset + i);
+      }
+    }
+
+    // a file that ends in silence has no dropout there
+    void finish (int64 length) noexcept
+    {
+      state.zeroStart = -1;
+      closeRuns (length);
+    }
+
+    ChannelState state;
+
+  private:
+    const QcAnalyzer::Options&  options;
+    const uint32                bit;
+    const float                 limit;
+    Array<QcAnalyzer::Issue>&   issues;
+
+    void step (float x, int64 index) noexcept
+    {
+      const float a = std::abs (x);
+
+      if (x == 0.0f)
+      {
+        if (state.zeroStart < 0)
+          state.zeroStart = index;
+      }
+      else
+      {
+        closeZero (index);
+        state.seenSignal = true;
+      }
+
+      if (a >= options.clipLevel)
+      {
+        if (state.clipStart < 0)
+        {
+          state.clipStart = index;
+          state.clipMax = 0;
+        }
+        state.clipMax = jmax (state.clipMax, a);
+      }
+      else
+      {
+        closeClip (index);
+      }
+
+      if (a >= limit)
+      {
+        if (state.overStart < 0)
+        {
+          state.overStart = index;
+          state.overMax = 0;
+        }
+        state.overMax = jmax (state.overMax, a);
+      }
+      else
+      {
+        closeOver (index);
+      }
+    }
+
+    void closeRuns (int64 index) noexcept
+    {
+      closeZero (index);
+      closeClip (index);
+      closeOver (index);
+    }
+
+    void closeZero (int64 index) noexcept
+    {
+      if (state.zeroStart < 0)
+        return;
+
+      // leading silence is not a dropout
+      if (state.seenSignal && index - state.zeroStart >= options.minDropoutSamples)
+        issues.add ({ QcAnalyzer::IssueType::dropout, state.zeroStart, index - state.zeroStart, bit, 0.0f, 1 });
+      state.zeroStart = -1;
+    }
+
+    void closeClip (int64 index) noexcept
+    {
+      if (state.clipStart < 0)
+        return;
+
+      if (index - state.clipStart >= options.minClipSamples)
+      {
+        issues.add ({ QcAnalyzer::IssueType::clipping, state.clipStart, index - state.clipStart, bit, state.clipMax, 1 });
+        state.overHadClip = true;
+      }
+      state.clipStart = -1;
+    }
+
+    // peaks over the limit that did not clip
+    void closeOver (int64 index) noexcept
+    {
+      if (state.overStart < 0)
+        return;
+
+      if (! state.overHadClip)
+        issues.add ({ QcAnalyzer::IssueType::peak, state.overStart, index - state.overStart, bit, state.overMax, 1 });
+      state.overStart = -1;
+      state.overHadClip = false;
+    }
+  };
+
+  String describeChannels (uint32 channels)
+  {
+    StringArray names;
+    for (int ch = 0; ch < 32; ++ch)
+      if ((channels & (1u << ch)) != 0)
+        names.add (String (ch + 1));
+    return "ch " + names.joinIntoString (" ");
+  }
+
+  String toDb (float gain)
+  {
+    return String (Decibels::gainToDecibels (std::abs (gain), -150.0f), 1);
+  }
+
+  String getMarkerTitle (const QcAnalyzer::Issue& issue, double sampleRate)
+  {
+    const String channels (describeChannels (issue.channels));
+
+    switch (issue.type)
+    {
+      case QcAnalyzer::IssueType::clipping:
+        return String (markerPrefix) + "clipping (" + String (issue.count) + (issue.count == 1 ? " run, " : " runs, ") + channels + ")";
+      case QcAnalyzer::IssueType::dropout:
+        return String (markerPrefix) + "dropout (" + String (issue.length * 1000.0 / sampleRate, 1) + " ms, " + channels + ")";
+      case QcAnalyzer::IssueType::dcOffset:
+        return String (markerPrefix) + "DC offset (" + toDb (issue.value) + " dB, " + channels + ")";
+      default:
+        return String (markerPrefix) + "peak (" + toDb (issue.value) + " dBFS, " + channels + ")";
+    }
+  }
+}
+
+
+class QcAnalyzer::FileJob : public ThreadPoolJob
+{
+public:
+  FileJob (QcAnalyzer& a, FileResult& r) : ThreadPoolJob (r.file.getFileName()), analyzer (a), result (r) {}
+
+  JobStatus runJob() override
+  {
+    if (! shouldExit())
+      analyzer.analyseFile (result);
+
+    ++analyzer.filesDone;
+    return jobHasFinished;
+  }
+
+private:
+  QcAnalyzer&   analyzer;
+  FileResult&   result;
+};
+
+
+QcAnalyzer::QcAnalyzer (const Array<File>& files, const Options& o) : options (o)
+{
+  Wave64AudioFormat::registerFormats (formatManager);
+
+  for (auto& f : files)
+    results.add (new FileResult())->file = f;
+}
+
+QcAnalyzer::~QcAnalyzer()
+{
+}
+
+bool QcAnalyzer::run (std::function<bool (double)> progressCallback, String& error)
+{
+  if (results.isEmpty())
+  {
+    error = "No audio files to analyse";
+    return false;
+  }
+
+  filesDone = 0;
+
+  ThreadPool pool (options.numThreads > 0 ? options.numThreads : SystemStats::getNumCpus());
+  for (auto* result : results)
+    pool.addJob (new FileJob (*this, *result), true);
+
+  while (filesDone.get() < results.size())
+  {
+    Thread::sleep (50);
+
+    if (progressCallback != nullptr && ! progressCallback (filesDone.get() / (double) results.size()))
+    {
+      pool.removeAllJobs (true, 10000);
+      error = "Analysis cancelled";
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void QcAnalyzer::analyseFile (FileResult& result)
+{
+  ScopedPointer<AudioFormatReader> reader (formatManager.createReaderFor (result.file));
+  if (reader == nullptr)
+  {
+    result.error = "Cannot read " + result.file.getFullPathName();
+    return;
+  }
+
+  if (analyse (*reader, options, result) && options.writeMarkers)
+    writeMarkers (result);
+}
+
+bool QcAnalyzer::analyse (AudioFormatReader& reader, const Options& options, FileResult& result)
+{
+  const int numChannels = (int) reader.numChannels;
+  result.sampleRate = reader.sampleRate;
+  result.length = reader.lengthInSamples;
+
+  if (numChannels <= 0 || result.sampleRate <= 0)
+  {
+    result.error = "Not an audio file: " + result.file.getFullPathName();
+    return false;
+  }
+
+  const float peakLimit = jmin (options.clipLevel, Decibels::decibelsToGain ((float) options.peakLimitDb));
+
+  Array<Issue> found;
+  OwnedArray<ChannelSweep> sweeps;
+  for (int ch = 0; ch < numChannels; ++ch)
+    sweeps.add (new ChannelSweep (options, ch, peakLimit, found));
+
+  AudioBuffer<float> buffer (numChannels, blockSize);
+
+  for (int64 pos = 0; pos < result.length; pos += blockSize)
+  {
+    const int num = (int) jmin ((int64) blockSize, result.length - pos);
+    if (! reader.read (&buffer, 0, num, pos, true, true))
+    {
+      result.error = "Read error in " + result.file.getFullPathName();
+      return false;
+    }
+
+    for (int ch = 0; ch < numChannels; ++ch)
+      sweeps[ch]->process (buffer.getReadPointer (ch), num, pos);
+  }
+
+  for (int ch = 0; ch < numChannels; ++ch)
+  {
+    auto* sweep = sweeps[ch];
+    sweep->finish (result.length);
+
+    const double dc = result.length > 0 ? sweep->state.sum / (double) result.length : 0.0;
+    result.channelPeaks.add (sweep->state.peak);
+    result.channelDc.add (dc);
+
+    if (Decibels::gainToDecibels (std::abs (dc), -150.0) > options.dcLimitDb)
+      found.add ({ IssueType::dcOffset, 0, result.length, ch < 32 ? 1u << ch : 0u, (float) dc, 1 });
+  }
+
+  for (auto& issue : found)
+    ++result.counts[(int) issue.type];
+
+  // the same finding on several channels, and findings close together, become one issue
+  std::sort (found.begin(), found.end(), [] (const Issue& a, const Issue& b)
+  {
+    return a.type != b.type ? a.type < b.type : a.start < b.start;
+  });
+
+  const int64 mergeSamples = (int64) (options.mergeSeconds * result.sampleRate);
+  result.issues.clearQuick();
+
+  for (auto& issue : found)
+  {
+    if (! result.issues.isEmpty())
+    {
+      auto& last = result.issues.getReference (result.issues.size() - 1);
+      const int64 lastEnd = last.start + last.length;
+
+      if (last.type == issue.type && issue.start <= lastEnd + mergeSamples)
+      {
+        last.length = jmax (lastEnd, issue.start + issue.length) - last.start;
+        last.channels |= issue.channels;
+        if (std::abs (issue.value) > std::abs (last.value))
+          last.value = issue.value;
+        // the same run seen on another channel is not another run
+        if (issue.start >= lastEnd)
+          ++last.count;
+        continue;
+      }
+    }
+
+    result.issues.add (issue);
+  }
+
+  return true;
+}
+
+// Replaces the markers of an earlier analysis, the ones with a Type, and keeps everything
+// else in the sidecar. A journal means a player has edits of the file that are not in the
+// sidecar yet: the file is left to it.
+bool QcAnalyzer::writeMarkers (FileResult& result)
+{
+  const File sidecar (result.file.getFullPathName() + MarkerFilesExt);
+  if (MarkerEditLog::getJournalFile (sidecar).existsAsFile())
+  {
+    result.error = "Markers not written: " + result.file.getFileName() + " has unsaved edits in the player";
+    return false;
+  }
+
+  Array<double> times;
+  StringArray titles, types;
+  Array<MarkerRegion> regions;
+  SegmentExporter::loadMarkers (result.file, times, titles, &regions);
+
+  Array<SidecarMerge::Marker> typed;
+  SidecarMerge::read (sidecar, typed);
+
+  const int numBefore = times.size();
+  for (int i = times.size(); --i >= 0;)
+    if (SidecarMerge::getType (typed, times[i], titles[i]).isNotEmpty())
+    {
+      times.remove (i);
+      titles.remove (i);
+    }
+  const bool removedAny = times.size() < numBefore;
+
+  for (int i = 0; i < times.size(); ++i)
+    types.add ({});
+
+  int perType[4] = {};
+  for (auto& issue : result.issues)
+  {
+    if (perType[(int) issue.type]++ >= options.maxMarkersPerType)
+      continue;
+
+    times.add (issue.start / result.sampleRate);
+    titles.add (getMarkerTitle (issue, result.sampleRate));
+    types.add (getTypeName (issue.type));
+    ++result.numMarkers;
+  }
+
+  // a clean file without a sidecar keeps having none
+  if (result.numMarkers == 0 && ! removedAny)
+    return true;
+
+  XmlElement root ("Markers");
+  for (int m = 0; m < times.size(); ++m)
+  {
+    auto* marker = root.createNewChildElement ("Marker");
+    marker->setAttribute ("Time", times[m]);
+    marker->setAttribute ("Title", titles[m]);
+
+    if (types[m].isNotEmpty())
+      marker->setAttribute ("Type", types[m]);
+  }
+
+  for (auto& region : regions)
+  {
+    auto* r = root.createNewChildElement ("Region");
+    r->setAttribute ("Start", region.start);
+    r->setAttribute ("End", region.end);
+    r->setAttribute ("Title", region.title);
+  }
+
+  if (! root.writeToFile (sidecar, {}))
+  {
+    result.error = "Cannot write " + sidecar.getFullPathName();
+    return false;
+  }
+
+  return true;
+}
+
+String QcAnalyzer::getTypeName (IssueType type)
+{
+  switch (type)
+  {
+    case IssueType::clipping:   return "clipping";
+    case IssueType::dropout:    return "dropout";
+    case IssueType::dcOffset:   return "dc-offset";
+    default:                    return "peak";
+  }
+}
+
+Array<File> QcAnalyzer::findAudioFiles (const File& fileOrFolder, AudioFormatManager& formats)
+{
+  Array<File> files;
+
+  if (fileOrFolder.existsAsFile())
+  {
+    files.add (fileOrFolder);
+  }
+  else if (fileOrFolder.isDirectory())
+  {
+    DirectoryIterator it (fileOrFolder, true, formats.getWildcardForAllFormats(), File::findFiles);
+    while (it.next())
+      files.add (it.getFile());
+
+    files.sort();
+  }
+
+  return files;
+}
+
+var QcAnalyzer::createReport() const
+{
+  Array<var> files;
+  int totals[4] = {};
+  int filesWithIssues = 0, filesFailed = 0;
+
+  for (auto* result : results)
+  {
+    DynamicObject::Ptr entry = new DynamicObject();
+    entry->setProperty ("file", result->file.getFullPathName());
+
+    if (result->error.isNotEmpty())
+    {
+      entry->setProperty ("error", result->error);
+      files.add (entry.get());
+      ++filesFailed;
+      continue;
+    }
+
+    entry->setProperty ("seconds", result->length / result->sampleRate);
+    entry->setProperty ("sample_rate", result->sampleRate);
+
+    Array<var> peaks, dc;
+    for (auto p : result->channelPeaks)
+      peaks.add (Decibels::gainToDecibels (p, -150.0f));
+    for (auto d : result->channelDc)
+      dc.add (d);
+    entry->setProperty ("peak_dbfs", peaks);
+    entry->setProperty ("dc", dc);
+
+    for (int t = 0; t < 4; ++t)
+    {
+      entry->setProperty (getTypeName ((IssueType) t), result->counts[t]);
+      totals[t] += result->counts[t];
+    }
+
+    Array<var> issues;
+    for (auto& issue : result->issues)
+    {
+      DynamicObject::Ptr i = new DynamicObject();
+      i->setProperty ("type", getTypeName (issue.type));
+      i->setProperty ("time", issue.start / result->sampleRate);
+      i->setProperty ("duration", issue.length / result->sampleRate);
+      i->setProperty ("channels", describeChannels (issue.channels).fromFirstOccurrenceOf ("ch ", false, false));
+      i->setProperty ("value", issue.value);
+      i->setProperty ("count", issue.count);
+      issues.add (i.get());
+    }
+    entry->setProperty ("issues", issues);
+    entry->setProperty ("markers", result->numMarkers);
+
+    if (! result->issues.isEmpty())
+      ++filesWithIssues;
+
+    files.add (entry.get());
+  }
+
+  DynamicObject::Ptr summary = new DynamicObject();
+  summary->setProperty ("files", results.size());
+  summary->setProperty ("files_with_issues", filesWithIssues);
+  summary->setProperty ("files_failed", filesFailed);
+  for (int t = 0; t < 4; ++t)
+    summary->setProperty (getTypeName ((IssueType) t), totals[t]);
+
+  DynamicObject::Ptr report = new DynamicObject();
+  report->setProperty ("summary", summary.get());
+  report->setProperty ("files", files);
+  return report.get();
+}
+
+int QcAnalyzer::runFromCommandLine (const StringArray& args)
+{
+  auto option = [&args] (const String& name) -> String
+  {
+    const int i = args.indexOf (name);
+    return i >= 0 ? args[i + 1] : String();
+  };
+
+  const auto cwd = File::getCurrentWorkingDirectory();
+  const File target (cwd.getChildFile (option ("--qc").unquoted()));
+
+  AudioFormatManager formats;
+  Wave64AudioFormat::registerFormats (formats);
+  const auto files = findAudioFiles (target, formats);
+
+  if (files.isEmpty())
+  {
+    std::cerr << "usage: EasyAudioMarker --qc <audio file or folder> [--report <file>] [--peak-limit <dBFS>] [--no-markers] [--jobs <n>]" << std::endl;
+    return 1;
+  }
+
+  Options options;
+  if (option ("--peak-limit").isNotEmpty())
+    options.peakLimitDb = option ("--peak-limit").getDoubleValue();
+  options.writeMarkers = ! args.contains ("--no-markers");
+  options.numThreads = option ("--jobs").getIntValue();
+
+  const File reportFile (option ("--report").isNotEmpty()
+                           ? cwd.getChildFile (option ("--report").unquoted())
+                           : target.isDirectory() ? target.getChildFile ("qc-report.json")
+                                                  : target.getSiblingFile (target.getFileNameWithoutExtension() + "_qc.json"));
+
+  QcAnalyzer analyzer (files, options);
+  String error;
+  const double start = Time::getMillisecondCounterHiRes();
+  const bool ok = analyzer.run ([] (double progress)
+                                {
+                                  std::cout << "\r" << roundToInt (progress * 100.0) << "%" << std::flush;
+                                  return true;
+                                }, error);
+  std::cout << std::endl;
+
+  if (! ok)
+  {
+    std::cerr << error << std::endl;
+    return 1;
+  }
+
+  bool anyFailed = false;
+  for (auto* result : analyzer.getResults())
+  {
+    if (result->error.isNotEmpty())
+    {
+      std::cerr << result->error << std::endl;
+      anyFailed = true;
+    }
+    else if (! result->issues.isEmpty())
+    {
+      std::cout << result->file.getRelativePathFrom (target.isDirectory() ? target : target.getParentDirectory()) << ":";
+      for (int t = 0; t < 4; ++t)
+        if (result->counts[t] > 0)
+          std::cout << " " << result->counts[t] << " " << getTypeName ((IssueType) t);
+      std::cout << std::endl;
+    }
+  }
+
+  if (! reportFile.replaceWithText (JSON::toString (analyzer.createReport())))
+  {
+    std::cerr << "cannot write " << reportFile.getFullPathName() << std::endl;
+    return 1;
+  }
+
+  std::cout << files.size() << " files analysed in " << String ((Time::getMillisecondCounterHiRes() - start) / 1000.0, 1)
+            << " s, report written to " << reportFile.getFullPathName() << std::endl;
+  return anyFailed ? 1 : 0;
+}
@@ -0,0 +1,100 @@
+/*
+  ==============================================================================
+
+    QcAnalyzer.h
+
+    Technical checks of recordings before they are marked: clipping (runs of
+    full-scale samples), dropouts (runs of exact digital zeros between
+    signal), DC offset and peaks over a limit. Each file is read once and
+    every check is made in the same SIMD sweep over its blocks; files are
+    analysed in parallel on a thread pool. Findings become markers of their
+    own type in the sidecar, and a JSON report sums them up.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+
+class QcAnalyzer
+{
+public:
+  enum class IssueType
+  {
+    clipping,
+    dropout,
+    dcOffset,
+    peak
+  };
+
+  struct Options
+  {
+    float     clipLevel = 0.999f;         // about -0.01 dBFS
+    int       minClipSamples = 3;
+    double    peakLimitDb = -1.0;
+    int       minDropoutSamples = 64;
+    double    dcLimitDb = -40.0;
+    double    mergeSeconds = 0.25;        // findings this close together become one marker
+    int       maxMarkersPerType = 200;
+    bool      writeMarkers = true;
+    int       numThreads = 0;             // 0 uses one per CPU
+  };
+
+  struct Issue
+  {
+    IssueType     type;
+    juce::int64   start, length;          // in samples
+    juce::uint32  channels;               // bit per channel
+    float         value;                  // peak level, or the DC mean
+    int           count;                  // findings merged into this one
+  };
+
+  struct FileResult
+  {
+    juce::File            file;
+    double                sampleRate = 0;
+    juce::int64           length = 0;
+    juce::Array<float>    channelPeaks;
+    juce::Array<double>   channelDc;
+    juce::Array<Issue>    issues;
+    int                   counts[4] = {};   // findings per type, before merging
+    int                   numMarkers = 0;
+    juce::String          error;
+  };
+
+  QcAnalyzer (const juce::Array<juce::File>& files, const Options& options);
+  ~QcAnalyzer();
+
+  // Blocks until every file is analysed. The callback gets the fraction done
+  // and may return false to cancel the remaining files.
+  bool run (std::function<bool (double)> progressCallback, juce::String& error);
+
+  const juce::OwnedArray<FileResult>& getResults() const noexcept   { return results; }
+  juce::var createReport() const;
+
+  // The sweep itself: reads the whole file and fills in the result.
+  static bool analyse (juce::AudioFormatReader& reader, const Options& options, FileResult& result);
+
+  static juce::String getTypeName (IssueType type);
+
+  // Every audio file under the folder, or the file itself.
+  static juce::Array<juce::File> findAudioFiles (const juce::File& fileOrFolder, juce::AudioFormatManager& formats);
+
+  // --qc <file or folder> [--report <file>] [--peak-limit <dBFS>] [--no-markers] [--jobs <n>]
+  static int runFromCommandLine (const juce::StringArray& args);
+
+private:
+  class FileJob;
+
+  Options                         options;
+  juce::AudioFormatManager        formatManager;
+  juce::OwnedArray<FileResult>    results;
+  juce::Atomic<int>               filesDone;
+
+  void analyseFile (FileResult& result);
+  bool writeMarkers (FileResult& result);
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (QcAnalyzer)
+};
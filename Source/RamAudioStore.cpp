@@ -0,0 +1,479 @@
+/*
+  ==============================================================================
+
+    RamAudioStore.cpp
+
+  ==============================================================================
+*/
+
+#include "RamAudioStore.h"
+
+
+using namespace juce;
+
+
+namespace
+{
+  // how a channel of a block is coded: the order of its predictor, or one repeated value
+  enum ChannelMode : uint8 { order0, order1, order2, constant };
+
+  const int escapeLength = 24;    // a quotient this long is followed by the raw residual
+  const int rawBits = 36;         // holds any zigzagged residual of 32-bit samples
+  const int maxRiceBits = 32;
+
+  struct BitWriter
+  {
+    std::vector<uint8>& out;
+    uint64 bits = 0;
+    int numBits = 0;
+
+    // value must fit in n bits, n <= 32
+    void write (uint32 value, int n)
+    {
+      bits = (bits << n) | value;
+      numBits += n;
+
+      while (numBits >= 8)
+      {
+        numBits -= 8;
+        out.push_back ((uint8) (bits >> numBits));
+      }
+    }
+
+    void writeResidual (uint64 u, int k)
+    {
+      const uint64 quotient = u >> k;
+
+      if (quotient >= (uint64) escapeLength)
+      {
+        write ((1u << escapeLength) - 1, escapeLength);
+        write ((uint32) (u >> 32), rawBits - 32);
+        write ((uint32) u, 32);
+        return;
+      }
+
+      // the quotient in unary, ones ended by a zero, then the low k bits
+      const int q = (int) quotient;
+      write (((1u << q) - 1) << 1, q + 1);
+      if (k > 0)
+        write ((uint32) (u & (((uint64) 1 << k) - 1)), k);
+    }
+
+    void flush()
+    {
+      if (numBits > 0)
+        write (0, 8 - numBits);
+    }
+  };
+
+  struct BitReader
+  {
+    const uint8* data;
+    const uint8* end;
+    uint64 bits = 0;      // the next bit is the top one
+    int numBits = 0;
+
+    void refill() noexcept
+    {
+      while (numBits <= 56)
+      {
+        bits |= (uint64) (data < end ? *data++ : 0) << (56 - numBits);
+        numBits += 8;
+      }
+    }
+
+    // n from 1 to 32
+    uint32 read (int n) noexcept
+    {
+      refill();
+      const auto value = (uint32) (bits >> (64 - n));
+      bits <<= n;
+      numBits -= n;
+      return value;
+    }
+
+    uint64 readResidual (int k) noexcept
+    {
+      int q = 0;
+      for (;;)
+      {
+        if (numBits == 0)
+          refill();
+
+        const bool one = (bits >> 63) != 0;
+        bits <<= 1;
+        --numBits;
+
+        if (! one)
+          break;
+
+        if (++q == escapeLength)
+        {
+          const uint64 high = read (rawBits - 32);
+          return (high << 32) | read (32);
+        }
+      }
+
+      return ((uint64) q << k) | (k > 0 ? read (k) : 0);
+    }
+  };
+
+  inline uint64 zigzag (int64 r) noexcept       { return r >= 0 ? (uint64) r << 1 : ((uint64) -r << 1) - 1; }
+  inline int64 unzigzag (uint64 u) noexcept     { return (int64) (u >> 1) ^ -(int64) (u & 1); }
+
+  void encodeChannel (const int* x, int n, std::vector<uint8>& out)
+  {
+    bool isConstant = true;
+    uint32 setBits = 0;
+    for (int i = 0; i < n; ++i)
+    {
+      isConstant = isConstant && x[i] == x[0];
+      setBits |= (uint32) x[i];
+    }
+
+    if (isConstant)
+    {
+      out.push_back (constant);
+      for (int b = 0; b < 4; ++b)
+        out.push_back ((uint8) ((uint32) x[0] >> (8 * b)));
+      return;
+    }
+
+    // low bits that are zero in every sample, as in 16 or 24-bit audio read into ints
+    int shift = 0;
+    while (shift < 31 && ((setBits >> shift) & 1) == 0)
+      ++shift;
+
+    auto v = [x, shift] (int i) { return (int64) (x[i] >> shift); };
+
+    auto residual = [&v] (int i, int order) -> int64
+    {
+      switch (order)
+      {
+        case 0:   return v (i);
+        case 1:   return v (i) - v (i - 1);
+        default:  return v (i) - 2 * v (i - 1) + v (i - 2);
+      }
+    };
+
+    // the predictor with the smallest residuals
+    uint64 sums[3] = {};
+    for (int i = 2; i < n; ++i)
+      for (int order = 0; order < 3; ++order)
+        sums[order] += zigzag (residual (i, order));
+
+    int order = 0;
+    for (int o = 1; o < 3 && n > o; ++o)
+      if (sums[o] < sums[order])
+        order = o;
+
+    // the Rice parameter for the mean residual
+    uint64 sum = 0;
+    for (int i = order; i < n; ++i)
+      sum += zigzag (residual (i, order));
+
+    int k = 0;
+    while (k < maxRiceBits && ((uint64) (n - order) << (k + 1)) <= sum)
+      ++k;
+
+    out.push_back ((uint8) order);
+    out.push_back ((uint8) shift);
+    out.push_back ((uint8) k);
+
+    BitWriter writer { out };
+    for (int i = 0; i < order; ++i)
+      writer.write ((uint32) v (i), 32);
+    for (int i = order; i < n; ++i)
+      writer.writeResidual (zigzag (residual (i, order)), k);
+    writer.flush();
+  }
+
+  void decodeChannel (const uint8* data, const uint8* end, int* x, int n) noexcept
+  {
+    if (data[0] == constant)
+    {
+      const int value = (int) ByteOrder::littleEndianInt (data + 1);
+      for (int i = 0; i < n; ++i)
+        x[i] = value;
+      return;
+    }
+
+    const int order = data[0], shift = data[1], k = data[2];
+    BitReader reader { data + 3, end };
+    int64 previous = 0, beforePrevious = 0;
+
+    for (int i = 0; i < n; ++i)
+    {
+      int64 value;
+
+      if (i < order)
+      {
+        value = (int32) reader.read (32);
+      }
+      else
+      {
+        const int64 r = unzigzag (reader.readResidual (k));
+        value = order == 0 ? r
+              : order == 1 ? r + previous
+                           : r + 2 * previous - beforePrevious;
+      }
+
+      x[i] = (int) ((uint32) value << shift);
+      beforePrevious = previous;
+      previous = value;
+    }
+  }
+}
+
+
+//==============================================================================
+RamAudioStore::RamAudioStore (int channels, int64 lengthInSamples)
+: numChannels (channels), length (lengthInSamples)
+{
+  blocks.resize ((size_t) ((length + blockSize - 1) / blockSize));
+}
+
+int RamAudioStore::getBlockLength (int block) const noexcept
+{
+  return (int) jmin ((int64) blockSize, length - (int64) block * blockSize);
+}
+
+void RamAudioStore::appendBlock (const int* const* channels)
+{
+  const int block = numStored.load();
+  jassert (block < getNumBlocks());
+
+  const int n = getBlockLength (block);
+
+  // the offset of each channel, then the channels
+  scratch.assign ((size_t) numChannels * 4, 0);
+
+  for (int ch = 0; ch < numChannels; ++ch)
+  {
+    const auto offset = (uint32) scratch.size();
+    for (int b = 0; b < 4; ++b)
+      scratch[(size_t) (ch * 4 + b)] = (uint8) (offset >> (8 * b));
+
+    encodeChannel (channels[ch], n, scratch);
+  }
+
+  blocks[(size_t) block].replaceWith (scratch.data(), scratch.size());
+  compressedBytes += (int64) scratch.size();
+  numStored = block + 1;
+}
+
+void RamAudioStore::readBlock (int block, int* const* channels) const
+{
+  jassert (block < getNumBlocksStored());
+
+  const auto& data = blocks[(size_t) block];
+  const auto* bytes = static_cast<const uint8*> (data.getData());
+  const int n = getBlockLength (block);
+
+  for (int ch = 0; ch < numChannels; ++ch)
+  {
+    if (channels[ch] == nullptr)
+      continue;
+
+    const auto start = ByteOrder::littleEndianInt (bytes + 4 * ch);
+    const auto end = ch + 1 < numChannels ? ByteOrder::littleEndianInt (bytes + 4 * (ch + 1))
+                                          : (uint32) data.getSize();
+    decodeChannel (bytes + start, bytes + end, channels[ch], n);
+  }
+}
+
+
+//==============================================================================
+RamAudioReader::RamAudioReader (AudioFormatReader* sourceToOwn)
+: AudioFormatReader (nullptr, sourceToOwn->getFormatName()), source (sourceToOwn)
+{
+  sampleRate            = source->sampleRate;
+  bitsPerSample         = source->bitsPerSample;
+  lengthInSamples       = source->lengthInSamples;
+  numChannels           = source->numChannels;
+  usesFloatingPointData = source->usesFloatingPointData;
+  metadataValues        = source->metadataValues;
+
+  decoded.allocate ((size_t) numChannels * RamAudioStore::blockSize, true);
+  decodedChannels.allocate (numChannels, true);
+  decodedBlocks.allocate (numChannels, false);
+
+  for (unsigned int ch = 0; ch < numChannels; ++ch)
+    decodedBlocks[ch] = -1;
+}
+
+void RamAudioReader::setStore (RamAudioStore* newStore)
+{
+  jassert (newStore == nullptr || newStore->getNumChannels() == (int) numChannels);
+
+  RamAudioStore::Ptr previous;   // released outside the lock
+
+  const ScopedLock sl (lock);
+  previous = store;
+  store = newStore;
+
+  for (unsigned int ch = 0; ch < numChannels; ++ch)
+    decodedBlocks[ch] = -1;
+}
+
+bool RamAudioReader::readSamples (int** destSamples, int numDestChannels, int startOffsetInDestBuffer,
+                                  int64 startSampleInFile, int numSamples)
+{
+  const ScopedLock sl (lock);
+
+  // a growing file is extended here, and read from the wrapped reader past the store
+  source->lengthInSamples = lengthInSamples;
+
+  const int channelsToFill = jmin (numDestChannels, (int) numChannels);
+  const int numStored = store != nullptr ? store->getNumBlocksStored() : 0;
+  const int64 storedLength = store != nullptr ? store->getLengthInSamples() : 0;
+
+  while (numSamples > 0)
+  {
+    const int64 block = startSampleInFile / RamAudioStore::blockSize;
+    const int64 blockStart = block * RamAudioStore::blockSize;
+    const bool inMemory = startSampleInFile >= 0 && block < numStored && startSampleInFile < storedLength;
+    const int num = (int) jmin ((int64) numSamples, blockStart + RamAudioStore::blockSize - startSampleInFile,
+                                inMemory ? storedLength - startSampleInFile : (int64) numSamples);
+
+    if (! inMemory)
+    {
+      if (! source->readSamples (destSamples, numDestChannels, startOffsetInDestBuffer, startSampleInFile, num))
+        return false;
+    }
+    else
+    {
+      // only the channels asked for, and only once per block
+      bool needsDecoding = false;
+      for (int ch = 0; ch < (int) numChannels; ++ch)
+      {
+        const bool wanted = ch < channelsToFill && destSamples[ch] != nullptr && decodedBlocks[ch] != (int) block;
+        decodedChannels[ch] = wanted ? decoded + (size_t) ch * RamAudioStore::blockSize : nullptr;
+        needsDecoding = needsDecoding || wanted;
+      }
+
+      if (needsDecoding)
+      {
+        store->readBlock ((int) block, decodedChannels);
+        for (int ch = 0; ch < (int) numChannels; ++ch)
+          if (decodedChannels[ch] != nullptr)
+            decodedBlocks[ch] = (int) block;
+      }
+
+      for (int ch = 0; ch < channelsToFill; ++ch)
+        if (destSamples[ch] != nullptr)
+          memcpy (destSamples[ch] + startOffsetInDestBuffer,
+                  decoded + (size_t) ch * RamAudioStore::blockSize + (startSampleInFile - blockStart),
+                  sizeof (int) * (size_t) num);
+    }
+
+    startOffsetInDestBuffer += num;
+    startSampleInFile += num;
+    numSamples -= num;
+  }
+
+  return true;
+}
+
+
+//==============================================================================
+RamAudioDecoder::RamAudioDecoder() : Thread ("decode to RAM")
+{
+}
+
+RamAudioDecoder::~RamAudioDecoder()
+{
+  stop();
+}
+
+RamAudioStore::Ptr RamAudioDecoder::start (AudioFormatReader* newReader)
+{
+  stop();
+
+  reader = newReader;
+  store = nullptr;
+  setError ({});
+
+  if (reader == nullptr)
+    return nullptr;
+
+  if ((reader->lengthInSamples + RamAudioStore::blockSize - 1) / RamAudioStore::blockSize > std::numeric_limits<int>::max())
+  {
+    setError ("The file is too long to be decoded into memory");
+    reader = nullptr;
+    return nullptr;
+  }
+
+  store = new RamAudioStore ((int) reader->numChannels, reader->lengthInSamples);
+  startThread (2);
+  return store;
+}
+
+void RamAudioDecoder::stop()
+{
+  stopThread (4000);
+}
+
+String RamAudioDecoder::getError() const
+{
+  const ScopedLock sl (errorLock);
+  return error;
+}
+
+void RamAudioDecoder::setError (const String& message)
+{
+  const ScopedLock sl (errorLock);
+  error = message;
+}
+
+void RamAudioDecoder::postProgress()
+{
+  if (auto callback = onProgress)
+    MessageManager::callAsync ([callback] { callback(); });
+}
+
+void RamAudioDecoder::run()
+{
+  // compressed, the samples should never need more than half the memory
+  const int64 memoryLimit = (int64) SystemStats::getMemorySizeInMegabytes() * 1024 * 1024 / 2;
+
+  const int numChannels = store->getNumChannels();
+  const int numBlocks = store->getNumBlocks();
+  HeapBlock<int> samples ((size_t) numChannels * RamAudioStore::blockSize);
+  HeapBlock<int*> channels (numChannels);
+  for (int ch = 0; ch < numChannels; ++ch)
+    channels[ch] = samples + (size_t) ch * RamAudioStore::blockSize;
+
+  int percentDone = 0;
+
+  for (int block = 0; block < numBlocks; ++block)
+  {
+    if (threadShouldExit())
+      return;
+
+    if (! reader->read (channels, numChannels, (int64) block * RamAudioStore::blockSize,
+                        store->getBlockLength (block), false))
+    {
+      setError ("Cannot read the file at " + String (block * (double) RamAudioStore::blockSize / reader->sampleRate, 1) + " s");
+      break;
+    }
+
+    store->appendBlock (channels);
+
+    if (store->getCompressedBytes() > memoryLimit)
+    {
+      setError ("The file does not fit into memory");
+      break;
+    }
+
+    const int percent = (int) ((block + 1) * (int64) 100 / numBlocks);
+    if (percent != percentDone)
+    {
+      percentDone = percent;
+      postProgress();
+    }
+  }
+
+  reader = nullptr;
+  postProgress();
+}
@@ -0,0 +1,119 @@
+/*
+  ==============================================================================
+
+    RamAudioStore.h
+
+    Decode-to-RAM playback for the few files worked on intensively. The
+    whole file is decoded once on a background thread into blocks of 4096
+    frames, each channel compressed losslessly the way FLAC does it: a
+    fixed linear predictor of order 0 to 2 and Rice-coded residuals. A two
+    hour stereo recording then takes a few hundred MB rather than GBs.
+    Every block stored so far is served from memory, so seeks, scrubbing
+    and loops touch no disk; once the whole file is in, the transport
+    plays it without a read-ahead buffer.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <atomic>
+#include <vector>
+
+
+// The compressed samples. Filled in order by one thread, while others read the
+// blocks stored so far.
+class RamAudioStore : public juce::ReferenceCountedObject
+{
+public:
+  using Ptr = juce::ReferenceCountedObjectPtr<RamAudioStore>;
+
+  static constexpr int blockSize = 4096;    // frames
+
+  RamAudioStore (int numChannels, juce::int64 lengthInSamples);
+
+  int getNumChannels() const noexcept                 { return numChannels; }
+  juce::int64 getLengthInSamples() const noexcept     { return length; }
+  int getNumBlocks() const noexcept                   { return (int) blocks.size(); }
+  int getBlockLength (int block) const noexcept;
+
+  int getNumBlocksStored() const noexcept             { return numStored.load(); }
+  bool isComplete() const noexcept                    { return getNumBlocksStored() == getNumBlocks(); }
+  juce::int64 getCompressedBytes() const noexcept     { return compressedBytes.load(); }
+
+  // Stores the next block, its samples as AudioFormatReader::read() gives them as ints.
+  void appendBlock (const int* const* channels);
+
+  // Decodes a stored block into the channels that are not null.
+  void readBlock (int block, int* const* channels) const;
+
+private:
+  const int                       numChannels;
+  const juce::int64               length;
+  std::vector<juce::MemoryBlock>  blocks;         // sized up front, so never moved while read
+  std::vector<juce::uint8>        scratch;
+  std::atomic<int>                numStored { 0 };
+  std::atomic<juce::int64>        compressedBytes { 0 };
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RamAudioStore)
+};
+
+
+// Reads the blocks the store holds from memory and the rest from the wrapped reader.
+// Sits at the bottom of the playback chain of the open file; without a store it only
+// passes the reads on.
+class RamAudioReader : public juce::AudioFormatReader
+{
+public:
+  RamAudioReader (juce::AudioFormatReader* sourceToOwn);
+
+  // Thread-safe; the store must hold the audio of the wrapped reader.
+  void setStore (RamAudioStore* newStore);
+
+  bool readSamples (int** destSamples, int numDestChannels, int startOffsetInDestBuffer,
+                    juce::int64 startSampleInFile, int numSamples) override;
+
+private:
+  juce::ScopedPointer<juce::AudioFormatReader>  source;
+  juce::CriticalSection                         lock;
+  RamAudioStore::Ptr                            store;
+  juce::HeapBlock<int>                          decoded;          // blockSize frames per channel
+  juce::HeapBlock<int*>                         decodedChannels;
+  juce::HeapBlock<int>                          decodedBlocks;    // the block each channel holds, or -1
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RamAudioReader)
+};
+
+
+// Decodes a whole file into a new store on its own thread.
+class RamAudioDecoder : private juce::Thread
+{
+public:
+  RamAudioDecoder();
+  ~RamAudioDecoder();
+
+  // Takes the reader, a second one on the file being played, and returns the store it fills.
+  RamAudioStore::Ptr start (juce::AudioFormatReader* reader);
+  void stop();
+
+  bool isDecoding() const noexcept                    { return isThreadRunning(); }
+
+  // Why the last decode stopped before the end, if it did.
+  juce::String getError() const;
+
+  // Called on the message thread about every percent, and at the end.
+  std::function<void()> onProgress;
+
+private:
+  juce::ScopedPointer<juce::AudioFormatReader>  reader;
+  RamAudioStore::Ptr                            store;
+  juce::CriticalSection                         errorLock;
+  juce::String                                  error;
+
+  void run() override;
+  void setError (const juce::String& message);
+  void postProgress();
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RamAudioDecoder)
+};
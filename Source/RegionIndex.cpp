@@ -0,0 +1,179 @@
+/*
+  ==============================================================================
+
+    RegionIndex.cpp
+
+  ==============================================================================
+*/
+
+#include "RegionIndex.h"
+#include <algorithm>
+
+
+using namespace juce;
+
+
+void RegionIndex::clear()
+{
+  regions.clear();
+  slots.clear();
+  dirty = true;
+}
+
+void RegionIndex::add (const MarkerRegion& region)
+{
+  jassert (slots.find (region.id) == slots.end() && region.start < region.end);
+
+  slots[region.id] = regions.size();
+  regions.push_back (region);
+  dirty = true;
+}
+
+void RegionIndex::remove (int64 id)
+{
+  auto it = slots.find (id);
+  if (it == slots.end())
+    return;
+
+  // swap with the last region so removal stays O(1)
+  const size_t slot = it->second;
+  slots.erase (it);
+
+  if (slot != regions.size() - 1)
+  {
+    regions[slot] = std::move (regions.back());
+    slots[regions[slot].id] = slot;
+  }
+  regions.pop_back();
+  dirty = true;
+}
+
+void RegionIndex::setTitle (int64 id, const String& title)
+{
+  // the tree holds indices, so it stays valid
+  auto it = slots.find (id);
+  if (it != slots.end())
+    regions[it->second].title = title;
+}
+
+const MarkerRegion* RegionIndex::find (int64 id) const
+{
+  auto it = slots.find (id);
+  return it != slots.end() ? &regions[it->second] : nullptr;
+}
+
+void RegionIndex::rebuild()
+{
+  startOrder.resize (regions.size());
+  for (size_t i = 0; i < regions.size(); ++i)
+    startOrder[i] = (int) i;
+
+  std::sort (startOrder.begin(), startOrder.end(),
+             [this] (int a, int b) { return regions[(size_t) a].start < regions[(size_t) b].start; });
+
+  nodes.clear();
+  std::vector<int> all (startOrder);
+  root = build (all);
+  dirty = false;
+}
+
+// indices come in sorted by start, and each part keeps that order
+int RegionIndex::build (std::vector<int>& indices)
+{
+  if (indices.empty())
+    return -1;
+
+  // the median start: that region contains the centre, and each side holds at most half
+  const double centre = regions[(size_t) indices[indices.size() / 2]].start;
+  std::vector<int> left, right, here;
+
+  for (auto i : indices)
+  {
+    const auto& r = regions[(size_t) i];
+    if (r.end <= centre)
+      left.push_back (i);
+    else if (r.start > centre)
+      right.push_back (i);
+    else
+      here.push_back (i);
+  }
+
+  const int index = (int) nodes.size();
+  nodes.emplace_back();
+  nodes[(size_t) index].centre = centre;
+  nodes[(size_t) index].byStart = here;
+
+  auto& byEnd = nodes[(size_t) index].byEnd;
+  byEnd = here;
+  std::sort (byEnd.begin(), byEnd.end(),
+             [this] (int a, int b) { return regions[(size_t) a].end > regions[(size_t) b].end; });
+
+  // nodes may move while the children are built
+  const int leftChild = build (left);
+  const int rightChild = build (right);
+  nodes[(size_t) index].left = leftChild;
+  nodes[(size_t) index].right = rightChild;
+  return index;
+}
+
+void RegionIndex::stab (double time, Array<const MarkerRegion*>& results) const
+{
+  for (int n = root; n >= 0;)
+  {
+    const auto& node = nodes[(size_t) n];
+
+    if (time < node.centre)
+    {
+      // all of them end after the centre, so past time: only the start decides
+      for (auto i : node.byStart)
+      {
+        if (regions[(size_t) i].start > time)
+          break;
+        results.add (&regions[(size_t) i]);
+      }
+      n = node.left;
+    }
+    else
+    {
+      // all of them start at or before the centre: only the end decides
+      for (auto i : node.byEnd)
+      {
+        if (regions[(size_t) i].end <= time)
+          break;
+        results.add (&regions[(size_t) i]);
+      }
+      n = node.right;
+    }
+  }
+}
+
+void RegionIndex::getRegionsAt (double time, Array<const MarkerRegion*>& results)
+{
+  prepare();
+  results.clearQuick();
+  stab (time, results);
+}
+
+void RegionIndex::getRegionsOverlapping (Range<double> range, Array<const MarkerRegion*>& results)
+{
+  prepare();
+  results.clearQuick();
+
+  // those that have begun by the start of the range, then those beginning inside it
+  stab (range.getStart(), results);
+
+  auto it = std::upper_bound (startOrder.begin(), startOrder.end(), range.getStart(),
+                              [this] (double t, int i) { return t < regions[(size_t) i].start; });
+
+  for (; it != startOrder.end() && regions[(size_t) *it].start < range.getEnd(); ++it)
+    results.add (&regions[(size_t) *it]);
+}
+
+void RegionIndex::getAllRegions (Array<const MarkerRegion*>& results)
+{
+  prepare();
+  results.clearQuick();
+
+  for (auto i : startOrder)
+    results.add (&regions[(size_t) i]);
+}
@@ -0,0 +1,74 @@
+/*
+  ==============================================================================
+
+    RegionIndex.h
+
+    Range markers: a start, an end and a title, for segments such as speaker
+    turns or music beds. Kept by WaveMarkerComp in a centred interval tree,
+    so finding the regions at a time (under the playhead) or overlapping a
+    range (the view) costs O(log n + k) for k results. The tree is rebuilt
+    on the first query after a change.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include <vector>
+#include <unordered_map>
+
+
+struct MarkerRegion
+{
+  double        start, end;     // seconds, start < end; the end itself is outside
+  juce::String  title;
+  juce::int64   id = 0;         // in memory only
+};
+
+
+class RegionIndex
+{
+public:
+  RegionIndex() = default;
+
+  void clear();
+  void add (const MarkerRegion& region);          // the id must not be in use
+  void remove (juce::int64 id);
+  void setTitle (juce::int64 id, const juce::String& title);
+  const MarkerRegion* find (juce::int64 id) const;
+
+  int size() const noexcept                       { return (int) regions.size(); }
+
+  // In no particular order.
+  void getRegionsAt (double time, juce::Array<const MarkerRegion*>& results);
+
+  // The regions at the start of range, then those starting inside it by start time.
+  void getRegionsOverlapping (juce::Range<double> range, juce::Array<const MarkerRegion*>& results);
+
+  // by start time
+  void getAllRegions (juce::Array<const MarkerRegion*>& results);
+
+private:
+  struct Node
+  {
+    double            centre;
+    int               left = -1, right = -1;
+    std::vector<int>  byStart;      // the regions containing centre, by start
+    std::vector<int>  byEnd;        // the same, last end first
+  };
+
+  std::vector<MarkerRegion>                   regions;
+  std::unordered_map<juce::int64, size_t>     slots;
+  std::vector<int>                            startOrder;
+  std::vector<Node>                           nodes;
+  int                                         root = -1;
+  bool                                        dirty = true;
+
+  void rebuild();
+  int build (std::vector<int>& indices);
+  void prepare()                                  { if (dirty) rebuild(); }
+  void stab (double time, juce::Array<const MarkerRegion*>& results) const;
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RegionIndex)
+};
@@ -0,0 +1,372 @@
+/*
+  ==============================================================================
+
+    RemoteAudioStream.cpp
+
+  ==============================================================================
+*/
+
+#include "RemoteAudioStream.h"
+
+
+using namespace juce;
+
+
+static const int remoteTimeoutMs = 10000;
+static const int maxOpenCaches = 4;
+static const int64 defaultCacheLimit = (int64) 2 << 30;
+static const char* const chunkPattern = "*.chunk";
+
+
+// The caches of all URLs share one folder and one size limit.
+namespace CacheUsage
+{
+  static CriticalSection lock;
+  static File root;
+  static int64 limit = defaultCacheLimit;
+  static int64 bytes = -1;              // not counted yet
+
+  // Deletes the chunks read least recently until the caches take 90 % of the limit.
+  static void add (int64 newBytes)
+  {
+    const ScopedLock sl (lock);
+
+    if (bytes >= 0)
+      bytes += newBytes;
+
+    if (bytes >= 0 && bytes <= limit)
+      return;
+
+    Array<File> chunks;
+    RemoteChunkCache::getCacheRoot().findChildFiles (chunks, File::findFiles, true, chunkPattern);
+    bytes = 0;
+    for (auto& f : chunks)
+      bytes += f.getSize();
+
+    if (bytes <= limit)
+      return;
+
+    std::sort (chunks.begin(), chunks.end(),
+               [] (const File& a, const File& b) { return a.getLastAccessTime() < b.getLastAccessTime(); });
+
+    for (auto& f : chunks)
+    {
+      if (bytes <= limit / 10 * 9)
+        break;
+
+      const int64 size = f.getSize();
+      if (f.deleteFile())
+        bytes -= size;
+    }
+  }
+}
+
+
+static CriticalSection openLock;
+static ReferenceCountedArray<RemoteChunkCache> openCaches;
+
+RemoteChunkCache::Ptr RemoteChunkCache::open (const URL& url, String& error)
+{
+  if (auto cache = getOpen (url))
+    return cache;
+
+  // the player and the waveform open the same URL: they share one cache and one probe
+  const ScopedLock sl (openLock);
+
+  for (auto* c : openCaches)
+    if (c->url.toString (true) == url.toString (true))
+      return c;
+
+  const auto name = String::toHexString (url.toString (true).hashCode64());
+  Ptr cache (new RemoteChunkCache (url, getCacheRoot().getChildFile (name)));
+
+  if (! cache->probe (error))
+    return nullptr;
+
+  openCaches.add (cache);
+  while (openCaches.size() > maxOpenCaches)
+    openCaches.remove (0);
+
+  return cache;
+}
+
+RemoteChunkCache::Ptr RemoteChunkCache::getOpen (const URL& url)
+{
+  const ScopedLock sl (openLock);
+
+  for (auto* c : openCaches)
+    if (c->url.toString (true) == url.toString (true))
+      return c;
+
+  return nullptr;
+}
+
+File RemoteChunkCache::getCacheRoot()
+{
+  const ScopedLock sl (CacheUsage::lock);
+
+  if (CacheUsage::root != File())
+    return CacheUsage::root;
+
+  return File::getSpecialLocation (File::userApplicationDataDirectory)
+           .getChildFile ("EasyAudioMarker").getChildFile ("RemoteCache");
+}
+
+void RemoteChunkCache::setCacheLocation (const File& root, int64 maxBytes)
+{
+  const ScopedLock sl (CacheUsage::lock);
+  CacheUsage::root = root;
+  CacheUsage::limit = maxBytes;
+  CacheUsage::bytes = -1;
+}
+
+RemoteChunkCache::RemoteChunkCache (const URL& u, const File& f) : url (u), folder (f)
+{
+}
+
+int64 RemoteChunkCache::getCacheKey() const
+{
+  return (url.toString (true) + validator + String (totalLength)).hashCode64();
+}
+
+File RemoteChunkCache::getChunkFile (int64 index) const
+{
+  return folder.getChildFile (String (index) + ".chunk");
+}
+
+int64 RemoteChunkCache::getChunkLength (int64 index) const noexcept
+{
+  return jmin ((int64) chunkSize, totalLength - index * chunkSize);
+}
+
+bool RemoteChunkCache::probe (String& error)
+{
+  const File infoFile (folder.getChildFile ("info.xml"));
+  ScopedPointer<XmlElement> info (XmlDocument::parse (infoFile));
+
+  // one byte tells the length, whether ranges are honoured and which version is served
+  StringPairArray headers;
+  int status = 0;
+  ScopedPointer<InputStream> in (url.createInputStream (false, nullptr, nullptr, "Range: bytes=0-0",
+                                                        remoteTimeoutMs, &headers, &status));
+
+  if (in == nullptr || status == 0)
+  {
+    // offline: whatever was cached before is still good to read
+    if (info != nullptr && info->getStringAttribute ("URL") == url.toString (true))
+    {
+      totalLength = info->getStringAttribute ("Length").getLargeIntValue();
+      validator = info->getStringAttribute ("Validator");
+      return totalLength > 0;
+    }
+
+    error = "Cannot connect to " + url.toString (false);
+    return false;
+  }
+
+  const String contentRange (headers.getValue ("Content-Range", {}));
+  if (status != 206 || ! contentRange.containsChar ('/'))
+  {
+    error = "The server does not support range requests (HTTP " + String (status) + ")";
+    return false;
+  }
+
+  totalLength = contentRange.fromLastOccurrenceOf ("/", false, false).trim().getLargeIntValue();
+  validator = headers.getValue ("ETag", {}) + headers.getValue ("Last-Modified", {});
+
+  if (totalLength <= 0)
+  {
+    error = "The server does not report the file length";
+    return false;
+  }
+
+  const bool cacheIsValid = info != nullptr
+                              && info->getStringAttribute ("URL") == url.toString (true)
+                              && info->getStringAttribute ("Length").getLargeIntValue() == totalLength
+                              && info->getStringAttribute ("Validator") == validator;
+
+  if (! cacheIsValid)
+  {
+    deleteChunks();
+    folder.createDirectory();
+
+    XmlElement newInfo ("RemoteCache");
+    newInfo.setAttribute ("URL", url.toString (true));
+    newInfo.setAttribute ("Length", String (totalLength));
+    newInfo.setAttribute ("Validator", validator);
+    newInfo.writeToFile (infoFile, {});
+  }
+
+  return true;
+}
+
+void RemoteChunkCache::deleteChunks()
+{
+  // only the audio of the old version: anything else kept for the URL stays
+  Array<File> chunks;
+  folder.findChildFiles (chunks, File::findFiles, false, chunkPattern);
+  for (auto& f : chunks)
+    f.deleteFile();
+
+  const ScopedLock sl (CacheUsage::lock);
+  CacheUsage::bytes = -1;
+}
+
+bool RemoteChunkCache::getChunk (int64 index, MemoryBlock& dest)
+{
+  if (index < 0 || index * chunkSize >= totalLength)
+    return false;
+
+  if (loadChunk (index, dest))
+    return true;
+
+  {
+    // the other readers of a chunk being fetched wait for it rather than fetch it again
+    const ScopedLock sl (fetchLock);
+
+    while (fetching.contains (index))
+    {
+      const ScopedUnlock su (fetchLock);
+      fetchFinished.wait (100);
+    }
+
+    if (loadChunk (index, dest))
+      return true;
+
+    fetching.add (index);
+  }
+
+  const bool ok = fetch (index, dest);
+
+  {
+    const ScopedLock sl (fetchLock);
+    fetching.removeFirstMatchingValue (index);
+  }
+
+  fetchFinished.signal();
+  return ok;
+}
+
+bool RemoteChunkCache::loadChunk (int64 index, MemoryBlock& dest) const
+{
+  File chunkFile (getChunkFile (index));
+  if (chunkFile.getSize() != getChunkLength (index) || ! chunkFile.loadFileAsData (dest)
+      || (int64) dest.getSize() != getChunkLength (index))
+    return false;
+
+  // the size limit deletes the chunks read least recently
+  chunkFile.setLastAccessTime (Time::getCurrentTime());
+  return true;
+}
+
+bool RemoteChunkCache::fetch (int64 index, MemoryBlock& dest)
+{
+  const int64 start = index * chunkSize;
+  const int64 length = getChunkLength (index);
+
+  StringPairArray headers;
+  int status = 0;
+  ScopedPointer<InputStream> in (url.createInputStream (false, nullptr, nullptr,
+                                                        "Range: bytes=" + String (start) + "-" + String (start + length - 1),
+                                                        remoteTimeoutMs, &headers, &status));
+  if (in == nullptr || status != 206)
+    return false;
+
+  dest.reset();
+  if (in->readIntoMemoryBlock (dest, (ssize_t) length) != (size_t) length)
+    return false;
+
+  bytesFetched += length;
+
+  // written aside and moved into place, so a reader never sees half a chunk
+  TemporaryFile temp (getChunkFile (index));
+  if (temp.getFile().replaceWithData (dest.getData(), dest.getSize())
+      && temp.overwriteTargetFileWithTemporary())
+    CacheUsage::add (length);
+
+  return true;
+}
+
+
+RemoteInputStream::RemoteInputStream (RemoteChunkCache::Ptr c) : cache (c)
+{
+  jassert (cache != nullptr);
+}
+
+int RemoteInputStream::read (void* destBuffer, int maxBytesToRead)
+{
+  auto* dest = static_cast<char*> (destBuffer);
+  int done = 0;
+
+  while (done < maxBytesToRead && position < cache->getTotalLength())
+  {
+    const int64 index = position / RemoteChunkCache::chunkSize;
+
+    if (index != currentChunk)
+    {
+      currentChunk = -1;
+      if (! cache->getChunk (index, chunk))
+        break;
+      currentChunk = index;
+    }
+
+    const int offset = (int) (position - index * RemoteChunkCache::chunkSize);
+    const int num = jmin (maxBytesToRead - done, (int) chunk.getSize() - offset);
+    if (num <= 0)
+      break;
+
+    memcpy (dest + done, static_cast<const char*> (chunk.getData()) + offset, (size_t) num);
+    done += num;
+    position += num;
+  }
+
+  return done;
+}
+
+bool RemoteInputStream::setPosition (int64 newPosition)
+{
+  position = jlimit ((int64) 0, cache->getTotalLength(), newPosition);
+  return true;
+}
+
+
+RemoteOverviewReader::RemoteOverviewReader (AudioFormatReader* sourceToOwn, int64 totalBytes)
+: AudioFormatReader (nullptr, sourceToOwn->getFormatName()), source (sourceToOwn)
+{
+  sampleRate            = source->sampleRate;
+  bitsPerSample         = source->bitsPerSample;
+  lengthInSamples       = source->lengthInSamples;
+  numChannels           = source->numChannels;
+  usesFloatingPointData = source->usesFloatingPointData;
+  metadataValues        = source->metadataValues;
+
+  stride = windowLength = jmax ((int64) 1, lengthInSamples);
+
+  if (totalBytes > (int64) maxWindows * RemoteChunkCache::chunkSize * 2 && lengthInSamples > 0)
+  {
+    // about one chunk per window, whatever the bytes per frame of the format
+    stride = (lengthInSamples + maxWindows - 1) / maxWindows;
+    windowLength = jlimit ((int64) 1, stride, (int64) ((double) RemoteChunkCache::chunkSize * lengthInSamples / totalBytes));
+  }
+}
+
+bool RemoteOverviewReader::readSamples (int** destSamples, int numDestChannels, int startOffsetInDestBuffer,
+                                        int64 startSampleInFile, int numSamples)
+{
+  while (numSamples > 0)
+  {
+    const int64 offsetInStride = startSampleInFile % stride;
+    const int64 offsetInWindow = offsetInStride % windowLength;
+    const int num = (int) jmin ((int64) numSamples, stride - offsetInStride, windowLength - offsetInWindow);
+
+    if (! source->readSamples (destSamples, numDestChannels, startOffsetInDestBuffer,
+                               startSampleInFile - offsetInStride + offsetInWindow, num))
+      return false;
+
+    startOffsetInDestBuffer += num;
+    startSampleInFile += num;
+    numSamples -= num;
+  }
+
+  return true;
+}
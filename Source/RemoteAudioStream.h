@@ -0,0 +1,120 @@
+/*
+  ==============================================================================
+
+    RemoteAudioStream.h
+
+    Seekable input stream over HTTP. The file is split into fixed-size chunks
+    that are fetched with range requests when a reader first touches them
+    and kept in a persistent cache folder, so seeking, scrubbing and the
+    waveform only ever download the parts they read, and only once.
+
+    The cache of a URL is reused as long as the server reports the same
+    length and ETag / Last-Modified; it also serves reads when the server
+    cannot be reached. All caches together are kept under a size limit by
+    deleting the chunks read least recently.
+
+    The thumbnail of a remote file is drawn from evenly spaced ranged reads
+    (RemoteOverviewReader), so opening a large file does not download it.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+
+class RemoteChunkCache : public juce::ReferenceCountedObject
+{
+public:
+  using Ptr = juce::ReferenceCountedObjectPtr<RemoteChunkCache>;
+
+  static constexpr int chunkSize = 256 * 1024;
+
+  // Returns the cache already open for this URL, or probes the server and
+  // opens one. Returns nullptr if the server cannot serve byte ranges.
+  // The probe is a blocking request: call it from a background thread.
+  static Ptr open (const juce::URL& url, juce::String& error);
+
+  // The cache open() already returned for this URL, or nullptr. Never blocks.
+  static Ptr getOpen (const juce::URL& url);
+
+  static juce::File getCacheRoot();
+  static void setCacheLocation (const juce::File& root, juce::int64 maxBytes);
+
+  // Where the markers of this URL are kept: outside its chunk folder, which an
+  // invalidated cache empties.
+  juce::File getMarkersFolder() const                 { return getCacheRoot().getSiblingFile ("Markers"); }
+
+  juce::int64 getTotalLength() const noexcept         { return totalLength; }
+  const juce::File& getFolder() const noexcept        { return folder; }
+  juce::int64 getCacheKey() const;
+  juce::int64 getNumBytesFetched() const noexcept     { return bytesFetched.get(); }
+
+  // Thread-safe. Fetches the chunk first if it is not in the cache; a chunk
+  // several readers ask for at once is fetched once.
+  bool getChunk (juce::int64 index, juce::MemoryBlock& dest);
+
+private:
+  RemoteChunkCache (const juce::URL& url, const juce::File& folder);
+
+  const juce::URL       url;
+  const juce::File      folder;
+  juce::int64           totalLength = -1;
+  juce::String          validator;
+  juce::Atomic<juce::int64> bytesFetched;
+  juce::CriticalSection fetchLock;
+  juce::Array<juce::int64> fetching;          // chunks being fetched
+  juce::WaitableEvent   fetchFinished;
+
+  bool probe (juce::String& error);
+  bool loadChunk (juce::int64 index, juce::MemoryBlock& dest) const;
+  bool fetch (juce::int64 index, juce::MemoryBlock& dest);
+  void deleteChunks();
+  juce::File getChunkFile (juce::int64 index) const;
+  juce::int64 getChunkLength (juce::int64 index) const noexcept;
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RemoteChunkCache)
+};
+
+
+class RemoteInputStream : public juce::InputStream
+{
+public:
+  RemoteInputStream (RemoteChunkCache::Ptr cache);
+
+  juce::int64 getTotalLength() override               { return cache->getTotalLength(); }
+  bool isExhausted() override                         { return position >= cache->getTotalLength(); }
+  int read (void* destBuffer, int maxBytesToRead) override;
+  juce::int64 getPosition() override                  { return position; }
+  bool setPosition (juce::int64 newPosition) override;
+
+private:
+  RemoteChunkCache::Ptr   cache;
+  juce::int64             position = 0;
+  juce::int64             currentChunk = -1;
+  juce::MemoryBlock       chunk;
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RemoteInputStream)
+};
+
+
+// Feeds the thumbnail of a remote file from at most maxWindows evenly spaced
+// windows of about one chunk each: every stretch of the file is drawn from the
+// window at its start. Files of a few hundred chunks are read whole.
+class RemoteOverviewReader : public juce::AudioFormatReader
+{
+public:
+  static constexpr int maxWindows = 256;
+
+  RemoteOverviewReader (juce::AudioFormatReader* sourceToOwn, juce::int64 totalBytes);
+
+  bool readSamples (int** destSamples, int numDestChannels, int startOffsetInDestBuffer,
+                    juce::int64 startSampleInFile, int numSamples) override;
+
+private:
+  juce::ScopedPointer<juce::AudioFormatReader>  source;
+  juce::int64                                   stride, windowLength;   // frames
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RemoteOverviewReader)
+};
@@ -0,0 +1,431 @@
+/*
+  ==============================================================================
+
+    SegmentExporter.cpp
+
+  ==============================================================================
+*/
+
+#include "SegmentExporter.h"
+#include "MainComponent.h"
+#include "WavCueChunks.h"
+#include "MarkerEditLog.h"
+
+
+using namespace juce;
+
+
+static const int copyChunkBytes = 1 << 20;   // how much is copied between checks for a cancel
+
+class SegmentExporter::SegmentJob : public ThreadPoolJob
+{
+public:
+  SegmentJob (SegmentExporter& e, int i) : ThreadPoolJob ("segment " + String (i)), exporter (e), index (i) {}
+
+  JobStatus runJob() override
+  {
+    if (shouldExit() || exporter.cancelled)
+      return jobHasFinished;
+
+    String error;
+    if (exporter.exportSegment (exporter.segments.getReference (index), error))
+    {
+      ++exporter.segmentsDone;
+    }
+    else
+    {
+      const ScopedLock sl (exporter.errorLock);
+      if (exporter.firstError.isEmpty())
+        exporter.firstError = error;
+      ++exporter.segmentsFailed;
+    }
+    return jobHasFinished;
+  }
+
+private:
+  SegmentExporter&  exporter;
+  const int         index;
+};
+
+
+SegmentExporter::SegmentExporter (const File& s, const Array<double>& markerTimes,
+                                  const StringArray& markerTitles, const Options& o)
+: source (s), options (o)
+{
+  Wave64AudioFormat::registerFormats (formatManager);
+
+  ScopedPointer<AudioFormatReader> reader (formatManager.createReaderFor (source));
+  if (reader == nullptr)
+  {
+    setupError = "Cannot read " + source.getFullPathName();
+    return;
+  }
+
+  sourceSampleRate = reader->sampleRate;
+  const int64 length = reader->lengthInSamples;
+
+  // segment boundaries: every marker strictly inside the file, in time order
+  Array<int> order;
+  for (int i = 0; i < markerTimes.size(); ++i)
+    order.add (i);
+  std::sort (order.begin(), order.end(), [&] (int a, int b) { return markerTimes[a] < markerTimes[b]; });
+
+  int64 start = 0;
+  String title ("start");
+
+  auto addSegment = [&] (int64 end)
+  {
+    if (end <= start)
+      return;
+
+    auto name = source.getFileNameWithoutExtension() + "_" + String (segments.size() + 1).paddedLeft ('0', 3);
+    auto legalTitle = File::createLegalFileName (title.trim());
+    if (legalTitle.isNotEmpty())
+      name << "_" << legalTitle;
+
+    segments.add ({ start, end, options.outputFolder.getChildFile (name + ".wav") });
+    start = end;
+  };
+
+  for (auto i : order)
+  {
+    const int64 pos = (int64) (markerTimes[i] * sourceSampleRate);
+    if (pos > 0 && pos < length)
+    {
+      addSegment (pos);
+      title = markerTitles[i];
+    }
+  }
+  addSegment (length);
+}
+
+SegmentExporter::~SegmentExporter()
+{
+}
+
+bool SegmentExporter::run (std::function<bool (double)> progressCallback, String& error)
+{
+  if (setupError.isNotEmpty())
+  {
+    error = setupError;
+    return false;
+  }
+
+  if (! options.outputFolder.createDirectory())
+  {
+    error = "Cannot create " + options.outputFolder.getFullPathName();
+    return false;
+  }
+
+  segmentsDone = 0;
+  segmentsFailed = 0;
+  firstError.clear();
+
+  ThreadPool pool (options.numThreads > 0 ? options.numThreads : SystemStats::getNumCpus());
+  for (int i = 0; i < segments.size(); ++i)
+    pool.addJob (new SegmentJob (*this, i), true);
+
+  while (segmentsDone.get() + segmentsFailed.get() < segments.size())
+  {
+    Thread::sleep (50);
+
+    const double progress = (segmentsDone.get() + segmentsFailed.get()) / (double) jmax (1, segments.size());
+    if (cancelled || (progressCallback != nullptr && ! progressCallback (progress)))
+    {
+      // the running jobs see the flag within one block and delete what they wrote
+      cancelled = true;
+      pool.removeAllJobs (true, 10000);
+      error = "Export cancelled";
+      return false;
+    }
+  }
+
+  if (segmentsFailed.get() > 0)
+  {
+    error = String (segmentsFailed.get()) + " segment(s) failed: " + firstError;
+    return false;
+  }
+  return true;
+}
+
+bool SegmentExporter::exportSegment (const Segment& segment, String& error)
+{
+  // PCM can be copied as-is unless it has to change rate or be denoised
+  if (options.targetSampleRate <= 0 || options.targetSampleRate == sourceSampleRate)
+    if (options.denoiseProfile == nullptr && WavCueChunks::isWavFile (source))
+      return copyPcm (segment, error);
+
+  return decodeAndWrite (segment, error);
+}
+
+bool SegmentExporter::copyPcm (const Segment& segment, String& error)
+{
+  WavCueChunks::DataLayout layout;
+  if (! WavCueChunks::getDataLayout (source, layout))
+    return decodeAndWrite (segment, error);
+
+  const int64 startByte = layout.dataOffset + segment.start * layout.blockAlign;
+  const int64 endByte = jmin (layout.dataOffset + segment.end * layout.blockAlign, layout.dataOffset + layout.dataSize);
+  const int64 numBytes = endByte - startByte;
+  const int64 riffSize = 4 + (int64) layout.fmtChunk.getSize() + 8 + numBytes + (numBytes & 1);
+
+  // too big for a plain RIFF header: let the WAV writer produce RF64 instead
+  if (riffSize > (int64) 0xffffffffu)
+    return decodeAndWrite (segment, error);
+
+  FileInputStream in (source);
+  segment.target.deleteFile();
+  FileOutputStream out (segment.target);
+
+  if (in.failedToOpen() || out.failedToOpen())
+  {
+    error = "Cannot open " + (in.failedToOpen() ? source : segment.target).getFullPathName();
+    return false;
+  }
+
+  out.write ("RIFF", 4);
+  out.writeInt ((int) (uint32) riffSize);
+  out.write ("WAVE", 4);
+  out.write (layout.fmtChunk.getData(), layout.fmtChunk.getSize());
+  out.write ("data", 4);
+  out.writeInt ((int) (uint32) numBytes);
+
+  in.setPosition (startByte);
+
+  for (int64 copied = 0; copied < numBytes;)
+  {
+    if (cancelled)
+    {
+      out.flush();
+      segment.target.deleteFile();
+      error = "Export cancelled";
+      return false;
+    }
+
+    const int64 num = jmin ((int64) copyChunkBytes, numBytes - copied);
+    if (out.writeFromInputStream (in, num) != num)
+    {
+      error = "Short read from " + source.getFullPathName();
+      return false;
+    }
+    copied += num;
+  }
+
+  if ((numBytes & 1) != 0)
+    out.writeByte (0);
+
+  out.flush();
+  if (out.getStatus().failed())
+  {
+    error = out.getStatus().getErrorMessage();
+    return false;
+  }
+  return true;
+}
+
+bool SegmentExporter::decodeAndWrite (const Segment& segment, String& error)
+{
+  ScopedPointer<AudioFormatReader> reader (formatManager.createReaderFor (source));
+  if (reader == nullptr)
+  {
+    error = "Cannot read " + source.getFullPathName();
+    return false;
+  }
+
+  const int numChannels = (int) reader->numChannels;
+  const double outRate = options.targetSampleRate > 0 ? options.targetSampleRate : reader->sampleRate;
+
+  // JUCE writes 32-bit WAV as float only, and the samples pass through float here,
+  // which carries 24 bits: 32-bit integer sources come out as 24-bit
+  const int bits = reader->usesFloatingPointData ? 32
+                 : reader->bitsPerSample <= 8 ? 8
+                 : reader->bitsPerSample <= 16 ? 16 : 24;
+
+  segment.target.deleteFile();
+  ScopedPointer<FileOutputStream> stream (segment.target.createOutputStream());
+  if (stream == nullptr)
+  {
+    error = "Cannot write " + segment.target.getFullPathName();
+    return false;
+  }
+
+  WavAudioFormat wav;
+  ScopedPointer<AudioFormatWriter> writer (wav.createWriterFor (stream, outRate, (unsigned int) numChannels, bits, {}, 0));
+  if (writer == nullptr)
+  {
+    error = "Cannot create a WAV writer for " + segment.target.getFullPathName();
+    return false;
+  }
+  stream.release(); // owned by the writer now
+
+  AudioFormatReaderSource readerSource (reader, false);
+  readerSource.setNextReadPosition (segment.start);
+
+  AudioSource* input = &readerSource;
+  ScopedPointer<ResamplingAudioSource> resampler;
+
+  if (outRate != reader->sampleRate)
+  {
+    resampler = new ResamplingAudioSource (&readerSource, false, numChannels);
+    resampler->setResamplingRatio (reader->sampleRate / outRate);
+    input = resampler;
+  }
+
+  const int blockSize = 16384;
+  input->prepareToPlay (blockSize, outRate);
+
+  // the denoiser runs one frame behind: read that much further and drop its first output
+  ScopedPointer<SpectralDenoiser> denoiser;
+  int64 toSkip = 0;
+
+  if (options.denoiseProfile != nullptr)
+  {
+    denoiser = new SpectralDenoiser (numChannels, outRate, *options.denoiseProfile, options.denoiseReductionDb);
+    toSkip = SpectralDenoiser::getLatencySamples();
+  }
+
+  AudioBuffer<float> buffer (numChannels, blockSize);
+  int64 remaining = (int64) ((segment.end - segment.start) * outRate / reader->sampleRate);
+
+  while (remaining > 0)
+  {
+    if (cancelled)
+    {
+      writer = nullptr;
+      segment.target.deleteFile();
+      error = "Export cancelled";
+      return false;
+    }
+
+    const int num = (int) jmin ((int64) blockSize, remaining + toSkip);
+    input->getNextAudioBlock (AudioSourceChannelInfo (&buffer, 0, num));
+
+    int skipped = 0;
+    if (denoiser != nullptr)
+    {
+      denoiser->process (buffer.getArrayOfWritePointers(), num);
+      skipped = (int) jmin ((int64) num, toSkip);
+      toSkip -= skipped;
+    }
+
+    if (! writer->writeFromAudioSampleBuffer (buffer, skipped, num - skipped))
+    {
+      error = "Write failed for " + segment.target.getFullPathName();
+      return false;
+    }
+    remaining -= num - skipped;
+  }
+
+  input->releaseResources();
+  return true;
+}
+
+bool SegmentExporter::loadMarkers (const File& audioFile, Array<double>& times, StringArray& titles,
+                                   Array<MarkerRegion>* regions)
+{
+  const File sidecar (audioFile.getFullPathName() + MarkerFilesExt);
+  ScopedPointer<XmlElement> root (XmlDocument::parse (sidecar));
+  bool found = false;
+
+  if (root != nullptr)
+  {
+    forEachXmlChildElementWithTagName (*root, m, "Marker")
+    {
+      times.add (m->getDoubleAttribute ("Time"));
+      titles.add (m->getStringAttribute ("Title"));
+    }
+
+    if (regions != nullptr)
+      forEachXmlChildElementWithTagName (*root, r, "Region")
+        regions->add ({ r->getDoubleAttribute ("Start"), r->getDoubleAttribute ("End"), r->getStringAttribute ("Title") });
+
+    found = true;
+  }
+  else
+  {
+    Array<WavCueChunks::CueMarker> cues;
+    found = WavCueChunks::read (audioFile, cues);
+
+    for (auto& cue : cues)
+    {
+      times.add (cue.time);
+      titles.add (cue.title);
+    }
+  }
+
+  // edits made since the last full save of the sidecar
+  return MarkerEditLog::replayJournal (sidecar, times, titles, regions) > 0 || found;
+}
+
+int SegmentExporter::runFromCommandLine (const StringArray& args)
+{
+  auto option = [&args] (const String& name) -> String
+  {
+    const int i = args.indexOf (name);
+    return i >= 0 ? args[i + 1] : String();
+  };
+
+  const auto cwd = File::getCurrentWorkingDirectory();
+  const File audioFile (cwd.getChildFile (option ("--export-segments").unquoted()));
+
+  if (! audioFile.existsAsFile())
+  {
+    std::cerr << "usage: EasyAudioMarker --export-segments <audio file> [--out <folder>] [--rate <Hz>] [--jobs <n>]"
+                 " [--denoise <noise start s>:<noise end s>] [--reduction <dB>]" << std::endl;
+    return 1;
+  }
+
+  Options options;
+  options.outputFolder = option ("--out").isNotEmpty()
+                           ? cwd.getChildFile (option ("--out").unquoted())
+                           : audioFile.getSiblingFile (audioFile.getFileNameWithoutExtension() + "_segments");
+  options.targetSampleRate = option ("--rate").getDoubleValue();
+  options.numThreads = option ("--jobs").getIntValue();
+
+  const String noise = option ("--denoise");
+  if (noise.isNotEmpty())
+  {
+    AudioFormatManager formats;
+    Wave64AudioFormat::registerFormats (formats);
+    ScopedPointer<AudioFormatReader> reader (formats.createReaderFor (audioFile));
+    String error = "Cannot read " + audioFile.getFullPathName();
+
+    if (reader != nullptr)
+      options.denoiseProfile = SpectralDenoiser::Profile::learn (*reader,
+                                 (int64) (noise.upToFirstOccurrenceOf (":", false, false).getDoubleValue() * reader->sampleRate),
+                                 (int64) (noise.fromFirstOccurrenceOf (":", false, false).getDoubleValue() * reader->sampleRate),
+                                 error);
+
+    if (options.denoiseProfile == nullptr)
+    {
+      std::cerr << error << std::endl;
+      return 1;
+    }
+
+    if (option ("--reduction").isNotEmpty())
+      options.denoiseReductionDb = option ("--reduction").getFloatValue();
+  }
+
+  Array<double> times;
+  StringArray titles;
+  if (! loadMarkers (audioFile, times, titles))
+    std::cerr << "no markers found, exporting the whole file" << std::endl;
+
+  SegmentExporter exporter (audioFile, times, titles, options);
+  String error;
+  const bool ok = exporter.run ([] (double progress)
+                                {
+                                  std::cout << "\r" << roundToInt (progress * 100.0) << "%" << std::flush;
+                                  return true;
+                                }, error);
+  std::cout << std::endl;
+
+  if (! ok)
+  {
+    std::cerr << error << std::endl;
+    return 1;
+  }
+
+  std::cout << exporter.getNumSegments() << " segments written to " << options.outputFolder.getFullPathName() << std::endl;
+  return 0;
+}
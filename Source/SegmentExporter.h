@@ -0,0 +1,86 @@
+/*
+  ==============================================================================
+
+    SegmentExporter.h
+
+    Cuts a recording at its marker positions and writes each segment to its
+    own WAV file, one segment per job on a thread pool. WAV sources that are
+    not resampled are copied byte for byte; anything else is decoded, resampled
+    if asked to, and re-encoded at the source bit depth, except that 32-bit
+    integer sources come out as 24-bit: decoding goes through float, and JUCE
+    writes 32-bit WAV as float only. With a noise profile every segment is
+    decoded and passed through the spectral denoiser.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "SpectralDenoiser.h"
+#include "RegionIndex.h"
+#include <atomic>
+
+
+class SegmentExporter
+{
+public:
+  struct Options
+  {
+    juce::File    outputFolder;
+    double        targetSampleRate = 0;   // 0 keeps the source rate
+    int           numThreads = 0;         // 0 uses one per CPU
+    SpectralDenoiser::Profile::Ptr denoiseProfile;   // none writes the audio as it is
+    float         denoiseReductionDb = 12.0f;
+  };
+
+  struct Segment
+  {
+    juce::int64   start, end;             // in source samples
+    juce::File    target;
+  };
+
+  SegmentExporter (const juce::File& source, const juce::Array<double>& markerTimes,
+                   const juce::StringArray& markerTitles, const Options& options);
+  ~SegmentExporter();
+
+  int getNumSegments() const noexcept     { return segments.size(); }
+
+  // Blocks until every segment is written. The callback gets the fraction done
+  // and may return false to cancel the remaining segments.
+  bool run (std::function<bool (double)> progressCallback, juce::String& error);
+
+  // Makes run() return soon from any thread; segments being written are deleted.
+  void cancel() noexcept                  { cancelled = true; }
+
+  // Reads the marker sidecar of a recording, or its embedded cues when there is
+  // none, with the edits of its journal applied. Its regions too, unless null.
+  static bool loadMarkers (const juce::File& audioFile, juce::Array<double>& times, juce::StringArray& titles,
+                           juce::Array<MarkerRegion>* regions = nullptr);
+
+  // --export-segments <audio file> [--out <folder>] [--rate <Hz>] [--jobs <n>]
+  //                   [--denoise <noise start s>:<noise end s>] [--reduction <dB>]
+  static int runFromCommandLine (const juce::StringArray& args);
+
+private:
+  class SegmentJob;
+
+  juce::File                    source;
+  Options                       options;
+  juce::AudioFormatManager      formatManager;
+  double                        sourceSampleRate = 0;
+  juce::Array<Segment>          segments;
+  juce::String                  setupError;
+
+  juce::Atomic<int>             segmentsDone;
+  juce::Atomic<int>             segmentsFailed;
+  std::atomic<bool>             cancelled { false };
+  juce::CriticalSection         errorLock;
+  juce::String                  firstError;
+
+  bool exportSegment (const Segment& segment, juce::String& error);
+  bool copyPcm (const Segment& segment, juce::String& error);
+  bool decodeAndWrite (const Segment& segment, juce::String& error);
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SegmentExporter)
+};
@@ -0,0 +1,173 @@
+/*
+  ==============================================================================
+
+    SidecarMerge.cpp
+
+  ==============================================================================
+*/
+
+#include "SidecarMerge.h"
+#include <algorithm>
+
+
+using namespace juce;
+
+
+void SidecarMerge::sort (Array<Marker>& markers)
+{
+  std::sort (markers.begin(), markers.end(), [] (const Marker& a, const Marker& b)
+  {
+    return a.time < b.time || (a.time == b.time && a.title < b.title);
+  });
+}
+
+void SidecarMerge::sort (Array<Region>& regions)
+{
+  std::sort (regions.begin(), regions.end(), [] (const Region& a, const Region& b)
+  {
+    return a.start < b.start || (a.start == b.start && (a.end < b.end || (a.end == b.end && a.title < b.title)));
+  });
+}
+
+bool SidecarMerge::read (const File& sidecar, Array<Marker>& markers, Array<Region>* regions)
+{
+  markers.clearQuick();
+  if (regions != nullptr)
+    regions->clearQuick();
+
+  if (! sidecar.existsAsFile())
+    return false;
+
+  ScopedPointer<XmlElement> root (XmlDocument::parse (sidecar));
+  if (root == nullptr)
+    return false;
+
+  forEachXmlChildElementWithTagName (*root, m, "Marker")
+    markers.add ({ m->getDoubleAttribute ("Time"), m->getStringAttribute ("Title"), m->getStringAttribute ("Type") });
+
+  sort (markers);
+
+  if (regions != nullptr)
+  {
+    forEachXmlChildElementWithTagName (*root, r, "Region")
+      regions->add ({ r->getDoubleAttribute ("Start"), r->getDoubleAttribute ("End"), r->getStringAttribute ("Title") });
+
+    sort (*regions);
+  }
+
+  return true;
+}
+
+SidecarMerge::Stamp SidecarMerge::getStamp (const File& sidecar)
+{
+  Stamp stamp;
+  stamp.taken = Time::getCurrentTime();
+
+  if (sidecar.existsAsFile())
+  {
+    stamp.size = sidecar.getSize();
+    stamp.modified = sidecar.getLastModificationTime();
+  }
+
+  return stamp;
+}
+
+bool SidecarMerge::mayHaveChanged (const File& sidecar, const Stamp& stamp)
+{
+  const Stamp now (getStamp (sidecar));
+
+  return now.size != stamp.size
+      || now.modified != stamp.modified
+      || (stamp.size >= 0 && stamp.taken - stamp.modified < RelativeTime::seconds (2.0));
+}
+
+String SidecarMerge::getType (const Array<Marker>& sorted, double time, const String& title)
+{
+  auto* m = std::lower_bound (sorted.begin(), sorted.end(), time - timeTolerance,
+                              [] (const Marker& a, double t) { return a.time < t; });
+
+  for (; m != sorted.end() && m->time <= time + timeTolerance; ++m)
+    if (m->title == title)
+      return m->type;
+
+  return {};
+}
+
+void SidecarMerge::diff (const Array<Marker>& base, const Array<Marker>& theirs, Array<Change>& changes)
+{
+  changes.clearQuick();
+
+  // one pass over both, a group of markers at the same time at a time
+  int b = 0, t = 0;
+  StringArray removed, added;
+  Array<double> addedTimes;
+
+  while (b < base.size() || t < theirs.size())
+  {
+    const double time = t >= theirs.size() ? base[b].time
+                      : b >= base.size()   ? theirs[t].time
+                                           : jmin (base[b].time, theirs[t].time);
+    removed.clearQuick();
+    added.clearQuick();
+    addedTimes.clearQuick();
+
+    for (; b < base.size() && base[b].time <= time + timeTolerance; ++b)
+      removed.add (base[b].title);
+
+    for (; t < theirs.size() && theirs[t].time <= time + timeTolerance; ++t)
+    {
+      // a title on both sides is unchanged
+      const int i = removed.indexOf (theirs[t].title);
+      if (i >= 0)
+        removed.remove (i);
+      else
+      {
+        added.add (theirs[t].title);
+        addedTimes.add (theirs[t].time);
+      }
+    }
+
+    const int numRetitled = jmin (removed.size(), added.size());
+
+    for (int i = 0; i < numRetitled; ++i)
+      changes.add ({ Change::retitle, time, added[i], removed[i] });
+
+    for (int i = numRetitled; i < removed.size(); ++i)
+      changes.add ({ Change::remove, time, removed[i], {} });
+
+    for (int i = numRetitled; i < added.size(); ++i)
+      changes.add ({ Change::add, addedTimes[i], added[i], {} });
+  }
+}
+
+bool SidecarMerge::isSame (const Region& a, const Region& b) noexcept
+{
+  return std::abs (a.start - b.start) <= timeTolerance && std::abs (a.end - b.end) <= timeTolerance
+      && a.title == b.title;
+}
+
+void SidecarMerge::diff (const Array<Region>& base, const Array<Region>& theirs, Array<RegionChange>& changes)
+{
+  changes.clearQuick();
+
+  // a region of one side is matched among those of the other starting at the same time
+  auto contains = [] (const Array<Region>& sorted, const Region& region)
+  {
+    auto* r = std::lower_bound (sorted.begin(), sorted.end(), region.start - timeTolerance,
+                                [] (const Region& a, double t) { return a.start < t; });
+
+    for (; r != sorted.end() && r->start <= region.start + timeTolerance; ++r)
+      if (isSame (*r, region))
+        return true;
+
+    return false;
+  };
+
+  for (auto& region : base)
+    if (! contains (theirs, region))
+      changes.add ({ RegionChange::remove, region });
+
+  for (auto& region : theirs)
+    if (! contains (base, region))
+      changes.add ({ RegionChange::add, region });
+}
@@ -0,0 +1,95 @@
+/*
+  ==============================================================================
+
+    SidecarMerge.h
+
+    Finds what another program changed in a marker sidecar, so the changes
+    can be merged into the markers being edited instead of reloading them.
+    Markers are identified by time and title, as in the edit journal; a
+    marker removed and another added at the same time count as a retitle.
+    Regions are identified by start, end and title, so any change to one
+    is a removal and an addition.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+
+class SidecarMerge
+{
+public:
+  struct Marker
+  {
+    double        time;
+    juce::String  title;
+    juce::String  type;             // the Type attribute, set on the findings of a QC pass
+  };
+
+  struct Region
+  {
+    double        start, end;
+    juce::String  title;
+  };
+
+  struct Change
+  {
+    enum Type { add, remove, retitle };
+
+    Type          type;
+    double        time;
+    juce::String  title;            // the new title for retitle
+    juce::String  previousTitle;    // retitle only
+  };
+
+  struct RegionChange
+  {
+    enum Type { add, remove };
+
+    Type          type;
+    Region        region;
+  };
+
+  // Size and modification time of a sidecar, taken when it is read or written here.
+  struct Stamp
+  {
+    juce::int64   size = -1;        // -1 when there is no file
+    juce::Time    modified, taken;
+  };
+
+  // Times closer than this are the same time.
+  static constexpr double timeTolerance = 1.0e-9;
+
+  // Sorted by time, then title.
+  static void sort (juce::Array<Marker>& markers);
+
+  // Sorted by start, end, then title.
+  static void sort (juce::Array<Region>& regions);
+
+  // The markers of a sidecar, sorted, and its regions unless null. False when there
+  // is none, or it does not parse (as when it is caught half written).
+  static bool read (const juce::File& sidecar, juce::Array<Marker>& markers,
+                    juce::Array<Region>* regions = nullptr);
+
+  static Stamp getStamp (const juce::File& sidecar);
+
+  // False only when the sidecar is surely unchanged since the stamp. A file system
+  // may keep whole seconds, so a stamp taken within two of the write proves nothing.
+  static bool mayHaveChanged (const juce::File& sidecar, const Stamp& stamp);
+
+  // The type of the marker at that time with that title, or an empty string.
+  static juce::String getType (const juce::Array<Marker>& sorted, double time, const juce::String& title);
+
+  // What turns base into theirs, both sorted; in time order.
+  static void diff (const juce::Array<Marker>& base, const juce::Array<Marker>& theirs,
+                    juce::Array<Change>& changes);
+
+  // What turns base into theirs, both sorted; removals first.
+  static void diff (const juce::Array<Region>& base, const juce::Array<Region>& theirs,
+                    juce::Array<RegionChange>& changes);
+
+private:
+  static bool isSame (const Region& a, const Region& b) noexcept;
+};
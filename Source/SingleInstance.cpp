@@ -0,0 +1,195 @@
+/*
+  ==============================================================================
+
+    SingleInstance.cpp
+
+  ==============================================================================
+*/
+
+#include "SingleInstance.h"
+#include <atomic>
+
+#if ! JUCE_WINDOWS
+ #include <sys/stat.h>
+#endif
+
+
+using namespace juce;
+
+
+static const uint32 instanceMagic = 0x45414d31;   // "EAM1"
+static const int connectTimeoutMs = 500;
+static const int acknowledgeTimeoutMs = 3000;
+
+// One pipe per user, which other users cannot open: on Windows it is named after the
+// logon, elsewhere its FIFOs live in the user's own runtime folder and are made private.
+static String getPipeName()
+{
+ #if JUCE_WINDOWS
+  return "EasyAudioMarker-" + File::createLegalFileName (SystemStats::getLogonName());
+ #else
+  File folder (SystemStats::getEnvironmentVariable ("XDG_RUNTIME_DIR", {}));
+  if (! folder.isDirectory())
+    folder = File::getSpecialLocation (File::userApplicationDataDirectory).getChildFile ("EasyAudioMarker");
+
+  folder.createDirectory();
+  return folder.getChildFile ("instance").getFullPathName();
+ #endif
+}
+
+static MemoryBlock encodeFiles (const StringArray& files)
+{
+  const String text (files.joinIntoString ("\n"));
+  return MemoryBlock (text.toRawUTF8(), text.getNumBytesAsUTF8());
+}
+
+static StringArray decodeFiles (const MemoryBlock& message)
+{
+  StringArray lines, files;
+  lines.addTokens (message.toString(), "\n", {});
+
+  // launches send absolute paths: anything else did not come from one
+  for (auto& line : lines)
+    if (line.contains ("://") || File::isAbsolutePath (line))
+      files.add (line);
+
+  return files;
+}
+
+
+class SingleInstance::Connection : public InterProcessConnection
+{
+public:
+  Connection (SingleInstance& o) : InterProcessConnection (false, instanceMagic), owner (o) {}
+  ~Connection()                                     { disconnect(); }
+
+  void connectionMade() override                    {}
+  void connectionLost() override                    {}
+
+  void messageReceived (const MemoryBlock& message) override
+  {
+    // the answer lets the new launch exit; the files are opened afterwards,
+    // and the pipe is opened anew for the next launch
+    sendMessage (MemoryBlock ("ok", 2));
+    owner.deliver (decodeFiles (message));
+  }
+
+private:
+  SingleInstance& owner;
+};
+
+
+namespace
+{
+  class ForwardingConnection : public InterProcessConnection
+  {
+  public:
+    ForwardingConnection() : InterProcessConnection (false, instanceMagic) {}
+    ~ForwardingConnection()                         { disconnect(); }
+
+    void connectionMade() override                  {}
+    void connectionLost() override                  { answered.signal(); }
+    void messageReceived (const MemoryBlock& message) override
+    {
+      accepted = message.toString() == "ok";
+      answered.signal();
+    }
+
+    WaitableEvent answered;
+    std::atomic<bool> accepted { false };
+  };
+}
+
+
+SingleInstance::SingleInstance() : listenerLock ("EasyAudioMarker-listener")
+{
+}
+
+SingleInstance::~SingleInstance()
+{
+  connection = nullptr;
+}
+
+bool SingleInstance::forwardToRunningInstance (const StringArray& files)
+{
+  // launches at the same moment take turns: they share one pipe and its answers
+  InterProcessLock forwardLock ("EasyAudioMarker-forward");
+  if (! forwardLock.enter (acknowledgeTimeoutMs))
+    return false;
+
+  ForwardingConnection connection;
+
+  // the pipe of an instance that crashed is still there: without an answer this launch starts normally
+  const bool accepted = connection.connectToPipe (getPipeName(), connectTimeoutMs)
+                          && connection.sendMessage (encodeFiles (files))
+                          && connection.answered.wait (acknowledgeTimeoutMs)
+                          && connection.accepted;
+
+  forwardLock.exit();
+  return accepted;
+}
+
+bool SingleInstance::startListening()
+{
+  if (! listenerLock.enter (0))
+    return false;
+
+  listen();
+  return connection != nullptr;
+}
+
+void SingleInstance::listen()
+{
+  const String name (getPipeName());
+
+  connection = nullptr;
+  connection = new Connection (*this);
+
+  if (! connection->createPipe (name, -1, false))
+  {
+    connection = nullptr;
+    return;
+  }
+
+ #if ! JUCE_WINDOWS
+  chmod ((name + "_in").toRawUTF8(), S_IRUSR | S_IWUSR);
+  chmod ((name + "_out").toRawUTF8(), S_IRUSR | S_IWUSR);
+ #endif
+}
+
+StringArray SingleInstance::getFilesFromCommandLine (const StringArray& args)
+{
+  StringArray files;
+
+  for (auto arg : args)
+  {
+    arg = arg.unquoted();
+
+    if (arg.isEmpty() || arg.startsWith ("-"))
+      continue;
+
+    if (arg.contains ("://"))
+      files.add (arg);
+    else
+      files.add (File::getCurrentWorkingDirectory().getChildFile (arg).getFullPathName());
+  }
+
+  return files;
+}
+
+void SingleInstance::deliver (const StringArray& files)
+{
+  // on the pipe's thread, the only one that makes references to this
+  WeakReference<SingleInstance> safeThis (this);
+
+  MessageManager::callAsync ([safeThis, files]
+  {
+    if (safeThis == nullptr)
+      return;
+
+    safeThis->listen();
+
+    if (safeThis->onFilesReceived)
+      safeThis->onFilesReceived (files);
+  });
+}
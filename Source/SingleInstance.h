@@ -0,0 +1,54 @@
+/*
+  ==============================================================================
+
+    SingleInstance.h
+
+    Keeps one running player per user. The first instance listens on a
+    named pipe only its user can open (in the user's runtime folder, or
+    named after the logon on Windows); later launches connect, hand over
+    their files as absolute paths and exit, and the running instance opens
+    them with its caches and audio device already warm. A launch that finds
+    nobody listening, or gets no answer, carries on as a normal instance.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+
+class SingleInstance
+{
+public:
+  SingleInstance();
+  ~SingleInstance();
+
+  // Sends the files to the instance already running and waits for it to take
+  // them. Returns false if there is none, so this process should start up.
+  static bool forwardToRunningInstance (const juce::StringArray& files);
+
+  // Starts taking files from later launches. Returns false if another
+  // instance listens already, e.g. one that started at the same moment.
+  bool startListening();
+
+  // Absolute paths or URLs of the non-option arguments, resolved against
+  // the working directory of the launch they come from.
+  static juce::StringArray getFilesFromCommandLine (const juce::StringArray& args);
+
+  // Called on the message thread with the files of a later launch; the
+  // list is empty when it was started without any.
+  std::function<void (const juce::StringArray&)> onFilesReceived;
+
+private:
+  class Connection;
+
+  juce::InterProcessLock          listenerLock;     // held by the instance that listens
+  juce::ScopedPointer<Connection> connection;
+
+  void listen();
+  void deliver (const juce::StringArray& files);
+
+  JUCE_DECLARE_WEAK_REFERENCEABLE (SingleInstance)
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SingleInstance)
+};
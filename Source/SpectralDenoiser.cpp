@@ -0,0 +1,440 @@
+/*
+  ==============================================================================
+
+    SpectralDenoiser.cpp
+
+  ==============================================================================
+*/
+
+#include "SpectralDenoiser.h"
+
+#if defined (__SSE__) || defined (_M_X64) || (defined (_M_IX86_FP) && _M_IX86_FP >= 1)
+ #include <xmmintrin.h>
+ #define EAM_DENOISE_SSE 1
+#elif defined (__ARM_NEON) || defined (__ARM_NEON__)
+ #include <arm_neon.h>
+ #define EAM_DENOISE_NEON 1
+#endif
+
+
+using namespace juce;
+
+
+static const int paddedBins = (SpectralDenoiser::numBins + 3) & ~3;
+static const double maxLearnSeconds = 10.0;
+static const float sensitivity = 3.0f;        // over-subtraction, so what is left of the hiss does not flicker
+static const double releaseSeconds = 0.1;
+
+
+namespace
+{
+  void fillWindow (float* window)
+  {
+    // periodic, so the squares of overlapping frames add up to a constant
+    for (int n = 0; n < SpectralDenoiser::frameSize; ++n)
+      window[n] = (float) std::sqrt (0.5 - 0.5 * std::cos (2.0 * double_Pi * n / SpectralDenoiser::frameSize));
+  }
+
+  // gain = max (floor, 1 - sensitivity * noise / power); it drops at once and recovers with the release
+  inline void updateGains (const float* power, const float* noise, float* gain, float floorGain, float release) noexcept
+  {
+   #if EAM_DENOISE_SSE
+    const __m128 one = _mm_set1_ps (1.0f), floorV = _mm_set1_ps (floorGain), releaseV = _mm_set1_ps (release);
+    const __m128 sensitivityV = _mm_set1_ps (sensitivity), tiny = _mm_set1_ps (1.0e-20f);
+
+    for (int k = 0; k < paddedBins; k += 4)
+    {
+      const __m128 p = _mm_add_ps (_mm_loadu_ps (power + k), tiny);
+      const __m128 ratio = _mm_div_ps (_mm_mul_ps (sensitivityV, _mm_loadu_ps (noise + k)), p);
+      const __m128 target = _mm_max_ps (floorV, _mm_sub_ps (one, ratio));
+      const __m128 g = _mm_loadu_ps (gain + k);
+      const __m128 rising = _mm_cmpge_ps (target, g);
+      const __m128 released = _mm_add_ps (target, _mm_mul_ps (releaseV, _mm_sub_ps (g, target)));
+      _mm_storeu_ps (gain + k, _mm_or_ps (_mm_and_ps (rising, target), _mm_andnot_ps (rising, released)));
+    }
+   #elif EAM_DENOISE_NEON
+    const float32x4_t one = vdupq_n_f32 (1.0f), floorV = vdupq_n_f32 (floorGain), releaseV = vdupq_n_f32 (release);
+    const float32x4_t tiny = vdupq_n_f32 (1.0e-20f);
+
+    for (int k = 0; k < paddedBins; k += 4)
+    {
+      const float32x4_t p = vaddq_f32 (vld1q_f32 (power + k), tiny);
+      float32x4_t inverse = vrecpeq_f32 (p);
+      inverse = vmulq_f32 (vrecpsq_f32 (p, inverse), inverse);
+      inverse = vmulq_f32 (vrecpsq_f32 (p, inverse), inverse);
+      const float32x4_t ratio = vmulq_f32 (vmulq_n_f32 (vld1q_f32 (noise + k), sensitivity), inverse);
+      const float32x4_t target = vmaxq_f32 (floorV, vsubq_f32 (one, ratio));
+      const float32x4_t g = vld1q_f32 (gain + k);
+      const float32x4_t released = vmlaq_f32 (target, releaseV, vsubq_f32 (g, target));
+      vst1q_f32 (gain + k, vbslq_f32 (vcgeq_f32 (target, g), target, released));
+    }
+   #else
+    for (int k = 0; k < paddedBins; ++k)
+    {
+      const float target = jmax (floorGain, 1.0f - sensitivity * noise[k] / (power[k] + 1.0e-20f));
+      gain[k] = target >= gain[k] ? target : target + release * (gain[k] - target);
+    }
+   #endif
+  }
+}
+
+
+SpectralDenoiser::Profile::Ptr SpectralDenoiser::Profile::create (const AudioBuffer<float>& noise, double rate)
+{
+  const int numSamples = noise.getNumSamples();
+  if (numSamples < frameSize || noise.getNumChannels() == 0 || rate <= 0)
+    return nullptr;
+
+  Fft fft (frameOrder);
+  HeapBlock<float> window ((size_t) frameSize);
+  fillWindow (window);
+
+  HeapBlock<Fft::Complex> spectrum ((size_t) frameSize);
+  HeapBlock<double> sum ((size_t) numBins, true);
+  int numFrames = 0;
+
+  for (int ch = 0; ch < noise.getNumChannels(); ++ch)
+  {
+    const float* data = noise.getReadPointer (ch);
+
+    for (int start = 0; start + frameSize <= numSamples; start += hopSize)
+    {
+      for (int n = 0; n < frameSize; ++n)
+        spectrum[n] = Fft::Complex (data[start + n] * window[n], 0.0f);
+
+      fft.perform (spectrum, false);
+
+      for (int k = 0; k < numBins; ++k)
+        sum[k] += std::norm (spectrum[k]);
+      ++numFrames;
+    }
+  }
+
+  Ptr profile (new Profile());
+  profile->sampleRate = rate;
+  profile->lengthSeconds = numSamples / rate;
+  for (int k = 0; k < numBins; ++k)
+    profile->power.add ((float) (sum[k] / numFrames));
+
+  return profile;
+}
+
+SpectralDenoiser::Profile::Ptr SpectralDenoiser::Profile::learn (AudioFormatReader& reader, int64 start, int64 end, String& error)
+{
+  start = jlimit ((int64) 0, reader.lengthInSamples, start);
+  end = jlimit (start, reader.lengthInSamples, jmin (end, start + (int64) (maxLearnSeconds * reader.sampleRate)));
+
+  if (end - start < frameSize)
+  {
+    error = "The noise sample must be at least " + String (roundToInt (frameSize * 1000.0 / reader.sampleRate)) + " ms long";
+    return nullptr;
+  }
+
+  AudioBuffer<float> buffer ((int) reader.numChannels, (int) (end - start));
+  if (! reader.read (&buffer, 0, buffer.getNumSamples(), start, true, true))
+  {
+    error = "Cannot read the noise sample";
+    return nullptr;
+  }
+
+  return create (buffer, reader.sampleRate);
+}
+
+void SpectralDenoiser::Profile::getBinPowers (double targetRate, float* powers) const
+{
+  // bin k lies at k * rate / frameSize Hz at either rate
+  for (int k = 0; k < numBins; ++k)
+  {
+    const double position = k * targetRate / sampleRate;
+    const int i = (int) position;
+
+    if (i >= numBins - 1)
+    {
+      powers[k] = power.getLast();
+    }
+    else
+    {
+      const float fraction = (float) (position - i);
+      powers[k] = power[i] + fraction * (power[i + 1] - power[i]);
+    }
+  }
+}
+
+
+struct SpectralDenoiser::Pair
+{
+  Pair (int first, int second) : channels { first, second }
+  {
+    for (int c = 0; c < 2; ++c)
+    {
+      input[c].allocate ((size_t) frameSize, true);
+      output[c].allocate ((size_t) frameSize, true);
+      power[c].allocate ((size_t) paddedBins, true);
+      gain[c].allocate ((size_t) paddedBins, false);
+    }
+    spectrum.allocate ((size_t) frameSize, true);
+    filtered.allocate ((size_t) frameSize, true);
+    reset();
+  }
+
+  void reset() noexcept
+  {
+    for (int c = 0; c < 2; ++c)
+    {
+      FloatVectorOperations::clear (input[c], frameSize);
+      FloatVectorOperations::clear (output[c], frameSize);
+      FloatVectorOperations::fill (gain[c], 1.0f, paddedBins);
+    }
+  }
+
+  const int                 channels[2];      // the second is -1 for an odd channel out
+  HeapBlock<float>          input[2], output[2], power[2], gain[2];
+  HeapBlock<Fft::Complex>   spectrum, filtered;
+};
+
+
+SpectralDenoiser::SpectralDenoiser (int channels, double sampleRate, const Profile& profile, float reductionDb)
+: numChannels (channels), fft (frameOrder)
+{
+  window.allocate ((size_t) frameSize, false);
+  fillWindow (window);
+
+  noisePower.allocate ((size_t) paddedBins, true);
+  profile.getBinPowers (sampleRate, noisePower);
+
+  floorGain = Decibels::decibelsToGain (-std::abs (reductionDb));
+  releaseCoefficient = (float) std::exp (-hopSize / (releaseSeconds * sampleRate));
+
+  for (int ch = 0; ch < numChannels; ch += 2)
+    pairs.add (new Pair (ch, ch + 1 < numChannels ? ch + 1 : -1));
+}
+
+SpectralDenoiser::~SpectralDenoiser()
+{
+}
+
+void SpectralDenoiser::reset() noexcept
+{
+  for (auto* pair : pairs)
+    pair->reset();
+  hopPosition = 0;
+}
+
+void SpectralDenoiser::process (float* const* channels, int numSamples) noexcept
+{
+  process (channels, numChannels, numSamples);
+}
+
+void SpectralDenoiser::process (float* const* channels, int numChannelsToProcess, int numSamples) noexcept
+{
+  const int numPairs = jmin (pairs.size(), (numChannelsToProcess + 1) / 2);
+
+  for (int done = 0; done < numSamples;)
+  {
+    const int num = jmin (hopSize - hopPosition, numSamples - done);
+
+    for (int p = 0; p < numPairs; ++p)
+    {
+      auto* pair = pairs.getUnchecked (p);
+
+      for (int c = 0; c < 2; ++c)
+      {
+        const int ch = pair->channels[c];
+        if (ch < 0 || ch >= numChannelsToProcess)
+          continue;
+
+        // in place: the new input is taken before the delayed output replaces it
+        FloatVectorOperations::copy (pair->input[c] + frameSize - hopSize + hopPosition, channels[ch] + done, num);
+        FloatVectorOperations::copy (channels[ch] + done, pair->output[c] + hopPosition, num);
+      }
+    }
+
+    hopPosition += num;
+    done += num;
+
+    if (hopPosition == hopSize)
+    {
+      for (int p = 0; p < numPairs; ++p)
+        processFrame (*pairs.getUnchecked (p));
+      hopPosition = 0;
+    }
+  }
+}
+
+void SpectralDenoiser::processFrame (Pair& pair) noexcept
+{
+  Fft::Complex* spectrum = pair.spectrum;
+  Fft::Complex* filtered = pair.filtered;
+  const float* left = pair.input[0];
+  const float* right = pair.input[1];
+
+  for (int n = 0; n < frameSize; ++n)
+    spectrum[n] = Fft::Complex (left[n] * window[n], right[n] * window[n]);
+
+  fft.perform (spectrum, false);
+
+  // the two real spectra: X = (Z[k] + conj Z[N-k]) / 2 and Y = (Z[k] - conj Z[N-k]) / 2i
+  for (int k = 0; k < numBins; ++k)
+  {
+    const Fft::Complex z = spectrum[k];
+    const Fft::Complex mirrored = std::conj (spectrum[(frameSize - k) & (frameSize - 1)]);
+    pair.power[0][k] = std::norm (z + mirrored) * 0.25f;
+    pair.power[1][k] = std::norm (z - mirrored) * 0.25f;
+  }
+
+  // a little smoothing across neighbouring bins steadies the decisions on noise
+  for (int c = 0; c < 2; ++c)
+  {
+    float* power = pair.power[c];
+    float previous = power[0];
+
+    for (int k = 1; k < numBins - 1; ++k)
+    {
+      const float current = power[k];
+      power[k] = 0.5f * current + 0.25f * (previous + power[k + 1]);
+      previous = current;
+    }
+  }
+
+  updateGains (pair.power[0], noisePower, pair.gain[0], floorGain, releaseCoefficient);
+  updateGains (pair.power[1], noisePower, pair.gain[1], floorGain, releaseCoefficient);
+
+  // gX * X + i gY * Y, written with the packed spectrum
+  for (int k = 0; k < frameSize; ++k)
+  {
+    const int bin = k <= frameSize / 2 ? k : frameSize - k;
+    const float gx = pair.gain[0][bin], gy = pair.gain[1][bin];
+    const Fft::Complex mirrored = std::conj (spectrum[(frameSize - k) & (frameSize - 1)]);
+    filtered[k] = spectrum[k] * (0.5f * (gx + gy)) + mirrored * (0.5f * (gx - gy));
+  }
+
+  fft.perform (filtered, true);
+
+  // the squared window overlaps to 2 at a quarter hop; the inverse FFT is unscaled
+  const float scale = 0.5f / frameSize;
+
+  for (int c = 0; c < 2; ++c)
+  {
+    float* out = pair.output[c];
+    memmove (out, out + hopSize, (size_t) (frameSize - hopSize) * sizeof (float));
+    FloatVectorOperations::clear (out + frameSize - hopSize, hopSize);
+
+    float* in = pair.input[c];
+    memmove (in, in + hopSize, (size_t) (frameSize - hopSize) * sizeof (float));
+  }
+
+  float* outLeft = pair.output[0];
+  float* outRight = pair.output[1];
+  for (int n = 0; n < frameSize; ++n)
+  {
+    const float w = window[n] * scale;
+    outLeft[n] += filtered[n].real() * w;
+    outRight[n] += filtered[n].imag() * w;
+  }
+}
+
+
+DenoisingAudioSource::DenoisingAudioSource (AudioSource* i) : input (i)
+{
+}
+
+DenoisingAudioSource::~DenoisingAudioSource()
+{
+}
+
+void DenoisingAudioSource::setProfile (SpectralDenoiser::Profile::Ptr newProfile)
+{
+  const ScopedLock ul (updateLock);
+  profile = newProfile;
+  update();
+}
+
+SpectralDenoiser::Profile::Ptr DenoisingAudioSource::getProfile() const
+{
+  const ScopedLock ul (updateLock);
+  return profile;
+}
+
+void DenoisingAudioSource::setEnabled (bool shouldBeEnabled)
+{
+  const ScopedLock ul (updateLock);
+  enabled = shouldBeEnabled;
+  update();
+}
+
+void DenoisingAudioSource::setReductionDb (float newReduction)
+{
+  const ScopedLock ul (updateLock);
+  reductionDb = newReduction;
+  update();
+}
+
+double DenoisingAudioSource::getLatencySeconds() const noexcept
+{
+  const ScopedLock ul (updateLock);
+  return active.load() ? SpectralDenoiser::getLatencySamples() / sampleRate : 0.0;
+}
+
+// sampleRate only changes here and in releaseResources(), while no callback reads it.
+void DenoisingAudioSource::prepareToPlay (int samplesPerBlockExpected, double newSampleRate)
+{
+  input->prepareToPlay (samplesPerBlockExpected, newSampleRate);
+
+  const ScopedLock ul (updateLock);
+  sampleRate = newSampleRate;
+  update();
+}
+
+void DenoisingAudioSource::releaseResources()
+{
+  input->releaseResources();
+
+  const ScopedLock ul (updateLock);
+  sampleRate = 0;
+  update();
+}
+
+// Called with updateLock held. The new denoiser is built without the audio lock,
+// which only guards the swap; the old one is freed after it.
+void DenoisingAudioSource::update()
+{
+  ScopedPointer<SpectralDenoiser> newDenoiser;
+
+  if (enabled && profile != nullptr && sampleRate > 0)
+    newDenoiser = new SpectralDenoiser (maxChannels, sampleRate, *profile, reductionDb);
+
+  {
+    const ScopedLock sl (lock);
+    denoiser.swapWith (newDenoiser);
+    active = denoiser != nullptr;
+  }
+
+  cpuLoad = 0.0f;
+}
+
+void DenoisingAudioSource::getNextAudioBlock (const AudioSourceChannelInfo& info)
+{
+  input->getNextAudioBlock (info);
+
+  if (! active.load())
+    return;
+
+  const ScopedLock sl (lock);
+  if (denoiser == nullptr)
+    return;
+
+  // built for maxChannels: the channels the device has are only a selection
+  const int numChannels = jmin (info.buffer->getNumChannels(), (int) maxChannels);
+
+  float* channels[maxChannels];
+  for (int ch = 0; ch < numChannels; ++ch)
+    channels[ch] = info.buffer->getWritePointer (ch, info.startSample);
+
+  const int64 start = Time::getHighResolutionTicks();
+  denoiser->process (channels, numChannels, info.numSamples);
+  const float load = (float) (Time::highResolutionTicksToSeconds (Time::getHighResolutionTicks() - start)
+                                / (info.numSamples / sampleRate));
+
+  // smoothed over roughly a second of callbacks, like the resampler's
+  cpuLoad = cpuLoad.load() + (load - cpuLoad.load()) * 0.05f;
+}
@@ -0,0 +1,137 @@
+/*
+  ==============================================================================
+
+    SpectralDenoiser.h
+
+    Spectral gating against steady hiss and hum. A noise profile, the mean
+    power per frequency bin, is learned from a stretch of the recording that
+    holds nothing but the noise. While processing, each bin is turned down
+    towards a floor as its power nears what the profile predicts, and comes
+    back up at once when the signal rises above it.
+
+    1024 point frames with 75% overlap, so the delay is one frame (about
+    21 ms at 48 kHz). Two channels share one complex FFT, as the real and
+    imaginary parts; the gain law runs four bins at a time with SSE or NEON.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "Fft.h"
+#include <atomic>
+
+
+class SpectralDenoiser
+{
+public:
+  static constexpr int frameOrder = 10;
+  static constexpr int frameSize = 1 << frameOrder;
+  static constexpr int hopSize = frameSize / 4;
+  static constexpr int numBins = frameSize / 2 + 1;
+
+  class Profile : public juce::ReferenceCountedObject
+  {
+  public:
+    using Ptr = juce::ReferenceCountedObjectPtr<Profile>;
+
+    // From audio holding only the noise: at least one frame of it.
+    static Ptr create (const juce::AudioBuffer<float>& noise, double sampleRate);
+
+    // Reads up to maxLearnSeconds of the range from the file.
+    static Ptr learn (juce::AudioFormatReader& reader, juce::int64 start, juce::int64 end, juce::String& error);
+
+    double getSampleRate() const noexcept           { return sampleRate; }
+    double getLengthSeconds() const noexcept        { return lengthSeconds; }
+
+    // The profile on the bins of another sample rate.
+    void getBinPowers (double targetRate, float* powers) const;
+
+  private:
+    Profile() = default;
+
+    double                  sampleRate = 0;
+    double                  lengthSeconds = 0;
+    juce::Array<float>      power;
+  };
+
+  SpectralDenoiser (int numChannels, double sampleRate, const Profile& profile, float reductionDb);
+  ~SpectralDenoiser();
+
+  int getNumChannels() const noexcept               { return numChannels; }
+
+  // Input and output are one frame apart.
+  static int getLatencySamples() noexcept           { return frameSize; }
+
+  // In place, any block size.
+  void process (float* const* channels, int numSamples) noexcept;
+
+  // Only the first numChannelsToProcess channels; the others stay idle and cost nothing.
+  void process (float* const* channels, int numChannelsToProcess, int numSamples) noexcept;
+  void reset() noexcept;
+
+private:
+  struct Pair;
+
+  const int                       numChannels;
+  Fft                             fft;
+  juce::HeapBlock<float>          window;           // sqrt-Hann, for analysis and synthesis
+  juce::HeapBlock<float>          noisePower;       // numBins, padded to a multiple of 4
+  juce::OwnedArray<Pair>          pairs;
+  float                           floorGain;
+  float                           releaseCoefficient;
+  int                             hopPosition = 0;
+
+  void processFrame (Pair& pair) noexcept;
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SpectralDenoiser)
+};
+
+
+// The denoiser in the playback path. Switched off, or without a profile, it
+// adds neither delay nor work. It is built for maxChannels on the thread that
+// changes a setting or prepares the source, never in the callback.
+class DenoisingAudioSource : public juce::AudioSource
+{
+public:
+  // Channels denoised; further channels of the device pass unchanged.
+  static constexpr int maxChannels = 32;
+
+  // The input is not owned.
+  DenoisingAudioSource (juce::AudioSource* input);
+  ~DenoisingAudioSource();
+
+  void setProfile (SpectralDenoiser::Profile::Ptr newProfile);
+  SpectralDenoiser::Profile::Ptr getProfile() const;
+
+  void setEnabled (bool shouldBeEnabled);
+  bool isEnabled() const noexcept                   { return enabled; }
+
+  void setReductionDb (float newReduction);
+  float getReductionDb() const noexcept             { return reductionDb; }
+
+  bool isActive() const noexcept                    { return active.load(); }
+  double getLatencySeconds() const noexcept;
+  float getCpuLoad() const noexcept                 { return cpuLoad.load(); }
+
+  void prepareToPlay (int samplesPerBlockExpected, double sampleRate) override;
+  void releaseResources() override;
+  void getNextAudioBlock (const juce::AudioSourceChannelInfo& info) override;
+
+private:
+  juce::AudioSource*                        input;
+  juce::CriticalSection                     updateLock;     // settings, never taken by the callback
+  juce::CriticalSection                     lock;           // the denoiser the callback uses
+  SpectralDenoiser::Profile::Ptr            profile;
+  juce::ScopedPointer<SpectralDenoiser>     denoiser;
+  bool                                      enabled = false;
+  float                                     reductionDb = 12.0f;
+  double                                    sampleRate = 0;
+  std::atomic<bool>                         active { false };
+  std::atomic<float>                        cpuLoad { 0.0f };
+
+  void update();
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DenoisingAudioSource)
+};
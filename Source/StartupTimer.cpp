@@ -0,0 +1,75 @@
+/*
+  ==============================================================================
+
+    StartupTimer.cpp
+
+  ==============================================================================
+*/
+
+#include "StartupTimer.h"
+
+
+using namespace juce;
+
+
+namespace
+{
+  // static initialisation runs before main(), as close to the launch as this code gets
+  const double launchTime = Time::getMillisecondCounterHiRes();
+
+  double firstPaintMs = -1.0;
+  double readyMs = -1.0;
+  File reportFile;
+
+  void reportIfComplete()
+  {
+    if (firstPaintMs < 0 || readyMs < 0)
+      return;
+
+    Logger::writeToLog ("startup: first paint " + String (firstPaintMs, 1) + " ms, ready " + String (readyMs, 1) + " ms");
+
+    if (reportFile == File())
+      return;
+
+    DynamicObject::Ptr report = new DynamicObject();
+    report->setProperty ("first_paint_ms", firstPaintMs);
+    report->setProperty ("ready_ms", readyMs);
+    reportFile.replaceWithText (JSON::toString (var (report.get())));
+
+    JUCEApplicationBase::quit();
+  }
+}
+
+
+void StartupTimer::markFirstPaint()
+{
+  if (firstPaintMs >= 0)
+    return;
+
+  firstPaintMs = Time::getMillisecondCounterHiRes() - launchTime;
+  reportIfComplete();
+}
+
+void StartupTimer::markReady()
+{
+  if (readyMs >= 0)
+    return;
+
+  readyMs = Time::getMillisecondCounterHiRes() - launchTime;
+  reportIfComplete();
+}
+
+double StartupTimer::getFirstPaintMs()
+{
+  return firstPaintMs;
+}
+
+double StartupTimer::getReadyMs()
+{
+  return readyMs;
+}
+
+void StartupTimer::setReportFile (const File& file)
+{
+  reportFile = file;
+}
@@ -0,0 +1,30 @@
+/*
+  ==============================================================================
+
+    StartupTimer.h
+
+    Times the startup of the player from process launch: until the window
+    first paints, and until the audio device is open and the player is
+    ready. Both are logged; with a report file they are also written as
+    JSON and the app quits, so startup can be tracked from a script.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+
+namespace StartupTimer
+{
+  // Milliseconds since launch. Message thread only.
+  void markFirstPaint();
+  void markReady();
+
+  double getFirstPaintMs();   // -1 until it happened
+  double getReadyMs();
+
+  // Once both are known, writes { "first_paint_ms", "ready_ms" } to the file and quits.
+  void setReportFile (const juce::File& file);
+}
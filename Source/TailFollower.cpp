@@ -0,0 +1,134 @@
+/*
+  ==============================================================================
+
+    TailFollower.cpp
+
+  ==============================================================================
+*/
+
+#include "TailFollower.h"
+#include "ChannelReaders.h"
+
+
+using namespace juce;
+
+
+static const int tailReadBlockSize = 65536;
+
+
+// only the followed file is watched, so there is no need to read `file` in the
+// callback, which start() writes on another thread
+TailFollower::TailFollower()
+: Thread ("tail follower"),
+  watcher ("tail watcher", [this] (const File&) { notify(); })
+{
+}
+
+TailFollower::~TailFollower()
+{
+  stop();
+}
+
+bool TailFollower::start (const File& f, PeakReceiver& r, const Array<int>& channels,
+                          int64 alreadyPeaked, String& error)
+{
+  stop();
+
+  WavCueChunks::DataLayout layout;
+  if (! WavCueChunks::getDataLayout (f, layout))
+  {
+    error = "Only WAV files that are being written can be followed";
+    return false;
+  }
+
+  WavAudioFormat wav;
+  auto* wavReader = wav.createReaderFor (f.createInputStream(), true);
+  if (wavReader == nullptr)
+  {
+    error = "Cannot read " + f.getFullPathName();
+    return false;
+  }
+
+  file = f;
+  sampleRate = wavReader->sampleRate;
+  reader = new ChannelSubsetReader (wavReader, channels);
+  reader->setLengthInSamples (0);
+  buffer.setSize (channels.size(), tailReadBlockSize);
+
+  receiver = &r;
+  const int64 keep = jlimit ((int64) 0, getAvailableSamples (file), alreadyPeaked);
+  if (keep == 0)
+    receiver->reset (channels.size(), sampleRate, 0);
+  peakedSamples = keep;
+
+  watcher.watchFile (file);
+  startThread (3);
+  notify();
+  return true;
+}
+
+void TailFollower::stop()
+{
+  watcher.clear();
+  stopThread (4000);
+  reader = nullptr;
+  receiver = nullptr;
+}
+
+int64 TailFollower::getAvailableSamples (const File& f)
+{
+  WavCueChunks::DataLayout layout;
+  if (! WavCueChunks::getDataLayout (f, layout))
+    return 0;
+
+  const int64 fileSize = f.getSize();
+  int64 bytes = fileSize - layout.dataOffset;
+  const int64 declared = layout.declaredDataSize;
+
+  if (declared > 0 && declared < bytes && declared != (int64) 0xffffffffu)
+  {
+    // the header is final when a chunk id follows the declared data; a writer that
+    // only updates the header from time to time leaves audio there instead
+    FileInputStream in (f);
+    char id[4] = {};
+    in.setPosition (layout.dataOffset + declared + (declared & 1));
+
+    if (in.read (id, 4) == 4
+        && std::all_of (id, id + 4, [] (char c) { return c >= 0x20 && c < 0x7f; }))
+      bytes = declared;
+  }
+
+  return jmax ((int64) 0, bytes / layout.blockAlign);
+}
+
+void TailFollower::run()
+{
+  while (! threadShouldExit())
+  {
+    readNewSamples();
+
+    // the watcher wakes this up; the timeout covers file systems without notifications
+    wait (1000);
+  }
+}
+
+void TailFollower::readNewSamples()
+{
+  const int64 available = getAvailableSamples (file);
+  int64 done = peakedSamples.load();
+
+  if (available <= done)
+    return;
+
+  reader->setLengthInSamples (available);
+
+  while (done < available && ! threadShouldExit())
+  {
+    const int num = (int) jmin ((int64) tailReadBlockSize, available - done);
+    reader->read (&buffer, 0, num, done, true, true);
+    receiver->addBlock (done, buffer, 0, num);
+
+    done += num;
+    peakedSamples = done;
+  }
+}
@@ -0,0 +1,64 @@
+/*
+  ==============================================================================
+
+    TailFollower.h
+
+    Follows a WAV file that another process is still writing. Each time the
+    file watcher reports a change, only the frames appended since the last
+    pass are read and added to the peak data; the new length is published
+    for the UI and the player to pick up.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "FileWatcher.h"
+#include "WavCueChunks.h"
+#include <atomic>
+
+class ChannelSubsetReader;
+
+
+class TailFollower : private juce::Thread
+{
+public:
+  using PeakReceiver = juce::AudioFormatWriter::ThreadedWriter::IncomingDataReceiver;
+
+  TailFollower();
+  ~TailFollower();
+
+  // Feeds the receiver the given channels as the file grows. The receiver keeps
+  // the peaks of the first alreadyPeaked frames; with 0 it is reset and fed from
+  // the start of the file.
+  bool start (const juce::File& file, PeakReceiver& receiver, const juce::Array<int>& channels,
+              juce::int64 alreadyPeaked, juce::String& error);
+  void stop();
+
+  bool isFollowing() const noexcept                 { return isThreadRunning(); }
+  const juce::File& getFile() const noexcept        { return file; }
+  double getSampleRate() const noexcept             { return sampleRate; }
+
+  // Frames whose peaks have been added so far.
+  juce::int64 getLengthInSamples() const noexcept   { return peakedSamples.load(); }
+
+  // Whole frames in the file right now. A data size that was already written
+  // into the header is trusted once a chunk follows the data, otherwise the
+  // file size decides.
+  static juce::int64 getAvailableSamples (const juce::File& file);
+
+private:
+  juce::File                                  file;
+  double                                      sampleRate = 0;
+  PeakReceiver*                               receiver = nullptr;
+  juce::ScopedPointer<ChannelSubsetReader>    reader;
+  juce::AudioBuffer<float>                    buffer;
+  std::atomic<juce::int64>                    peakedSamples { 0 };
+  FileWatcher                                 watcher;
+
+  void run() override;
+  void readNewSamples();
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TailFollower)
+};
@@ -0,0 +1,624 @@
+/*
+  ==============================================================================
+
+    TakeAligner.cpp
+
+  ==============================================================================
+*/
+
+#include "TakeAligner.h"
+#include "Fft.h"
+#include "MainComponent.h"
+#include "MarkerEditLog.h"
+#include "SegmentExporter.h"
+#include "SidecarMerge.h"
+#include <algorithm>
+
+
+using namespace juce;
+
+
+static const double envelopeRate = 1000.0;      // frames per second; anchors are exact to a frame
+static const int coarseFactor = 10;             // the global search runs at 100 Hz
+static const int framesPerJob = 60000;
+static const int framesPerRead = 1000;
+static const int fineSearchFrames = 20;         // +-20 ms around the coarse peak
+static const int windowFrames = 30000;          // drift is followed in 30 s windows
+static const int windowSearchFrames = 2000;     // each may move +-2 s from the overall offset
+static const float minConfidence = 0.1f;
+static const float minWindowConfidence = 0.5f;
+static const double maxAnchorJump = 0.005;
+
+
+struct TakeAligner::Envelope
+{
+  File            file;
+  double          sampleRate = 0;
+  int64           lengthInSamples = 0;
+  int64           numFrames = 0;
+  HeapBlock<float> frames;
+  HeapBlock<float> coarse;
+  int64           numCoarse = 0;
+
+  int64 getFrameStart (int64 frame) const noexcept
+  {
+    return (int64) (frame * sampleRate / envelopeRate);
+  }
+
+  // log loudness minus its mean over the surrounding half second: level differences
+  // between the two takes drop out and the note onsets and pauses remain
+  void whiten()
+  {
+    for (int64 i = 0; i < numFrames; ++i)
+      frames[i] = std::log (frames[i] + 1.0e-5f);
+
+    HeapBlock<double> sums ((size_t) numFrames + 1);
+    sums[0] = 0;
+    for (int64 i = 0; i < numFrames; ++i)
+      sums[i + 1] = sums[i] + frames[i];
+
+    const int64 half = 250;
+    for (int64 i = 0; i < numFrames; ++i)
+    {
+      const int64 lo = jmax ((int64) 0, i - half), hi = jmin (numFrames, i + half + 1);
+      frames[i] -= (float) ((sums[hi] - sums[lo]) / (double) (hi - lo));
+    }
+
+    numCoarse = numFrames / coarseFactor;
+    coarse.allocate ((size_t) jmax ((int64) 1, numCoarse), true);
+    for (int64 j = 0; j < numCoarse; ++j)
+    {
+      float sum = 0;
+      for (int k = 0; k < coarseFactor; ++k)
+        sum += frames[j * coarseFactor + k];
+      coarse[j] = sum / coarseFactor;
+    }
+  }
+};
+
+
+class TakeAligner::EnvelopeJob : public ThreadPoolJob
+{
+public:
+  EnvelopeJob (TakeAligner& a, Envelope& e, int64 first, int64 end)
+  : ThreadPoolJob ("envelope"), aligner (a), envelope (e), firstFrame (first), endFrame (end) {}
+
+  JobStatus runJob() override
+  {
+    ScopedPointer<AudioFormatReader> reader (aligner.formatManager.createReaderFor (envelope.file));
+
+    if (reader != nullptr)
+    {
+      AudioBuffer<float> buffer ((int) reader->numChannels,
+                                 (int) envelope.getFrameStart (framesPerRead) + 2);
+
+      for (int64 frame = firstFrame; frame < endFrame && ! shouldExit(); frame += framesPerRead)
+      {
+        const int64 last = jmin (endFrame, frame + framesPerRead);
+        const int64 blockStart = envelope.getFrameStart (frame);
+        const int numSamples = (int) (envelope.getFrameStart (last) - blockStart);
+
+        reader->read (&buffer, 0, numSamples, blockStart, true, true);
+
+        for (int64 f = frame; f < last; ++f)
+        {
+          const int start = (int) (envelope.getFrameStart (f) - blockStart);
+          const int num = jmax (1, (int) (envelope.getFrameStart (f + 1) - blockStart) - start);
+          float sum = 0;
+
+          for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+          {
+            const float* s = buffer.getReadPointer (ch, start);
+            for (int i = 0; i < num; ++i)
+              sum += s[i] * s[i];
+          }
+
+          envelope.frames[f] = std::sqrt (sum / (float) (num * buffer.getNumChannels()));
+        }
+      }
+    }
+
+    ++aligner.jobsDone;
+    return jobHasFinished;
+  }
+
+private:
+  TakeAligner&  aligner;
+  Envelope&     envelope;
+  const int64   firstFrame, endFrame;
+};
+
+
+class TakeAligner::WindowJob : public ThreadPoolJob
+{
+public:
+  WindowJob (TakeAligner& a, int64 s) : ThreadPoolJob ("window"), aligner (a), start (s) {}
+
+  JobStatus runJob() override
+  {
+    if (! shouldExit())
+      aligner.alignWindow (start);
+
+    ++aligner.jobsDone;
+    return jobHasFinished;
+  }
+
+private:
+  TakeAligner&  aligner;
+  const int64   start;
+};
+
+
+namespace
+{
+  // Circular cross-correlation r[lag] = sum a[n] * b[n + lag]; negative lags wrap around.
+  void crossCorrelate (const Fft& fft, const float* a, int64 numA, const float* b, int64 numB,
+                       HeapBlock<Fft::Complex>& result)
+  {
+    const int n = fft.getSize();
+    HeapBlock<Fft::Complex> other ((size_t) n, true);
+    result.allocate ((size_t) n, true);
+
+    for (int64 i = 0; i < numA; ++i)
+      result[i] = a[i];
+    for (int64 i = 0; i < numB; ++i)
+      other[i] = b[i];
+
+    fft.perform (result, false);
+    fft.perform (other, false);
+
+    for (int i = 0; i < n; ++i)
+      result[i] = std::conj (result[i]) * other[i];
+
+    fft.perform (result, true);
+  }
+
+  double dot (const float* a, const float* b, int64 num)
+  {
+    double sum = 0;
+    for (int64 i = 0; i < num; ++i)
+      sum += a[i] * b[i];
+    return sum;
+  }
+
+  // correlation coefficient of a and b when b is shifted by lag frames
+  float coefficientAt (const float* a, int64 numA, const float* b, int64 numB, int64 lag)
+  {
+    const int64 startA = jmax ((int64) 0, -lag);
+    const int64 num = jmin (numA - startA, numB - (startA + lag));
+    if (num <= 0)
+      return 0.0f;
+
+    const double ab = dot (a + startA, b + startA + lag, num);
+    const double aa = dot (a + startA, a + startA, num);
+    const double bb = dot (b + startA + lag, b + startA + lag, num);
+    return aa > 0 && bb > 0 ? (float) (ab / std::sqrt (aa * bb)) : 0.0f;
+  }
+
+  // fractional position of a peak from its two neighbours
+  double parabolicPeak (double left, double centre, double right)
+  {
+    const double d = left - 2.0 * centre + right;
+    return d < 0 ? jlimit (-0.5, 0.5, 0.5 * (left - right) / d) : 0.0;
+  }
+}
+
+
+TakeAligner::TakeAligner (const File& r, const File& t, const Options& o)
+: reference (r), target (t), options (o)
+{
+  Wave64AudioFormat::registerFormats (formatManager);
+}
+
+TakeAligner::~TakeAligner()
+{
+}
+
+bool TakeAligner::run (std::function<bool (double)> progressCallback, String& error)
+{
+  anchors.clear();
+  referenceEnvelope = new Envelope();
+  targetEnvelope = new Envelope();
+
+  ThreadPool pool (options.numThreads > 0 ? options.numThreads : SystemStats::getNumCpus());
+
+  auto waitForJobs = [&] (int numJobs, double progressStart, double progressEnd)
+  {
+    while (jobsDone.get() < numJobs)
+    {
+      Thread::sleep (20);
+
+      const double progress = progressStart + (progressEnd - progressStart) * jobsDone.get() / (double) jmax (1, numJobs);
+      if (progressCallback != nullptr && ! progressCallback (progress))
+      {
+        pool.removeAllJobs (true, 10000);
+        error = "Alignment cancelled";
+        return false;
+      }
+    }
+    return true;
+  };
+
+  // both files are decoded at once, a minute of each per job
+  int numJobs = 0;
+  jobsDone = 0;
+
+  for (auto* envelope : { referenceEnvelope.get(), targetEnvelope.get() })
+  {
+    envelope->file = envelope == referenceEnvelope.get() ? reference : target;
+
+    ScopedPointer<AudioFormatReader> reader (formatManager.createReaderFor (envelope->file));
+    if (reader == nullptr || reader->sampleRate <= 0)
+    {
+      error = "Cannot read " + envelope->file.getFullPathName();
+      return false;
+    }
+
+    envelope->sampleRate = reader->sampleRate;
+    envelope->lengthInSamples = reader->lengthInSamples;
+    envelope->numFrames = (int64) (reader->lengthInSamples * envelopeRate / reader->sampleRate);
+    envelope->frames.allocate ((size_t) jmax ((int64) 1, envelope->numFrames), true);
+
+    for (int64 first = 0; first < envelope->numFrames; first += framesPerJob)
+    {
+      pool.addJob (new EnvelopeJob (*this, *envelope, first, jmin (envelope->numFrames, first + framesPerJob)), true);
+      ++numJobs;
+    }
+  }
+
+  if (! waitForJobs (numJobs, 0.0, 0.8))
+    return false;
+
+  targetLength = targetEnvelope->lengthInSamples / targetEnvelope->sampleRate;
+  referenceEnvelope->whiten();
+  targetEnvelope->whiten();
+
+  if (! findGlobalOffset (error))
+    return false;
+
+  if (options.estimateDrift)
+  {
+    numJobs = 0;
+    jobsDone = 0;
+
+    for (int64 start = 0; start + windowFrames <= referenceEnvelope->numFrames; start += windowFrames)
+    {
+      pool.addJob (new WindowJob (*this, start), true);
+      ++numJobs;
+    }
+
+    if (! waitForJobs (numJobs, 0.85, 1.0))
+      return false;
+
+    fitDrift();
+  }
+
+  return true;
+}
+
+bool TakeAligner::findGlobalOffset (String& error)
+{
+  const auto& ref = *referenceEnvelope;
+  const auto& tgt = *targetEnvelope;
+
+  if (ref.numCoarse < 10 || tgt.numCoarse < 10)
+  {
+    error = "The files are too short to align";
+    return false;
+  }
+
+  const Fft fft (Fft::getOrderFor (ref.numCoarse + tgt.numCoarse));
+  HeapBlock<Fft::Complex> corr;
+  crossCorrelate (fft, ref.coarse, ref.numCoarse, tgt.coarse, tgt.numCoarse, corr);
+
+  // the shorter take must overlap by at least a quarter, which keeps edge effects out
+  const int64 minOverlap = jmin (ref.numCoarse, tgt.numCoarse) / 4;
+  int64 bestLag = 0;
+  float best = -std::numeric_limits<float>::max();
+
+  for (int64 lag = -(ref.numCoarse - minOverlap); lag <= tgt.numCoarse - minOverlap; ++lag)
+  {
+    const float value = corr[lag >= 0 ? lag : fft.getSize() + lag].real();
+    if (value > best)
+    {
+      best = value;
+      bestLag = lag;
+    }
+  }
+
+  // refine at the full envelope rate around the coarse peak
+  const int64 centre = bestLag * coarseFactor;
+  double dots[2 * fineSearchFrames + 1];
+  int bestFine = 0;
+
+  for (int k = 0; k <= 2 * fineSearchFrames; ++k)
+  {
+    const int64 lag = centre + k - fineSearchFrames;
+    const int64 startA = jmax ((int64) 0, -lag);
+    const int64 num = jmin (ref.numFrames - startA, tgt.numFrames - (startA + lag));
+    dots[k] = num > 0 ? dot (ref.frames + startA, tgt.frames + startA + lag, num) : 0.0;
+
+    if (k == 0 || dots[k] > dots[bestFine])
+      bestFine = k;
+  }
+
+  const int64 fineLag = centre + bestFine - fineSearchFrames;
+  double fraction = 0;
+  if (bestFine > 0 && bestFine < 2 * fineSearchFrames)
+    fraction = parabolicPeak (dots[bestFine - 1], dots[bestFine], dots[bestFine + 1]);
+
+  offset = (fineLag + fraction) / envelopeRate;
+  confidence = coefficientAt (ref.frames, ref.numFrames, tgt.frames, tgt.numFrames, fineLag);
+
+  if (confidence < minConfidence)
+  {
+    error = "The files do not seem to contain the same recording";
+    return false;
+  }
+
+  return true;
+}
+
+void TakeAligner::alignWindow (int64 start)
+{
+  const auto& ref = *referenceEnvelope;
+  const auto& tgt = *targetEnvelope;
+
+  // the part of the target this window can move over
+  const int64 searchStart = start + (int64) std::floor (offset * envelopeRate) - windowSearchFrames;
+  const int64 searchLength = windowFrames + 2 * windowSearchFrames;
+  if (searchStart < 0 || searchStart + searchLength > tgt.numFrames)
+    return;
+
+  if (dot (ref.frames + start, ref.frames + start, windowFrames) <= 0)
+    return;
+
+  // one instance per job: the tables are small next to the correlation itself
+  const Fft fft (Fft::getOrderFor (windowFrames + searchLength));
+  HeapBlock<Fft::Complex> corr;
+  crossCorrelate (fft, ref.frames + start, windowFrames, tgt.frames + searchStart, searchLength, corr);
+
+  int best = 0;
+  for (int lag = 1; lag <= 2 * windowSearchFrames; ++lag)
+    if (corr[lag].real() > corr[best].real())
+      best = lag;
+
+  const float coefficient = coefficientAt (ref.frames + start, windowFrames,
+                                           tgt.frames + searchStart, searchLength, best);
+  if (coefficient < minWindowConfidence)
+    return;
+
+  double fraction = 0;
+  if (best > 0 && best < 2 * windowSearchFrames)
+    fraction = parabolicPeak (corr[best - 1].real(), corr[best].real(), corr[best + 1].real());
+
+  const double centre = windowFrames / 2.0;
+  const Anchor anchor { (start + centre) / envelopeRate, (searchStart + best + fraction + centre) / envelopeRate };
+
+  const ScopedLock sl (anchorLock);
+  anchors.add (anchor);
+}
+
+void TakeAligner::fitDrift()
+{
+  std::sort (anchors.begin(), anchors.end(),
+             [] (const Anchor& a, const Anchor& b) { return a.referenceTime < b.referenceTime; });
+
+  // a window that disagrees with both neighbours matched a repeated passage
+  Array<Anchor> kept;
+  for (int i = 0; i < anchors.size(); ++i)
+  {
+    const double o = anchors[i].targetTime - anchors[i].referenceTime;
+    const bool nearPrevious = i > 0 && std::abs (o - (anchors[i - 1].targetTime - anchors[i - 1].referenceTime)) <= maxAnchorJump;
+    const bool nearNext = i + 1 < anchors.size() && std::abs (o - (anchors[i + 1].targetTime - anchors[i + 1].referenceTime)) <= maxAnchorJump;
+
+    if (nearPrevious || nearNext || anchors.size() < 3)
+      kept.add (anchors[i]);
+  }
+  anchors.swapWith (kept);
+
+  if (anchors.size() < 2)
+  {
+    anchors.clear();
+    driftPpm = 0;
+    return;
+  }
+
+  // least squares line through the offsets
+  double st = 0, so = 0, stt = 0, sto = 0;
+  for (auto& a : anchors)
+  {
+    const double o = a.targetTime - a.referenceTime;
+    st += a.referenceTime;
+    so += o;
+    stt += a.referenceTime * a.referenceTime;
+    sto += a.referenceTime * o;
+  }
+
+  const double n = anchors.size();
+  const double d = n * stt - st * st;
+  driftPpm = d > 0 ? (n * sto - st * so) / d * 1.0e6 : 0.0;
+}
+
+double TakeAligner::mapTime (double referenceTime) const
+{
+  const double mapped = mapUnbounded (referenceTime);
+  return mapped >= 0 && mapped <= targetLength ? mapped : -1.0;
+}
+
+// the offset of the nearest anchors, and the drift beyond them
+double TakeAligner::mapUnbounded (double referenceTime) const
+{
+  double mapped = referenceTime + offset;
+
+  if (anchors.size() >= 2)
+  {
+    auto offsetOf = [] (const Anchor& a) { return a.targetTime - a.referenceTime; };
+    const double slope = driftPpm * 1.0e-6;
+    const auto& first = anchors.getReference (0);
+    const auto& last = anchors.getReference (anchors.size() - 1);
+
+    if (referenceTime <= first.referenceTime)
+      mapped = referenceTime + offsetOf (first) + slope * (referenceTime - first.referenceTime);
+    else if (referenceTime >= last.referenceTime)
+      mapped = referenceTime + offsetOf (last) + slope * (referenceTime - last.referenceTime);
+    else
+    {
+      auto next = std::upper_bound (anchors.begin(), anchors.end(), referenceTime,
+                                    [] (double t, const Anchor& a) { return t < a.referenceTime; });
+      const auto& b = *next;
+      const auto& a = *(next - 1);
+      const double p = (referenceTime - a.referenceTime) / (b.referenceTime - a.referenceTime);
+      mapped = referenceTime + offsetOf (a) + p * (offsetOf (b) - offsetOf (a));
+    }
+  }
+
+  return mapped;
+}
+
+int TakeAligner::mapMarkers (const Array<double>& times, const StringArray& titles,
+                             Array<double>& mappedTimes, StringArray& mappedTitles) const
+{
+  int dropped = 0;
+
+  for (int i = 0; i < times.size(); ++i)
+  {
+    const double t = mapTime (times[i]);
+    if (t < 0)
+    {
+      ++dropped;
+      continue;
+    }
+
+    mappedTimes.add (t);
+    mappedTitles.add (titles[i]);
+  }
+
+  return dropped;
+}
+
+int TakeAligner::mapRegions (const Array<MarkerRegion>& regions, Array<MarkerRegion>& mapped) const
+{
+  int dropped = 0;
+
+  for (auto& region : regions)
+  {
+    const double start = jmax (0.0, mapUnbounded (region.start));
+    const double end = jmin (targetLength, mapUnbounded (region.end));
+
+    if (! (start < end))
+    {
+      ++dropped;
+      continue;
+    }
+
+    mapped.add ({ start, end, region.title });
+  }
+
+  return dropped;
+}
+
+int TakeAligner::runFromCommandLine (const StringArray& args)
+{
+  auto option = [&args] (const String& name) -> String
+  {
+    const int i = args.indexOf (name);
+    return i >= 0 ? args[i + 1] : String();
+  };
+
+  const auto cwd = File::getCurrentWorkingDirectory();
+  const int i = args.indexOf ("--align-markers");
+  const File referenceFile (cwd.getChildFile (args[i + 1].unquoted()));
+  const File targetFile (cwd.getChildFile (args[i + 2].unquoted()));
+
+  if (! referenceFile.existsAsFile() || ! targetFile.existsAsFile())
+  {
+    std::cerr << "usage: EasyAudioMarker --align-markers <reference audio> <target audio> [--no-drift] [--jobs <n>] [--force]" << std::endl;
+    return 1;
+  }
+
+  const File sidecar (targetFile.getFullPathName() + MarkerFilesExt);
+  if (sidecar.existsAsFile() && ! args.contains ("--force"))
+  {
+    std::cerr << sidecar.getFullPathName() << " exists, use --force to replace it" << std::endl;
+    return 1;
+  }
+
+  Array<double> times;
+  StringArray titles;
+  Array<MarkerRegion> regions;
+  if (! SegmentExporter::loadMarkers (referenceFile, times, titles, &regions))
+  {
+    std::cerr << "no markers found for " << referenceFile.getFullPathName() << std::endl;
+    return 1;
+  }
+
+  Options options;
+  options.estimateDrift = ! args.contains ("--no-drift");
+  options.numThreads = option ("--jobs").getIntValue();
+
+  TakeAligner aligner (referenceFile, targetFile, options);
+  String error;
+  const bool ok = aligner.run ([] (double progress)
+                               {
+                                 std::cout << "\r" << roundToInt (progress * 100.0) << "%" << std::flush;
+                                 return true;
+                               }, error);
+  std::cout << std::endl;
+
+  if (! ok)
+  {
+    std::cerr << error << std::endl;
+    return 1;
+  }
+
+  // the findings of a QC pass stay findings
+  Array<SidecarMerge::Marker> typed;
+  SidecarMerge::read (File (referenceFile.getFullPathName() + MarkerFilesExt), typed);
+
+  XmlElement root ("Markers");
+  int numMarkers = 0, dropped = 0;
+  for (int m = 0; m < times.size(); ++m)
+  {
+    const double time = aligner.mapTime (times[m]);
+    if (time < 0)
+    {
+      ++dropped;
+      continue;
+    }
+
+    auto* marker = root.createNewChildElement ("Marker");
+    marker->setAttribute ("Time", time);
+    marker->setAttribute ("Title", titles[m]);
+
+    const String type (SidecarMerge::getType (typed, times[m], titles[m]));
+    if (type.isNotEmpty())
+      marker->setAttribute ("Type", type);
+    ++numMarkers;
+  }
+
+  Array<MarkerRegion> mappedRegions;
+  dropped += aligner.mapRegions (regions, mappedRegions);
+  for (auto& region : mappedRegions)
+  {
+    auto* r = root.createNewChildElement ("Region");
+    r->setAttribute ("Start", region.start);
+    r->setAttribute ("End", region.end);
+    r->setAttribute ("Title", region.title);
+  }
+
+  if (! root.writeToFile (sidecar, {}))
+  {
+    std::cerr << "cannot write " << sidecar.getFullPathName() << std::endl;
+    return 1;
+  }
+  MarkerEditLog::getJournalFile (sidecar).deleteFile();
+
+  std::cout << "offset " << String (aligner.getOffset(), 3) << " s, drift " << String (aligner.getDriftPpm(), 1)
+            << " ppm over " << aligner.getAnchors().size() << " anchors, confidence " << String (aligner.getConfidence(), 2) << std::endl
+            << numMarkers << " markers and " << mappedRegions.size() << " regions written to " << sidecar.getFullPathName();
+  if (dropped > 0)
+    std::cout << ", " << dropped << " outside the target dropped";
+  std::cout << std::endl;
+  return 0;
+}
@@ -0,0 +1,89 @@
+/*
+  ==============================================================================
+
+    TakeAligner.h
+
+    Finds where the audio of a marked reference take sits in another version
+    of it (a re-export, a differently trimmed copy) so its markers can be
+    carried over. Both files are reduced to 1 kHz loudness envelopes on a
+    thread pool; an FFT cross-correlation of the 100 Hz decimated envelopes
+    finds the overall offset, which is then refined to the millisecond.
+    Optionally, windows along the file are correlated on their own to follow
+    clock drift, and markers are mapped piecewise between those anchors.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "RegionIndex.h"
+
+
+class TakeAligner
+{
+public:
+  struct Options
+  {
+    bool    estimateDrift = true;
+    int     numThreads = 0;               // 0 uses one per CPU
+  };
+
+  // The same moment in both files, in seconds.
+  struct Anchor
+  {
+    double  referenceTime, targetTime;
+  };
+
+  TakeAligner (const juce::File& reference, const juce::File& target, const Options& options);
+  ~TakeAligner();
+
+  // Blocks until the alignment is known. The callback gets the fraction done
+  // and may return false to cancel.
+  bool run (std::function<bool (double)> progressCallback, juce::String& error);
+
+  // target time = reference time + offset, at the start of the reference
+  double getOffset() const noexcept               { return offset; }
+  double getDriftPpm() const noexcept             { return driftPpm; }
+  float getConfidence() const noexcept            { return confidence; }
+  const juce::Array<Anchor>& getAnchors() const noexcept { return anchors; }
+
+  // Where a reference time lies in the target; negative when it was trimmed away.
+  double mapTime (double referenceTime) const;
+
+  // Maps the markers that still exist in the target. Returns how many were dropped.
+  int mapMarkers (const juce::Array<double>& times, const juce::StringArray& titles,
+                  juce::Array<double>& mappedTimes, juce::StringArray& mappedTitles) const;
+
+  // Maps the regions that still overlap the target, cut to it. Returns how many were dropped.
+  int mapRegions (const juce::Array<MarkerRegion>& regions, juce::Array<MarkerRegion>& mapped) const;
+
+  // --align-markers <reference audio> <target audio> [--no-drift] [--jobs <n>] [--force]
+  static int runFromCommandLine (const juce::StringArray& args);
+
+private:
+  struct Envelope;
+  class EnvelopeJob;
+  class WindowJob;
+
+  juce::File                      reference, target;
+  Options                         options;
+  juce::AudioFormatManager        formatManager;
+  juce::ScopedPointer<Envelope>   referenceEnvelope, targetEnvelope;
+
+  double                          offset = 0;
+  double                          driftPpm = 0;
+  float                           confidence = 0;
+  double                          targetLength = 0;
+  juce::Array<Anchor>             anchors;
+
+  juce::CriticalSection           anchorLock;
+  juce::Atomic<int>               jobsDone;
+
+  double mapUnbounded (double referenceTime) const;
+  bool findGlobalOffset (juce::String& error);
+  void alignWindow (juce::int64 start);
+  void fitDrift();
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TakeAligner)
+};
@@ -0,0 +1,393 @@
+/*
+  ==============================================================================
+
+    WavCueChunks.cpp
+
+  ==============================================================================
+*/
+
+#include "WavCueChunks.h"
+#include <map>
+
+
+using namespace juce;
+
+
+namespace
+{
+  struct Chunk
+  {
+    uint32  id;
+    int64   offset;     // of the chunk header
+    int64   size;       // of the payload, without the pad byte; from ds64 for RF64 data
+    uint32  listType;
+
+    int64 end() const noexcept  { return offset + 8 + size + (size & 1); }
+  };
+
+  inline uint32 fourCC (const char* s) noexcept     { return ByteOrder::littleEndianInt (s); }
+
+  // A JUNK chunk right after the RIFF header is where a writer turns the file
+  // into RF64 once it passes 4 GB (JUCE does, so do most recorders); it must
+  // stay in place and the size it was given.
+  bool isDs64Placeholder (const Chunk& c)
+  {
+    return c.offset == 12 && (c.id == fourCC ("JUNK") || c.id == fourCC ("junk"));
+  }
+
+  bool isFreeForCues (const Chunk& c)
+  {
+    if (isDs64Placeholder (c))
+      return false;
+
+    return c.id == fourCC ("cue ") || c.id == fourCC ("JUNK") || c.id == fourCC ("junk")
+        || c.id == fourCC ("PAD ") || (c.id == fourCC ("LIST") && c.listType == fourCC ("adtl"));
+  }
+
+  // ds64Offset is set to the ds64 chunk of an RF64 file, or -1 for plain RIFF
+  bool scanChunks (InputStream& in, double& sampleRate, Array<Chunk>& chunks, int64& ds64Offset)
+  {
+    in.setPosition (0);
+    const uint32 riff = (uint32) in.readInt();
+    if (riff != fourCC ("RIFF") && riff != fourCC ("RF64") && riff != fourCC ("BW64"))
+      return false;
+    in.readInt();
+    if ((uint32) in.readInt() != fourCC ("WAVE"))
+      return false;
+
+    const int64 length = in.getTotalLength();
+    int64 rf64DataSize = -1;
+    ds64Offset = -1;
+
+    while (in.getPosition() + 8 <= length)
+    {
+      Chunk c { 0, in.getPosition(), 0, 0 };
+      c.id = (uint32) in.readInt();
+      c.size = (uint32) in.readInt();
+
+      if (c.id == fourCC ("ds64") && riff != fourCC ("RIFF") && c.size >= 16)
+      {
+        ds64Offset = c.offset;
+        in.readInt64();                         // RIFF size
+        rf64DataSize = in.readInt64();
+      }
+      else if (c.id == fourCC ("data") && c.size == 0xffffffffu && rf64DataSize >= 0)
+      {
+        c.size = rf64DataSize;
+      }
+      else if (c.id == fourCC ("fmt ") && c.size >= 8)
+      {
+        in.readShort();
+        in.readShort();
+        sampleRate = (double) (uint32) in.readInt();
+      }
+      else if (c.id == fourCC ("LIST") && c.size >= 4)
+      {
+        c.listType = (uint32) in.readInt();
+      }
+
+      chunks.add (c);
+
+      // a data chunk still being written may declare 0 bytes: everything after it is audio
+      if (c.end() > length || (c.id == fourCC ("data") && c.size == 0))
+        break;
+      in.setPosition (c.end());
+    }
+
+    return sampleRate > 0;
+  }
+
+  void writeCueChunks (MemoryOutputStream& out, const Array<WavCueChunks::CueMarker>& markers, double sampleRate)
+  {
+    out.writeInt ((int) fourCC ("cue "));
+    out.writeInt (4 + 24 * markers.size());
+    out.writeInt (markers.size());
+
+    for (int i = 0; i < markers.size(); ++i)
+    {
+      const uint32 offset = (uint32) jlimit (0.0, (double) 0xffffffffu, markers[i].time * sampleRate);
+      out.writeInt (i + 1);                        // cue point id
+      out.writeInt ((int) offset);                 // play order position
+      out.writeInt ((int) fourCC ("data"));
+      out.writeInt (0);                            // chunk start
+      out.writeInt (0);                            // block start
+      out.writeInt ((int) offset);                 // sample offset
+    }
+
+    MemoryOutputStream adtl;
+    adtl.writeInt ((int) fourCC ("adtl"));
+
+    for (int i = 0; i < markers.size(); ++i)
+    {
+      auto text = markers[i].title.toUTF8();
+      const int textSize = (int) markers[i].title.getNumBytesAsUTF8() + 1;
+
+      adtl.writeInt ((int) fourCC ("labl"));
+      adtl.writeInt (4 + textSize);
+      adtl.writeInt (i + 1);
+      adtl.write (text.getAddress(), (size_t) textSize);
+      if ((textSize & 1) != 0)
+        adtl.writeByte (0);
+    }
+
+    out.writeInt ((int) fourCC ("LIST"));
+    out.writeInt ((int) adtl.getDataSize());
+    out << adtl;
+  }
+}
+
+
+bool WavCueChunks::isWavFile (const File& file)
+{
+  FileInputStream in (file);
+  if (in.failedToOpen())
+    return false;
+
+  double sampleRate = 0;
+  Array<Chunk> chunks;
+  int64 ds64Offset;
+  return scanChunks (in, sampleRate, chunks, ds64Offset);
+}
+
+bool WavCueChunks::getDataLayout (const File& file, DataLayout& layout)
+{
+  FileInputStream in (file);
+  if (in.failedToOpen())
+    return false;
+
+  Array<Chunk> chunks;
+  int64 ds64Offset;
+  if (! scanChunks (in, layout.sampleRate, chunks, ds64Offset))
+    return false;
+
+  bool hasFormat = false, hasData = false;
+
+  for (auto& c : chunks)
+  {
+    if (c.id == fourCC ("fmt ") && c.size >= 16)
+    {
+      in.setPosition (c.offset);
+      in.readIntoMemoryBlock (layout.fmtChunk, (ssize_t) (8 + c.size + (c.size & 1)));
+      in.setPosition (c.offset + 8 + 12);
+      layout.blockAlign = (int) (uint16) in.readShort();
+      hasFormat = true;
+    }
+    else if (c.id == fourCC ("data"))
+    {
+      layout.dataOffset = c.offset + 8;
+      layout.dataSize = jmin (c.size, in.getTotalLength() - layout.dataOffset);
+      layout.declaredDataSize = c.size;
+      hasData = true;
+    }
+  }
+
+  return hasFormat && hasData && layout.blockAlign > 0;
+}
+
+bool WavCueChunks::read (const File& file, Array<CueMarker>& markers)
+{
+  FileInputStream in (file);
+  if (in.failedToOpen())
+    return false;
+
+  double sampleRate = 0;
+  Array<Chunk> chunks;
+  int64 ds64Offset;
+  if (! scanChunks (in, sampleRate, chunks, ds64Offset))
+    return false;
+
+  std::map<uint32, uint32> offsets;
+  std::map<uint32, String> labels;
+
+  for (auto& c : chunks)
+  {
+    if (c.id == fourCC ("cue "))
+    {
+      in.setPosition (c.offset + 8);
+      const int num = jmin (in.readInt(), (int) (c.size / 24));
+
+      for (int i = 0; i < num; ++i)
+      {
+        const uint32 id = (uint32) in.readInt();
+        in.skipNextBytes (16);
+        offsets[id] = (uint32) in.readInt();
+      }
+    }
+    else if (c.id == fourCC ("LIST") && c.listType == fourCC ("adtl"))
+    {
+      int64 pos = c.offset + 12;
+      const int64 end = c.offset + 8 + c.size;
+
+      while (pos + 12 <= end)
+      {
+        in.setPosition (pos);
+        const uint32 subId = (uint32) in.readInt();
+        const uint32 subSize = (uint32) in.readInt();
+
+        if (subSize >= 4 && (subId == fourCC ("labl") || subId == fourCC ("note")))
+        {
+          const uint32 id = (uint32) in.readInt();
+          MemoryBlock text;
+          in.readIntoMemoryBlock (text, (ssize_t) subSize - 4);
+
+          // a note only names a cue that has no label
+          if (subId == fourCC ("labl") || labels.find (id) == labels.end())
+            labels[id] = String::fromUTF8 ((const char*) text.getData(), (int) strnlen ((const char*) text.getData(), text.getSize()));
+        }
+
+        pos += 8 + subSize + (subSize & 1);
+      }
+    }
+  }
+
+  if (offsets.empty())
+    return false;
+
+  for (auto& o : offsets)
+    markers.add ({ o.second / sampleRate, labels[o.first] });
+
+  std::sort (markers.begin(), markers.end(),
+             [] (const CueMarker& a, const CueMarker& b) { return a.time < b.time; });
+  return true;
+}
+
+bool WavCueChunks::write (const File& file, const Array<CueMarker>& markers, String& error)
+{
+  double sampleRate = 0;
+  Array<Chunk> chunks;
+  int64 fileLength, ds64Offset;
+
+  {
+    FileInputStream in (file);
+    if (in.failedToOpen() || ! scanChunks (in, sampleRate, chunks, ds64Offset))
+    {
+      error = "Not a WAV file";
+      return false;
+    }
+    fileLength = in.getTotalLength();
+  }
+
+  int dataIndex = -1;
+  for (int i = 0; i < chunks.size(); ++i)
+    if (chunks[i].id == fourCC ("data"))
+      dataIndex = i;
+
+  if (dataIndex < 0)
+  {
+    error = "No data chunk";
+    return false;
+  }
+
+  MemoryOutputStream payload;
+  // cue positions are 32-bit sample offsets; later markers stay in the sidecar only
+  Array<CueMarker> embeddable;
+  for (auto& m : markers)
+    if (m.time * sampleRate <= (double) 0xffffffffu)
+      embeddable.add (m);
+
+  writeCueChunks (payload, embeddable, sampleRate);
+  const int64 needed = (int64) payload.getDataSize();
+
+  // 1. a run of free chunks (old cue/adtl, JUNK) that is exactly large enough,
+  //    or large enough to leave room for a JUNK header after the new chunks
+  int64 writePos = -1, regionEnd = -1;
+
+  for (int first = 0; first < chunks.size() && writePos < 0; ++first)
+  {
+    if (! isFreeForCues (chunks[first]))
+      continue;
+
+    for (int last = first; last < chunks.size() && isFreeForCues (chunks[last]); ++last)
+    {
+      const int64 span = chunks[last].end() - chunks[first].offset;
+      if (span == needed || span >= needed + 8)
+      {
+        writePos = chunks[first].offset;
+        regionEnd = chunks[last].end();
+        break;
+      }
+    }
+  }
+
+  // 2. otherwise replace the free chunks trailing the audio data, or append
+  bool truncateAfter = false;
+
+  if (writePos < 0)
+  {
+    int firstTrailing = chunks.size();
+    while (firstTrailing > dataIndex + 1 && isFreeForCues (chunks[firstTrailing - 1]))
+      --firstTrailing;
+
+    writePos = firstTrailing < chunks.size() ? chunks[firstTrailing].offset : fileLength + (fileLength & 1);
+    regionEnd = writePos + needed;
+    truncateAfter = true;
+  }
+
+  const int64 newLength = truncateAfter ? writePos + needed : jmax (fileLength, regionEnd);
+  if (ds64Offset < 0 && newLength - 8 > (int64) 0xffffffffu)
+  {
+    error = "File too large for a RIFF header";
+    return false;
+  }
+
+  FileOutputStream out (file);
+  if (out.failedToOpen())
+  {
+    error = out.getStatus().getErrorMessage();
+    return false;
+  }
+
+  // old cue/adtl chunks outside the rewritten region become JUNK
+  for (auto& c : chunks)
+  {
+    const bool isCue = c.id == fourCC ("cue ") || (c.id == fourCC ("LIST") && c.listType == fourCC ("adtl"));
+    if (isCue && (c.offset < writePos || (! truncateAfter && c.offset >= regionEnd)))
+    {
+      out.setPosition (c.offset);
+      out.writeInt ((int) fourCC ("JUNK"));
+    }
+  }
+
+  if (writePos > fileLength)
+  {
+    out.setPosition (fileLength);
+    out.writeByte (0);
+  }
+
+  out.setPosition (writePos);
+  out << payload;
+
+  const int64 filler = regionEnd - writePos - needed;
+  if (! truncateAfter && filler >= 8)
+  {
+    out.writeInt ((int) fourCC ("JUNK"));
+    out.writeInt ((int) (filler - 8));
+    out.writeRepeatedByte (0, (size_t) (filler - 8));
+  }
+
+  if (truncateAfter)
+  {
+    out.flush();
+    out.truncate();
+  }
+
+  if (ds64Offset >= 0)
+  {
+    // RF64 keeps 0xffffffff in the header and the real size in ds64
+    out.setPosition (ds64Offset + 8);
+    out.writeInt64 (newLength - 8);
+  }
+  else
+  {
+    out.setPosition (4);
+    out.writeInt ((int) (uint32) (newLength - 8));
+  }
+  out.flush();
+
+  if (out.getStatus().failed())
+  {
+    error = out.getStatus().getErrorMessage();
+    return false;
+  }
+  return true;
+}
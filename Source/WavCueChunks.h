@@ -0,0 +1,54 @@
+/*
+  ==============================================================================
+
+    WavCueChunks.h
+
+    Reads and writes markers as "cue " + "LIST"/"adtl" chunks of a WAV file
+    in place. Only the metadata chunks and the RIFF size are rewritten, so the
+    cost does not depend on the length of the audio data.
+
+    RF64 files, which JUCE writes once a WAV passes 4 GB, are handled alike:
+    their 64-bit sizes live in the ds64 chunk. Cue positions stay 32-bit, so
+    markers past 2^32 samples (about 24.8 hours at 48 kHz) are not embedded.
+
+    Also exposes where the sample data of a WAV file lives, for tools that
+    copy PCM without decoding it.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+
+namespace WavCueChunks
+{
+  struct CueMarker
+  {
+    double        time;
+    juce::String  title;
+  };
+
+  struct DataLayout
+  {
+    juce::MemoryBlock   fmtChunk;       // complete chunk, header included
+    juce::int64         dataOffset = 0; // first byte of the samples
+    juce::int64         dataSize = 0;       // what the file holds, at most the declared size
+    juce::int64         declaredDataSize = 0;   // 0xffffffff when a RIFF writer left it open
+    int                 blockAlign = 0;
+    double              sampleRate = 0;
+  };
+
+  bool isWavFile (const juce::File& file);
+  bool getDataLayout (const juce::File& file, DataLayout& layout);
+
+  // Returns false if the file has no cue chunk or is not a WAV file.
+  bool read (const juce::File& file, juce::Array<CueMarker>& markers);
+
+  // Replaces any existing cue/adtl chunks. Old chunks that cannot be reused
+  // are turned into JUNK and the new ones are written into free space or
+  // appended at the end of the file. The JUNK chunk reserved for a ds64
+  // header at the start of the file is never used.
+  bool write (const juce::File& file, const juce::Array<CueMarker>& markers, juce::String& error);
+}
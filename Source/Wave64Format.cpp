@@ -0,0 +1,206 @@
+/*
+  ==============================================================================
+
+    Wave64Format.cpp
+
+  ==============================================================================
+*/
+
+#include "Wave64Format.h"
+
+
+using namespace juce;
+
+
+static const char* const wave64FormatName = "Wave64 file";
+static const int readBlockFrames = 4096;
+
+
+namespace
+{
+  // chunk ids are GUIDs; the audio ones are the RIFF fourCC followed by the same 12 bytes
+  const uint8 riffGuid[16] = { 'r', 'i', 'f', 'f', 0x2e, 0x91, 0xcf, 0x11, 0xa5, 0xd6, 0x28, 0xdb, 0x04, 0xc1, 0x00, 0x00 };
+  const uint8 waveGuid[16] = { 'w', 'a', 'v', 'e', 0xf3, 0xac, 0xd3, 0x11, 0x8c, 0xd1, 0x00, 0xc0, 0x4f, 0x8e, 0xdb, 0x8a };
+  const uint8 fmtGuid[16]  = { 'f', 'm', 't', ' ', 0xf3, 0xac, 0xd3, 0x11, 0x8c, 0xd1, 0x00, 0xc0, 0x4f, 0x8e, 0xdb, 0x8a };
+  const uint8 dataGuid[16] = { 'd', 'a', 't', 'a', 0xf3, 0xac, 0xd3, 0x11, 0x8c, 0xd1, 0x00, 0xc0, 0x4f, 0x8e, 0xdb, 0x8a };
+
+  bool readGuid (InputStream& in, const uint8* expected)
+  {
+    uint8 guid[16];
+    return in.read (guid, 16) == 16 && memcmp (guid, expected, 16) == 0;
+  }
+
+  enum
+  {
+    formatPcm = 1,
+    formatFloat = 3,
+    formatExtensible = 0xfffe
+  };
+}
+
+
+class Wave64Reader : public AudioFormatReader
+{
+public:
+  Wave64Reader (InputStream* in) : AudioFormatReader (in, wave64FormatName)
+  {
+    if (! readGuid (*in, riffGuid))
+      return;
+    in->readInt64();
+    if (! readGuid (*in, waveGuid))
+      return;
+
+    const int64 totalLength = in->getTotalLength();
+    bool hasFormat = false;
+
+    // sizes include the 24 byte header, and every chunk starts on an 8 byte boundary
+    for (int64 pos = in->getPosition(); pos + 24 <= totalLength;)
+    {
+      in->setPosition (pos);
+      uint8 guid[16];
+      in->read (guid, 16);
+      const int64 size = in->readInt64();
+
+      if (size < 24)
+        break;
+
+      if (memcmp (guid, fmtGuid, 16) == 0 && size >= 24 + 16)
+      {
+        int format = (uint16) in->readShort();
+        numChannels = (unsigned int) (uint16) in->readShort();
+        sampleRate = (uint32) in->readInt();
+        in->readInt();                                  // bytes per second
+        bytesPerFrame = (uint16) in->readShort();
+        bitsPerSample = (unsigned int) (uint16) in->readShort();
+
+        if (format == formatExtensible && size >= 24 + 40)
+        {
+          in->skipNextBytes (8);                        // extension size, valid bits, channel mask
+          format = (uint16) in->readShort();            // the sub-format GUID starts with the tag
+        }
+
+        usesFloatingPointData = format == formatFloat;
+        hasFormat = (format == formatPcm && bitsPerSample >= 8 && bitsPerSample <= 32 && bitsPerSample % 8 == 0)
+                    || (usesFloatingPointData && bitsPerSample == 32);
+      }
+      else if (memcmp (guid, dataGuid, 16) == 0)
+      {
+        dataOffset = pos + 24;
+
+        // a file cut short, or still being written, holds less than it declares
+        dataLength = jmin (size - 24, totalLength - dataOffset);
+        break;
+      }
+
+      pos += (size + 7) & ~(int64) 7;
+    }
+
+    if (! hasFormat || dataOffset == 0 || numChannels == 0 || sampleRate <= 0
+          || bytesPerFrame != (int) (numChannels * bitsPerSample / 8))
+    {
+      numChannels = 0;
+      return;
+    }
+
+    lengthInSamples = dataLength / bytesPerFrame;
+    block.allocate ((size_t) (readBlockFrames * bytesPerFrame), false);
+  }
+
+  bool isValid() const noexcept     { return numChannels > 0; }
+
+  bool readSamples (int** destSamples, int numDestChannels, int startOffsetInDestBuffer,
+                    int64 startSampleInFile, int numSamples) override
+  {
+    clearSamplesBeyondAvailableLength (destSamples, numDestChannels, startOffsetInDestBuffer,
+                                       startSampleInFile, numSamples, lengthInSamples);
+    if (numSamples <= 0)
+      return true;
+
+    input->setPosition (dataOffset + startSampleInFile * bytesPerFrame);
+
+    while (numSamples > 0)
+    {
+      const int num = jmin (readBlockFrames, numSamples);
+      const int bytes = num * bytesPerFrame;
+      const int bytesRead = input->read (block, bytes);
+
+      if (bytesRead < bytes)
+        zeromem (block + jmax (0, bytesRead), (size_t) (bytes - jmax (0, bytesRead)));
+
+      copySampleData (destSamples, startOffsetInDestBuffer, numDestChannels, num);
+      startOffsetInDestBuffer += num;
+      numSamples -= num;
+    }
+
+    return true;
+  }
+
+private:
+  int64             dataOffset = 0, dataLength = 0;
+  int               bytesPerFrame = 0;
+  HeapBlock<char>   block;
+
+  void copySampleData (int** dest, int destOffset, int numDest, int num) const noexcept
+  {
+    const int numSource = (int) numChannels;
+
+    switch (bitsPerSample)
+    {
+      case 8:   ReadHelper<AudioData::Int32, AudioData::UInt8, AudioData::LittleEndian>::read (dest, destOffset, numDest, block, numSource, num); break;
+      case 16:  ReadHelper<AudioData::Int32, AudioData::Int16, AudioData::LittleEndian>::read (dest, destOffset, numDest, block, numSource, num); break;
+      case 24:  ReadHelper<AudioData::Int32, AudioData::Int24, AudioData::LittleEndian>::read (dest, destOffset, numDest, block, numSource, num); break;
+      case 32:
+        if (usesFloatingPointData)
+          ReadHelper<AudioData::Float32, AudioData::Float32, AudioData::LittleEndian>::read (dest, destOffset, numDest, block, numSource, num);
+        else
+          ReadHelper<AudioData::Int32, AudioData::Int32, AudioData::LittleEndian>::read (dest, destOffset, numDest, block, numSource, num);
+        break;
+      default:  jassertfalse; break;
+    }
+  }
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Wave64Reader)
+};
+
+
+Wave64AudioFormat::Wave64AudioFormat() : AudioFormat (wave64FormatName, ".w64")
+{
+}
+
+Wave64AudioFormat::~Wave64AudioFormat()
+{
+}
+
+void Wave64AudioFormat::registerFormats (AudioFormatManager& manager)
+{
+  manager.registerBasicFormats();
+  manager.registerFormat (new Wave64AudioFormat(), false);
+}
+
+Array<int> Wave64AudioFormat::getPossibleSampleRates()
+{
+  return { 8000, 11025, 16000, 22050, 32000, 44100, 48000, 88200, 96000, 176400, 192000, 352800, 384000 };
+}
+
+Array<int> Wave64AudioFormat::getPossibleBitDepths()
+{
+  return { 8, 16, 24, 32 };
+}
+
+AudioFormatReader* Wave64AudioFormat::createReaderFor (InputStream* sourceStream, bool deleteStreamIfOpeningFails)
+{
+  ScopedPointer<Wave64Reader> reader (new Wave64Reader (sourceStream));
+
+  if (reader->isValid())
+    return reader.release();
+
+  if (! deleteStreamIfOpeningFails)
+    reader->input = nullptr;
+
+  return nullptr;
+}
+
+AudioFormatWriter* Wave64AudioFormat::createWriterFor (OutputStream*, double, unsigned int, int, const StringPairArray&, int)
+{
+  return nullptr;
+}
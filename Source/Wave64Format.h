@@ -0,0 +1,43 @@
+/*
+  ==============================================================================
+
+    Wave64Format.h
+
+    Reads Sony Wave64 (.w64) files, the other common container for WAV data
+    past 4 GB: RIFF with 16 byte GUIDs for chunk ids and 64-bit chunk sizes.
+    PCM of 8 to 32 bits and 32-bit float, plain or extensible. Samples are
+    read from the stream on demand, so opening costs the same at any length.
+    There is no writer; long recordings are written as RF64 by the WAV format.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+
+class Wave64AudioFormat : public juce::AudioFormat
+{
+public:
+  Wave64AudioFormat();
+  ~Wave64AudioFormat();
+
+  // registerBasicFormats() plus this one, for every place that opens audio files
+  static void registerFormats (juce::AudioFormatManager& manager);
+
+  juce::Array<int> getPossibleSampleRates() override;
+  juce::Array<int> getPossibleBitDepths() override;
+  bool canDoStereo() override                       { return true; }
+  bool canDoMono() override                         { return true; }
+
+  juce::AudioFormatReader* createReaderFor (juce::InputStream* sourceStream, bool deleteStreamIfOpeningFails) override;
+
+  // always nullptr
+  juce::AudioFormatWriter* createWriterFor (juce::OutputStream*, double sampleRateToUse, unsigned int numberOfChannels,
+                                            int bitsPerSample, const juce::StringPairArray& metadataValues,
+                                            int qualityOptionIndex) override;
+
+private:
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Wave64AudioFormat)
+};
@@ -0,0 +1,71 @@
+/*
+  ==============================================================================
+
+    FftTests.cpp
+
+    Compares Fft::perform with a direct DFT in double precision, forward
+    and inverse, for every size the denoiser and the aligner may use.
+
+  ==============================================================================
+*/
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "../../Source/Fft.h"
+#include <vector>
+
+
+using namespace juce;
+
+
+class FftTests : public UnitTest
+{
+public:
+  FftTests() : UnitTest ("Fft") {}
+
+  void runTest() override
+  {
+    for (int order = 1; order <= 12; ++order)
+    {
+      beginTest ("Size " + String (1 << order));
+
+      const Fft fft (order);
+      expectEquals (fft.getSize(), 1 << order);
+
+      for (bool inverse : { false, true })
+      {
+        std::vector<Fft::Complex> input ((size_t) fft.getSize());
+        for (auto& c : input)
+          c = Fft::Complex (getRandom().nextFloat() * 2.0f - 1.0f, getRandom().nextFloat() * 2.0f - 1.0f);
+
+        auto output = input;
+        fft.perform (output.data(), inverse);
+
+        // rounding grows with the size; a wrong butterfly is off by the size of the values
+        const double error = getMaxError (input, output, inverse);
+        expect (error <= 1.0e-6 * fft.getSize(),
+                String (inverse ? "inverse" : "forward") + " error " + String (error));
+      }
+    }
+  }
+
+private:
+  static double getMaxError (const std::vector<Fft::Complex>& input, const std::vector<Fft::Complex>& output, bool inverse)
+  {
+    const int size = (int) input.size();
+    const double sign = inverse ? 2.0 : -2.0;
+    double maxError = 0;
+
+    for (int k = 0; k < size; ++k)
+    {
+      std::complex<double> sum;
+      for (int j = 0; j < size; ++j)
+        sum += std::complex<double> (input[(size_t) j]) * std::polar (1.0, sign * double_Pi * ((int64) j * k % size) / size);
+
+      maxError = jmax (maxError, std::abs (sum - std::complex<double> (output[(size_t) k])));
+    }
+
+    return maxError;
+  }
+};
+
+static FftTests fftTests;
@@ -0,0 +1,184 @@
+/*
+  ==============================================================================
+
+    MarkerDensityTests.cpp
+
+    Counts and lists markers in half-open ranges, groups them into clusters
+    at the level a zoom asks for, spreads them over columns, and follows a
+    file that grows past the summarised length.
+
+  ==============================================================================
+*/
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "../../Source/MarkerDensity.h"
+
+
+using namespace juce;
+
+
+class MarkerDensityTests : public UnitTest
+{
+public:
+  MarkerDensityTests() : UnitTest ("MarkerDensity") {}
+
+  void runTest() override
+  {
+    beginTest ("Counts and markers in a range");
+    {
+      MarkerDensity density;
+      density.add (marker (0), 10.2);
+      density.add (marker (1), 0.5);
+      density.add (marker (2), 1.6);
+      density.add (marker (3), 1.5);
+      density.add (marker (4), 63.9);
+
+      expectEquals (density.countInRange ({ 0.0, 64.0 }), 5);
+      expectEquals (density.countInRange ({ 1.5, 10.2 }), 2, "the start is in, the end is not");
+      expectEquals (density.countInRange ({ 2.0, 10.0 }), 0);
+
+      Array<MarkerInfo*> found;
+      density.getMarkersInRange ({ 1.0, 11.0 }, found);
+      expect (found == Array<MarkerInfo*> ({ marker (3), marker (2), marker (0) }), "ordered by time");
+
+      // adding a marker again moves it
+      density.add (marker (0), 30.0);
+      expectEquals (density.countInRange ({ 10.0, 11.0 }), 0);
+      expectEquals (density.countInRange ({ 30.0, 31.0 }), 1);
+
+      density.remove (marker (1));
+      expectEquals (density.countInRange ({ 0.0, 64.0 }), 4);
+
+      density.clear();
+      expectEquals (density.countInRange ({ 0.0, 64.0 }), 0);
+    }
+
+    beginTest ("Clusters");
+    {
+      MarkerDensity density;
+      addMarkers (density, { 0.5, 1.5, 1.6, 10.2 });
+
+      // bins of one second
+      Array<MarkerDensity::Cluster> clusters;
+      density.getClusters ({ 0.0, 64.0 }, 1.0, clusters);
+      expectEquals (clusters.size(), 3);
+      expectCluster (clusters[0], 0.5, 0.5, 1);
+      expectCluster (clusters[1], 1.5, 1.6, 2);
+      expectCluster (clusters[2], 10.2, 10.2, 1);
+
+      // bins of two
+      density.getClusters ({ 0.0, 64.0 }, 1.5, clusters);
+      expectEquals (clusters.size(), 2);
+      expectCluster (clusters[0], 0.5, 1.6, 3);
+      expectCluster (clusters[1], 10.2, 10.2, 1);
+
+      density.getClusters ({ 5.0, 64.0 }, 1.0, clusters);
+      expectEquals (clusters.size(), 1);
+      expectCluster (clusters[0], 10.2, 10.2, 1);
+    }
+
+    beginTest ("Density");
+    {
+      MarkerDensity density;
+      Array<int> counts;
+
+      density.getDensity ({ 0.0, 64.0 }, 8, counts);
+      expect (counts == Array<int> ({ 0, 0, 0, 0, 0, 0, 0, 0 }), "no markers");
+
+      addMarkers (density, { 0.5, 1.5, 1.6, 10.2 });
+
+      // a column per bin of one second
+      density.getDensity ({ 0.0, 64.0 }, 64, counts);
+      expectEquals (counts.size(), 64);
+      expectEquals (counts[0], 1);
+      expectEquals (counts[1], 2);
+      expectEquals (counts[10], 1);
+      expectEquals (sum (counts), 4);
+
+      density.getDensity ({ 0.0, 64.0 }, 0, counts);
+      expect (counts.isEmpty());
+
+      // columns that do not line up with the bins still see every marker once
+      density.clear();
+      auto r = getRandom();
+      Array<double> times;
+      for (int i = 0; i < 1000; ++i)
+        times.add (r.nextDouble() * 50.0);
+      addMarkers (density, times);
+
+      density.getDensity ({ 0.0, 64.0 }, 37, counts);
+      expectEquals (sum (counts), 1000);
+    }
+
+    beginTest ("A growing file");
+    {
+      MarkerDensity density;
+      const int start = density.getRevision();
+
+      density.add (marker (0), 10.0);
+      expect (density.getRevision() != start);
+
+      int revision = density.getRevision();
+      density.remove (marker (1));
+      expectEquals (density.getRevision(), revision, "nothing removed");
+
+      // past the 64 s covered so far
+      density.countInRange ({ 0.0, 1.0 });
+      density.setLength (100.0);
+      expect (density.getRevision() != revision);
+
+      revision = density.getRevision();
+      density.countInRange ({ 0.0, 1.0 });
+      density.setLength (110.0);
+      expectEquals (density.getRevision(), revision, "still inside the 128 s now covered");
+
+      density.add (marker (1), 120.0);
+      expectEquals (density.countInRange ({ 100.0, 128.0 }), 1);
+
+      Array<MarkerDensity::Cluster> clusters;
+      density.getClusters ({ 64.0, 128.0 }, 1.0, clusters);
+      expectEquals (clusters.size(), 1);
+      expectCluster (clusters[0], 120.0, 120.0, 1);
+
+      // markers past the length widen the summary too
+      density.add (marker (2), 300.0);
+      density.getClusters ({ 256.0, 512.0 }, 1.0, clusters);
+      expectEquals (clusters.size(), 1);
+      expectCluster (clusters[0], 300.0, 300.0, 1);
+    }
+  }
+
+private:
+  // The summary only keys on the pointers, so these stand in for the players'
+  // marker components and are never dereferenced.
+  char storage[1024];
+
+  MarkerInfo* marker (int index)
+  {
+    return reinterpret_cast<MarkerInfo*> (storage + index);
+  }
+
+  void addMarkers (MarkerDensity& density, const Array<double>& times)
+  {
+    for (int i = 0; i < times.size(); ++i)
+      density.add (marker (i), times[i]);
+  }
+
+  static int sum (const Array<int>& counts)
+  {
+    int total = 0;
+    for (auto c : counts)
+      total += c;
+    return total;
+  }
+
+  void expectCluster (const MarkerDensity::Cluster& cluster, double first, double last, int count)
+  {
+    const String what ("cluster at " + String (first));
+    expectEquals (cluster.span.getStart(), first, what);
+    expectEquals (cluster.span.getEnd(), last, what);
+    expectEquals (cluster.count, count, what);
+  }
+};
+
+static MarkerDensityTests markerDensityTests;
@@ -0,0 +1,213 @@
+/*
+  ==============================================================================
+
+    MarkerEditLogTests.cpp
+
+    Undoes and redoes whole transactions against a plain marker list, trims
+    the oldest ones once the log is full, and replays a journal written with
+    toJournalLine on top of the markers it was recorded against.
+
+  ==============================================================================
+*/
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "../../Source/MarkerEditLog.h"
+
+
+using namespace juce;
+
+
+class MarkerEditLogTests : public UnitTest
+{
+public:
+  MarkerEditLogTests() : UnitTest ("MarkerEditLog") {}
+
+  void runTest() override
+  {
+    beginTest ("Undo and redo by transaction");
+    {
+      Markers markers;
+      MarkerEditLog log;
+
+      log.beginTransaction();
+      markers.edit (log, add (1.0, "a"));
+      markers.edit (log, add (2.0, "b"));
+      log.beginTransaction();
+      markers.edit (log, retitle (1.0, "a", "c"));
+      expectEquals (markers.describe(), String ("1:c 2:b"));
+
+      expect (log.undo (markers));
+      expectEquals (markers.describe(), String ("1:a 2:b"));
+      expect (log.undo (markers));
+      expectEquals (markers.describe(), String());
+      expect (! log.canUndo());
+      expect (! log.undo (markers));
+
+      expect (log.redo (markers));
+      expectEquals (markers.describe(), String ("1:a 2:b"));
+      expect (log.redo (markers));
+      expectEquals (markers.describe(), String ("1:c 2:b"));
+      expect (! log.canRedo());
+    }
+
+    beginTest ("A new edit drops what could be redone");
+    {
+      Markers markers;
+      MarkerEditLog log;
+
+      log.beginTransaction();
+      markers.edit (log, add (1.0, "a"));
+      log.beginTransaction();
+      markers.edit (log, add (2.0, "b"));
+      log.undo (markers);
+
+      log.beginTransaction();
+      markers.edit (log, add (3.0, "c"));
+      expect (! log.canRedo());
+      expectEquals (markers.describe(), String ("1:a 3:c"));
+
+      log.undo (markers);
+      log.undo (markers);
+      expectEquals (markers.describe(), String());
+      log.redo (markers);
+      log.redo (markers);
+      expectEquals (markers.describe(), String ("1:a 3:c"));
+    }
+
+    beginTest ("The oldest transactions are forgotten when full");
+    {
+      Markers markers;
+      MarkerEditLog log (4);
+
+      for (int i = 0; i < 3; ++i)
+      {
+        log.beginTransaction();
+        markers.edit (log, add (i * 2.0, "x"));
+        markers.edit (log, add (i * 2.0 + 1.0, "y"));
+      }
+
+      // room for two of the three transactions
+      expect (log.undo (markers));
+      expect (log.undo (markers));
+      expect (! log.undo (markers));
+      expectEquals (markers.describe(), String ("0:x 1:y"));
+
+      // one transaction larger than the log is still kept whole
+      MarkerEditLog small (2);
+      Markers others;
+      small.beginTransaction();
+      for (int i = 0; i < 5; ++i)
+        others.edit (small, add (i, "z"));
+      expect (small.undo (others));
+      expectEquals (others.describe(), String());
+    }
+
+    beginTest ("Journal replay");
+    {
+      const File sidecar (File::createTempFile (".xml"));
+      const File journal (MarkerEditLog::getJournalFile (sidecar));
+
+      String lines;
+      lines << MarkerEditLog::toJournalLine (add (3.0, "new"), true)
+            << MarkerEditLog::toJournalLine (add (1.0, "dup"), false)          // undoing an add removes
+            << MarkerEditLog::toJournalLine (retitle (2.0, "b", "renamed"), true)
+            << MarkerEditLog::toJournalLine (retitle (9.0, "missing", "x"), true)
+            << MarkerEditLog::toJournalLine (region (4.0, 5.0, "r"), true)
+            << MarkerEditLog::toJournalLine (retitleRegion (4.0, 5.0, "r", "s"), true)
+            << "not xml\n";
+      expect (journal.replaceWithText (lines));
+
+      Array<double> times { 1.0, 1.0, 2.0 };
+      StringArray titles { "dup", "dup", "b" };
+      Array<MarkerRegion> regions;
+
+      // the line that matches nothing and the garbage are skipped
+      expectEquals (MarkerEditLog::replayJournal (sidecar, times, titles, &regions), 5);
+
+      // of two identical markers one goes, whichever it is
+      expectEquals (times.size(), 3);
+      expectEquals (titles.joinIntoString (","), String ("dup,renamed,new"));
+      expectEquals (times[2], 3.0);
+      expectEquals (regions.size(), 1);
+      expectEquals (regions[0].title, String ("s"));
+
+      // without a region list the region lines are left alone
+      Array<double> moreTimes { 2.0 };
+      StringArray moreTitles { "b" };
+      expectEquals (MarkerEditLog::replayJournal (sidecar, moreTimes, moreTitles), 2);
+      expectEquals (moreTitles.joinIntoString (","), String ("renamed,new"));
+
+      journal.deleteFile();
+      sidecar.deleteFile();
+    }
+  }
+
+private:
+  using Command = MarkerEditLog::Command;
+
+  // A marker list that applies the commands the way WaveMarkerComp does.
+  struct Markers : public MarkerEditLog::Target
+  {
+    Array<double> times;
+    StringArray titles;
+
+    void edit (MarkerEditLog& log, const Command& command)
+    {
+      applyEdit (command, true);
+      log.record (command);
+    }
+
+    void applyEdit (const Command& command, bool forward) override
+    {
+      const int i = times.indexOf (command.time);
+
+      if (command.type == Command::retitleMarker)
+      {
+        titles.set (i, forward ? command.title : command.previousTitle);
+      }
+      else if ((command.type == Command::addMarker) == forward)
+      {
+        int at = 0;
+        while (at < times.size() && times[at] < command.time)
+          ++at;
+        times.insert (at, command.time);
+        titles.insert (at, command.title);
+      }
+      else
+      {
+        times.remove (i);
+        titles.remove (i);
+      }
+    }
+
+    String describe() const
+    {
+      StringArray s;
+      for (int i = 0; i < times.size(); ++i)
+        s.add (String (roundToInt (times[i])) + ":" + titles[i]);
+      return s.joinIntoString (" ");
+    }
+  };
+
+  static Command add (double time, const String& title)
+  {
+    return { Command::addMarker, 0, time, title, {} };
+  }
+
+  static Command retitle (double time, const String& from, const String& to)
+  {
+    return { Command::retitleMarker, 0, time, to, from };
+  }
+
+  static Command region (double start, double end, const String& title)
+  {
+    return { Command::addRegion, 0, start, title, {}, end };
+  }
+
+  static Command retitleRegion (double start, double end, const String& from, const String& to)
+  {
+    return { Command::retitleRegion, 0, start, to, from, end };
+  }
+};
+
+static MarkerEditLogTests markerEditLogTests;
@@ -0,0 +1,159 @@
+/*
+  ==============================================================================
+
+    QcAnalyzerTests.cpp
+
+    Sweeps a sine with known faults planted in it: clipped runs just long
+    enough and just too short, dropouts between signal and silence at either
+    end that is not one, peaks over the limit, runs across block ends, and a
+    DC offset. Findings on several channels and close together must merge.
+
+  ==============================================================================
+*/
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "../../Source/QcAnalyzer.h"
+
+
+using namespace juce;
+
+
+class QcAnalyzerTests : public UnitTest
+{
+public:
+  QcAnalyzerTests() : UnitTest ("QcAnalyzer") {}
+
+  void runTest() override
+  {
+    using Type = QcAnalyzer::IssueType;
+
+    beginTest ("Clipping, dropouts and peaks");
+    {
+      // three blocks of the sweep, the last one short
+      AudioBuffer<float> audio (makeSine (2, 140000, 0.5f, 0.0f));
+
+      set (audio, 0, 0, 200, 0.0f);           // leading silence
+      set (audio, 0, 10000, 5, 1.0f);         // clipped on both channels at once...
+      set (audio, 1, 10001, 5, -1.0f);
+      set (audio, 0, 10100, 4, 1.0f);         // ...and again shortly after
+      set (audio, 0, 20000, 2, 1.0f);         // too short to count as clipping: a peak
+      set (audio, 1, 30000, 100, 0.0f);       // dropout
+      set (audio, 1, 40000, 50, 0.0f);        // too short for one
+      set (audio, 1, 45000, 1, 0.95f);        // over -1 dBFS
+      set (audio, 0, 65534, 4, 1.0f);         // across the first block end
+      set (audio, 1, 131000, 100, 0.0f);      // across the second
+      set (audio, 1, 138000, 2000, 0.0f);     // trailing silence
+
+      QcAnalyzer::FileResult result;
+      expect (analyse (audio, result), result.error);
+
+      expectEquals (result.length, (int64) 140000);
+      expectEquals (result.counts[(int) Type::clipping], 4);
+      expectEquals (result.counts[(int) Type::dropout], 2);
+      expectEquals (result.counts[(int) Type::dcOffset], 0);
+      expectEquals (result.counts[(int) Type::peak], 2);
+      expectEquals (result.channelPeaks[0], 1.0f);
+      expectEquals (result.channelPeaks[1], 1.0f);
+
+      expectEquals (result.issues.size(), 6);
+      if (result.issues.size() == 6)
+      {
+        expectIssue (result.issues[0], Type::clipping, 10000, 104, 3, 2);
+        expectIssue (result.issues[1], Type::clipping, 65534, 4, 1, 1);
+        expectIssue (result.issues[2], Type::dropout, 30000, 100, 2, 1);
+        expectIssue (result.issues[3], Type::dropout, 131000, 100, 2, 1);
+        expectIssue (result.issues[4], Type::peak, 20000, 2, 1, 1);
+        expectIssue (result.issues[5], Type::peak, 45000, 1, 2, 1);
+        expectEquals (result.issues[0].value, 1.0f);
+        expectEquals (result.issues[5].value, 0.95f);
+      }
+    }
+
+    beginTest ("DC offset");
+    {
+      AudioBuffer<float> audio (makeSine (1, 48000, 0.3f, 0.02f));
+
+      QcAnalyzer::FileResult result;
+      expect (analyse (audio, result), result.error);
+
+      expect (std::abs (result.channelDc[0] - 0.02) < 1.0e-4);
+      expectEquals (result.issues.size(), 1);
+      expectIssue (result.issues[0], Type::dcOffset, 0, 48000, 1, 1);
+      expect (std::abs (result.issues[0].value - 0.02f) < 1.0e-4f);
+    }
+
+    beginTest ("Nothing to report");
+    {
+      AudioBuffer<float> audio (makeSine (2, 10000, 0.5f, 0.0f));
+
+      QcAnalyzer::FileResult result;
+      expect (analyse (audio, result), result.error);
+      expect (result.issues.isEmpty());
+    }
+  }
+
+private:
+  static constexpr double sampleRate = 48000.0;
+
+  // An AudioFormatReader over a buffer, with float data as in a float WAV.
+  class MemoryReader : public AudioFormatReader
+  {
+  public:
+    MemoryReader (const AudioBuffer<float>& b) : AudioFormatReader (nullptr, "memory"), audio (b)
+    {
+      sampleRate = QcAnalyzerTests::sampleRate;
+      bitsPerSample = 32;
+      usesFloatingPointData = true;
+      lengthInSamples = audio.getNumSamples();
+      numChannels = (unsigned int) audio.getNumChannels();
+    }
+
+    bool readSamples (int** destSamples, int numDestChannels, int startOffsetInDestBuffer,
+                      int64 startSampleInFile, int numSamples) override
+    {
+      for (int ch = 0; ch < numDestChannels; ++ch)
+        if (destSamples[ch] != nullptr)
+          memcpy (destSamples[ch] + startOffsetInDestBuffer, audio.getReadPointer (ch, (int) startSampleInFile),
+                  sizeof (float) * (size_t) numSamples);
+      return true;
+    }
+
+  private:
+    const AudioBuffer<float>& audio;
+  };
+
+  // Whole periods, so only the offset adds up to any DC.
+  static AudioBuffer<float> makeSine (int numChannels, int numSamples, float level, float offset)
+  {
+    AudioBuffer<float> audio (numChannels, numSamples);
+    for (int ch = 0; ch < numChannels; ++ch)
+      for (int i = 0; i < numSamples; ++i)
+        audio.setSample (ch, i, offset + level * (float) std::sin (2.0 * double_Pi * i / 100.0 + 0.3 + ch));
+    return audio;
+  }
+
+  static void set (AudioBuffer<float>& audio, int channel, int start, int num, float value)
+  {
+    for (int i = start; i < start + num; ++i)
+      audio.setSample (channel, i, value);
+  }
+
+  static bool analyse (const AudioBuffer<float>& audio, QcAnalyzer::FileResult& result)
+  {
+    MemoryReader reader (audio);
+    return QcAnalyzer::analyse (reader, QcAnalyzer::Options(), result);
+  }
+
+  void expectIssue (const QcAnalyzer::Issue& issue, QcAnalyzer::IssueType type,
+                    int64 start, int64 length, uint32 channels, int count)
+  {
+    const String what (QcAnalyzer::getTypeName (type) + " at " + String (start));
+    expect (issue.type == type, what + ": type");
+    expectEquals (issue.start, start, what + ": start");
+    expectEquals (issue.length, length, what + ": length");
+    expectEquals ((int) issue.channels, (int) channels, what + ": channels");
+    expectEquals (issue.count, count, what + ": count");
+  }
+};
+
+static QcAnalyzerTests qcAnalyzerTests;
@@ -0,0 +1,150 @@
+/*
+  ==============================================================================
+
+    RamAudioStoreTests.cpp
+
+    Stores blocks of hard samples and reads them back: every channel must
+    come back bit for bit, whichever coding its block got, a constant, a
+    predictor with escaped residuals, the widest Rice parameter, any 32-bit
+    value or the bits of floats.
+
+  ==============================================================================
+*/
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "../../Source/RamAudioStore.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+
+using namespace juce;
+
+
+class RamAudioStoreTests : public UnitTest
+{
+public:
+  RamAudioStoreTests() : UnitTest ("RamAudioStore") {}
+
+  void runTest() override
+  {
+    beginTest ("Round trip of every coding");
+    {
+      // with a short last block
+      const int64 length = 3 * RamAudioStore::blockSize + 3;
+      std::vector<std::vector<int>> channels ((size_t) numCases, std::vector<int> ((size_t) length));
+      fill (channels);
+
+      RamAudioStore store (numCases, length);
+      checkRoundTrip (store, channels);
+      expect (store.isComplete());
+      expect (store.getCompressedBytes() > 0);
+    }
+
+    beginTest ("The widest Rice parameter");
+    {
+      // Three samples coded with order 1 have residuals whose mean needs all 32 bits
+      // below the quotient; longer blocks never get there, as order 0 stays cheaper.
+      std::vector<std::vector<int>> channels (1, { std::numeric_limits<int>::min(),
+                                                   std::numeric_limits<int>::max(),
+                                                   std::numeric_limits<int>::max() - 2 });
+      RamAudioStore store (1, 3);
+      checkRoundTrip (store, channels);
+    }
+
+    beginTest ("Channels read on their own");
+    {
+      const int64 length = 2 * RamAudioStore::blockSize;
+      std::vector<std::vector<int>> channels ((size_t) numCases, std::vector<int> ((size_t) length));
+      fill (channels);
+
+      RamAudioStore store (numCases, length);
+      append (store, channels);
+
+      std::vector<int> decoded ((size_t) RamAudioStore::blockSize);
+      std::vector<int*> pointers ((size_t) numCases, nullptr);
+
+      for (int ch = 0; ch < numCases; ++ch)
+      {
+        pointers[(size_t) ch] = decoded.data();
+        store.readBlock (1, pointers.data());
+        pointers[(size_t) ch] = nullptr;
+
+        expect (std::equal (decoded.begin(), decoded.end(), channels[(size_t) ch].begin() + RamAudioStore::blockSize),
+                "channel " + String (ch));
+      }
+    }
+  }
+
+private:
+  enum Case
+  {
+    constantValue,      // a constant block
+    spikes,             // small residuals, a few escaped
+    wideSpikes,         // escaped residuals that need more than 32 bits
+    fullRange,          // any 32-bit value
+    floatBits,          // a float sine as AudioFormatReader gives it for float files
+    shifted16Bit,       // 16-bit samples in the top bits of an int
+    numCases
+  };
+
+  void fill (std::vector<std::vector<int>>& channels)
+  {
+    auto r = getRandom();
+    const size_t length = channels[0].size();
+
+    for (size_t i = 0; i < length; ++i)
+    {
+      const double phase = 2.0 * double_Pi * 440.0 * (double) i / 48000.0;
+      const float sample = 0.5f * (float) std::sin (phase);
+
+      channels[constantValue][i] = -123456789;
+      channels[spikes][i] = i % 997 == 5 ? (r.nextBool() ? 1 : -1) * (1 << 30) : r.nextInt (7) - 3;
+      channels[wideSpikes][i] = i % 1499 == 7 ? std::numeric_limits<int>::min() : (int) i * 1000;
+      channels[fullRange][i] = r.nextInt();
+      memcpy (&channels[floatBits][i], &sample, sizeof (int));
+      channels[shifted16Bit][i] = (int) (sample * 32767.0f) * 65536;
+    }
+  }
+
+  static void append (RamAudioStore& store, const std::vector<std::vector<int>>& channels)
+  {
+    std::vector<const int*> pointers (channels.size());
+
+    for (int block = 0; block < store.getNumBlocks(); ++block)
+    {
+      for (size_t ch = 0; ch < channels.size(); ++ch)
+        pointers[ch] = channels[ch].data() + (size_t) block * RamAudioStore::blockSize;
+
+      store.appendBlock (pointers.data());
+    }
+  }
+
+  // Reads the blocks back out of order, as seeks do.
+  void checkRoundTrip (RamAudioStore& store, const std::vector<std::vector<int>>& channels)
+  {
+    append (store, channels);
+    expectEquals (store.getNumBlocksStored(), store.getNumBlocks());
+
+    std::vector<std::vector<int>> decoded (channels.size(), std::vector<int> ((size_t) RamAudioStore::blockSize));
+    std::vector<int*> pointers;
+    for (auto& d : decoded)
+      pointers.push_back (d.data());
+
+    for (int i = store.getNumBlocks(); --i >= 0;)
+    {
+      const int block = (i * 7) % store.getNumBlocks();
+      const size_t start = (size_t) block * RamAudioStore::blockSize;
+      const size_t n = (size_t) store.getBlockLength (block);
+
+      store.readBlock (block, pointers.data());
+
+      for (size_t ch = 0; ch < channels.size(); ++ch)
+        expect (std::equal (decoded[ch].begin(), decoded[ch].begin() + (long) n, channels[ch].begin() + (long) start),
+                "block " + String (block) + ", channel " + String ((int) ch));
+    }
+  }
+};
+
+static RamAudioStoreTests ramAudioStoreTests;
@@ -0,0 +1,208 @@
+/*
+  ==============================================================================
+
+    RegionIndexTests.cpp
+
+    Stabs and range queries on the interval tree: ends are outside their
+    region, regions may share a start, and the overlap results come in the
+    documented order. Random regions on a coarse grid, so that starts and
+    ends coincide often, are checked against a plain search.
+
+  ==============================================================================
+*/
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "../../Source/RegionIndex.h"
+#include <algorithm>
+#include <iterator>
+#include <map>
+
+
+using namespace juce;
+
+
+class RegionIndexTests : public UnitTest
+{
+public:
+  RegionIndexTests() : UnitTest ("RegionIndex") {}
+
+  void runTest() override
+  {
+    beginTest ("Half-open regions");
+    {
+      RegionIndex index;
+      index.add ({ 1.0, 2.0, "a", 1 });
+      index.add ({ 2.0, 3.0, "b", 2 });
+
+      expectEquals (idsAt (index, 0.999), String());
+      expectEquals (idsAt (index, 1.0), String ("1"));
+      expectEquals (idsAt (index, 1.999), String ("1"));
+      expectEquals (idsAt (index, 2.0), String ("2"), "the end belongs to the next region only");
+      expectEquals (idsAt (index, 3.0), String());
+
+      expectEquals (idsOverlapping (index, { 0.0, 1.0 }), String(), "a range ending at a start misses it");
+      expectEquals (idsOverlapping (index, { 2.0, 2.5 }), String ("2"), "a range starting at an end misses it");
+      expectEquals (idsOverlapping (index, { 1.5, 2.5 }), String ("1 2"));
+    }
+
+    beginTest ("Equal starts");
+    {
+      RegionIndex index;
+      index.add ({ 1.0, 2.0, "a", 1 });
+      index.add ({ 1.0, 3.0, "b", 2 });
+      index.add ({ 1.0, 1.5, "c", 3 });
+      index.add ({ 0.0, 1.0, "d", 4 });
+
+      expectEquals (idsAt (index, 1.0), String ("1 2 3"));
+      expectEquals (idsAt (index, 1.5), String ("1 2"));
+      expectEquals (idsAt (index, 2.0), String ("2"));
+      expectEquals (idsOverlapping (index, { 0.5, 1.0 }), String ("4"));
+      expectEquals (idsOverlapping (index, { 0.5, 1.01 }), String ("1 2 3 4"));
+      expectEquals (idsOverlapping (index, { 1.0, 1.01 }), String ("1 2 3"));
+    }
+
+    beginTest ("Order of overlapping regions");
+    {
+      RegionIndex index;
+      index.add ({ 5.0, 6.0, "y", 3 });
+      index.add ({ 0.0, 10.0, "long", 1 });
+      index.add ({ 12.0, 13.0, "z", 4 });
+      index.add ({ 4.0, 4.5, "w", 5 });
+      index.add ({ 2.0, 3.0, "x", 2 });
+
+      // those under the start of the range in any order, then the others by start
+      Array<const MarkerRegion*> results;
+      index.getRegionsOverlapping ({ 2.5, 5.5 }, results);
+      expectEquals (results.size(), 4);
+      if (results.size() == 4)
+      {
+        expectEquals (ids ({ results[0], results[1] }), String ("1 2"));
+        expectEquals (results[2]->title, String ("w"));
+        expectEquals (results[3]->title, String ("y"));
+      }
+
+      index.getAllRegions (results);
+      StringArray titles;
+      for (auto* r : results)
+        titles.add (r->title);
+      expectEquals (titles.joinIntoString (" "), String ("long x w y z"));
+    }
+
+    beginTest ("Removing and renaming");
+    {
+      RegionIndex index;
+      index.add ({ 0.0, 4.0, "a", 1 });
+      index.add ({ 1.0, 2.0, "b", 2 });
+      index.add ({ 3.0, 5.0, "c", 3 });
+      expectEquals (idsAt (index, 1.5), String ("1 2"));
+
+      // the last region takes the removed one's place
+      index.remove (1);
+      index.remove (99);
+      expectEquals (index.size(), 2);
+      expect (index.find (1) == nullptr);
+      expect (index.find (3) != nullptr && index.find (3)->title == "c");
+      expectEquals (idsAt (index, 1.5), String ("2"));
+      expectEquals (idsAt (index, 3.5), String ("3"));
+
+      // no rebuild needed for a title
+      index.setTitle (3, "renamed");
+      Array<const MarkerRegion*> results;
+      index.getRegionsAt (4.5, results);
+      expect (results.size() == 1 && results[0]->title == "renamed");
+
+      index.clear();
+      expectEquals (index.size(), 0);
+      expectEquals (idsAt (index, 1.5), String());
+    }
+
+    beginTest ("Random regions against a plain search");
+    {
+      auto r = getRandom();
+      RegionIndex index;
+      std::map<int64, MarkerRegion> all;
+      int64 nextId = 1;
+
+      for (int round = 0; round < 20; ++round)
+      {
+        for (int i = 0; i < 50; ++i)
+        {
+          const double start = r.nextInt (100) * 0.25;
+          const MarkerRegion region { start, start + (1 + r.nextInt (20)) * 0.25, {}, nextId++ };
+          index.add (region);
+          all[region.id] = region;
+        }
+
+        for (int i = 0; i < 20 && ! all.empty(); ++i)
+        {
+          auto it = all.begin();
+          std::advance (it, r.nextInt ((int) all.size()));
+          index.remove (it->first);
+          all.erase (it);
+        }
+
+        expectEquals (index.size(), (int) all.size());
+
+        for (int i = 0; i < 20; ++i)
+        {
+          // on the grid half the time
+          const double time = r.nextInt (130) * 0.25 - (r.nextBool() ? 0.0 : 0.1);
+          const Range<double> range (time, time + r.nextInt (12) * 0.25 + 0.1);
+
+          StringArray at, overlapping;
+          for (auto& entry : all)
+          {
+            const auto& region = entry.second;
+            if (region.start <= time && time < region.end)
+              at.add (String (region.id));
+            if (region.start < range.getEnd() && region.end > range.getStart())
+              overlapping.add (String (region.id));
+          }
+          sortIds (at);
+          sortIds (overlapping);
+
+          expectEquals (idsAt (index, time), at.joinIntoString (" "), "at " + String (time));
+          expectEquals (idsOverlapping (index, range), overlapping.joinIntoString (" "), "overlapping from " + String (time));
+
+          Array<const MarkerRegion*> results;
+          index.getRegionsOverlapping (range, results);
+          for (int k = 1; k < results.size(); ++k)
+            if (results[k]->start > range.getStart())
+              expect (results[k - 1]->start <= results[k]->start, "by start after the stab");
+        }
+      }
+    }
+  }
+
+private:
+  static void sortIds (StringArray& ids)
+  {
+    std::sort (ids.begin(), ids.end(), [] (const String& a, const String& b) { return a.getLargeIntValue() < b.getLargeIntValue(); });
+  }
+
+  // sorted ids, so the results compare whatever order they came in
+  static String ids (const Array<const MarkerRegion*>& regions)
+  {
+    StringArray s;
+    for (auto* r : regions)
+      s.add (String (r->id));
+    sortIds (s);
+    return s.joinIntoString (" ");
+  }
+
+  static String idsAt (RegionIndex& index, double time)
+  {
+    Array<const MarkerRegion*> results;
+    index.getRegionsAt (time, results);
+    return ids (results);
+  }
+
+  static String idsOverlapping (RegionIndex& index, Range<double> range)
+  {
+    Array<const MarkerRegion*> results;
+    index.getRegionsOverlapping (range, results);
+    return ids (results);
+  }
+};
+
+static RegionIndexTests regionIndexTests;
@@ -0,0 +1,259 @@
+/*
+  ==============================================================================
+
+    RemoteAudioStreamTests.cpp
+
+    Reads files from a small range-request server on the loopback: the
+    bytes must match, every chunk must be fetched once however many readers
+    ask for it, a new version must empty the chunks but keep the markers,
+    and the caches must stay under their size limit.
+
+  ==============================================================================
+*/
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "../../Source/RemoteAudioStream.h"
+
+
+using namespace juce;
+
+
+// Serves one block of bytes at every path, one request at a time, and records
+// the ranges asked for.
+class RangeServer : private Thread
+{
+public:
+  RangeServer (const MemoryBlock& d) : Thread ("range server"), data (d)
+  {
+    listener.createListener (0, "127.0.0.1");
+    startThread();
+  }
+
+  ~RangeServer()
+  {
+    signalThreadShouldExit();
+    listener.close();
+    stopThread (5000);
+  }
+
+  URL getURL (const String& path) const
+  {
+    return URL ("http://127.0.0.1:" + String (listener.getBoundPort()) + "/" + path);
+  }
+
+  void setETag (const String& newTag)
+  {
+    const ScopedLock sl (lock);
+    etag = newTag;
+  }
+
+  // The number of requests for a range starting at this offset, the probes aside.
+  int getNumRequests (int64 start) const
+  {
+    const ScopedLock sl (lock);
+    return starts.countNumberOfOccurrences (start);
+  }
+
+  int getNumRequests() const
+  {
+    const ScopedLock sl (lock);
+    return starts.size();
+  }
+
+private:
+  const MemoryBlock data;
+  StreamingSocket listener;
+  CriticalSection lock;
+  String etag { "\"1\"" };
+  Array<int64> starts;
+
+  void run() override
+  {
+    while (! threadShouldExit())
+    {
+      ScopedPointer<StreamingSocket> client (listener.waitForNextConnection());
+      if (client != nullptr)
+        serve (*client);
+    }
+  }
+
+  void serve (StreamingSocket& client)
+  {
+    String request;
+    char buffer[1024];
+
+    while (! request.contains ("\r\n\r\n") && request.length() < 16384
+             && client.waitUntilReady (true, 5000) == 1)
+    {
+      const int num = client.read (buffer, sizeof (buffer), false);
+      if (num <= 0)
+        return;
+      request += String (CharPointer_UTF8 (buffer), (size_t) num);
+    }
+
+    const String range (request.fromFirstOccurrenceOf ("bytes=", false, true).upToFirstOccurrenceOf ("\r\n", false, false));
+    const int64 start = range.upToFirstOccurrenceOf ("-", false, false).getLargeIntValue();
+    const int64 end = jmin ((int64) data.getSize() - 1, range.fromFirstOccurrenceOf ("-", false, false).getLargeIntValue());
+
+    String header;
+    {
+      const ScopedLock sl (lock);
+      if (end > start)
+        starts.add (start);
+
+      header << "HTTP/1.1 206 Partial Content\r\n"
+             << "Content-Range: bytes " << start << "-" << end << "/" << (int64) data.getSize() << "\r\n"
+             << "Content-Length: " << (end - start + 1) << "\r\n"
+             << "ETag: " << etag << "\r\n"
+             << "Connection: close\r\n\r\n";
+    }
+
+    client.write (header.toRawUTF8(), (int) header.getNumBytesAsUTF8());
+    client.write (addBytesToPointer (data.getData(), start), (int) (end - start + 1));
+  }
+};
+
+
+class RemoteAudioStreamTests : public UnitTest
+{
+public:
+  RemoteAudioStreamTests() : UnitTest ("RemoteAudioStream") {}
+
+  void runTest() override
+  {
+    const File root (File::createTempFile ("remote"));
+    RemoteChunkCache::setCacheLocation (root.getChildFile ("RemoteCache"), (int64) 1 << 30);
+
+    MemoryBlock data;
+    for (int i = 0; i < RemoteChunkCache::chunkSize * numChunks / 4; ++i)
+      data.append (&i, 4);
+    data.setSize (data.getSize() - 1000);
+
+    RangeServer server (data);
+
+    beginTest ("Reads match the file, each chunk is fetched once");
+    {
+      String error;
+      auto cache = RemoteChunkCache::open (server.getURL ("a.wav"), error);
+      expect (cache != nullptr, error);
+      if (cache == nullptr)
+        return;
+
+      expectEquals (cache->getTotalLength(), (int64) data.getSize());
+      expect (readAll (cache) == data);
+      expect (readAll (cache) == data);
+
+      for (int i = 0; i < numChunks; ++i)
+        expectEquals (server.getNumRequests ((int64) i * RemoteChunkCache::chunkSize), 1);
+    }
+
+    beginTest ("Concurrent readers fetch a chunk once");
+    {
+      String error;
+      auto cache = RemoteChunkCache::open (server.getURL ("b.wav"), error);
+      expect (cache != nullptr, error);
+      if (cache == nullptr)
+        return;
+
+      const int before = server.getNumRequests();
+
+      OwnedArray<ReaderThread> readers;
+      for (int i = 0; i < 4; ++i)
+        readers.add (new ReaderThread (cache));
+      for (auto* r : readers)
+        r->startThread();
+      for (auto* r : readers)
+      {
+        r->waitForThreadToExit (-1);
+        expect (r->result == data);
+      }
+
+      expectEquals (server.getNumRequests() - before, numChunks);
+    }
+
+    beginTest ("A new version empties the chunks and keeps the markers");
+    {
+      String error;
+      auto cache = RemoteChunkCache::open (server.getURL ("a.wav"), error);
+      const File folder (cache->getFolder());
+      const File markers (cache->getMarkersFolder().getChildFile (folder.getFileName() + ".easymarkers"));
+      markers.getParentDirectory().createDirectory();
+      expect (markers.replaceWithText ("<Markers/>"));
+      cache = nullptr;
+
+      // pushes a.wav out of the open caches, so the next open probes it again
+      server.setETag ("\"2\"");
+      for (int i = 0; i < 4; ++i)
+        RemoteChunkCache::open (server.getURL ("other" + String (i)), error);
+
+      expectEquals (countChunks (folder), numChunks);
+      cache = RemoteChunkCache::open (server.getURL ("a.wav"), error);
+      expect (cache != nullptr, error);
+      expectEquals (countChunks (folder), 0);
+      expect (markers.existsAsFile());
+
+      const int before = server.getNumRequests();
+      expect (readAll (cache) == data);
+      expectEquals (server.getNumRequests() - before, numChunks);
+    }
+
+    beginTest ("The caches stay under their size limit");
+    {
+      const int64 limit = (int64) RemoteChunkCache::chunkSize * 3;
+      RemoteChunkCache::setCacheLocation (root.getChildFile ("RemoteCache"), limit);
+
+      String error;
+      auto cache = RemoteChunkCache::open (server.getURL ("c.wav"), error);
+      expect (cache != nullptr, error);
+      if (cache == nullptr)
+        return;
+
+      expect (readAll (cache) == data);
+
+      Array<File> chunks;
+      RemoteChunkCache::getCacheRoot().findChildFiles (chunks, File::findFiles, true, "*.chunk");
+      int64 bytes = 0;
+      for (auto& f : chunks)
+        bytes += f.getSize();
+      expect (bytes <= limit, "cached " + String (bytes) + " bytes");
+
+      // evicted chunks are fetched again
+      expect (readAll (cache) == data);
+    }
+
+    root.deleteRecursively();
+  }
+
+private:
+  static constexpr int numChunks = 6;
+
+  struct ReaderThread : public Thread
+  {
+    ReaderThread (RemoteChunkCache::Ptr c) : Thread ("reader"), cache (c) {}
+
+    void run() override
+    {
+      RemoteInputStream in (cache);
+      in.readIntoMemoryBlock (result);
+    }
+
+    RemoteChunkCache::Ptr cache;
+    MemoryBlock result;
+  };
+
+  static MemoryBlock readAll (RemoteChunkCache::Ptr cache)
+  {
+    RemoteInputStream in (cache);
+    MemoryBlock result;
+    in.readIntoMemoryBlock (result);
+    return result;
+  }
+
+  static int countChunks (const File& folder)
+  {
+    Array<File> chunks;
+    return folder.findChildFiles (chunks, File::findFiles, false, "*.chunk");
+  }
+};
+
+static RemoteAudioStreamTests remoteAudioStreamTests;
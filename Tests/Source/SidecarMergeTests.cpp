@@ -0,0 +1,245 @@
+/*
+  ==============================================================================
+
+    SidecarMergeTests.cpp
+
+    Diffs marker and region lists the way a sidecar changed by another
+    program is merged: retitles, additions and removals grouped by time, with
+    markers removed and added at the same time paired up as retitles. Random
+    lists check that the changes always turn the one list into the other.
+
+  ==============================================================================
+*/
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "../../Source/SidecarMerge.h"
+
+
+using namespace juce;
+
+
+class SidecarMergeTests : public UnitTest
+{
+public:
+  SidecarMergeTests() : UnitTest ("SidecarMerge") {}
+
+  void runTest() override
+  {
+    using Change = SidecarMerge::Change;
+
+    beginTest ("Retitles, additions and removals");
+    {
+      const auto base = markers ({ { 1.0, "a" }, { 2.0, "b" }, { 3.0, "c" } });
+      const auto theirs = markers ({ { 1.0, "a" }, { 2.0, "B" }, { 4.0, "d" } });
+
+      Array<Change> changes;
+      SidecarMerge::diff (base, theirs, changes);
+      expectEquals (describe (changes), String ("2.0 b>B, 3.0 -c, 4.0 +d"));
+      expectApplies (base, theirs);
+
+      SidecarMerge::diff (base, base, changes);
+      expect (changes.isEmpty());
+
+      SidecarMerge::diff ({}, base, changes);
+      expectEquals (describe (changes), String ("1.0 +a, 2.0 +b, 3.0 +c"));
+
+      SidecarMerge::diff (base, {}, changes);
+      expectEquals (describe (changes), String ("1.0 -a, 2.0 -b, 3.0 -c"));
+    }
+
+    beginTest ("Markers at the same time");
+    {
+      Array<Change> changes;
+
+      // a title on both sides stays; of the rest, removed and added pair up in title order
+      SidecarMerge::diff (markers ({ { 5.0, "x" }, { 5.0, "y" }, { 5.0, "z" } }),
+                          markers ({ { 5.0, "q" }, { 5.0, "y" } }), changes);
+      expectEquals (describe (changes), String ("5.0 x>q, 5.0 -z"));
+
+      SidecarMerge::diff (markers ({ { 5.0, "x" } }),
+                          markers ({ { 5.0, "p" }, { 5.0, "q" } }), changes);
+      expectEquals (describe (changes), String ("5.0 x>p, 5.0 +q"));
+
+      // one of two identical markers goes
+      SidecarMerge::diff (markers ({ { 5.0, "d" }, { 5.0, "d" } }),
+                          markers ({ { 5.0, "d" } }), changes);
+      expectEquals (describe (changes), String ("5.0 -d"));
+
+      // a marker that moved is not a retitle
+      SidecarMerge::diff (markers ({ { 5.0, "x" } }),
+                          markers ({ { 6.0, "x" } }), changes);
+      expectEquals (describe (changes), String ("5.0 -x, 6.0 +x"));
+
+      // rounding in the file is not a change
+      SidecarMerge::diff (markers ({ { 5.0, "x" } }),
+                          markers ({ { 5.0 + 1.0e-12, "x" } }), changes);
+      expect (changes.isEmpty());
+    }
+
+    beginTest ("Random marker lists");
+    {
+      auto r = getRandom();
+
+      for (int n = 0; n < 200; ++n)
+      {
+        // few times and titles, so groups and duplicates are common
+        Array<SidecarMerge::Marker> base, theirs;
+        for (auto* list : { &base, &theirs })
+        {
+          for (int i = r.nextInt (8); --i >= 0;)
+            list->add ({ r.nextInt (5) * 0.5, String::charToString ((juce_wchar) ('a' + r.nextInt (3))), {} });
+          SidecarMerge::sort (*list);
+        }
+
+        expectApplies (base, theirs);
+      }
+    }
+
+    beginTest ("Regions");
+    {
+      using RegionChange = SidecarMerge::RegionChange;
+
+      const auto base = regions ({ { 0.0, 1.0, "r" }, { 2.0, 3.0, "s" }, { 2.0, 3.0, "t" } });
+      const auto theirs = regions ({ { 0.0, 1.0, "r" }, { 2.0, 3.0, "t" }, { 2.0, 4.0, "s" }, { 5.0, 6.0, "u" } });
+
+      // any change is a removal and an addition, the removals first
+      Array<RegionChange> changes;
+      SidecarMerge::diff (base, theirs, changes);
+      expectEquals (changes.size(), 3);
+      if (changes.size() == 3)
+      {
+        expect (changes[0].type == RegionChange::remove && isSame (changes[0].region, { 2.0, 3.0, "s" }));
+        expect (changes[1].type == RegionChange::add && isSame (changes[1].region, { 2.0, 4.0, "s" }));
+        expect (changes[2].type == RegionChange::add && isSame (changes[2].region, { 5.0, 6.0, "u" }));
+      }
+
+      SidecarMerge::diff (theirs, theirs, changes);
+      expect (changes.isEmpty());
+
+      SidecarMerge::diff (base, regions ({ { 0.0, 1.0 + 1.0e-12, "r" }, { 2.0, 3.0, "s" }, { 2.0, 3.0, "t" } }), changes);
+      expect (changes.isEmpty(), "rounding in the file is not a change");
+    }
+
+    beginTest ("Reading a sidecar");
+    {
+      const File sidecar (File::createTempFile (".xml"));
+
+      Array<SidecarMerge::Marker> read;
+      Array<SidecarMerge::Region> readRegions;
+      expect (! SidecarMerge::read (sidecar, read, &readRegions));
+      const auto missing = SidecarMerge::getStamp (sidecar);
+      expect (! SidecarMerge::mayHaveChanged (sidecar, missing));
+
+      expect (sidecar.replaceWithText ("<Markers>"
+                                       "<Marker Time=\"2\" Title=\"b\"/>"
+                                       "<Region Start=\"3\" End=\"4\" Title=\"s\"/>"
+                                       "<Marker Time=\"1\" Title=\"QC clipping\" Type=\"clipping\"/>"
+                                       "<Region Start=\"0\" End=\"5\" Title=\"r\"/>"
+                                       "<Marker Time=\"1\" Title=\"a\"/>"
+                                       "</Markers>"));
+      expect (SidecarMerge::mayHaveChanged (sidecar, missing));
+
+      expect (SidecarMerge::read (sidecar, read, &readRegions));
+      expectEquals (describe (read), String ("1.0 QC clipping, 1.0 a, 2.0 b"));
+      expectEquals (readRegions.size(), 2);
+      expectEquals (readRegions[0].title, String ("r"));
+      expectEquals (SidecarMerge::getType (read, 1.0, "QC clipping"), String ("clipping"));
+      expectEquals (SidecarMerge::getType (read, 1.0, "a"), String());
+
+      // too soon after the write to tell
+      expect (SidecarMerge::mayHaveChanged (sidecar, SidecarMerge::getStamp (sidecar)));
+
+      expect (sidecar.replaceWithText ("<Markers><Marker"));
+      expect (! SidecarMerge::read (sidecar, read));
+      expect (read.isEmpty());
+
+      sidecar.deleteFile();
+    }
+  }
+
+private:
+  static Array<SidecarMerge::Marker> markers (const std::initializer_list<SidecarMerge::Marker>& list)
+  {
+    Array<SidecarMerge::Marker> result;
+    for (auto& m : list)
+      result.add (m);
+    SidecarMerge::sort (result);
+    return result;
+  }
+
+  static Array<SidecarMerge::Region> regions (const std::initializer_list<SidecarMerge::Region>& list)
+  {
+    Array<SidecarMerge::Region> result;
+    for (auto& r : list)
+      result.add (r);
+    SidecarMerge::sort (result);
+    return result;
+  }
+
+  static String describe (const Array<SidecarMerge::Change>& changes)
+  {
+    StringArray s;
+    for (auto& c : changes)
+      s.add (String (c.time, 1) + " " + (c.type == SidecarMerge::Change::add    ? "+" + c.title
+                                    : c.type == SidecarMerge::Change::remove ? "-" + c.title
+                                                                             : c.previousTitle + ">" + c.title));
+    return s.joinIntoString (", ");
+  }
+
+  static String describe (const Array<SidecarMerge::Marker>& markers)
+  {
+    StringArray s;
+    for (auto& m : markers)
+      s.add (String (m.time, 1) + " " + m.title);
+    return s.joinIntoString (", ");
+  }
+
+  static bool isSame (const SidecarMerge::Region& a, const SidecarMerge::Region& b)
+  {
+    return a.start == b.start && a.end == b.end && a.title == b.title;
+  }
+
+  static int find (const Array<SidecarMerge::Marker>& list, double time, const String& title)
+  {
+    for (int i = 0; i < list.size(); ++i)
+      if (std::abs (list[i].time - time) <= SidecarMerge::timeTolerance && list[i].title == title)
+        return i;
+    return -1;
+  }
+
+  // Applies the diff to base as the player does, and expects theirs.
+  void expectApplies (const Array<SidecarMerge::Marker>& base, const Array<SidecarMerge::Marker>& theirs)
+  {
+    Array<SidecarMerge::Change> changes;
+    SidecarMerge::diff (base, theirs, changes);
+    const String what (describe (base) + " to " + describe (theirs) + ": " + describe (changes));
+
+    Array<SidecarMerge::Marker> merged (base);
+    for (int i = 0; i < changes.size(); ++i)
+    {
+      const auto& c = changes.getReference (i);
+      expect (i == 0 || changes[i - 1].time <= c.time, what + ": not in time order");
+
+      if (c.type == SidecarMerge::Change::add)
+      {
+        merged.add ({ c.time, c.title, {} });
+        continue;
+      }
+
+      const int found = find (merged, c.time, c.type == SidecarMerge::Change::remove ? c.title : c.previousTitle);
+      expect (found >= 0, what + ": nothing to change at " + String (c.time));
+      if (found < 0)
+        return;
+
+      if (c.type == SidecarMerge::Change::remove)
+        merged.remove (found);
+      else
+        merged.getReference (found).title = c.title;
+    }
+
+    SidecarMerge::sort (merged);
+    expectEquals (describe (merged), describe (theirs), what);
+  }
+};
+
+static SidecarMergeTests sidecarMergeTests;
@@ -0,0 +1,138 @@
+/*
+  ==============================================================================
+
+    TakeAlignerTests.cpp
+
+    Cuts two takes out of one performance of noise bursts, the second one
+    quieter and starting earlier or later, and checks the aligner finds the
+    offset to the millisecond and maps markers and regions into the target.
+
+  ==============================================================================
+*/
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "../../Source/TakeAligner.h"
+
+
+using namespace juce;
+
+
+class TakeAlignerTests : public UnitTest
+{
+public:
+  TakeAlignerTests() : UnitTest ("TakeAligner") {}
+
+  void runTest() override
+  {
+    const File reference (File::createTempFile (".wav"));
+    const File target (File::createTempFile (".wav"));
+
+    TakeAligner::Options options;
+    options.estimateDrift = false;
+
+    const AudioBuffer<float> performance (makePerformance (50.0));
+
+    beginTest ("A target that starts earlier");
+    {
+      // the target starts 2.75 s before the reference, so everything in it comes later
+      expect (writeTake (reference, performance, 5.0, 40.0, 1.0f));
+      expect (writeTake (target, performance, 2.25, 40.0, 0.5f));
+
+      TakeAligner aligner (reference, target, options);
+      String error;
+      expect (aligner.run (nullptr, error), error);
+      expectNear (aligner.getOffset(), 2.75, "offset");
+      expect (aligner.getConfidence() > 0.5f);
+
+      Array<double> mappedTimes;
+      StringArray mappedTitles;
+      expectEquals (aligner.mapMarkers ({ 1.0, 20.0, 39.0 }, { "a", "b", "past the end" }, mappedTimes, mappedTitles), 1);
+      expectEquals (mappedTitles.joinIntoString (","), String ("a,b"));
+      expectNear (mappedTimes[0], 3.75, "a");
+      expectNear (mappedTimes[1], 22.75, "b");
+    }
+
+    beginTest ("A target that starts later");
+    {
+      expect (writeTake (target, performance, 7.5, 30.0, 0.5f));
+
+      TakeAligner aligner (reference, target, options);
+      String error;
+      expect (aligner.run (nullptr, error), error);
+      expectNear (aligner.getOffset(), -2.5, "offset");
+      expectEquals (aligner.mapTime (1.0), -1.0, "trimmed away");
+      expectNear (aligner.mapTime (10.0), 7.5, "time in both");
+
+      // regions are cut to the target, and dropped when nothing is left
+      Array<MarkerRegion> regions, mapped;
+      regions.add ({ 1.0, 4.0, "cut" });
+      regions.add ({ 0.5, 2.0, "gone" });
+      expectEquals (aligner.mapRegions (regions, mapped), 1);
+      expectEquals (mapped.size(), 1);
+      expectEquals (mapped[0].title, String ("cut"));
+      expectEquals (mapped[0].start, 0.0);
+      expectNear (mapped[0].end, 1.5, "end of the cut region");
+    }
+
+    beginTest ("Files too short to align");
+    {
+      expect (writeTake (target, performance, 5.0, 0.05, 1.0f));
+
+      TakeAligner aligner (reference, target, options);
+      String error;
+      expect (! aligner.run (nullptr, error));
+      expectEquals (error, String ("The files are too short to align"));
+    }
+
+    reference.deleteFile();
+    target.deleteFile();
+  }
+
+private:
+  static constexpr double sampleRate = 8000.0;
+
+  // the envelopes run at 1 kHz, so the offsets must come out within a frame
+  void expectNear (double actual, double expected, const String& what)
+  {
+    expect (std::abs (actual - expected) <= 0.001, what + ": " + String (actual) + " instead of " + String (expected));
+  }
+
+  // Noise in bursts of random length and level, with the odd pause.
+  AudioBuffer<float> makePerformance (double seconds)
+  {
+    auto r = getRandom();
+    AudioBuffer<float> buffer (1, (int) (seconds * sampleRate));
+    float gain = 0;
+
+    for (int i = 0, next = 0; i < buffer.getNumSamples(); ++i)
+    {
+      if (i == next)
+      {
+        next += (int) ((0.02 + 0.2 * r.nextDouble()) * sampleRate);
+        gain = r.nextInt (8) == 0 ? 0.0f : std::pow (10.0f, -2.0f * r.nextFloat());
+      }
+
+      buffer.setSample (0, i, gain * (r.nextFloat() * 2.0f - 1.0f));
+    }
+
+    return buffer;
+  }
+
+  bool writeTake (const File& file, const AudioBuffer<float>& performance, double start, double length, float gain)
+  {
+    file.deleteFile();
+    WavAudioFormat format;
+    ScopedPointer<AudioFormatWriter> writer (format.createWriterFor (new FileOutputStream (file), sampleRate,
+                                                                     1, 16, {}, 0));
+    if (writer == nullptr)
+      return false;
+
+    AudioBuffer<float> take (1, (int) (length * sampleRate));
+    take.copyFrom (0, 0, performance, 0, (int) (start * sampleRate), take.getNumSamples());
+    take.applyGain (gain);
+
+    return writer->writeFromAudioSampleBuffer (take, 0, take.getNumSamples());
+  }
+};
+
+static TakeAlignerTests takeAlignerTests;
@@ -0,0 +1,46 @@
+/*
+  ==============================================================================
+
+    TestMain.cpp
+
+    Unit tests for EasyAudioMarker: round trips and comparisons with a
+    reference for the code whose output can be checked exactly. Each test
+    is a juce::UnitTest in its own file and registers itself.
+
+    EasyAudioMarkerTests [--seed <n>]
+
+    Exit code is 1 when a test fails.
+
+  ==============================================================================
+*/
+
+#include "../JuceLibraryCode/JuceHeader.h"
+
+
+using namespace juce;
+
+
+int main (int argc, char* argv[])
+{
+  ScopedJuceInitialiser_GUI juceInit;
+
+  StringArray args;
+  for (int i = 1; i < argc; ++i)
+    args.add (argv[i]);
+
+  const int seedIndex = args.indexOf ("--seed");
+  const int64 seed = seedIndex >= 0 ? args[seedIndex + 1].getLargeIntValue() : Random::getSystemRandom().nextInt64();
+
+  UnitTestRunner runner;
+  runner.setAssertOnFailure (false);
+  runner.runAllTests (seed);
+
+  int failures = 0;
+  for (int i = 0; i < runner.getNumResults(); ++i)
+    failures += runner.getResult (i)->failures;
+
+  if (failures > 0)
+    std::cout << failures << " failures, rerun with --seed " << seed << std::endl;
+
+  return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,199 @@
+/*
+  ==============================================================================
+
+    WavCueChunksTests.cpp
+
+    Writes cues into WAV and RF64 files and reads them back: the markers
+    must survive unchanged, and the audio, the ds64 placeholder and the
+    header sizes must stay consistent whether the cues fit in place or not.
+
+  ==============================================================================
+*/
+
+#include "../JuceLibraryCode/JuceHeader.h"
+#include "../../Source/WavCueChunks.h"
+
+
+using namespace juce;
+
+
+class WavCueChunksTests : public UnitTest
+{
+public:
+  WavCueChunksTests() : UnitTest ("WavCueChunks") {}
+
+  void runTest() override
+  {
+    const File wav (File::createTempFile (".wav"));
+    const File rf64 (File::createTempFile (".wav"));
+
+    beginTest ("Round trip in a file written by JUCE");
+    {
+      expect (writeWav (wav));
+      const MemoryBlock before (load (wav));
+
+      checkRoundTrip (wav, makeMarkers (5));
+      checkRoundTrip (wav, makeMarkers (200));   // no longer fits: appended
+      checkRoundTrip (wav, makeMarkers (3));     // fits into the old chunks again
+      checkRoundTrip (wav, {});
+
+      const MemoryBlock after (load (wav));
+      WavCueChunks::DataLayout layout;
+      expect (WavCueChunks::getDataLayout (wav, layout));
+      expect (sameBytes (before, after, 8, layout.dataOffset + layout.dataSize),
+              "the ds64 placeholder, the format and the audio must not change");
+    }
+
+    beginTest ("Round trip in RF64");
+    {
+      expect (writeRf64 (rf64));
+      WavCueChunks::DataLayout before;
+      expect (WavCueChunks::getDataLayout (rf64, before));
+
+      checkRoundTrip (rf64, makeMarkers (7));
+      checkRoundTrip (rf64, makeMarkers (50));
+
+      WavCueChunks::DataLayout after;
+      expect (WavCueChunks::getDataLayout (rf64, after));
+      expectEquals (after.dataOffset, before.dataOffset);
+      expectEquals (after.dataSize, before.dataSize);
+
+      FileInputStream in (rf64);
+      in.setPosition (4);
+      expectEquals ((uint32) in.readInt(), 0xffffffffu, "RF64 keeps its 32-bit size open");
+      in.setPosition (20);
+      expectEquals (in.readInt64(), rf64.getSize() - 8, "the ds64 RIFF size follows the file");
+    }
+
+    beginTest ("Markers past 2^32 samples stay out of the file");
+    {
+      Array<WavCueChunks::CueMarker> markers;
+      markers.add ({ 1.0, "early" });
+      markers.add ({ 100000.0, "past the cue range" });
+
+      String error;
+      expect (WavCueChunks::write (wav, markers, error), error);
+
+      Array<WavCueChunks::CueMarker> read;
+      expect (WavCueChunks::read (wav, read));
+      expectEquals (read.size(), 1);
+      expectEquals (read[0].title, String ("early"));
+    }
+
+    wav.deleteFile();
+    rf64.deleteFile();
+  }
+
+private:
+  static constexpr double sampleRate = 48000.0;
+
+  // Distinct times, titles of odd and even length and some non-ASCII.
+  Array<WavCueChunks::CueMarker> makeMarkers (int num)
+  {
+    Array<WavCueChunks::CueMarker> markers;
+    for (int i = 0; i < num; ++i)
+    {
+      String title ("Marker " + String (i));
+      if (i % 3 == 1)
+        title << CharPointer_UTF8 (" \xc3\xa9t\xc3\xa9");
+      if (i % 4 == 2)
+        title << "!";
+      markers.add ({ (i * 4800 + getRandom().nextInt (4800)) / sampleRate, title });
+    }
+
+    std::sort (markers.begin(), markers.end(),
+               [] (const WavCueChunks::CueMarker& a, const WavCueChunks::CueMarker& b) { return a.time < b.time; });
+    return markers;
+  }
+
+  void checkRoundTrip (const File& file, const Array<WavCueChunks::CueMarker>& markers)
+  {
+    String error;
+    expect (WavCueChunks::write (file, markers, error), error);
+
+    Array<WavCueChunks::CueMarker> read;
+    const bool hasCues = WavCueChunks::read (file, read);
+    expect (hasCues == ! markers.isEmpty());
+    expectEquals (read.size(), markers.size());
+
+    for (int i = 0; i < jmin (read.size(), markers.size()); ++i)
+    {
+      expect (std::abs (read[i].time - markers[i].time) <= 1.0 / sampleRate, "time of " + markers[i].title);
+      expectEquals (read[i].title, markers[i].title);
+    }
+
+    FileInputStream in (file);
+    in.setPosition (0);
+    const bool isRf64 = (uint32) in.readInt() == ByteOrder::littleEndianInt ("RF64");
+    if (! isRf64)
+      expectEquals ((int64) (uint32) in.readInt(), file.getSize() - 8, "RIFF size");
+
+    expect (WavCueChunks::isWavFile (file));
+  }
+
+  // Eight seconds of noise as JUCE writes it, with its JUNK chunk reserved for ds64.
+  bool writeWav (const File& file)
+  {
+    file.deleteFile();
+    WavAudioFormat format;
+    ScopedPointer<AudioFormatWriter> writer (format.createWriterFor (new FileOutputStream (file), sampleRate,
+                                                                     2, 16, {}, 0));
+    if (writer == nullptr)
+      return false;
+
+    AudioBuffer<float> buffer (2, (int) sampleRate * 8);
+    for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+      for (int i = 0; i < buffer.getNumSamples(); ++i)
+        buffer.setSample (ch, i, getRandom().nextFloat() * 2.0f - 1.0f);
+
+    return writer->writeFromAudioSampleBuffer (buffer, 0, buffer.getNumSamples());
+  }
+
+  // A small RF64 file: JUCE only writes one past 4 GB.
+  bool writeRf64 (const File& file)
+  {
+    const int64 numFrames = (int64) sampleRate;
+    const int64 dataSize = numFrames * 4;
+    const int64 riffSize = 4 + (8 + 28) + (8 + 16) + (8 + dataSize);
+
+    MemoryOutputStream out;
+    out.write ("RF64", 4);
+    out.writeInt (-1);
+    out.write ("WAVE", 4);
+    out.write ("ds64", 4);
+    out.writeInt (28);
+    out.writeInt64 (riffSize);
+    out.writeInt64 (dataSize);
+    out.writeInt64 (numFrames);
+    out.writeInt (0);
+    out.write ("fmt ", 4);
+    out.writeInt (16);
+    out.writeShort (1);
+    out.writeShort (2);
+    out.writeInt ((int) sampleRate);
+    out.writeInt ((int) sampleRate * 4);
+    out.writeShort (4);
+    out.writeShort (16);
+    out.write ("data", 4);
+    out.writeInt (-1);
+    for (int64 i = 0; i < numFrames * 2; ++i)
+      out.writeShort ((short) getRandom().nextInt (65536));
+
+    return file.replaceWithData (out.getData(), out.getDataSize());
+  }
+
+  static MemoryBlock load (const File& file)
+  {
+    MemoryBlock data;
+    file.loadFileAsData (data);
+    return data;
+  }
+
+  static bool sameBytes (const MemoryBlock& a, const MemoryBlock& b, int64 start, int64 end)
+  {
+    return (int64) a.getSize() >= end && (int64) b.getSize() >= end
+        && memcmp (addBytesToPointer (a.getData(), start), addBytesToPointer (b.getData(), start), (size_t) (end - start)) == 0;
+  }
+};
+
+static WavCueChunksTests wavCueChunksTests;